@@ -0,0 +1,240 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of batched BSDF functions against calling the 
+ * scalar ones for each direction, for full and partial batches.
+ * usage: bench_bsdf_batch [num_batches]
+ * \file bench_bsdf_batch.c
+ */
+
+#include <eiAPI/ei_bsdf_batch.h>
+#include <eiCORE/ei_simd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+/* the number of distinct batches cycled through */
+#define BENCH_NUM_DIRS		1024
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static eiDirBatch	g_Wo[ BENCH_NUM_DIRS ];
+static eiDirBatch	g_Wi[ BENCH_NUM_DIRS ];
+/* accumulate results so that nothing is optimized out */
+static volatile eiScalar	g_Sink;
+
+static void bench_init_dirs()
+{
+	eiUint	seed;
+	eiInt	k, i;
+
+	seed = 12345;
+
+	for (k = 0; k < BENCH_NUM_DIRS; ++k)
+	{
+		for (i = 0; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			eiScalar	u[4];
+			eiScalar	r;
+			eiInt		j;
+
+			for (j = 0; j < 4; ++j)
+			{
+				seed = seed * 1664525U + 1013904223U;
+				u[j] = (eiScalar)(seed >> 8) / (eiScalar)(1 << 24);
+			}
+
+			/* both directions in the upper hemisphere */
+			r = sqrtf(1.0f - u[0] * u[0]);
+			g_Wo[k].x[i] = r * cosf(6.2831853f * u[1]);
+			g_Wo[k].y[i] = r * sinf(6.2831853f * u[1]);
+			g_Wo[k].z[i] = u[0];
+			r = sqrtf(1.0f - u[2] * u[2]);
+			g_Wi[k].x[i] = r * cosf(6.2831853f * u[3]);
+			g_Wi[k].y[i] = r * sinf(6.2831853f * u[3]);
+			g_Wi[k].z[i] = u[2];
+		}
+	}
+}
+
+static eiVector bench_get_dir(const eiDirBatch *w, const eiInt i)
+{
+	eiVector	v;
+
+	v.x = w->x[i];
+	v.y = w->y[i];
+	v.z = w->z[i];
+
+	return v;
+}
+
+/** \brief Time scalar and batched functions over num_batches 
+ * batches of n directions, prints nanoseconds per direction. */
+static void bench_size(const eiInt num_batches, const eiInt n)
+{
+	eiScalar	result[ EI_BSDF_BATCH_SIZE ];
+	eiDirBatch	wi;
+	eiUint64	t[8];
+	eiScalar	sum;
+	eiInt		k, i;
+	eiGeoScalar	scale;
+
+	sum = 0.0f;
+
+	/* Blinn evaluation */
+	t[0] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		const eiDirBatch	*wo = &g_Wo[ k % BENCH_NUM_DIRS ];
+		const eiDirBatch	*wd = &g_Wi[ k % BENCH_NUM_DIRS ];
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, f;
+
+			o = bench_get_dir(wo, i);
+			d = bench_get_dir(wd, i);
+			ei_blinn_bsdf(&f, &o, &d, 20.0f);
+			sum += f.x;
+		}
+	}
+	t[1] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		ei_blinn_bsdf_batch(result, &g_Wo[ k % BENCH_NUM_DIRS ], &g_Wi[ k % BENCH_NUM_DIRS ], 20.0f, n);
+		sum += result[0];
+	}
+
+	/* Blinn pdf */
+	t[2] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		const eiDirBatch	*wo = &g_Wo[ k % BENCH_NUM_DIRS ];
+		const eiDirBatch	*wd = &g_Wi[ k % BENCH_NUM_DIRS ];
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d;
+
+			o = bench_get_dir(wo, i);
+			d = bench_get_dir(wd, i);
+			sum += ei_blinn_pdf(&o, &d, 20.0f);
+		}
+	}
+	t[3] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		ei_blinn_pdf_batch(result, &g_Wo[ k % BENCH_NUM_DIRS ], &g_Wi[ k % BENCH_NUM_DIRS ], 20.0f, n);
+		sum += result[0];
+	}
+
+	/* Ward evaluation */
+	t[4] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		const eiDirBatch	*wo = &g_Wo[ k % BENCH_NUM_DIRS ];
+		const eiDirBatch	*wd = &g_Wi[ k % BENCH_NUM_DIRS ];
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, f;
+
+			o = bench_get_dir(wo, i);
+			d = bench_get_dir(wd, i);
+			ei_ward_bsdf(&f, &o, &d, 4.0f, 60.0f);
+			sum += f.x;
+		}
+	}
+	t[5] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		ei_ward_bsdf_batch(result, &g_Wo[ k % BENCH_NUM_DIRS ], &g_Wi[ k % BENCH_NUM_DIRS ], 4.0f, 60.0f, n);
+		sum += result[0];
+	}
+
+	/* specular transmission sampling */
+	t[6] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		const eiDirBatch	*wo = &g_Wo[ k % BENCH_NUM_DIRS ];
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d;
+
+			o = bench_get_dir(wo, i);
+			if (ei_speculartransmission_sample_bsdf(&o, &d, 1.0f, 1.5f))
+			{
+				sum += d.z;
+			}
+		}
+	}
+	t[7] = bench_time_ms();
+	for (k = 0; k < num_batches; ++k)
+	{
+		if (ei_speculartransmission_sample_bsdf_batch(&g_Wo[ k % BENCH_NUM_DIRS ], &wi, 1.0f, 1.5f, n) & 1U)
+		{
+			sum += wi.z[0];
+		}
+	}
+	g_Sink = sum;
+
+	scale = 1.0e6 / ((eiGeoScalar)num_batches * (eiGeoScalar)n);
+
+	printf("n = %d, ns per direction, scalar / batch\n", n);
+	printf("  blinn eval:     %8.2f / %8.2f\n", (t[1] - t[0]) * scale, (t[2] - t[1]) * scale);
+	printf("  blinn pdf:      %8.2f / %8.2f\n", (t[3] - t[2]) * scale, (t[4] - t[3]) * scale);
+	printf("  ward eval:      %8.2f / %8.2f\n", (t[5] - t[4]) * scale, (t[6] - t[5]) * scale);
+	printf("  transmission:   %8.2f / %8.2f\n", (t[7] - t[6]) * scale, (bench_time_ms() - t[7]) * scale);
+}
+
+int main(int argc, char *argv[])
+{
+	eiInt	num_batches;
+
+	num_batches = 4000000;
+
+	if (argc > 1)
+	{
+		num_batches = MAX(1, atoi(argv[1]));
+	}
+
+	bench_init_dirs();
+
+	printf("SIMD width: %d\n", EI_VF_WIDTH);
+
+	/* full batches and partial batches with tails */
+	bench_size(num_batches, EI_BSDF_BATCH_SIZE);
+	bench_size(num_batches, 7);
+	bench_size(num_batches, 5);
+	bench_size(num_batches, 3);
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of the time segments of moving hairs intersected
+ * as packets, renders a field of short hairs which move fast, each in
+ * its own direction, with different numbers of time segments. the
+ * time includes building the packets and their hierarchies.
+ * usage: bench_hair_motion [num_frames]
+ * \file bench_hair_motion.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_WIDTH			160
+#define BENCH_HEIGHT		120
+#define BENCH_COLUMNS		200
+#define BENCH_ROWS			150
+#define BENCH_DEGREE		3
+#define BENCH_NUM_VERTICES	(BENCH_DEGREE + 1)
+#define BENCH_RADIUS		0.02f
+/* how far hairs move during the shutter interval */
+#define BENCH_MOTION		1.5f
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static eiScalar bench_random()
+{
+	return 2.0f * (eiScalar)rand() / (eiScalar)RAND_MAX - 1.0f;
+}
+
+/** \brief Add the vertices of all hairs to the current table, at the
+ * shutter close each hair has moved along its direction. */
+static void bench_add_hair_vertices(const eiBool moved)
+{
+	eiInt	col, row, i;
+
+	srand(1234);
+
+	for (row = 0; row < BENCH_ROWS; ++row)
+	{
+		for (col = 0; col < BENCH_COLUMNS; ++col)
+		{
+			eiScalar	x0 = -20.0f + 40.0f * ((eiScalar)col + 0.5f) / (eiScalar)BENCH_COLUMNS;
+			eiScalar	y0 = -15.0f + 30.0f * ((eiScalar)row + 0.5f) / (eiScalar)BENCH_ROWS;
+			eiScalar	dx = bench_random();
+			eiScalar	dy = bench_random();
+			eiScalar	dz = bench_random();
+			eiScalar	k = moved ? BENCH_MOTION : 0.0f;
+
+			for (i = 0; i < BENCH_NUM_VERTICES; ++i)
+			{
+				eiScalar	s = (eiScalar)i / (eiScalar)(BENCH_NUM_VERTICES - 1);
+
+				ei_tab_add_vector4(
+					x0 + 0.1f * s + k * dx,
+					y0 + 0.4f * s - 0.1f * s * s + k * dy,
+					-30.0f + 0.1f * s + k * dz,
+					BENCH_RADIUS);
+			}
+		}
+	}
+}
+
+static void bench_add_hair_object(const eiInt motion_segments)
+{
+	eiInt	i;
+
+	ei_object("hair1", "hair");
+		ei_degree(BENCH_DEGREE);
+		ei_hair_intersect_mode(EI_HAIR_INTERSECT_PACKET);
+		ei_hair_motion_segments(motion_segments);
+
+		ei_vertex_list(ei_tab(EI_DATA_TYPE_VECTOR4, BENCH_COLUMNS * BENCH_ROWS * BENCH_NUM_VERTICES));
+		bench_add_hair_vertices(eiFALSE);
+		ei_end_tab();
+
+		ei_motion_vertex_list(ei_tab(EI_DATA_TYPE_VECTOR4, BENCH_COLUMNS * BENCH_ROWS * BENCH_NUM_VERTICES));
+		bench_add_hair_vertices(eiTRUE);
+		ei_end_tab();
+
+		ei_hair_list(ei_tab(EI_DATA_TYPE_INDEX, BENCH_COLUMNS * BENCH_ROWS * 2));
+		for (i = 0; i < BENCH_COLUMNS * BENCH_ROWS; ++i)
+		{
+			ei_tab_add_index(i * BENCH_NUM_VERTICES);
+			ei_tab_add_index(1);
+		}
+		ei_end_tab();
+	ei_end_object();
+}
+
+/** \brief Render frames and returns the wall clock time in
+ * milliseconds, scene loading is not timed. */
+static eiUint64 bench_render(const eiInt num_frames, const eiInt motion_segments)
+{
+	eiTestImage		image;
+	eiUint64		elapsed;
+	eiInt			i;
+
+	elapsed = 0;
+
+	for (i = 0; i < num_frames; ++i)
+	{
+		eiUint64	start;
+
+		ei_test_image_init(&image, "color", BENCH_WIDTH, BENCH_HEIGHT);
+		ei_test_load_scene("hair.ess");
+
+		ei_options("opt");
+			ei_samples(0, 2);
+			ei_shutter(0.0f, 1.0f);
+			ei_motion(eiTRUE);
+		ei_end_options();
+
+		ei_camera("cam1");
+			ei_resolution(BENCH_WIDTH, BENCH_HEIGHT);
+		ei_end_camera();
+
+		bench_add_hair_object(motion_segments);
+
+		ei_instance("hairinst");
+			ei_element("hair1");
+			ei_add_material("mtl");
+		ei_end_instance();
+
+		ei_instgroup("world");
+			ei_add_instance("caminst1");
+			ei_add_instance("hairinst");
+		ei_end_instgroup();
+
+		start = bench_time_ms();
+		ei_test_render(&image);
+		elapsed += bench_time_ms() - start;
+
+		ei_test_unload_scene();
+		ei_test_image_exit(&image);
+	}
+
+	return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+	const eiInt		segments[] = { 1, 2, 4, 8, 16 };
+	eiInt			num_frames;
+	eiInt			i;
+
+	num_frames = 4;
+
+	if (argc > 1)
+	{
+		num_frames = MAX(1, atoi(argv[1]));
+	}
+
+	/* warm up loading shader modules */
+	bench_render(1, 1);
+
+	printf("frames: %d, %dx%d, %d moving hairs\n",
+		num_frames, BENCH_WIDTH, BENCH_HEIGHT, BENCH_COLUMNS * BENCH_ROWS);
+
+	for (i = 0; i < (eiInt)(sizeof(segments) / sizeof(segments[0])); ++i)
+	{
+		printf("%2d time segments: %llu ms\n",
+			segments[i], (unsigned long long)bench_render(num_frames, segments[i]));
+	}
+
+	return 0;
+}
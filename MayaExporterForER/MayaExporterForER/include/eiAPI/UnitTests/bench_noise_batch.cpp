@@ -0,0 +1,215 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of batched noise against the scalar noise
+ * functions, reports millions of points per second for 1D to 4D
+ * noise and 5 octaves of turbulence.
+ * usage: bench_noise_batch [num_points] [num_rounds]
+ * \file bench_noise_batch.cpp
+ */
+
+#include <eiAPI/ei_shaderx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_OCTAVES		5
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static float	*g_U;
+static float	*g_V;
+static float	*g_W;
+static point	*g_P;
+static float	*g_Result;
+/* accumulated to keep the results alive */
+static float	g_Sum = 0.0f;
+
+static void bench_report(const char *name, const eiUint64 scalar_time, const eiUint64 batch_time,
+	const int num_points, const int num_rounds)
+{
+	double	num_mpts = (double)num_points * (double)num_rounds / 1.0e6;
+
+	printf("%-12s scalar %8.2f Mpts/s, batch %8.2f Mpts/s\n",
+		name,
+		num_mpts * 1000.0 / (double)MAX(scalar_time, 1),
+		num_mpts * 1000.0 / (double)MAX(batch_time, 1));
+}
+
+static void bench_sum(const int num_points)
+{
+	for (int i = 0; i < num_points; ++i)
+	{
+		g_Sum += g_Result[i];
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int			num_points;
+	int			num_rounds;
+	eiUint64	start_time;
+	eiUint64	scalar_time;
+	eiUint64	batch_time;
+	int			i, r;
+
+	num_points = (argc > 1) ? atoi(argv[1]) : 65536;
+	num_rounds = (argc > 2) ? atoi(argv[2]) : 50;
+	num_points = MAX(1, num_points);
+	num_rounds = MAX(1, num_rounds);
+
+	g_U = (float *)malloc(sizeof(float) * num_points);
+	g_V = (float *)malloc(sizeof(float) * num_points);
+	g_W = (float *)malloc(sizeof(float) * num_points);
+	g_P = new point[ num_points ];
+	g_Result = (float *)malloc(sizeof(float) * num_points);
+
+	srand(1234);
+
+	for (i = 0; i < num_points; ++i)
+	{
+		g_U[i] = 200.0f * (float)rand() / (float)RAND_MAX - 100.0f;
+		g_V[i] = 200.0f * (float)rand() / (float)RAND_MAX - 100.0f;
+		g_W[i] = 200.0f * (float)rand() / (float)RAND_MAX - 100.0f;
+		g_P[i] = point(g_U[i], g_V[i], g_W[i]);
+	}
+
+	printf("SIMD width %d, %d points, %d rounds\n", EI_VF_WIDTH, num_points, num_rounds);
+
+	/* 1D */
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			g_Result[i] = noise(g_U[i]);
+		}
+		bench_sum(num_points);
+	}
+	scalar_time = bench_time_ms() - start_time;
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		noise_batch(g_U, g_Result, num_points);
+		bench_sum(num_points);
+	}
+	batch_time = bench_time_ms() - start_time;
+	bench_report("noise 1D", scalar_time, batch_time, num_points, num_rounds);
+
+	/* 2D */
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			g_Result[i] = noise(g_U[i], g_V[i]);
+		}
+		bench_sum(num_points);
+	}
+	scalar_time = bench_time_ms() - start_time;
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		noise_batch(g_U, g_V, g_Result, num_points);
+		bench_sum(num_points);
+	}
+	batch_time = bench_time_ms() - start_time;
+	bench_report("noise 2D", scalar_time, batch_time, num_points, num_rounds);
+
+	/* 3D */
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			g_Result[i] = noise(g_P[i]);
+		}
+		bench_sum(num_points);
+	}
+	scalar_time = bench_time_ms() - start_time;
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		noise_batch(g_P, g_Result, num_points);
+		bench_sum(num_points);
+	}
+	batch_time = bench_time_ms() - start_time;
+	bench_report("noise 3D", scalar_time, batch_time, num_points, num_rounds);
+
+	/* 4D */
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			g_Result[i] = noise(g_P[i], g_W[i]);
+		}
+		bench_sum(num_points);
+	}
+	scalar_time = bench_time_ms() - start_time;
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		noise_batch(g_P, g_W, g_Result, num_points);
+		bench_sum(num_points);
+	}
+	batch_time = bench_time_ms() - start_time;
+	bench_report("noise 4D", scalar_time, batch_time, num_points, num_rounds);
+
+	/* turbulence, with fewer rounds as each point costs 5 octaves */
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; r += BENCH_OCTAVES)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			g_Result[i] = turbulence(g_P[i], BENCH_OCTAVES);
+		}
+		bench_sum(num_points);
+	}
+	scalar_time = bench_time_ms() - start_time;
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; r += BENCH_OCTAVES)
+	{
+		turbulence_batch(g_P, g_Result, num_points, BENCH_OCTAVES);
+		bench_sum(num_points);
+	}
+	batch_time = bench_time_ms() - start_time;
+	bench_report("turbulence", scalar_time, batch_time, num_points,
+		(num_rounds + BENCH_OCTAVES - 1) / BENCH_OCTAVES);
+
+	printf("checksum %f\n", g_Sum);
+
+	free(g_Result);
+	delete [] g_P;
+	free(g_W);
+	free(g_V);
+	free(g_U);
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of binding primitive variables to shader 
+ * parameters, compares looking up by name for every evaluation 
+ * with interpolating through pre-resolved handles.
+ * usage: bench_prim_var [num_frames]
+ * \file bench_prim_var.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#include <eiAPI/ei_shadesys.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_WIDTH			160
+#define BENCH_HEIGHT		120
+#define BENCH_NUM_FACES		12
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static void bench_override_face_colors(const char *obj_name)
+{
+	eiTag	tab;
+	eiInt	i;
+
+	tab = ei_tab(EI_DATA_TYPE_VECTOR, BENCH_NUM_FACES);
+	for (i = 0; i < BENCH_NUM_FACES; ++i)
+	{
+		ei_tab_add_vector(0.5f, (eiScalar)i / (eiScalar)BENCH_NUM_FACES, 0.5f);
+	}
+	ei_end_tab();
+
+	ei_object(obj_name, "poly");
+		ei_declare("Cs", eiUNIFORM, EI_DATA_TYPE_TAG, &tab);
+	ei_end_object();
+}
+
+/** \brief Render frames and returns the wall clock time in 
+ * milliseconds, scene loading is not timed. */
+static eiUint64 bench_render(const eiInt num_frames, const eiBool folding)
+{
+	eiTestImage		image;
+	eiUint64		elapsed;
+	eiInt			i;
+
+	elapsed = 0;
+
+	for (i = 0; i < num_frames; ++i)
+	{
+		eiUint64	start;
+
+		ei_test_image_init(&image, "color", BENCH_WIDTH, BENCH_HEIGHT);
+		ei_test_load_scene("param_folding.ess");
+		bench_override_face_colors("obj1");
+		bench_override_face_colors("obj2");
+
+		ei_shader_param_folding(folding);
+		start = bench_time_ms();
+		ei_test_render(&image);
+		elapsed += bench_time_ms() - start;
+		ei_shader_param_folding(eiTRUE);
+
+		ei_test_unload_scene();
+		ei_test_image_exit(&image);
+	}
+
+	return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+	eiInt		num_frames;
+	eiUint64	by_name;
+	eiUint64	by_handle;
+
+	num_frames = 8;
+
+	if (argc > 1)
+	{
+		num_frames = MAX(1, atoi(argv[1]));
+	}
+
+	/* warm up loading shader modules */
+	bench_render(1, eiTRUE);
+
+	by_name = bench_render(num_frames, eiFALSE);
+	by_handle = bench_render(num_frames, eiTRUE);
+
+	printf("frames: %d, %dx%d\n", num_frames, BENCH_WIDTH, BENCH_HEIGHT);
+	printf("lookup by name:   %llu ms\n", (unsigned long long)by_name);
+	printf("resolved handles: %llu ms\n", (unsigned long long)by_handle);
+
+	return 0;
+}
@@ -0,0 +1,525 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of reconstructing a bucket with many output
+ * variables, the samples flattened into structure-of-arrays and
+ * filtered channel by channel, against the linked lists of samples
+ * which are copied, scaled and added output by output for each
+ * sample, as contribute did before. the time of the new path
+ * includes flattening the samples.
+ * usage: bench_recon_samples [num_frames]
+ * \file bench_recon_samples.c
+ */
+
+#include <eiAPI/ei.h>
+#include <eiAPI/ei_sampler.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+/* the pixels of a bucket, and one pixel of margin on each side
+   for the filter footprint */
+#define BENCH_BUCKET_SIZE	32
+#define BENCH_NUM_PIXELS	(BENCH_BUCKET_SIZE + 2 + 1)
+#define BENCH_NUM_SUBPIXELS	4
+#define BENCH_SPP			(BENCH_NUM_SUBPIXELS * BENCH_NUM_SUBPIXELS)
+#define BENCH_FILTER_SIZE	2.0f
+#define BENCH_NUM_AOVS		10
+
+/* the types of output variables besides color and opacity */
+static const eiInt g_AovTypes[ BENCH_NUM_AOVS ] = {
+	EI_DATA_TYPE_VECTOR,
+	EI_DATA_TYPE_SCALAR,
+	EI_DATA_TYPE_VECTOR,
+	EI_DATA_TYPE_INT,
+	EI_DATA_TYPE_SCALAR,
+	EI_DATA_TYPE_VECTOR,
+	EI_DATA_TYPE_SCALAR,
+	EI_DATA_TYPE_VECTOR,
+	EI_DATA_TYPE_INT,
+	EI_DATA_TYPE_SCALAR,
+};
+
+/** \brief A sample as stored before, followed by the outputs. */
+typedef struct BenchSample {
+	struct BenchSample	*next;
+	eiInt				x;
+	eiInt				y;
+	eiScalar			weight;
+	eiVector			color;
+	eiVector			opacity;
+} BenchSample;
+
+static eiUint		g_AovOffsets[ BENCH_NUM_AOVS ];
+static eiUint		g_SampleSize;
+static eiInt		g_NumChannels;
+static eiByte		*g_Samples;
+static BenchSample	*g_Pixels[ BENCH_NUM_PIXELS * BENCH_NUM_PIXELS ];
+static eiUint		g_Seed = 12345;
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static eiScalar bench_random()
+{
+	g_Seed = g_Seed * 1664525U + 1013904223U;
+
+	return (eiScalar)(g_Seed >> 8) / (eiScalar)(1 << 24);
+}
+
+static eiByte *bench_aov(BenchSample *s, const eiInt i)
+{
+	return (eiByte *)s + g_AovOffsets[i];
+}
+
+/** \brief Create a sample at each sub-pixel of all pixels, with
+ * random outputs, linked into a list for each pixel. */
+static void bench_init_samples()
+{
+	eiInt	px, py, k, i;
+	eiByte	*p;
+
+	g_SampleSize = sizeof(BenchSample);
+	g_NumChannels = 6;
+
+	for (i = 0; i < BENCH_NUM_AOVS; ++i)
+	{
+		g_AovOffsets[i] = g_SampleSize;
+
+		switch (g_AovTypes[i])
+		{
+		case EI_DATA_TYPE_INT:
+			g_SampleSize += sizeof(eiInt);
+			g_NumChannels += 1;
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			g_SampleSize += sizeof(eiScalar);
+			g_NumChannels += 1;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			g_SampleSize += sizeof(eiVector);
+			g_NumChannels += 3;
+			break;
+		}
+	}
+
+	g_SampleSize = (g_SampleSize + 7) & ~7U;
+	g_Samples = (eiByte *)malloc(g_SampleSize * BENCH_SPP * BENCH_NUM_PIXELS * BENCH_NUM_PIXELS);
+	p = g_Samples;
+
+	for (py = 0; py < BENCH_NUM_PIXELS; ++py)
+	{
+		for (px = 0; px < BENCH_NUM_PIXELS; ++px)
+		{
+			BenchSample	**list = &g_Pixels[ px + py * BENCH_NUM_PIXELS ];
+
+			*list = NULL;
+
+			for (k = 0; k < BENCH_SPP; ++k)
+			{
+				BenchSample	*s = (BenchSample *)p;
+
+				p += g_SampleSize;
+
+				s->x = px * BENCH_NUM_SUBPIXELS + k % BENCH_NUM_SUBPIXELS;
+				s->y = py * BENCH_NUM_SUBPIXELS + k / BENCH_NUM_SUBPIXELS;
+				s->weight = 1.0f;
+				setv(&s->color, bench_random(), bench_random(), bench_random());
+				setv(&s->opacity, 1.0f, 1.0f, 1.0f);
+
+				for (i = 0; i < BENCH_NUM_AOVS; ++i)
+				{
+					switch (g_AovTypes[i])
+					{
+					case EI_DATA_TYPE_INT:
+						*((eiInt *)bench_aov(s, i)) = (eiInt)(bench_random() * 100.0f);
+						break;
+					case EI_DATA_TYPE_SCALAR:
+						*((eiScalar *)bench_aov(s, i)) = bench_random();
+						break;
+					case EI_DATA_TYPE_VECTOR:
+						setv((eiVector *)bench_aov(s, i), bench_random(), bench_random(), bench_random());
+						break;
+					}
+				}
+
+				s->next = *list;
+				*list = s;
+			}
+		}
+	}
+}
+
+/** \brief Scale a sample as ei_sample_info_mul did. */
+static void bench_old_mul(BenchSample *s, const eiScalar a)
+{
+	eiInt	i;
+
+	mulvfi(&s->color, a);
+	mulvfi(&s->opacity, a);
+
+	for (i = 0; i < BENCH_NUM_AOVS; ++i)
+	{
+		switch (g_AovTypes[i])
+		{
+		case EI_DATA_TYPE_INT:
+			*((eiInt *)bench_aov(s, i)) = roundf((eiScalar)(*((eiInt *)bench_aov(s, i))) * a);
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			*((eiScalar *)bench_aov(s, i)) *= a;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			mulvfi((eiVector *)bench_aov(s, i), a);
+			break;
+		}
+	}
+}
+
+/** \brief Add a sample as ei_sample_info_add did. */
+static void bench_old_add(BenchSample *s1, BenchSample *s2)
+{
+	eiInt	i;
+
+	addi(&s1->color, &s2->color);
+	addi(&s1->opacity, &s2->opacity);
+
+	for (i = 0; i < BENCH_NUM_AOVS; ++i)
+	{
+		switch (g_AovTypes[i])
+		{
+		case EI_DATA_TYPE_INT:
+			*((eiInt *)bench_aov(s1, i)) += *((eiInt *)bench_aov(s2, i));
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			*((eiScalar *)bench_aov(s1, i)) += *((eiScalar *)bench_aov(s2, i));
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			addi((eiVector *)bench_aov(s1, i), (eiVector *)bench_aov(s2, i));
+			break;
+		}
+	}
+}
+
+/** \brief Write the outputs of a sample as scalar channels. */
+static void bench_write(BenchSample *s, eiScalar *out)
+{
+	eiInt	i;
+
+	*out ++ = s->color.r;
+	*out ++ = s->color.g;
+	*out ++ = s->color.b;
+	*out ++ = s->opacity.r;
+	*out ++ = s->opacity.g;
+	*out ++ = s->opacity.b;
+
+	for (i = 0; i < BENCH_NUM_AOVS; ++i)
+	{
+		switch (g_AovTypes[i])
+		{
+		case EI_DATA_TYPE_INT:
+			*out ++ = (eiScalar)(*((eiInt *)bench_aov(s, i)));
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			*out ++ = *((eiScalar *)bench_aov(s, i));
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			*out ++ = ((eiVector *)bench_aov(s, i))->x;
+			*out ++ = ((eiVector *)bench_aov(s, i))->y;
+			*out ++ = ((eiVector *)bench_aov(s, i))->z;
+			break;
+		}
+	}
+}
+
+static void bench_footprint(
+	const eiInt px, const eiInt py,
+	eiInt *xmin, eiInt *xmax, eiInt *ymin, eiInt *ymax, eiInt *lx, eiInt *ly)
+{
+	eiScalar	x, y, filter_radius;
+
+	x = (eiScalar)px + 0.5f + 1.0f;
+	y = (eiScalar)py + 0.5f + 1.0f;
+	filter_radius = BENCH_FILTER_SIZE * 0.5f;
+
+	*xmin = MAX(0, lfloorf(x - filter_radius));
+	*xmax = MIN(BENCH_NUM_PIXELS - 1, lceilf(x + filter_radius));
+	*ymin = MAX(0, lfloorf(y - filter_radius));
+	*ymax = MIN(BENCH_NUM_PIXELS - 1, lceilf(y + filter_radius));
+	*lx = (eiInt)(x * (eiScalar)BENCH_NUM_SUBPIXELS);
+	*ly = (eiInt)(y * (eiScalar)BENCH_NUM_SUBPIXELS);
+}
+
+/** \brief Reconstruct the bucket from the linked lists. */
+static void bench_old_frame(eiFilterTable *tab, eiScalar *image)
+{
+	BenchSample	*factor, *total;
+	eiInt		px, py;
+
+	factor = (BenchSample *)malloc(g_SampleSize);
+	total = (BenchSample *)malloc(g_SampleSize);
+
+	for (py = 0; py < BENCH_BUCKET_SIZE; ++py)
+	{
+		for (px = 0; px < BENCH_BUCKET_SIZE; ++px)
+		{
+			eiInt		xmin, xmax, ymin, ymax, lx, ly;
+			eiScalar	sum_weight, weight;
+			eiInt		i, j;
+
+			bench_footprint(px, py, &xmin, &xmax, &ymin, &ymax, &lx, &ly);
+
+			memset(total, 0, g_SampleSize);
+			sum_weight = 0.0f;
+
+			for (j = ymin; j <= ymax; ++j)
+			{
+				for (i = xmin; i <= xmax; ++i)
+				{
+					BenchSample	*s;
+
+					for (s = g_Pixels[ i + j * BENCH_NUM_PIXELS ]; s != NULL; s = s->next)
+					{
+						memcpy(factor, s, g_SampleSize);
+
+						ei_buffer_get(&tab->weights, abs(s->x - lx), abs(s->y - ly), &weight);
+						weight *= MAX(0.0f, s->weight);
+
+						bench_old_mul(factor, weight);
+						sum_weight += weight;
+
+						bench_old_add(total, factor);
+					}
+				}
+			}
+
+			bench_old_mul(total, 1.0f / sum_weight);
+
+			bench_write(total, image + (px + py * BENCH_BUCKET_SIZE) * g_NumChannels);
+		}
+	}
+
+	free(total);
+	free(factor);
+}
+
+/** \brief Flatten the linked lists as ei_recon_samples_build does. */
+static void bench_new_build(eiReconSamples *recon)
+{
+	eiInt	num_samples, row_samples;
+	eiInt	i, j, k, n;
+
+	recon->num_pixels_x = BENCH_NUM_PIXELS;
+	recon->num_pixels_y = BENCH_NUM_PIXELS;
+	recon->pixel_offsets = (eiInt *)ei_allocate(sizeof(eiInt) * (BENCH_NUM_PIXELS * BENCH_NUM_PIXELS + 1));
+
+	num_samples = 0;
+	recon->max_row_samples = 0;
+
+	for (j = 0; j < BENCH_NUM_PIXELS; ++j)
+	{
+		row_samples = num_samples;
+
+		for (i = 0; i < BENCH_NUM_PIXELS; ++i)
+		{
+			BenchSample	*s;
+
+			recon->pixel_offsets[ i + j * BENCH_NUM_PIXELS ] = num_samples;
+
+			for (s = g_Pixels[ i + j * BENCH_NUM_PIXELS ]; s != NULL; s = s->next)
+			{
+				++ num_samples;
+			}
+		}
+
+		recon->max_row_samples = MAX(recon->max_row_samples, num_samples - row_samples);
+	}
+
+	recon->pixel_offsets[ BENCH_NUM_PIXELS * BENCH_NUM_PIXELS ] = num_samples;
+	recon->num_samples = n = num_samples;
+	recon->num_channels = g_NumChannels;
+
+	recon->x = (eiInt *)ei_allocate(sizeof(eiInt) * n);
+	recon->y = (eiInt *)ei_allocate(sizeof(eiInt) * n);
+	recon->weight = (eiScalar *)ei_allocate(sizeof(eiScalar) * n);
+	recon->channels = (eiScalar *)ei_allocate(sizeof(eiScalar) * n * g_NumChannels);
+	recon->round_channels = (eiBool *)ei_allocate(sizeof(eiBool) * g_NumChannels);
+	recon->filter_weights = (eiScalar *)ei_allocate(sizeof(eiScalar) * recon->max_row_samples);
+	recon->sums = (eiScalar *)ei_allocate(sizeof(eiScalar) * g_NumChannels);
+
+	k = 0;
+
+	for (j = 0; j < BENCH_NUM_PIXELS; ++j)
+	{
+		for (i = 0; i < BENCH_NUM_PIXELS; ++i)
+		{
+			BenchSample	*s;
+
+			for (s = g_Pixels[ i + j * BENCH_NUM_PIXELS ]; s != NULL; s = s->next)
+			{
+				eiScalar	values[ 6 + 3 * BENCH_NUM_AOVS ];
+				eiInt		c;
+
+				recon->x[k] = s->x;
+				recon->y[k] = s->y;
+				recon->weight[k] = MAX(0.0f, s->weight);
+
+				bench_write(s, values);
+
+				for (c = 0; c < g_NumChannels; ++c)
+				{
+					recon->channels[ c * n + k ] = values[c];
+				}
+
+				++ k;
+			}
+		}
+	}
+
+	n = 6;
+
+	for (i = 0; i < BENCH_NUM_AOVS; ++i)
+	{
+		switch (g_AovTypes[i])
+		{
+		case EI_DATA_TYPE_INT:
+			recon->round_channels[ n ++ ] = eiTRUE;
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			recon->round_channels[ n ++ ] = eiFALSE;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			recon->round_channels[ n ++ ] = eiFALSE;
+			recon->round_channels[ n ++ ] = eiFALSE;
+			recon->round_channels[ n ++ ] = eiFALSE;
+			break;
+		}
+	}
+
+	for (i = 0; i < 6; ++i)
+	{
+		recon->round_channels[i] = eiFALSE;
+	}
+}
+
+/** \brief Reconstruct the bucket from structure-of-arrays. */
+static void bench_new_frame(eiFilterTable *tab, eiScalar *image)
+{
+	eiReconSamples	recon;
+	eiInt			px, py;
+
+	ei_recon_samples_init(&recon);
+
+	bench_new_build(&recon);
+
+	for (py = 0; py < BENCH_BUCKET_SIZE; ++py)
+	{
+		for (px = 0; px < BENCH_BUCKET_SIZE; ++px)
+		{
+			eiInt		xmin, xmax, ymin, ymax, lx, ly;
+			eiScalar	inv_sum_weight;
+			eiScalar	*out;
+			eiInt		c;
+
+			bench_footprint(px, py, &xmin, &xmax, &ymin, &ymax, &lx, &ly);
+
+			inv_sum_weight = 1.0f / ei_recon_samples_filter(&recon, tab, xmin, xmax, ymin, ymax, lx, ly);
+
+			out = image + (px + py * BENCH_BUCKET_SIZE) * g_NumChannels;
+
+			for (c = 0; c < g_NumChannels; ++c)
+			{
+				out[c] = recon.sums[c] * inv_sum_weight;
+
+				if (recon.round_channels[c])
+				{
+					out[c] = roundf(out[c]);
+				}
+			}
+		}
+	}
+
+	ei_recon_samples_exit(&recon);
+}
+
+int main(int argc, char *argv[])
+{
+	eiFilterTable	tab;
+	eiScalar		*old_image, *new_image;
+	eiUint64		t[3];
+	eiScalar		max_diff;
+	eiInt			num_frames;
+	eiInt			i;
+
+	num_frames = 200;
+
+	if (argc > 1)
+	{
+		num_frames = MAX(1, atoi(argv[1]));
+	}
+
+	bench_init_samples();
+
+	ei_filter_table_init(&tab, BENCH_NUM_SUBPIXELS, BENCH_FILTER_SIZE * 0.5f, EI_FILTER_GAUSSIAN);
+
+	old_image = (eiScalar *)malloc(sizeof(eiScalar) * BENCH_BUCKET_SIZE * BENCH_BUCKET_SIZE * g_NumChannels);
+	new_image = (eiScalar *)malloc(sizeof(eiScalar) * BENCH_BUCKET_SIZE * BENCH_BUCKET_SIZE * g_NumChannels);
+
+	t[0] = bench_time_ms();
+	for (i = 0; i < num_frames; ++i)
+	{
+		bench_old_frame(&tab, old_image);
+	}
+	t[1] = bench_time_ms();
+	for (i = 0; i < num_frames; ++i)
+	{
+		bench_new_frame(&tab, new_image);
+	}
+	t[2] = bench_time_ms();
+
+	max_diff = 0.0f;
+
+	for (i = 0; i < BENCH_BUCKET_SIZE * BENCH_BUCKET_SIZE * g_NumChannels; ++i)
+	{
+		max_diff = MAX(max_diff, absf(old_image[i] - new_image[i]));
+	}
+
+	printf("buckets: %d, %dx%d pixels, %d samples per pixel, %d outputs, %d channels\n",
+		num_frames, BENCH_BUCKET_SIZE, BENCH_BUCKET_SIZE, BENCH_SPP, BENCH_NUM_AOVS, g_NumChannels);
+	printf("  per-sample outputs:  %llu ms\n", (unsigned long long)(t[1] - t[0]));
+	printf("  structure-of-arrays: %llu ms\n", (unsigned long long)(t[2] - t[1]));
+	printf("  max difference:      %g\n", max_diff);
+
+	free(new_image);
+	free(old_image);
+	ei_filter_table_exit(&tab);
+	free(g_Samples);
+
+	return 0;
+}
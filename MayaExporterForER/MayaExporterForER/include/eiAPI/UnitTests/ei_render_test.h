@@ -0,0 +1,297 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_RENDER_TEST_H
+#define EI_RENDER_TEST_H
+
+/** \brief Rendering test scenes and capturing their frame buffers, 
+ * shared by unit tests of eiAPI.
+ * \file ei_render_test.h
+ */
+
+#include <eiAPI/ei.h>
+#include <eiAPI/ei_connection.h>
+#include <eiAPI/ei_buffer.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/** \brief A frame buffer captured from rendering, pixels are
+ * stored as scalars in scanline order. */
+typedef struct eiTestImage {
+	/* the name of the captured frame buffer, "color" for the
+	   color frame buffer, otherwise the name of output variable */
+	char		name[ EI_MAX_NODE_NAME_LEN ];
+	eiInt		width;
+	eiInt		height;
+	/* the number of scalars per pixel */
+	eiInt		num_channels;
+	eiScalar	*pixels;
+} eiTestImage;
+
+/* the image being captured by the test connection */
+static eiTestImage *g_TestCapture = NULL;
+
+static void ei_test_image_init(eiTestImage *image, const char *name, const eiInt width, const eiInt height)
+{
+	strncpy(image->name, name, EI_MAX_NODE_NAME_LEN - 1);
+	image->name[ EI_MAX_NODE_NAME_LEN - 1 ] = '\0';
+	image->width = width;
+	image->height = height;
+	image->num_channels = 0;
+	image->pixels = NULL;
+}
+
+static void ei_test_image_exit(eiTestImage *image)
+{
+	free(image->pixels);
+	image->pixels = NULL;
+}
+
+static void ei_test_capture_tile(eiTestImage *image, eiFrameBufferCache *cache, 
+	const eiInt left, const eiInt right, const eiInt top, const eiInt bottom)
+{
+	eiScalar	value[ 16 ];
+	eiInt		num_channels;
+	eiInt		x, y;
+
+	num_channels = ei_framebuffer_cache_get_data_size(cache) / sizeof(eiScalar);
+
+	if (num_channels <= 0 || num_channels > 16)
+	{
+		return;
+	}
+
+	if (image->pixels == NULL)
+	{
+		image->num_channels = num_channels;
+		image->pixels = (eiScalar *)calloc(image->width * image->height * num_channels, sizeof(eiScalar));
+	}
+
+	for (y = top; y < bottom && y < image->height; ++y)
+	{
+		for (x = left; x < right && x < image->width; ++x)
+		{
+			ei_framebuffer_cache_get(cache, x - left, y - top, value);
+
+			memcpy(image->pixels + (x + y * image->width) * num_channels, 
+				value, sizeof(eiScalar) * num_channels);
+		}
+	}
+}
+
+static void ei_test_connection_print(eiConnection *con, const eiInt severity, const char *message)
+{
+	if (severity <= EI_VERBOSE_ERROR)
+	{
+		fprintf(stderr, "%s", message);
+	}
+}
+
+static eiBool ei_test_connection_progress(eiConnection *con, const eiScalar percent)
+{
+	return eiTRUE;
+}
+
+static void ei_test_connection_clear_tile(eiConnection *con, 
+	const eiInt left, const eiInt right, const eiInt top, const eiInt bottom, const eiHostID host)
+{
+}
+
+static void ei_test_connection_update_tile(eiConnection *con, 
+	eiFrameBufferCache *colorFrameBuffer, 
+	eiFrameBufferCache *opacityFrameBuffer, 
+	ei_array *frameBuffers, 
+	const eiInt left, const eiInt right, const eiInt top, const eiInt bottom)
+{
+	eiIntptr	i;
+
+	if (g_TestCapture == NULL)
+	{
+		return;
+	}
+
+	if (strcmp(g_TestCapture->name, "color") == 0)
+	{
+		ei_test_capture_tile(g_TestCapture, colorFrameBuffer, left, right, top, bottom);
+		return;
+	}
+
+	for (i = 0; i < ei_array_size(frameBuffers); ++i)
+	{
+		eiFrameBufferCache	*cache;
+
+		cache = (eiFrameBufferCache *)ei_array_get(frameBuffers, i);
+
+		if (strcmp(ei_framebuffer_cache_get_name(cache), g_TestCapture->name) == 0)
+		{
+			ei_test_capture_tile(g_TestCapture, cache, left, right, top, bottom);
+			return;
+		}
+	}
+}
+
+static void ei_test_connection_draw_pixel(eiConnection *con, 
+	const eiInt x, const eiInt y, const eiVector *color)
+{
+}
+
+static void ei_test_connection_update_sub_window(eiConnection *con, 
+	const eiInt left, const eiInt right, const eiInt top, const eiInt bottom)
+{
+}
+
+static eiConnection g_TestConnection = {
+	ei_test_connection_print, 
+	ei_test_connection_progress, 
+	ei_test_connection_clear_tile, 
+	ei_test_connection_update_tile, 
+	ei_test_connection_draw_pixel, 
+	ei_test_connection_update_sub_window
+};
+
+/** \brief Parse a scene from the scenes directory into a new context, 
+ * the scene should not contain the render statement, so that tests
+ * can edit it before rendering. */
+static void ei_test_load_scene(const char *scene_name)
+{
+	char	filename[ EI_MAX_FILE_NAME_LEN ];
+
+	sprintf(filename, "%s/%s", EI_TEST_SCENE_DIR, scene_name);
+
+	/* the parser creates the context and links shader modules */
+	ei_parse(filename);
+}
+
+/** \brief Render the loaded scene and capture a frame buffer into
+ * the image, the scene must have "world", "caminst1" and "opt". */
+static void ei_test_render(eiTestImage *image)
+{
+	g_TestCapture = image;
+
+	ei_connection(&g_TestConnection);
+	ei_render("world", "caminst1", "opt");
+
+	g_TestCapture = NULL;
+}
+
+/** \brief Delete the context of the loaded scene. */
+static void ei_test_unload_scene()
+{
+	ei_delete_context(ei_context(NULL));
+}
+
+/** \brief Get the maximum absolute difference of all channels of two
+ * images, returns infinity if either image was not captured. */
+static eiScalar ei_test_image_max_difference(const eiTestImage *a, const eiTestImage *b)
+{
+	eiScalar	max_diff;
+	eiInt		i, n;
+
+	if (a->pixels == NULL || b->pixels == NULL
+		|| a->width != b->width
+		|| a->height != b->height
+		|| a->num_channels != b->num_channels)
+	{
+		return eiMAX_SCALAR;
+	}
+
+	max_diff = 0.0f;
+	n = a->width * a->height * a->num_channels;
+
+	for (i = 0; i < n; ++i)
+	{
+		eiScalar	diff;
+
+		diff = (eiScalar)fabs(a->pixels[i] - b->pixels[i]);
+
+		/* not-a-number never compares equal */
+		if (!(diff <= max_diff))
+		{
+			max_diff = (diff == diff) ? diff : eiMAX_SCALAR;
+		}
+	}
+
+	return max_diff;
+}
+
+/** \brief Get the root mean square difference of all channels of 
+ * two images, returns infinity if either image was not captured. */
+static eiScalar ei_test_image_rms_difference(const eiTestImage *a, const eiTestImage *b)
+{
+	eiGeoScalar	sum;
+	eiInt		i, n;
+
+	if (a->pixels == NULL || b->pixels == NULL
+		|| a->width != b->width
+		|| a->height != b->height
+		|| a->num_channels != b->num_channels)
+	{
+		return eiMAX_SCALAR;
+	}
+
+	sum = 0.0;
+	n = a->width * a->height * a->num_channels;
+
+	for (i = 0; i < n; ++i)
+	{
+		eiGeoScalar	diff;
+
+		diff = (eiGeoScalar)a->pixels[i] - (eiGeoScalar)b->pixels[i];
+		sum += diff * diff;
+	}
+
+	return (eiScalar)sqrt(sum / (eiGeoScalar)MAX(1, n));
+}
+
+/** \brief Whether two images are bit-identical. */
+static eiBool ei_test_image_identical(const eiTestImage *a, const eiTestImage *b)
+{
+	if (a->pixels == NULL || b->pixels == NULL
+		|| a->width != b->width
+		|| a->height != b->height
+		|| a->num_channels != b->num_channels)
+	{
+		return eiFALSE;
+	}
+
+	return (memcmp(a->pixels, b->pixels, 
+		sizeof(eiScalar) * a->width * a->height * a->num_channels) == 0);
+}
+
+/** \brief Get the average of all channels of an image. */
+static eiScalar ei_test_image_average(const eiTestImage *image)
+{
+	eiGeoScalar	sum;
+	eiInt		i, n;
+
+	if (image->pixels == NULL)
+	{
+		return 0.0f;
+	}
+
+	sum = 0.0;
+	n = image->width * image->height * image->num_channels;
+
+	for (i = 0; i < n; ++i)
+	{
+		sum += image->pixels[i];
+	}
+
+	return (eiScalar)(sum / (eiGeoScalar)MAX(1, n));
+}
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of batched BSDF functions against the scalar ones, 
+ * for all batch sizes including the ones which are not multiples of 
+ * the SIMD width, the results must never be written beyond n.
+ * \file test_bsdf_batch.c
+ */
+
+#include <eiAPI/ei_bsdf_batch.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <math.h>
+
+/* the relative tolerance of SIMD approximations of pow */
+#define TEST_TOLERANCE		2.0e-4f
+/* guard values after the results of a batch */
+#define TEST_NUM_GUARDS		8
+#define TEST_GUARD			-12345.0f
+/* the number of random batches for each size */
+#define TEST_NUM_ROUNDS		64
+
+static eiUint g_Seed = 12345;
+
+static eiScalar test_random()
+{
+	g_Seed = g_Seed * 1664525U + 1013904223U;
+
+	return (eiScalar)(g_Seed >> 8) / (eiScalar)(1 << 24);
+}
+
+/** \brief A random unit direction, lanes in the upper and the lower 
+ * hemisphere are mixed to cover all branches. */
+static void test_random_dir(eiVector *w)
+{
+	eiScalar	z, r, phi;
+
+	z = 2.0f * test_random() - 1.0f;
+	r = sqrtf(MAX(0.0f, 1.0f - z * z));
+	phi = 2.0f * (eiScalar)eiPI * test_random();
+
+	w->x = r * cosf(phi);
+	w->y = r * sinf(phi);
+	w->z = z;
+}
+
+/** \brief Fill batches with random directions, lanes beyond n are 
+ * filled with not-a-number which must not affect the results. */
+static void test_random_batch(eiDirBatch *wo, eiDirBatch *wi, const eiInt n)
+{
+	eiInt	i;
+
+	for (i = 0; i < EI_BSDF_BATCH_SIZE; ++i)
+	{
+		eiVector	o, d;
+
+		test_random_dir(&o);
+		test_random_dir(&d);
+
+		if (i >= n)
+		{
+			o.x = o.y = o.z = (eiScalar)sqrt(-1.0);
+			d = o;
+		}
+
+		wo->x[i] = o.x; wo->y[i] = o.y; wo->z[i] = o.z;
+		wi->x[i] = d.x; wi->y[i] = d.y; wi->z[i] = d.z;
+	}
+}
+
+static eiVector test_get_dir(const eiDirBatch *w, const eiInt i)
+{
+	eiVector	v;
+
+	v.x = w->x[i];
+	v.y = w->y[i];
+	v.z = w->z[i];
+
+	return v;
+}
+
+static eiBool test_close(const eiScalar a, const eiScalar b)
+{
+	return (fabsf(a - b) <= TEST_TOLERANCE * MAX(1.0f, MAX(fabsf(a), fabsf(b))));
+}
+
+/** \brief Allocate results of n scalars followed by guards. */
+static eiScalar *test_alloc_results(const eiInt n)
+{
+	eiScalar	*r;
+	eiInt		i;
+
+	r = (eiScalar *)malloc(sizeof(eiScalar) * (n + TEST_NUM_GUARDS));
+
+	for (i = 0; i < n + TEST_NUM_GUARDS; ++i)
+	{
+		r[i] = TEST_GUARD;
+	}
+
+	return r;
+}
+
+static eiBool test_guards_intact(const eiScalar *r, const eiInt n)
+{
+	eiInt	i;
+
+	for (i = n; i < n + TEST_NUM_GUARDS; ++i)
+	{
+		if (r[i] != TEST_GUARD)
+		{
+			return eiFALSE;
+		}
+	}
+
+	return eiTRUE;
+}
+
+static void test_lambert(const eiInt n)
+{
+	eiDirBatch	wo, wi;
+	eiScalar	*f, *pdf;
+	eiInt		k, i;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		test_random_batch(&wo, &wi, n);
+		f = test_alloc_results(n);
+		pdf = test_alloc_results(n);
+
+		ei_lambert_bsdf_batch(f, &wo, &wi, n);
+		ei_lambert_pdf_batch(pdf, &wo, &wi, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, sf;
+
+			o = test_get_dir(&wo, i);
+			d = test_get_dir(&wi, i);
+			ei_lambert_bsdf(&sf, &o, &d);
+
+			eiCHECK(test_close(f[i], sf.x));
+			eiCHECK(test_close(pdf[i], ei_lambert_pdf(&o, &d)));
+		}
+
+		eiCHECK(test_guards_intact(f, n));
+		eiCHECK(test_guards_intact(pdf, n));
+
+		free(pdf);
+		free(f);
+	}
+}
+
+static void test_blinn(const eiInt n, const eiScalar exponent)
+{
+	eiDirBatch	wo, wi;
+	eiScalar	*f, *pdf;
+	eiInt		k, i;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		test_random_batch(&wo, &wi, n);
+		f = test_alloc_results(n);
+		pdf = test_alloc_results(n);
+
+		ei_blinn_bsdf_batch(f, &wo, &wi, exponent, n);
+		ei_blinn_pdf_batch(pdf, &wo, &wi, exponent, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, sf;
+
+			o = test_get_dir(&wo, i);
+			d = test_get_dir(&wi, i);
+			ei_blinn_bsdf(&sf, &o, &d, exponent);
+
+			eiCHECK(test_close(f[i], sf.x));
+			eiCHECK(test_close(pdf[i], ei_blinn_pdf(&o, &d, exponent)));
+		}
+
+		eiCHECK(test_guards_intact(f, n));
+		eiCHECK(test_guards_intact(pdf, n));
+
+		free(pdf);
+		free(f);
+	}
+}
+
+static void test_ward(const eiInt n, const eiScalar shiny_u, const eiScalar shiny_v)
+{
+	eiDirBatch	wo, wi;
+	eiScalar	*f, *pdf;
+	eiInt		k, i;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		test_random_batch(&wo, &wi, n);
+		f = test_alloc_results(n);
+		pdf = test_alloc_results(n);
+
+		ei_ward_bsdf_batch(f, &wo, &wi, shiny_u, shiny_v, n);
+		ei_ward_pdf_batch(pdf, &wo, &wi, shiny_u, shiny_v, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, sf;
+
+			o = test_get_dir(&wo, i);
+			d = test_get_dir(&wi, i);
+			ei_ward_bsdf(&sf, &o, &d, shiny_u, shiny_v);
+
+			eiCHECK(test_close(f[i], sf.x));
+			eiCHECK(test_close(pdf[i], ei_ward_pdf(&o, &d, shiny_u, shiny_v)));
+		}
+
+		eiCHECK(test_guards_intact(f, n));
+		eiCHECK(test_guards_intact(pdf, n));
+
+		free(pdf);
+		free(f);
+	}
+}
+
+static void test_fresnelblend(const eiInt n)
+{
+	eiDirBatch		wo, wi;
+	eiColorBatch	f;
+	eiBlinnParams	blinn;
+	eiVector		Rd, Rs;
+	eiInt			k, i;
+
+	blinn.exponent = 20.0f;
+	Rd.r = 0.8f; Rd.g = 0.5f; Rd.b = 0.2f;
+	Rs.r = 0.04f; Rs.g = 0.05f; Rs.b = 0.06f;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		test_random_batch(&wo, &wi, n);
+
+		for (i = 0; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			f.r[i] = f.g[i] = f.b[i] = TEST_GUARD;
+		}
+
+		ei_fresnelblend_bsdf_batch(&f, &wo, &wi, &Rd, &Rs, 
+			ei_blinn_microfacet_bsdf_batch, &blinn, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d, sf;
+
+			o = test_get_dir(&wo, i);
+			d = test_get_dir(&wi, i);
+			ei_fresnelblend_bsdf(&sf, &o, &d, &Rd, &Rs, 
+				ei_blinn_microfacet_bsdf, &blinn);
+
+			eiCHECK(test_close(f.r[i], sf.r));
+			eiCHECK(test_close(f.g[i], sf.g));
+			eiCHECK(test_close(f.b[i], sf.b));
+		}
+
+		for (i = n; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			eiCHECK(f.r[i] == TEST_GUARD && f.g[i] == TEST_GUARD && f.b[i] == TEST_GUARD);
+		}
+	}
+}
+
+static void test_fresnel_dielectric(const eiInt n)
+{
+	eiScalar	*cosi, *F;
+	eiInt		k, i;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		/* exactly n inputs, reading beyond them is an overrun */
+		cosi = (eiScalar *)malloc(sizeof(eiScalar) * n);
+		F = test_alloc_results(n);
+
+		for (i = 0; i < n; ++i)
+		{
+			cosi[i] = 2.0f * test_random() - 1.0f;
+		}
+
+		ei_fresnel_dielectric_batch(F, cosi, 1.0f, 1.5f, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	sF;
+
+			ei_fresnel_dielectric(&sF, cosi[i], 1.0f, 1.5f);
+
+			eiCHECK(test_close(F[i], sF.x));
+		}
+
+		eiCHECK(test_guards_intact(F, n));
+
+		free(F);
+		free(cosi);
+	}
+}
+
+static void test_specular_sample(const eiInt n)
+{
+	eiDirBatch	wo, wi;
+	eiUint		valid;
+	eiInt		k, i;
+
+	for (k = 0; k < TEST_NUM_ROUNDS; ++k)
+	{
+		test_random_batch(&wo, &wi, n);
+
+		for (i = 0; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			wi.x[i] = wi.y[i] = wi.z[i] = TEST_GUARD;
+		}
+
+		ei_specularreflection_sample_bsdf_batch(&wo, &wi, n);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d;
+
+			o = test_get_dir(&wo, i);
+			ei_specularreflection_sample_bsdf(&o, &d);
+
+			eiCHECK(wi.x[i] == d.x && wi.y[i] == d.y && wi.z[i] == d.z);
+		}
+
+		for (i = n; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			eiCHECK(wi.x[i] == TEST_GUARD && wi.y[i] == TEST_GUARD && wi.z[i] == TEST_GUARD);
+		}
+
+		for (i = 0; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			wi.x[i] = wi.y[i] = wi.z[i] = TEST_GUARD;
+		}
+
+		/* the relative index is large enough for total internal 
+		   reflection on some lanes */
+		valid = ei_speculartransmission_sample_bsdf_batch(&wo, &wi, 1.0f, 2.4f, n);
+
+		eiCHECK((valid >> n) == 0);
+
+		for (i = 0; i < n; ++i)
+		{
+			eiVector	o, d;
+			eiBool		scalar_valid;
+
+			o = test_get_dir(&wo, i);
+			scalar_valid = ei_speculartransmission_sample_bsdf(&o, &d, 1.0f, 2.4f);
+
+			eiCHECK(((valid >> i) & 1U) == (eiUint)scalar_valid);
+
+			if (scalar_valid)
+			{
+				eiCHECK(test_close(wi.x[i], d.x));
+				eiCHECK(test_close(wi.y[i], d.y));
+				eiCHECK(test_close(wi.z[i], d.z));
+			}
+		}
+
+		for (i = n; i < EI_BSDF_BATCH_SIZE; ++i)
+		{
+			eiCHECK(wi.x[i] == TEST_GUARD && wi.y[i] == TEST_GUARD && wi.z[i] == TEST_GUARD);
+		}
+	}
+}
+
+static void test_all_sizes(void (*test)(const eiInt n))
+{
+	eiInt	n;
+
+	for (n = 1; n <= EI_BSDF_BATCH_SIZE; ++n)
+	{
+		test(n);
+	}
+}
+
+static void test_blinn_sizes()
+{
+	eiInt	n;
+
+	for (n = 1; n <= EI_BSDF_BATCH_SIZE; ++n)
+	{
+		test_blinn(n, 0.0f);
+		test_blinn(n, 1.0f);
+		test_blinn(n, 37.5f);
+	}
+}
+
+static void test_ward_sizes()
+{
+	eiInt	n;
+
+	for (n = 1; n <= EI_BSDF_BATCH_SIZE; ++n)
+	{
+		test_ward(n, 10.0f, 10.0f);
+		test_ward(n, 4.0f, 60.0f);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_all_sizes(test_lambert));
+	eiRUN_TEST(test_blinn_sizes());
+	eiRUN_TEST(test_ward_sizes());
+	eiRUN_TEST(test_all_sizes(test_fresnelblend));
+	eiRUN_TEST(test_all_sizes(test_fresnel_dielectric));
+	eiRUN_TEST(test_all_sizes(test_specular_sample));
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of projecting arrays of points to screen space, the
+ * results must match projecting the points one by one for every
+ * array length, also in place, including points behind the near
+ * clipping plane.
+ * \file test_camera_screen.c
+ */
+
+#include <eiAPI/ei_camera.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_LENGTH		19
+#define TEST_CAPACITY		(TEST_MAX_LENGTH + 1)
+/* relative to the magnitude of screen coordinates */
+#define TEST_TOLERANCE		1.0e-4f
+/* the slots beyond the array length are filled with this */
+#define TEST_GUARD_VALUE	-12345.0f
+
+static eiScalar test_random(const eiScalar range)
+{
+	return range * (2.0f * (eiScalar)rand() / (eiScalar)RAND_MAX - 1.0f);
+}
+
+/** \brief A 640x480 camera with the parameters precomputed as the
+ * renderer does for a focal length of 1 and an aperture of 1. */
+static void test_init_camera(eiCamera *cam)
+{
+	memset(cam, 0, sizeof(eiCamera));
+
+	cam->image_center_x = 320.0f;
+	cam->image_center_y = 240.0f;
+	cam->camera_to_pixel_x = 640.0f;
+	cam->camera_to_pixel_y = 640.0f;
+	cam->coeffz = 1.0f;
+	cam->constz = 0.0f;
+	cam->focalz = -1.0f;
+	cam->project_near_clip = -0.01f;
+}
+
+/** \brief Project a point the way ei_camera_object_to_screen does. */
+static void test_object_to_screen(
+	const eiCamera *cam,
+	eiVector *p_pos,
+	const eiVector *o_pos,
+	const eiMatrix *object_to_view)
+{
+	eiVector	v_pos;
+	eiScalar	z;
+	eiScalar	k;
+
+	point_transform(&v_pos, o_pos, object_to_view);
+
+	if (v_pos.z > cam->project_near_clip)
+	{
+		v_pos.z = cam->project_near_clip;
+	}
+
+	z = cam->focalz / v_pos.z;
+	p_pos->z = z;
+	k = z * cam->coeffz + cam->constz;
+	p_pos->x = cam->image_center_x - v_pos.x * k * cam->camera_to_pixel_x;
+	p_pos->y = cam->image_center_y - v_pos.y * k * cam->camera_to_pixel_y;
+}
+
+static eiBool test_near(const eiScalar a, const eiScalar b)
+{
+	return absf(a - b) <= TEST_TOLERANCE * MAX(1.0f, absf(b));
+}
+
+static void test_object_to_screen_array()
+{
+	eiCamera	cam;
+	eiMatrix	object_to_view;
+	eiVector	src[ TEST_CAPACITY ];
+	eiVector	dst[ TEST_CAPACITY ];
+	eiInt		n, i, in_place;
+
+	test_init_camera(&cam);
+
+	/* move the objects 10 units in front of the camera, which looks
+	   down the negative z axis, with a little rotation about y */
+	initm(&object_to_view, 1.0f);
+	object_to_view.m1 = 0.8f;
+	object_to_view.m3 = -0.6f;
+	object_to_view.m9 = 0.6f;
+	object_to_view.m11 = 0.8f;
+	object_to_view.m15 = -10.0f;
+
+	srand(1234);
+
+	for (n = 0; n <= TEST_MAX_LENGTH; ++n)
+	{
+		for (in_place = 0; in_place < 2; ++in_place)
+		{
+			eiBool	passed = eiTRUE;
+
+			for (i = 0; i < TEST_CAPACITY; ++i)
+			{
+				/* some points lie behind the near clipping plane */
+				setv(&src[i], test_random(5.0f), test_random(5.0f), test_random(12.0f));
+				setv(&dst[i], TEST_GUARD_VALUE, TEST_GUARD_VALUE, TEST_GUARD_VALUE);
+			}
+
+			if (in_place)
+			{
+				memcpy(dst, src, sizeof(eiVector) * n);
+				ei_camera_object_to_screen_array(&cam, dst, dst, n, &object_to_view);
+			}
+			else
+			{
+				ei_camera_object_to_screen_array(&cam, dst, src, n, &object_to_view);
+			}
+
+			for (i = 0; i < n; ++i)
+			{
+				eiVector	expected;
+
+				test_object_to_screen(&cam, &expected, &src[i], &object_to_view);
+
+				passed = passed
+					&& test_near(dst[i].x, expected.x)
+					&& test_near(dst[i].y, expected.y)
+					&& test_near(dst[i].z, expected.z);
+			}
+
+			for (i = n; i < TEST_CAPACITY; ++i)
+			{
+				passed = passed
+					&& dst[i].x == TEST_GUARD_VALUE
+					&& dst[i].y == TEST_GUARD_VALUE
+					&& dst[i].z == TEST_GUARD_VALUE;
+			}
+
+			eiCHECK(passed);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_object_to_screen_array());
+
+	return eiTEST_RESULT();
+}
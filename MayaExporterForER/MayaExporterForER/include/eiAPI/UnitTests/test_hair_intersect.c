@@ -0,0 +1,268 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of the hair intersection modes, a field of wavy hairs
+ * rendered with the BSP-tree and with packets must show the same hit
+ * positions, distances and normals, for linear and cubic hairs. moving
+ * hairs rendered as packets must show the same hits with one hierarchy
+ * as with a hierarchy for each time segment.
+ * \file test_hair_intersect.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+
+#define TEST_WIDTH				80
+#define TEST_HEIGHT				60
+#define TEST_COLUMNS			12
+#define TEST_ROWS				4
+#define TEST_SEGMENTS			4
+#define TEST_RADIUS				0.35f
+/* how far hairs move during the shutter interval */
+#define TEST_MOTION_X			1.5f
+#define TEST_MOTION_Z			2.0f
+/* the channels of "state_color" */
+#define TEST_CHANNEL_P			0
+#define TEST_CHANNEL_T			1
+#define TEST_CHANNEL_N			2
+/* positions and distances are around 30 units, normals are unit */
+#define TEST_P_TOLERANCE		0.03f
+#define TEST_T_TOLERANCE		0.03f
+#define TEST_N_TOLERANCE		0.01f
+/* silhouette pixels may be hit by one mode and missed by the other */
+#define TEST_MAX_DIFFERENT		(TEST_WIDTH * TEST_HEIGHT / 100)
+/* time segments only change the boxes of the hierarchy, not the hits */
+#define TEST_SEGMENTS_TOLERANCE	1.0e-4f
+
+/** \brief Add the vertices of all hairs to the current table, hairs
+ * stand in a grid 30 units in front of the camera and wave in x and
+ * z, at the shutter close they have moved by the offset, each row in
+ * its own direction. */
+static void add_hair_vertices(const eiInt num_vertices, const eiScalar dx, const eiScalar dz)
+{
+	eiInt	col, row, i;
+
+	for (row = 0; row < TEST_ROWS; ++row)
+	{
+		eiScalar	sign = ((row & 1) == 0) ? 1.0f : -1.0f;
+
+		for (col = 0; col < TEST_COLUMNS; ++col)
+		{
+			eiScalar	x0 = -18.0f + 36.0f * ((eiScalar)col + 0.5f) / (eiScalar)TEST_COLUMNS;
+			eiScalar	y0 = -13.0f + 6.5f * (eiScalar)row;
+
+			for (i = 0; i < num_vertices; ++i)
+			{
+				eiScalar	s = (eiScalar)i / (eiScalar)(num_vertices - 1);
+
+				ei_tab_add_vector4(
+					x0 + 0.8f * sinf(6.0f * s + (eiScalar)row) + sign * dx,
+					y0 + 6.0f * s,
+					-30.0f + 3.0f * cosf(4.0f * s + (eiScalar)col) + sign * dz,
+					TEST_RADIUS);
+			}
+		}
+	}
+}
+
+/** \brief Create the hair object, moving hairs get a motion vertex
+ * list and are split into the number of time segments. */
+static void add_hair_object(const eiInt mode, const eiInt degree, const eiBool moving, const eiInt motion_segments)
+{
+	const eiInt		num_vertices = TEST_SEGMENTS * degree + 1;
+	eiInt			i;
+
+	ei_object("hair1", "hair");
+		ei_degree(degree);
+		ei_hair_intersect_mode(mode);
+		ei_hair_motion_segments(motion_segments);
+
+		ei_vertex_list(ei_tab(EI_DATA_TYPE_VECTOR4, TEST_COLUMNS * TEST_ROWS * num_vertices));
+		add_hair_vertices(num_vertices, 0.0f, 0.0f);
+		ei_end_tab();
+
+		if (moving)
+		{
+			ei_motion_vertex_list(ei_tab(EI_DATA_TYPE_VECTOR4, TEST_COLUMNS * TEST_ROWS * num_vertices));
+			add_hair_vertices(num_vertices, TEST_MOTION_X, TEST_MOTION_Z);
+			ei_end_tab();
+		}
+
+		/* the offset of the first vertex and the number of segments */
+		ei_hair_list(ei_tab(EI_DATA_TYPE_INDEX, TEST_COLUMNS * TEST_ROWS * 2));
+		for (i = 0; i < TEST_COLUMNS * TEST_ROWS; ++i)
+		{
+			ei_tab_add_index(i * num_vertices);
+			ei_tab_add_index(TEST_SEGMENTS);
+		}
+		ei_end_tab();
+	ei_end_object();
+}
+
+static void render_hair(eiTestImage *image, 
+	const eiInt mode, const eiInt degree, const eiBool moving, const eiInt motion_segments, const eiInt channel)
+{
+	ei_test_image_init(image, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	ei_test_load_scene("hair.ess");
+
+	if (moving)
+	{
+		ei_options("opt");
+			ei_shutter(0.0f, 1.0f);
+			ei_motion(eiTRUE);
+		ei_end_options();
+	}
+
+	ei_shader("state_shader");
+		ei_shader_param_int("channel", channel);
+	ei_end_shader();
+
+	add_hair_object(mode, degree, moving, motion_segments);
+
+	ei_instance("hairinst");
+		ei_element("hair1");
+		ei_add_material("mtl");
+	ei_end_instance();
+
+	ei_instgroup("world");
+		ei_add_instance("caminst1");
+		ei_add_instance("hairinst");
+	ei_end_instgroup();
+
+	ei_test_render(image);
+
+	ei_test_unload_scene();
+}
+
+/** \brief Count the pixels where any channel of two images differs
+ * by more than the tolerance. */
+static eiInt count_different_pixels(const eiTestImage *a, const eiTestImage *b, const eiScalar tolerance)
+{
+	eiInt	count, i, k;
+
+	if (a->pixels == NULL || b->pixels == NULL || a->num_channels != b->num_channels)
+	{
+		return a->width * a->height;
+	}
+
+	count = 0;
+
+	for (i = 0; i < a->width * a->height; ++i)
+	{
+		for (k = 0; k < a->num_channels; ++k)
+		{
+			if (fabs(a->pixels[ i * a->num_channels + k ] - b->pixels[ i * b->num_channels + k ]) > tolerance)
+			{
+				++ count;
+				break;
+			}
+		}
+	}
+
+	return count;
+}
+
+static void check_modes(const eiInt degree, const eiInt channel, const eiScalar tolerance, const char *name)
+{
+	eiTestImage		bsp_image;
+	eiTestImage		packet_image;
+	eiInt			num_different;
+
+	render_hair(&bsp_image, EI_HAIR_INTERSECT_BSP, degree, eiFALSE, 1, channel);
+	render_hair(&packet_image, EI_HAIR_INTERSECT_PACKET, degree, eiFALSE, 1, channel);
+
+	eiCHECK(bsp_image.pixels != NULL);
+	eiCHECK(packet_image.pixels != NULL);
+
+	num_different = count_different_pixels(&bsp_image, &packet_image, tolerance);
+
+	printf("degree %d %s: %d different pixels, max difference %f\n",
+		degree, name, num_different, ei_test_image_max_difference(&bsp_image, &packet_image));
+
+	eiCHECK(num_different <= TEST_MAX_DIFFERENT);
+
+	/* the hairs must be in view, otherwise both images are empty */
+	if (channel == TEST_CHANNEL_T)
+	{
+		eiCHECK(ei_test_image_average(&bsp_image) > 0.0f);
+	}
+
+	ei_test_image_exit(&packet_image);
+	ei_test_image_exit(&bsp_image);
+}
+
+static void test_hair_modes_linear()
+{
+	check_modes(1, TEST_CHANNEL_P, TEST_P_TOLERANCE, "position");
+	check_modes(1, TEST_CHANNEL_T, TEST_T_TOLERANCE, "distance");
+	check_modes(1, TEST_CHANNEL_N, TEST_N_TOLERANCE, "normal");
+}
+
+static void test_hair_modes_cubic()
+{
+	check_modes(3, TEST_CHANNEL_P, TEST_P_TOLERANCE, "position");
+	check_modes(3, TEST_CHANNEL_T, TEST_T_TOLERANCE, "distance");
+	check_modes(3, TEST_CHANNEL_N, TEST_N_TOLERANCE, "normal");
+}
+
+static void check_segments(const eiInt degree, const eiInt channel, const char *name)
+{
+	const eiInt		segments[] = { 2, 4, 8 };
+	eiTestImage		reference;
+	eiInt			i;
+
+	render_hair(&reference, EI_HAIR_INTERSECT_PACKET, degree, eiTRUE, 1, channel);
+
+	eiCHECK(reference.pixels != NULL);
+
+	for (i = 0; i < (eiInt)(sizeof(segments) / sizeof(segments[0])); ++i)
+	{
+		eiTestImage		image;
+		eiScalar		max_diff;
+
+		render_hair(&image, EI_HAIR_INTERSECT_PACKET, degree, eiTRUE, segments[i], channel);
+
+		max_diff = ei_test_image_max_difference(&reference, &image);
+
+		printf("degree %d %s, %d time segments: max difference %f\n", 
+			degree, name, segments[i], max_diff);
+
+		eiCHECK(max_diff <= TEST_SEGMENTS_TOLERANCE);
+
+		ei_test_image_exit(&image);
+	}
+
+	ei_test_image_exit(&reference);
+}
+
+/** \brief The hierarchies of time segments must find the same hits
+ * as the single hierarchy bounding the whole motion. */
+static void test_hair_motion_segments()
+{
+	check_segments(1, TEST_CHANNEL_P, "position");
+	check_segments(1, TEST_CHANNEL_T, "distance");
+	check_segments(3, TEST_CHANNEL_P, "position");
+	check_segments(3, TEST_CHANNEL_T, "distance");
+	check_segments(3, TEST_CHANNEL_N, "normal");
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_hair_modes_linear());
+	eiRUN_TEST(test_hair_modes_cubic());
+	eiRUN_TEST(test_hair_motion_segments());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of batched noise, the results must match the scalar
+ * noise functions for every batch length, and no result beyond the
+ * batch length may be written.
+ * \file test_noise_batch.cpp
+ */
+
+#include <eiAPI/ei_shaderx.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TEST_NUM_POINTS		4096
+/* fused multiply-add of wider SIMD may round differently */
+#define TEST_TOLERANCE		1.0e-6f
+#define TEST_OCTAVES		5
+/* the result slots beyond the batch length are filled with this */
+#define TEST_GUARD_VALUE	-12345.0f
+
+static float	g_U[ TEST_NUM_POINTS ];
+static float	g_V[ TEST_NUM_POINTS ];
+static float	g_W[ TEST_NUM_POINTS ];
+static point	g_P[ TEST_NUM_POINTS ];
+
+static float test_random(const float range)
+{
+	return range * (2.0f * (float)rand() / (float)RAND_MAX - 1.0f);
+}
+
+/** \brief Generate random points, every fourth point is snapped to
+ * the integer lattice, where flooring of non-positive coordinates
+ * is most likely to differ. */
+static void test_generate_points()
+{
+	srand(1234);
+
+	for (int i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		g_U[i] = test_random(100.0f);
+		g_V[i] = test_random(100.0f);
+		g_W[i] = test_random(100.0f);
+
+		if (i % 4 == 0)
+		{
+			g_U[i] = floorf(g_U[i]);
+			g_V[i] = floorf(g_V[i]);
+		}
+
+		g_P[i] = point(g_U[i], g_V[i], g_W[i]);
+	}
+
+	g_U[0] = g_V[0] = g_W[0] = 0.0f;
+	g_P[0] = point(0.0f, 0.0f, 0.0f);
+}
+
+/** \brief Check the results of a batch against the scalar ones, and
+ * check the guard slots after the batch. */
+static bool test_compare(const float *batch, const float *scalar, const int n, const int capacity)
+{
+	bool	passed = true;
+
+	for (int i = 0; i < n; ++i)
+	{
+		if (!(absf(batch[i] - scalar[i]) <= TEST_TOLERANCE * MAX(1.0f, absf(scalar[i]))))
+		{
+			passed = false;
+		}
+	}
+
+	for (int i = n; i < capacity; ++i)
+	{
+		if (batch[i] != TEST_GUARD_VALUE)
+		{
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+static void test_fill_guard(float *result, const int capacity)
+{
+	for (int i = 0; i < capacity; ++i)
+	{
+		result[i] = TEST_GUARD_VALUE;
+	}
+}
+
+/** \brief Compare all batched functions with the scalar functions
+ * over all points in one batch. */
+static void test_match_scalar()
+{
+	static float	batch[ TEST_NUM_POINTS ];
+	static float	scalar[ TEST_NUM_POINTS ];
+	const point		periods(8.0f, 16.0f, 5.0f);
+	int				i;
+
+	noise_batch(g_U, batch, TEST_NUM_POINTS);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = noise(g_U[i]);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	noise_batch(g_U, g_V, batch, TEST_NUM_POINTS);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = noise(g_U[i], g_V[i]);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	noise_batch(g_P, batch, TEST_NUM_POINTS);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = noise(g_P[i]);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	noise_batch(g_P, g_W, batch, TEST_NUM_POINTS);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = noise(g_P[i], g_W[i]);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	pnoise_batch(g_P, periods, batch, TEST_NUM_POINTS);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = pnoise(g_P[i], periods);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	fbm_batch(g_P, batch, TEST_NUM_POINTS, TEST_OCTAVES);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = fbm(g_P[i], TEST_OCTAVES);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+
+	turbulence_batch(g_P, batch, TEST_NUM_POINTS, TEST_OCTAVES);
+	for (i = 0; i < TEST_NUM_POINTS; ++i)
+	{
+		scalar[i] = turbulence(g_P[i], TEST_OCTAVES);
+	}
+	eiCHECK(test_compare(batch, scalar, TEST_NUM_POINTS, TEST_NUM_POINTS));
+}
+
+/** \brief Run batches of every length up to two full SIMD widths
+ * plus one, the lanes of partial batches must match the scalar
+ * functions and must not be stored beyond the batch length. */
+static void test_tail_lengths()
+{
+	const int		capacity = 2 * EI_VF_WIDTH + 1;
+	float			batch[ 2 * EI_VF_WIDTH + 1 ];
+	float			scalar[ 2 * EI_VF_WIDTH + 1 ];
+	const point		periods(8.0f, 16.0f, 5.0f);
+
+	for (int n = 1; n <= capacity; ++n)
+	{
+		int		i;
+
+		test_fill_guard(batch, capacity);
+		noise_batch(g_U, batch, n);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = noise(g_U[i]);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+
+		test_fill_guard(batch, capacity);
+		noise_batch(g_U, g_V, batch, n);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = noise(g_U[i], g_V[i]);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+
+		test_fill_guard(batch, capacity);
+		noise_batch(g_P, batch, n);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = noise(g_P[i]);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+
+		test_fill_guard(batch, capacity);
+		noise_batch(g_P, g_W, batch, n);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = noise(g_P[i], g_W[i]);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+
+		test_fill_guard(batch, capacity);
+		pnoise_batch(g_P, periods, batch, n);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = pnoise(g_P[i], periods);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+
+		test_fill_guard(batch, capacity);
+		turbulence_batch(g_P, batch, n, TEST_OCTAVES);
+		for (i = 0; i < n; ++i)
+		{
+			scalar[i] = turbulence(g_P[i], TEST_OCTAVES);
+		}
+		eiCHECK(test_compare(batch, scalar, n, capacity));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	test_generate_points();
+
+	eiRUN_TEST(test_match_scalar());
+	eiRUN_TEST(test_tail_lengths());
+
+	return eiTEST_RESULT();
+}
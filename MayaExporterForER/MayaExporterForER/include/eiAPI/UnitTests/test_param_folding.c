@@ -0,0 +1,112 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of folding constant shader parameters, the images
+ * rendered with folding must be bit-identical to the ones rendered
+ * by looking up primitive variables for every evaluation.
+ * \file test_param_folding.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#include <eiAPI/ei_shadesys.h>
+
+#define TEST_WIDTH		160
+#define TEST_HEIGHT		120
+
+/** \brief Override "Cs" of plastic on the second cube by a
+ * constant primitive variable of the object. */
+static void override_object_color()
+{
+	eiVector	color;
+
+	color.x = 0.1f;
+	color.y = 0.9f;
+	color.z = 0.2f;
+
+	ei_object("obj2", "poly");
+		ei_declare("Cs", eiCONSTANT, EI_DATA_TYPE_VECTOR, &color);
+	ei_end_object();
+}
+
+static void render_scene(eiTestImage *image, const eiBool override, const eiBool folding)
+{
+	ei_test_load_scene("param_folding.ess");
+
+	if (override)
+	{
+		override_object_color();
+	}
+
+	ei_shader_param_folding(folding);
+	ei_test_render(image);
+	ei_shader_param_folding(eiTRUE);
+
+	ei_test_unload_scene();
+}
+
+/** \brief No parameter is overridden, all evaluations on both
+ * objects after the first one are folded. */
+static void test_folded_constants()
+{
+	eiTestImage		folded;
+	eiTestImage		unfolded;
+
+	ei_test_image_init(&folded, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&unfolded, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	render_scene(&folded, eiFALSE, eiTRUE);
+	render_scene(&unfolded, eiFALSE, eiFALSE);
+
+	eiCHECK(folded.pixels != NULL);
+	eiCHECK(ei_test_image_average(&folded) > 0.0f);
+	eiCHECK(ei_test_image_identical(&folded, &unfolded));
+
+	ei_test_image_exit(&unfolded);
+	ei_test_image_exit(&folded);
+}
+
+/** \brief The same constant parameter is overridden on one object
+ * and folded on the other, the memorized bindings must not leak
+ * between objects. */
+static void test_overridden_constants()
+{
+	eiTestImage		plain;
+	eiTestImage		folded;
+	eiTestImage		unfolded;
+
+	ei_test_image_init(&plain, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&folded, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&unfolded, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	render_scene(&plain, eiFALSE, eiTRUE);
+	render_scene(&folded, eiTRUE, eiTRUE);
+	render_scene(&unfolded, eiTRUE, eiFALSE);
+
+	/* the override must be visible */
+	eiCHECK(ei_test_image_max_difference(&plain, &folded) > 0.0f);
+	eiCHECK(ei_test_image_identical(&folded, &unfolded));
+
+	ei_test_image_exit(&unfolded);
+	ei_test_image_exit(&folded);
+	ei_test_image_exit(&plain);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_folded_constants());
+	eiRUN_TEST(test_overridden_constants());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of pre-resolved handles of primitive variables, the 
+ * images interpolated through handles cached for the duration of 
+ * states must be bit-identical to the ones looked up by name for 
+ * every evaluation.
+ * \file test_prim_var_handle.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#include <eiAPI/ei_shadesys.h>
+
+#define TEST_WIDTH		160
+#define TEST_HEIGHT		120
+/* the number of triangles of each cube */
+#define TEST_NUM_FACES	12
+
+/** \brief Override "Cs" of plastic on an object by a uniform 
+ * primitive variable, which has a different color per face. */
+static void override_face_colors(const char *obj_name, const eiScalar hue)
+{
+	eiTag	tab;
+	eiInt	i;
+
+	tab = ei_tab(EI_DATA_TYPE_VECTOR, TEST_NUM_FACES);
+	for (i = 0; i < TEST_NUM_FACES; ++i)
+	{
+		eiScalar	t;
+
+		t = (eiScalar)i / (eiScalar)(TEST_NUM_FACES - 1);
+
+		ei_tab_add_vector(hue, t, 1.0f - t);
+	}
+	ei_end_tab();
+
+	ei_object(obj_name, "poly");
+		ei_declare("Cs", eiUNIFORM, EI_DATA_TYPE_TAG, &tab);
+	ei_end_object();
+}
+
+static void render_scene(eiTestImage *image, const eiInt num_overrides, const eiBool folding)
+{
+	ei_test_load_scene("param_folding.ess");
+
+	if (num_overrides >= 1)
+	{
+		override_face_colors("obj2", 0.9f);
+	}
+	if (num_overrides >= 2)
+	{
+		override_face_colors("obj1", 0.1f);
+	}
+
+	/* without folding, the primitive variables are looked up by 
+	   name for every evaluation */
+	ei_shader_param_folding(folding);
+	ei_test_render(image);
+	ei_shader_param_folding(eiTRUE);
+
+	ei_test_unload_scene();
+}
+
+/** \brief One object is bound through handles, the other one is 
+ * folded to constants. */
+static void test_one_object()
+{
+	eiTestImage		plain;
+	eiTestImage		by_name;
+	eiTestImage		by_handle;
+
+	ei_test_image_init(&plain, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&by_name, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&by_handle, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	render_scene(&plain, 0, eiTRUE);
+	render_scene(&by_name, 1, eiFALSE);
+	render_scene(&by_handle, 1, eiTRUE);
+
+	/* the primitive variable must be bound */
+	eiCHECK(ei_test_image_max_difference(&plain, &by_handle) > 0.0f);
+	eiCHECK(ei_test_image_identical(&by_name, &by_handle));
+
+	ei_test_image_exit(&by_handle);
+	ei_test_image_exit(&by_name);
+	ei_test_image_exit(&plain);
+}
+
+/** \brief Both objects are bound through the same handles, which 
+ * must be resolved again when the hit object changes. */
+static void test_two_objects()
+{
+	eiTestImage		by_name;
+	eiTestImage		by_handle;
+
+	ei_test_image_init(&by_name, "color", TEST_WIDTH, TEST_HEIGHT);
+	ei_test_image_init(&by_handle, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	render_scene(&by_name, 2, eiFALSE);
+	render_scene(&by_handle, 2, eiTRUE);
+
+	eiCHECK(ei_test_image_average(&by_handle) > 0.0f);
+	eiCHECK(ei_test_image_identical(&by_name, &by_handle));
+
+	ei_test_image_exit(&by_handle);
+	ei_test_image_exit(&by_name);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_one_object());
+	eiRUN_TEST(test_two_objects());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of QMC sequences by ambient occlusion, images rendered
+ * with few occlusion rays must converge to a reference rendered with
+ * many rays, with both the Halton and the Sobol sequence, and with
+ * contrast-driven and variance-driven sampling.
+ * \file test_qmc_ao.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#include <eiAPI/ei_options.h>
+
+#define TEST_WIDTH				80
+#define TEST_HEIGHT				60
+#define TEST_REFERENCE_RAYS		1024
+#define TEST_RAYS				16
+/* the error of 16 occlusion rays per pixel is around 1/8 at most */
+#define TEST_RMS_TOLERANCE		0.1f
+/* the errors of pixels average out over the image */
+#define TEST_AVERAGE_TOLERANCE	0.01f
+
+static void render_ao(eiTestImage *image, const eiInt sequence, const eiInt sampling_mode, const eiInt rays)
+{
+	ei_test_image_init(image, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	ei_test_load_scene("qmc_ao.ess");
+
+	ei_options("opt");
+		ei_qmc_sequence(sequence);
+		if (sampling_mode == EI_SAMPLING_MODE_VARIANCE)
+		{
+			ei_samples(1, 4);
+			ei_sampling_mode(EI_SAMPLING_MODE_VARIANCE, 0.01f, 0.0f);
+		}
+	ei_end_options();
+
+	ei_shader("ao_shader");
+		ei_shader_param_int("rays", rays);
+	ei_end_shader();
+
+	ei_test_render(image);
+
+	ei_test_unload_scene();
+}
+
+static void check_convergence(const eiTestImage *reference, const eiInt sequence, const eiInt sampling_mode, const char *name)
+{
+	eiTestImage		image;
+	eiScalar		rms;
+
+	render_ao(&image, sequence, sampling_mode, TEST_RAYS);
+
+	rms = ei_test_image_rms_difference(reference, &image);
+
+	printf("%s: RMS error %f with %d rays\n", name, rms, TEST_RAYS);
+
+	eiCHECK(rms <= TEST_RMS_TOLERANCE);
+	eiCHECK(fabs(ei_test_image_average(&image) - ei_test_image_average(reference)) <= TEST_AVERAGE_TOLERANCE);
+
+	ei_test_image_exit(&image);
+}
+
+static void test_ao_convergence()
+{
+	eiTestImage		reference;
+
+	render_ao(&reference, EI_QMC_SEQUENCE_HALTON, EI_SAMPLING_MODE_CONTRAST, TEST_REFERENCE_RAYS);
+
+	eiCHECK(reference.pixels != NULL);
+	eiCHECK(ei_test_image_average(&reference) > 0.0f);
+
+	check_convergence(&reference, EI_QMC_SEQUENCE_HALTON, EI_SAMPLING_MODE_CONTRAST, "Halton");
+	check_convergence(&reference, EI_QMC_SEQUENCE_SOBOL, EI_SAMPLING_MODE_CONTRAST, "Sobol");
+
+	ei_test_image_exit(&reference);
+}
+
+/** \brief Variance-driven sampling draws positions in pixels from
+ * its own dimensions, if they overlapped the occlusion rays, the
+ * rays would follow the positions and the image would be biased. */
+static void test_ao_variance_sampling()
+{
+	eiTestImage		reference;
+
+	render_ao(&reference, EI_QMC_SEQUENCE_HALTON, EI_SAMPLING_MODE_VARIANCE, TEST_REFERENCE_RAYS);
+
+	eiCHECK(reference.pixels != NULL);
+
+	check_convergence(&reference, EI_QMC_SEQUENCE_HALTON, EI_SAMPLING_MODE_VARIANCE, "Halton variance");
+	check_convergence(&reference, EI_QMC_SEQUENCE_SOBOL, EI_SAMPLING_MODE_VARIANCE, "Sobol variance");
+
+	ei_test_image_exit(&reference);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_ao_convergence());
+	eiRUN_TEST(test_ao_variance_sampling());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of variance-driven sampling, the error estimated from
+ * the running statistics of a pixel must converge like the standard
+ * error of the mean, pixels of a flat image must stop at the minimum
+ * number of samples, and noisy pixels must take more.
+ * \file test_variance_sampling.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+#include <eiAPI/ei_options.h>
+#include <eiAPI/ei_sampler.h>
+
+#define TEST_WIDTH				80
+#define TEST_HEIGHT				60
+/* the maximum samples per pixel of samples 0 2 */
+#define TEST_MAX_SPP			16
+/* the estimated error of uniform random colors within this
+   fraction of the standard error */
+#define TEST_ERROR_TOLERANCE	0.25f
+
+static eiUint g_Seed = 12345;
+
+static eiScalar test_random()
+{
+	g_Seed = g_Seed * 1664525U + 1013904223U;
+
+	return (eiScalar)(g_Seed >> 8) / (eiScalar)(1 << 24);
+}
+
+/** \brief The standard error of the mean of n uniform random numbers
+ * in [0, 1) is sqrt(1/12/n), the estimate must follow it while n
+ * grows, and the mean must converge to 1/2. */
+static void test_error_converges()
+{
+	eiSampleStats	stats;
+	eiScalar		last_error;
+	eiInt			n;
+
+	ei_sample_stats_init(&stats);
+	last_error = eiMAX_SCALAR;
+
+	for (n = 64; n <= 4096; n *= 4)
+	{
+		eiScalar	expected, error;
+
+		while (stats.num_samples < n)
+		{
+			eiVector	color;
+
+			setv(&color, test_random(), test_random(), test_random());
+			ei_sample_stats_add(&stats, &color);
+		}
+
+		expected = sqrtf(1.0f / (12.0f * (eiScalar)n));
+		error = ei_sample_stats_error(&stats);
+
+		printf("%d samples: error %f, expected %f\n", n, error, expected);
+
+		eiCHECK(fabs(error - expected) <= TEST_ERROR_TOLERANCE * expected);
+		eiCHECK(error < last_error);
+		eiCHECK(fabs(stats.mean.x - 0.5f) <= 4.0f * expected);
+		eiCHECK(fabs(stats.mean.y - 0.5f) <= 4.0f * expected);
+		eiCHECK(fabs(stats.mean.z - 0.5f) <= 4.0f * expected);
+
+		last_error = error;
+	}
+}
+
+/** \brief The error is unknown with less than two samples, and zero
+ * for a constant color. */
+static void test_error_of_flat_pixel()
+{
+	eiSampleStats	stats;
+	eiVector		color;
+	eiInt			i;
+
+	ei_sample_stats_init(&stats);
+	eiCHECK(ei_sample_stats_error(&stats) == eiMAX_SCALAR);
+
+	setv(&color, 0.3f, 0.6f, 0.9f);
+	ei_sample_stats_add(&stats, &color);
+	eiCHECK(ei_sample_stats_error(&stats) == eiMAX_SCALAR);
+
+	for (i = 1; i < 4; ++i)
+	{
+		ei_sample_stats_add(&stats, &color);
+	}
+
+	eiCHECK(stats.num_samples == 4);
+	eiCHECK(ei_sample_stats_error(&stats) == 0.0f);
+}
+
+/** \brief Render the occlusion scene in variance mode, showing the
+ * number of samples of each pixel relative to the maximum. */
+static void render_sampling_rate(eiTestImage *image, const eiScalar intensity, const eiInt min_samples)
+{
+	eiInt	diagnostic_mode;
+
+	ei_test_image_init(image, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	ei_test_load_scene("qmc_ao.ess");
+
+	diagnostic_mode = EI_DIAGNOSTIC_MODE_SAMPLING_RATE;
+
+	ei_options("opt");
+		ei_samples(0, 2);
+		ei_sampling_mode(EI_SAMPLING_MODE_VARIANCE, 0.01f, 0.0f);
+		ei_variance_min_samples(min_samples);
+		ei_variable("diagnostic_mode", &diagnostic_mode);
+	ei_end_options();
+
+	ei_shader("ao_shader");
+		ei_shader_param_int("rays", 4);
+		ei_shader_param_scalar("intensity", intensity);
+	ei_end_shader();
+
+	ei_test_render(image);
+
+	ei_test_unload_scene();
+}
+
+static void check_flat_image(const eiInt min_samples)
+{
+	eiTestImage		image;
+	eiScalar		expected;
+	eiInt			num_different;
+	eiInt			i;
+
+	/* an intensity of 0 makes every sample black */
+	render_sampling_rate(&image, 0.0f, min_samples);
+
+	eiCHECK(image.pixels != NULL);
+
+	expected = (eiScalar)min_samples / (eiScalar)TEST_MAX_SPP;
+	num_different = 0;
+
+	for (i = 0; i < image.width * image.height * image.num_channels; ++i)
+	{
+		if (fabs(image.pixels[i] - expected) > 1.0e-5f)
+		{
+			++ num_different;
+		}
+	}
+
+	printf("%d minimum samples: %d channels of pixels differ from %f\n",
+		min_samples, num_different, expected);
+
+	eiCHECK(num_different == 0);
+
+	ei_test_image_exit(&image);
+}
+
+static void test_flat_pixels_stop_at_min_spp()
+{
+	check_flat_image(4);
+	check_flat_image(8);
+}
+
+/** \brief Occlusion with 4 rays is noisy, so pixels take more than
+ * the minimum samples on average. */
+static void test_noisy_pixels_take_more()
+{
+	eiTestImage		image;
+	eiScalar		average;
+
+	render_sampling_rate(&image, 1.0f, 4);
+
+	eiCHECK(image.pixels != NULL);
+
+	average = ei_test_image_average(&image);
+
+	printf("average sampling rate %f\n", average);
+
+	eiCHECK(average > 4.0f / (eiScalar)TEST_MAX_SPP);
+
+	ei_test_image_exit(&image);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_error_converges());
+	eiRUN_TEST(test_error_of_flat_pixel());
+	eiRUN_TEST(test_flat_pixels_stop_at_min_spp());
+	eiRUN_TEST(test_noisy_pixels_take_more());
+
+	return eiTEST_RESULT();
+}
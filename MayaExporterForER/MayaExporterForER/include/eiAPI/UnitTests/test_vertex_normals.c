@@ -0,0 +1,272 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of vertex normals calculated with multiple threads,
+ * the normals of a wavy grid, where every inner vertex is shared by
+ * six triangles, must match the ones calculated by a single thread,
+ * whether the triangles are in diced order or shuffled.
+ * \file test_vertex_normals.c
+ */
+
+#include <eiAPI/ei_object.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* the number of vertices on each side of the grid */
+#define TEST_GRID_SIZE		129
+#define TEST_NUM_VERTICES	(TEST_GRID_SIZE * TEST_GRID_SIZE)
+#define TEST_NUM_TRIANGLES	((TEST_GRID_SIZE - 1) * (TEST_GRID_SIZE - 1) * 2)
+/* threads sum the same normals in a different order */
+#define TEST_TOLERANCE		1.0e-5f
+
+/** \brief A triangle mesh in plain arrays. */
+typedef struct eiTestMesh {
+	eiVector	positions[ TEST_NUM_VERTICES ];
+	eiUint		triangles[ TEST_NUM_TRIANGLES ][3];
+} eiTestMesh;
+
+static eiTestMesh	g_Mesh;
+static eiScalar		g_Serial[3][ TEST_NUM_VERTICES ];
+static eiScalar		g_Parallel[3][ TEST_NUM_VERTICES ];
+
+static void get_test_triangle(
+	void *data, 
+	const eiUint i, 
+	eiUint *v1, 
+	eiUint *v2, 
+	eiUint *v3)
+{
+	eiTestMesh	*mesh = (eiTestMesh *)data;
+
+	*v1 = mesh->triangles[i][0];
+	*v2 = mesh->triangles[i][1];
+	*v3 = mesh->triangles[i][2];
+}
+
+/** \brief The angle between the edges of a triangle at vertex a. */
+static eiScalar get_test_angle(const eiVector *a, const eiVector *b, const eiVector *c)
+{
+	eiVector	e1, e2;
+
+	sub(&e1, b, a);
+	sub(&e2, c, a);
+	normalizei(&e1);
+	normalizei(&e2);
+
+	return acosf(MAX(-1.0f, MIN(1.0f, dot(&e1, &e2))));
+}
+
+static void accum_test_face_normals(
+	void *data, 
+	const eiUint first_tri, 
+	const eiUint last_tri, 
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint base)
+{
+	eiTestMesh	*mesh = (eiTestMesh *)data;
+	eiUint		i, k;
+
+	for (i = first_tri; i < last_tri; ++i)
+	{
+		eiVector	*p[3];
+		eiVector	e1, e2, fn;
+
+		for (k = 0; k < 3; ++k)
+		{
+			p[k] = &mesh->positions[ mesh->triangles[i][k] ];
+		}
+
+		sub(&e1, p[1], p[0]);
+		sub(&e2, p[2], p[0]);
+		cross(&fn, &e1, &e2);
+		normalizei(&fn);
+
+		for (k = 0; k < 3; ++k)
+		{
+			eiUint		v = mesh->triangles[i][k] - base;
+			eiScalar	w = get_test_angle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+
+			N0[v] += w * fn.x;
+			N1[v] += w * fn.y;
+			N2[v] += w * fn.z;
+		}
+	}
+}
+
+/** \brief Build a wavy grid, two triangles per cell, in the order
+ * of rows of cells like diced tessellations. */
+static void build_test_grid(eiTestMesh *mesh)
+{
+	eiUint	i, j, k;
+
+	for (j = 0; j < TEST_GRID_SIZE; ++j)
+	{
+		for (i = 0; i < TEST_GRID_SIZE; ++i)
+		{
+			setv(&mesh->positions[i + j * TEST_GRID_SIZE], 
+				(eiScalar)i, 
+				(eiScalar)j, 
+				3.0f * sinf((eiScalar)i * 0.2f) * cosf((eiScalar)j * 0.15f));
+		}
+	}
+
+	k = 0;
+
+	for (j = 0; j < TEST_GRID_SIZE - 1; ++j)
+	{
+		for (i = 0; i < TEST_GRID_SIZE - 1; ++i)
+		{
+			eiUint	v = i + j * TEST_GRID_SIZE;
+
+			mesh->triangles[k][0] = v;
+			mesh->triangles[k][1] = v + 1;
+			mesh->triangles[k][2] = v + 1 + TEST_GRID_SIZE;
+			++ k;
+
+			mesh->triangles[k][0] = v;
+			mesh->triangles[k][1] = v + 1 + TEST_GRID_SIZE;
+			mesh->triangles[k][2] = v + TEST_GRID_SIZE;
+			++ k;
+		}
+	}
+}
+
+static void calc_test_normals(eiScalar N[3][ TEST_NUM_VERTICES ], const eiUint num_threads)
+{
+	eiVertexNormalsMesh		mesh;
+
+	mesh.data = &g_Mesh;
+	mesh.num_vertices = TEST_NUM_VERTICES;
+	mesh.num_triangles = TEST_NUM_TRIANGLES;
+	mesh.get_triangle = get_test_triangle;
+	mesh.accum_face_normals = accum_test_face_normals;
+
+	ei_calc_vertex_normals(&mesh, N[0], N[1], N[2], num_threads);
+}
+
+/** \brief Compare normals with multiple threads to the serial ones,
+ * which must be of unit length. */
+static void check_parallel_normals()
+{
+	const eiUint	threads[] = { 2, 3, 4, 7, 16, 64 };
+	eiUint			t, i;
+
+	calc_test_normals(g_Serial, 1);
+
+	for (i = 0; i < TEST_NUM_VERTICES; ++i)
+	{
+		eiScalar	len;
+
+		len = sqrtf(g_Serial[0][i] * g_Serial[0][i] + 
+			g_Serial[1][i] * g_Serial[1][i] + 
+			g_Serial[2][i] * g_Serial[2][i]);
+
+		if (fabs(len - 1.0f) > TEST_TOLERANCE)
+		{
+			eiCHECK(fabs(len - 1.0f) <= TEST_TOLERANCE);
+			return;
+		}
+	}
+
+	for (t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+	{
+		eiScalar	max_diff = 0.0f;
+		eiUint		c;
+
+		calc_test_normals(g_Parallel, threads[t]);
+
+		for (c = 0; c < 3; ++c)
+		{
+			for (i = 0; i < TEST_NUM_VERTICES; ++i)
+			{
+				max_diff = MAX(max_diff, (eiScalar)fabs(g_Parallel[c][i] - g_Serial[c][i]));
+			}
+		}
+
+		printf("%u threads: max difference %g\n", threads[t], max_diff);
+
+		eiCHECK(max_diff <= TEST_TOLERANCE);
+	}
+}
+
+static void test_diced_order()
+{
+	build_test_grid(&g_Mesh);
+
+	check_parallel_normals();
+}
+
+/** \brief Shuffled triangles reference all vertices from every
+ * range, which falls back to a single thread, with the same normals. */
+static void test_shuffled_order()
+{
+	eiUint	seed = 12345;
+	eiUint	i;
+
+	build_test_grid(&g_Mesh);
+
+	for (i = TEST_NUM_TRIANGLES - 1; i > 0; --i)
+	{
+		eiUint	j, k, tmp;
+
+		seed = seed * 1664525U + 1013904223U;
+		j = (seed >> 8) % (i + 1);
+
+		for (k = 0; k < 3; ++k)
+		{
+			tmp = g_Mesh.triangles[i][k];
+			g_Mesh.triangles[i][k] = g_Mesh.triangles[j][k];
+			g_Mesh.triangles[j][k] = tmp;
+		}
+	}
+
+	check_parallel_normals();
+}
+
+/** \brief Vertices of a flat grid have the normal of the plane. */
+static void test_flat_grid()
+{
+	eiUint	i;
+
+	build_test_grid(&g_Mesh);
+
+	for (i = 0; i < TEST_NUM_VERTICES; ++i)
+	{
+		g_Mesh.positions[i].z = 0.0f;
+	}
+
+	calc_test_normals(g_Parallel, 4);
+
+	for (i = 0; i < TEST_NUM_VERTICES; ++i)
+	{
+		if (fabs(g_Parallel[2][i] - 1.0f) > TEST_TOLERANCE)
+		{
+			eiCHECK(fabs(g_Parallel[2][i] - 1.0f) <= TEST_TOLERANCE);
+			return;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_diced_order());
+	eiRUN_TEST(test_shuffled_order());
+	eiRUN_TEST(test_flat_grid());
+
+	return eiTEST_RESULT();
+}
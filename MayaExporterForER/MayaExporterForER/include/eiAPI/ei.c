@@ -972,6 +972,85 @@ void ei_render(const char *root_instgroup, const char *camera_inst, const char *
 	ei_renderer_render(g_Context->renderer, root_instgrp_tag, cam_inst_tag, opt_tag);
 }
 
+void ei_begin_session(const char *root_instgroup, const char *camera_inst, const char *options)
+{
+	eiNodeSystem	*nodesys;
+	eiTag			root_instgrp_tag;
+	eiTag			cam_inst_tag;
+	eiTag			opt_tag;
+
+	nodesys = g_Context->nodesys;
+
+	root_instgrp_tag = ei_nodesys_find_node(nodesys, root_instgroup);
+	cam_inst_tag = ei_nodesys_find_node(nodesys, camera_inst);
+	opt_tag = ei_nodesys_find_node(nodesys, options);
+
+	if (root_instgrp_tag == eiNULL_TAG || 
+		cam_inst_tag == eiNULL_TAG || 
+		opt_tag == eiNULL_TAG)
+	{
+		ei_error("Cannot find the scene to begin session.\n");
+		return;
+	}
+
+	ei_renderer_begin_session(g_Context->renderer, root_instgrp_tag, cam_inst_tag, opt_tag);
+}
+
+static void ei_update_session(const char *name, const eiInt edits)
+{
+	eiTag	node;
+
+	node = ei_nodesys_find_node(g_Context->nodesys, name);
+
+	if (node == eiNULL_TAG)
+	{
+		ei_error("Cannot find the edited element %s.\n", name);
+		return;
+	}
+
+	ei_renderer_update_session(g_Context->renderer, edits, node);
+}
+
+void ei_update_shader(const char *name)
+{
+	ei_update_session(name, EI_EDIT_SHADER);
+}
+
+void ei_update_light(const char *name)
+{
+	ei_update_session(name, EI_EDIT_LIGHT);
+}
+
+void ei_update_camera(const char *name)
+{
+	ei_update_session(name, EI_EDIT_CAMERA);
+}
+
+void ei_update_instance(const char *name)
+{
+	ei_update_session(name, EI_EDIT_INSTANCE);
+}
+
+void ei_update_object(const char *name)
+{
+	ei_update_session(name, EI_EDIT_GEOMETRY);
+}
+
+void ei_update_options(const char *name)
+{
+	ei_update_session(name, EI_EDIT_OPTIONS);
+}
+
+void ei_render_progressive()
+{
+	ei_renderer_render_session(g_Context->renderer);
+}
+
+void ei_end_session()
+{
+	ei_renderer_end_session(g_Context->renderer);
+}
+
 void ei_declare(const char *name, const eiInt storage_class, const eiInt type, const void *default_value)
 {
 	eiNodeSystem	*nodesys;
@@ -1204,6 +1283,74 @@ void ei_samples(eiInt min, eiInt max)
 	}
 }
 
+/** \brief Select the sampling mode and its termination criteria. */
+void ei_sampling_mode(eiInt mode, eiScalar noise_threshold, eiScalar time_limit)
+{
+	eiOptions	*opt;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	clampi(mode, EI_SAMPLING_MODE_CONTRAST, EI_SAMPLING_MODE_COUNT - 1);
+
+	opt = (eiOptions *)g_Context->current_node;
+
+	opt->sampling_mode = mode;
+	opt->noise_threshold = MAX(0.0f, noise_threshold);
+	opt->sampling_time_limit = MAX(0.0f, time_limit);
+}
+
+/** \brief Set the initial samples of pixels in variance mode. */
+void ei_variance_min_samples(eiInt num_samples)
+{
+	eiOptions	*opt;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	opt = (eiOptions *)g_Context->current_node;
+
+	opt->variance_min_samples = MAX(2, num_samples);
+}
+
+/** \brief Enable progressive rendering and set its budgets. */
+void ei_progressive(eiBool enable, eiScalar time_limit, eiInt max_samples)
+{
+	eiOptions	*opt;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	opt = (eiOptions *)g_Context->current_node;
+
+	opt->progressive = enable;
+	opt->progressive_time_limit = MAX(0.0f, time_limit);
+	opt->progressive_samples = MAX(0, max_samples);
+}
+
+/** \brief Select the low-discrepancy sequence for QMC sampling. */
+void ei_qmc_sequence(eiInt sequence)
+{
+	eiOptions	*opt;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	clampi(sequence, EI_QMC_SEQUENCE_HALTON, EI_QMC_SEQUENCE_COUNT - 1);
+
+	opt = (eiOptions *)g_Context->current_node;
+
+	opt->qmc_sequence = sequence;
+}
+
 /** \brief Set the bucket size of tiled rendering. */
 void ei_bucket_size(eiInt size)
 {
@@ -2821,6 +2968,42 @@ void ei_degree(eiInt degree)
 		degree);
 }
 
+void ei_hair_intersect_mode(eiInt mode)
+{
+	eiNodeSystem	*nodesys;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	nodesys = g_Context->nodesys;
+
+	ei_nodesys_set_int(
+		nodesys, 
+		&g_Context->current_node, 
+		"intersect_mode", 
+		mode);
+}
+
+void ei_hair_motion_segments(eiInt num)
+{
+	eiNodeSystem	*nodesys;
+
+	if (!ei_non_nested_pair_inside(&g_Context->node_pair))
+	{
+		return;
+	}
+
+	nodesys = g_Context->nodesys;
+
+	ei_nodesys_set_int(
+		nodesys, 
+		&g_Context->current_node, 
+		"motion_segments", 
+		num);
+}
+
 void ei_vertex_list(const eiTag tab)
 {
 	eiNodeSystem	*nodesys;
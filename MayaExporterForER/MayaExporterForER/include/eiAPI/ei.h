@@ -68,6 +68,13 @@ enum {
 	EI_ACCEL_COUNT, 
 };
 
+/** \brief The hair intersection mode */
+enum {
+	EI_HAIR_INTERSECT_BSP = 0, 
+	EI_HAIR_INTERSECT_PACKET, 
+	EI_HAIR_INTERSECT_COUNT, 
+};
+
 /** \brief The image data types */
 enum {
 	EI_IMG_DATA_NONE = 0, 
@@ -185,6 +192,32 @@ eiAPI void ei_delete(const char *element_name);
  */
 eiAPI void ei_render(const char *root_instgroup, const char *camera_inst, const char *options);
 
+/* interactive sessions */
+/** \brief Begin an interactive session for the scene. The scene and 
+ * acceleration structures are kept across renderings of the session, 
+ * edits must be reported by ei_update_* statements so that only the 
+ * data depending on the edits will be rebuilt.
+ */
+eiAPI void ei_begin_session(const char *root_instgroup, const char *camera_inst, const char *options);
+/** \brief Report that parameters of a shader have been edited. */
+eiAPI void ei_update_shader(const char *name);
+/** \brief Report that parameters of a light have been edited. */
+eiAPI void ei_update_light(const char *name);
+/** \brief Report that a camera has been edited or moved. */
+eiAPI void ei_update_camera(const char *name);
+/** \brief Report that the transform or attributes of an instance 
+ * have been edited. */
+eiAPI void ei_update_instance(const char *name);
+/** \brief Report that the geometry of an object has been edited. */
+eiAPI void ei_update_object(const char *name);
+/** \brief Report that the global options have been edited. */
+eiAPI void ei_update_options(const char *name);
+/** \brief Render the session progressively with all edits applied. */
+eiAPI void ei_render_progressive();
+/** \brief End the interactive session, the images of last 
+ * rendering will be written to outputs. */
+eiAPI void ei_end_session();
+
 /* nodes */
 eiAPI void ei_declare(const char *name, const eiInt storage_class, const eiInt type, const void *default_value);
 eiAPI void ei_variable(const char *name, const void *value);
@@ -217,6 +250,33 @@ eiAPI void ei_options(const char *name);
 	/** \brief This statement determines the minimum and maximum sample rate.
 	 */
 	eiAPI void ei_samples(eiInt min, eiInt max);
+	/** \brief Select the sampling mode. In variance mode, sampling 
+	 * runs in rounds which spend samples on the pixels with highest 
+	 * estimated error, until the standard error of every pixel falls 
+	 * below noise_threshold or time_limit seconds have been spent on 
+	 * a bucket. A time_limit of 0 means no limit.
+	 */
+	eiAPI void ei_sampling_mode(eiInt mode, eiScalar noise_threshold, eiScalar time_limit);
+	/** \brief The number of samples every pixel takes in variance mode 
+	 * before its error is estimated, at least 2, 4 by default.
+	 */
+	eiAPI void ei_variance_min_samples(eiInt num_samples);
+	/** \brief Enable progressive rendering. The frame is rendered in 
+	 * successive passes starting from one sample per pixel, each pass 
+	 * raises the sample rate by one level up to the maximum sample rate, 
+	 * then passes of the maximum sample rate repeat with new samples. 
+	 * The samples of all passes are accumulated. Rendering stops within 
+	 * a bucket of exceeding time_limit seconds, or when the next pass 
+	 * would take the accumulated samples per pixel over max_samples. 
+	 * Zero means no limit, without any limit rendering stops after the 
+	 * pass of the maximum sample rate.
+	 */
+	eiAPI void ei_progressive(eiBool enable, eiScalar time_limit, eiInt max_samples);
+	/** \brief Select the low-discrepancy sequence for QMC sampling. 
+	 * The Sobol sequence is Owen-scrambled per pixel and supports any 
+	 * number of dimensions, which suits deep ray trees.
+	 */
+	eiAPI void ei_qmc_sequence(eiInt sequence);
 	/** \brief Set the bucket size of tiled rendering.
 	 */
 	eiAPI void ei_bucket_size(eiInt size);
@@ -480,6 +540,13 @@ eiAPI void ei_object(const char *name, const char *type);
 
 	/* hair objects */
 	eiAPI void ei_degree(eiInt degree);
+	/** \brief Set how rays intersect with the hair object, 
+	 * EI_HAIR_INTERSECT_BSP by default. */
+	eiAPI void ei_hair_intersect_mode(eiInt mode);
+	/** \brief Set the number of time segments for moving hairs 
+	 * intersected as packets, each segment has its own hierarchy 
+	 * bounding only its part of the motion, 8 by default. */
+	eiAPI void ei_hair_motion_segments(eiInt num);
 
 	eiAPI void ei_vertex_list(const eiTag tab);
 	eiAPI void ei_motion_vertex_list(const eiTag tab);
@@ -16,6 +16,7 @@
 #include <eiAPI/ei_api.h>
 #include <eiAPI/ei_raytracer.h>
 #include <eiAPI/ei_rayhair.h>
+#include <eiAPI/ei_rayhair_packet.h>
 #include <eiAPI/ei_buffer.h>
 #include <eiAPI/ei_texture.h>
 #include <eiAPI/ei_nodesys.h>
@@ -121,6 +122,14 @@ void ei_api_init()
 	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_TREE ].cast = NULL;
 	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_TREE ].type_size = 0;
 
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].byteswap = byteswap_ray_hair_packets;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].generate_data = generate_ray_hair_packets;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].clear_data = NULL;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].execute_job = NULL;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].count_job = NULL;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].cast = NULL;
+	g_DataGenTable.data_gens[ EI_DATA_TYPE_RAY_HAIR_PACKETS ].type_size = 0;
+
 	g_DataGenTable.data_gens[ EI_DATA_TYPE_BUFFER ].byteswap = byteswap_data_buffer;
 	g_DataGenTable.data_gens[ EI_DATA_TYPE_BUFFER ].generate_data = NULL;
 	g_DataGenTable.data_gens[ EI_DATA_TYPE_BUFFER ].clear_data = NULL;
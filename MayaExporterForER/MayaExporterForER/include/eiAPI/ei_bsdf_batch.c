@@ -0,0 +1,552 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiAPI/ei_bsdf_batch.h>
+#include <eiCORE/ei_simd.h>
+
+/* must be the same as the scalar implementation */
+#define BSDF_EPS	1.0e-4f
+
+#define INV_PI		(1.0f / (eiScalar)eiPI)
+#define INV_2PI		(1.0f / (2.0f * (eiScalar)eiPI))
+
+/** \brief Load the first m lanes of a vector, the tail of a batch 
+ * is padded by repeating the last lane, so that nothing beyond the 
+ * batch is read. */
+static eiFORCEINLINE eiVf load_lanes(const eiScalar *p, const eiInt m)
+{
+	eiScalar	t[ EI_VF_WIDTH ];
+	eiInt		l;
+
+	if (m >= EI_VF_WIDTH)
+	{
+		return ei_vf_load(p);
+	}
+
+	for (l = 0; l < EI_VF_WIDTH; ++l)
+	{
+		t[l] = p[ MIN(l, m - 1) ];
+	}
+
+	return ei_vf_load(t);
+}
+
+/** \brief Store the first m lanes of a vector, nothing beyond the 
+ * batch is written. */
+static eiFORCEINLINE void store_lanes(eiScalar *p, const eiInt m, const eiVf a)
+{
+	eiScalar	t[ EI_VF_WIDTH ];
+	eiInt		l;
+
+	if (m >= EI_VF_WIDTH)
+	{
+		ei_vf_store(p, a);
+		return;
+	}
+
+	ei_vf_store(t, a);
+
+	for (l = 0; l < m; ++l)
+	{
+		p[l] = t[l];
+	}
+}
+
+/** \brief Load a vector of directions from a batch, the arrays of 
+ * a batch are always EI_BSDF_BATCH_SIZE long, lanes beyond the tail 
+ * are loaded but their results are never stored. */
+static eiFORCEINLINE void load_dir(
+	eiVf *x, eiVf *y, eiVf *z,
+	const eiDirBatch *w,
+	const eiInt i)
+{
+	*x = ei_vf_load(w->x + i);
+	*y = ei_vf_load(w->y + i);
+	*z = ei_vf_load(w->z + i);
+}
+
+/** \brief The normalized half vector of wo and wi, matches
+ * normalizei which clamps the squared length. */
+static eiFORCEINLINE void half_vector(
+	eiVf *hx, eiVf *hy, eiVf *hz,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiInt i)
+{
+	eiVf	ox, oy, oz;
+	eiVf	ix, iy, iz;
+	eiVf	inv_len;
+
+	load_dir(&ox, &oy, &oz, wo, i);
+	load_dir(&ix, &iy, &iz, wi, i);
+
+	*hx = ei_vf_add(ox, ix);
+	*hy = ei_vf_add(oy, iy);
+	*hz = ei_vf_add(oz, iz);
+
+	inv_len = ei_vf_div(ei_vf_set1(1.0f), ei_vf_sqrt(ei_vf_max(
+		ei_vf_add(ei_vf_add(ei_vf_mul(*hx, *hx), ei_vf_mul(*hy, *hy)), ei_vf_mul(*hz, *hz)),
+		ei_vf_set1(eiSCALAR_EPS))));
+
+	*hx = ei_vf_mul(*hx, inv_len);
+	*hy = ei_vf_mul(*hy, inv_len);
+	*hz = ei_vf_mul(*hz, inv_len);
+}
+
+void ei_lambert_bsdf_batch(
+	eiScalar * const f,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		/* premultiply by cosThetaI */
+		store_lanes(f + i, m, ei_vf_mul(ei_vf_abs(ei_vf_load(wi->z + i)), ei_vf_set1(INV_PI)));
+	}
+}
+
+void ei_lambert_pdf_batch(
+	eiScalar * const pdf,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	oz, iz, p;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		oz = ei_vf_load(wo->z + i);
+		iz = ei_vf_load(wi->z + i);
+
+		p = ei_vf_mul(ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_abs(iz)), ei_vf_set1(INV_PI));
+
+		store_lanes(pdf + i, m, ei_vf_select(
+			ei_vf_gt(ei_vf_mul(oz, iz), ei_vf_set1(0.0f)),
+			p,
+			ei_vf_set1(0.0f)));
+	}
+}
+
+void ei_specularreflection_sample_bsdf_batch(
+	const eiDirBatch *wo,
+	eiDirBatch * const wi,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		store_lanes(wi->x + i, m, ei_vf_sub(ei_vf_set1(0.0f), ei_vf_load(wo->x + i)));
+		store_lanes(wi->y + i, m, ei_vf_sub(ei_vf_set1(0.0f), ei_vf_load(wo->y + i)));
+		store_lanes(wi->z + i, m, ei_vf_load(wo->z + i));
+	}
+}
+
+eiUint ei_speculartransmission_sample_bsdf_batch(
+	const eiDirBatch *wo,
+	eiDirBatch * const wi,
+	const eiScalar etai,
+	const eiScalar etat,
+	const eiInt n)
+{
+	eiUint	valid;
+	eiInt	i, m;
+
+	valid = 0;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	ox, oy, oz;
+		eiVf	entering, eta, sini2, sint2, cost;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		load_dir(&ox, &oy, &oz, wo, i);
+
+		/* figure out which eta is incident and which is transmitted */
+		entering = ei_vf_gt(oz, ei_vf_set1(0.0f));
+		eta = ei_vf_select(entering, ei_vf_set1(etai / etat), ei_vf_set1(etat / etai));
+
+		/* compute transmitted ray direction */
+		sini2 = ei_vf_max(ei_vf_set1(0.0f), ei_vf_sub(ei_vf_set1(1.0f), ei_vf_mul(oz, oz)));
+		sint2 = ei_vf_mul(ei_vf_mul(eta, eta), sini2);
+		cost = ei_vf_sqrt(ei_vf_max(ei_vf_set1(0.0f), ei_vf_sub(ei_vf_set1(1.0f), sint2)));
+		cost = ei_vf_select(entering, ei_vf_sub(ei_vf_set1(0.0f), cost), cost);
+
+		store_lanes(wi->x + i, m, ei_vf_mul(eta, ei_vf_sub(ei_vf_set1(0.0f), ox)));
+		store_lanes(wi->y + i, m, ei_vf_mul(eta, ei_vf_sub(ei_vf_set1(0.0f), oy)));
+		store_lanes(wi->z + i, m, cost);
+
+		/* handle total internal reflection for transmission */
+		valid |= ((eiUint)ei_vf_movemask(ei_vf_lt(sint2, ei_vf_set1(1.0f)))) << i;
+	}
+
+	if (n < 32)
+	{
+		valid &= (1U << n) - 1U;
+	}
+
+	return valid;
+}
+
+void ei_fresnel_dielectric_batch(
+	eiScalar * const F,
+	const eiScalar *cosi,
+	const eiScalar eta_i,
+	const eiScalar eta_t,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	c, entering, ei, et, sint, cost;
+		eiVf	Rparl, Rperp, R;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		c = load_lanes(cosi + i, m);
+		c = ei_vf_min(ei_vf_max(c, ei_vf_set1(-1.0f)), ei_vf_set1(1.0f));
+
+		/* compute indices of refraction for dielectric */
+		entering = ei_vf_gt(c, ei_vf_set1(0.0f));
+		ei = ei_vf_select(entering, ei_vf_set1(eta_i), ei_vf_set1(eta_t));
+		et = ei_vf_select(entering, ei_vf_set1(eta_t), ei_vf_set1(eta_i));
+
+		/* compute sint using Snell's law */
+		sint = ei_vf_mul(ei_vf_div(ei, et), ei_vf_sqrt(ei_vf_max(ei_vf_set1(0.0f),
+			ei_vf_sub(ei_vf_set1(1.0f), ei_vf_mul(c, c)))));
+		cost = ei_vf_sqrt(ei_vf_max(ei_vf_set1(0.0f), ei_vf_sub(ei_vf_set1(1.0f), ei_vf_mul(sint, sint))));
+		c = ei_vf_abs(c);
+
+		Rparl = ei_vf_div(
+			ei_vf_sub(ei_vf_mul(et, c), ei_vf_mul(ei, cost)),
+			ei_vf_add(ei_vf_mul(et, c), ei_vf_mul(ei, cost)));
+		Rperp = ei_vf_div(
+			ei_vf_sub(ei_vf_mul(ei, c), ei_vf_mul(et, cost)),
+			ei_vf_add(ei_vf_mul(ei, c), ei_vf_mul(et, cost)));
+		R = ei_vf_mul(ei_vf_add(ei_vf_mul(Rparl, Rparl), ei_vf_mul(Rperp, Rperp)), ei_vf_set1(0.5f));
+
+		/* handle total internal reflection */
+		store_lanes(F + i, m, ei_vf_select(ei_vf_ge(sint, ei_vf_set1(1.0f)), ei_vf_set1(1.0f), R));
+	}
+}
+
+/** \brief (1 - x)^5 for x in [0, 1], clamped as the scalar
+ * implementation. */
+static eiFORCEINLINE eiVf pow5_one_minus(const eiVf x)
+{
+	eiVf	t, t2;
+
+	t = ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_sub(ei_vf_set1(1.0f), x));
+	t2 = ei_vf_mul(t, t);
+
+	return ei_vf_mul(ei_vf_mul(t2, t2), t);
+}
+
+void ei_fresnelblend_bsdf_batch(
+	eiColorBatch * const f,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiVector *Rd,
+	const eiVector *Rs,
+	eiMicrofacet_bsdf_batch dist,
+	void *dist_param,
+	const eiInt n)
+{
+	eiScalar	D[ EI_BSDF_BATCH_SIZE ];
+	eiDirBatch	wh;
+	eiVf		zero_h[ EI_BSDF_BATCH_SIZE / EI_VF_WIDTH ];
+	eiInt		i, m;
+
+	/* compute half vectors for the distribution first */
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	hx, hy, hz;
+		eiVf	eps;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		hx = ei_vf_add(ei_vf_load(wo->x + i), ei_vf_load(wi->x + i));
+		hy = ei_vf_add(ei_vf_load(wo->y + i), ei_vf_load(wi->y + i));
+		hz = ei_vf_add(ei_vf_load(wo->z + i), ei_vf_load(wi->z + i));
+
+		eps = ei_vf_set1(BSDF_EPS);
+		zero_h[ i / EI_VF_WIDTH ] = ei_vf_and(
+			ei_vf_and(ei_vf_lt(ei_vf_abs(hx), eps), ei_vf_lt(ei_vf_abs(hy), eps)),
+			ei_vf_lt(ei_vf_abs(hz), eps));
+
+		half_vector(&hx, &hy, &hz, wo, wi, i);
+		ei_vf_store(wh.x + i, hx);
+		ei_vf_store(wh.y + i, hy);
+		ei_vf_store(wh.z + i, hz);
+	}
+
+	dist(D, &wh, dist_param, n);
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	ix, iy, iz, oz;
+		eiVf	cos_i, cos_o, idoth;
+		eiVf	Kd, k, invKs, Ks;
+		eiVf	invalid;
+		eiVf	zero;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		load_dir(&ix, &iy, &iz, wi, i);
+		oz = ei_vf_load(wo->z + i);
+
+		cos_i = ei_vf_abs(iz);
+		cos_o = ei_vf_abs(oz);
+		idoth = ei_vf_add(ei_vf_add(
+			ei_vf_mul(ix, ei_vf_load(wh.x + i)),
+			ei_vf_mul(iy, ei_vf_load(wh.y + i))),
+			ei_vf_mul(iz, ei_vf_load(wh.z + i)));
+
+		Kd = ei_vf_mul(ei_vf_set1(28.0f / (23.0f * (eiScalar)eiPI)), ei_vf_mul(
+			ei_vf_sub(ei_vf_set1(1.0f), pow5_one_minus(ei_vf_mul(ei_vf_set1(0.5f), cos_i))),
+			ei_vf_sub(ei_vf_set1(1.0f), pow5_one_minus(ei_vf_mul(ei_vf_set1(0.5f), cos_o)))));
+
+		/* Schlick's approximation of Fresnel */
+		k = pow5_one_minus(idoth);
+
+		invKs = ei_vf_mul(ei_vf_set1(8.0f * (eiScalar)eiPI),
+			ei_vf_mul(ei_vf_abs(idoth), ei_vf_max(cos_i, cos_o)));
+		invalid = ei_vf_or(zero_h[ i / EI_VF_WIDTH ], ei_vf_lt(ei_vf_abs(invKs), ei_vf_set1(BSDF_EPS)));
+
+		/* premultiply cosThetaI */
+		Ks = ei_vf_div(ei_vf_mul(ei_vf_load(D + i), cos_i),
+			ei_vf_select(invalid, ei_vf_set1(1.0f), invKs));
+
+		zero = ei_vf_set1(0.0f);
+
+#define FRESNELBLEND_CHANNEL(c) \
+		store_lanes(f->c + i, m, ei_vf_select(invalid, zero, ei_vf_add(\
+			ei_vf_mul(Kd, ei_vf_set1(Rd->c * (1.0f - Rs->c))), \
+			ei_vf_mul(Ks, ei_vf_add(ei_vf_set1(Rs->c), ei_vf_mul(k, ei_vf_set1(1.0f - Rs->c)))))));
+
+		FRESNELBLEND_CHANNEL(r)
+		FRESNELBLEND_CHANNEL(g)
+		FRESNELBLEND_CHANNEL(b)
+
+#undef FRESNELBLEND_CHANNEL
+	}
+}
+
+void ei_blinn_microfacet_bsdf_batch(
+	eiScalar * const D,
+	const eiDirBatch *wh,
+	void *param,
+	const eiInt n)
+{
+	eiBlinnParams	*p;
+	eiInt			i, m;
+
+	p = (eiBlinnParams *)param;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	costhetah;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		costhetah = ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_abs(ei_vf_load(wh->z + i)));
+
+		store_lanes(D + i, m, ei_vf_mul(
+			ei_vf_set1((p->exponent + 2.0f) * INV_2PI),
+			ei_vf_pow(costhetah, ei_vf_set1(p->exponent))));
+	}
+}
+
+void ei_blinn_bsdf_batch(
+	eiScalar * const f,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiScalar exponent,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	hx, hy, hz;
+		eiVf	costhetah;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		half_vector(&hx, &hy, &hz, wo, wi, i);
+
+		costhetah = ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_abs(hz));
+
+		store_lanes(f + i, m, ei_vf_mul(
+			ei_vf_set1((exponent + 2.0f) * INV_2PI),
+			ei_vf_pow(costhetah, ei_vf_set1(exponent))));
+	}
+}
+
+void ei_blinn_pdf_batch(
+	eiScalar * const pdf,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiScalar exponent,
+	const eiInt n)
+{
+	eiInt	i, m;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	hx, hy, hz;
+		eiVf	costheta, odoth, p;
+		eiVf	valid;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		half_vector(&hx, &hy, &hz, wo, wi, i);
+
+		costheta = ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_abs(hz));
+		odoth = ei_vf_add(ei_vf_add(
+			ei_vf_mul(ei_vf_load(wo->x + i), hx),
+			ei_vf_mul(ei_vf_load(wo->y + i), hy)),
+			ei_vf_mul(ei_vf_load(wo->z + i), hz));
+		valid = ei_vf_gt(odoth, ei_vf_set1(BSDF_EPS));
+
+		p = ei_vf_div(
+			ei_vf_mul(ei_vf_set1(exponent + 1.0f), ei_vf_pow(costheta, ei_vf_set1(exponent))),
+			ei_vf_mul(ei_vf_set1(2.0f * (eiScalar)eiPI * 4.0f), ei_vf_select(valid, odoth, ei_vf_set1(1.0f))));
+
+		store_lanes(pdf + i, m, ei_vf_select(valid, p, ei_vf_set1(eiSCALAR_EPS)));
+	}
+}
+
+/** \brief The Ward distribution of half vectors, with the result
+ * for degenerated half vectors and the exponent. */
+static eiFORCEINLINE eiVf ward_distribution(
+	const eiVf hx, const eiVf hy, const eiVf hz,
+	const eiScalar shiny_u, const eiScalar shiny_v,
+	const eiScalar norm,
+	eiVf *ds)
+{
+	eiVf	costhetah, e;
+
+	costhetah = ei_vf_max(ei_vf_set1(BSDF_EPS), ei_vf_abs(hz));
+	*ds = ei_vf_sub(ei_vf_set1(1.0f), ei_vf_mul(costhetah, costhetah));
+
+	e = ei_vf_div(
+		ei_vf_add(ei_vf_mul(ei_vf_set1(shiny_u), ei_vf_mul(hx, hx)), ei_vf_mul(ei_vf_set1(shiny_v), ei_vf_mul(hy, hy))),
+		ei_vf_select(ei_vf_lt(ei_vf_abs(*ds), ei_vf_set1(BSDF_EPS)), ei_vf_set1(1.0f), *ds));
+
+	return ei_vf_mul(ei_vf_set1(norm), ei_vf_pow(costhetah, e));
+}
+
+void ei_ward_microfacet_bsdf_batch(
+	eiScalar * const D,
+	const eiDirBatch *wh,
+	void *param,
+	const eiInt n)
+{
+	eiWardParams	*p;
+	eiScalar		norm;
+	eiInt			i, m;
+
+	p = (eiWardParams *)param;
+	norm = sqrtf((p->shiny_u + 2.0f) * (p->shiny_v + 2.0f)) * INV_2PI;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	d, ds;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		d = ward_distribution(
+			ei_vf_load(wh->x + i), ei_vf_load(wh->y + i), ei_vf_load(wh->z + i),
+			p->shiny_u, p->shiny_v, norm, &ds);
+
+		store_lanes(D + i, m, ei_vf_select(ei_vf_lt(ei_vf_abs(ds), ei_vf_set1(BSDF_EPS)), ei_vf_set1(0.0f), d));
+	}
+}
+
+void ei_ward_bsdf_batch(
+	eiScalar * const f,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiScalar shiny_u, const eiScalar shiny_v,
+	const eiInt n)
+{
+	eiScalar	norm;
+	eiInt		i, m;
+
+	norm = sqrtf((shiny_u + 2.0f) * (shiny_v + 2.0f)) * INV_2PI;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	hx, hy, hz;
+		eiVf	d, ds;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		half_vector(&hx, &hy, &hz, wo, wi, i);
+
+		d = ward_distribution(hx, hy, hz, shiny_u, shiny_v, norm, &ds);
+
+		store_lanes(f + i, m, ei_vf_select(ei_vf_lt(ei_vf_abs(ds), ei_vf_set1(BSDF_EPS)), ei_vf_set1(0.0f), d));
+	}
+}
+
+void ei_ward_pdf_batch(
+	eiScalar * const pdf,
+	const eiDirBatch *wo,
+	const eiDirBatch *wi,
+	const eiScalar shiny_u, const eiScalar shiny_v,
+	const eiInt n)
+{
+	eiScalar	norm;
+	eiInt		i, m;
+
+	norm = sqrtf((shiny_u + 1.0f) * (shiny_v + 1.0f)) * INV_2PI;
+
+	for (i = 0; i < n; i += EI_VF_WIDTH)
+	{
+		eiVf	hx, hy, hz;
+		eiVf	d, ds, odoth, p;
+		eiVf	valid;
+
+		m = MIN(n - i, EI_VF_WIDTH);
+
+		half_vector(&hx, &hy, &hz, wo, wi, i);
+
+		d = ward_distribution(hx, hy, hz, shiny_u, shiny_v, norm, &ds);
+		odoth = ei_vf_add(ei_vf_add(
+			ei_vf_mul(ei_vf_load(wo->x + i), hx),
+			ei_vf_mul(ei_vf_load(wo->y + i), hy)),
+			ei_vf_mul(ei_vf_load(wo->z + i), hz));
+		valid = ei_vf_and(ei_vf_gt(ds, ei_vf_set1(BSDF_EPS)), ei_vf_gt(odoth, ei_vf_set1(BSDF_EPS)));
+
+		p = ei_vf_div(d, ei_vf_mul(ei_vf_set1(4.0f), ei_vf_select(valid, odoth, ei_vf_set1(1.0f))));
+
+		store_lanes(pdf + i, m, ei_vf_select(valid, p, ei_vf_set1(BSDF_EPS)));
+	}
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_BSDF_BATCH_H
+#define EI_BSDF_BATCH_H
+
+/** \brief Batched BSDF evaluation over structure-of-arrays
+ * directions, the scalar functions in ei_shader.h remain the
+ * reference implementation.
+ * \file ei_bsdf_batch.h
+ */
+
+#include <eiAPI/ei_shader.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the maximum number of directions in a batch */
+#define EI_BSDF_BATCH_SIZE		8
+
+/** \brief A batch of directions in structure-of-arrays layout.
+ * the batched functions may read lanes beyond n, which do not 
+ * affect the results, but they write only the first n lanes of 
+ * results, so arrays of scalar results can be as short as n. */
+typedef struct eiDirBatch {
+	eiScalar		x[ EI_BSDF_BATCH_SIZE ];
+	eiScalar		y[ EI_BSDF_BATCH_SIZE ];
+	eiScalar		z[ EI_BSDF_BATCH_SIZE ];
+} eiDirBatch;
+
+/** \brief A batch of colors in structure-of-arrays layout. */
+typedef struct eiColorBatch {
+	eiScalar		r[ EI_BSDF_BATCH_SIZE ];
+	eiScalar		g[ EI_BSDF_BATCH_SIZE ];
+	eiScalar		b[ EI_BSDF_BATCH_SIZE ];
+} eiColorBatch;
+
+/** \brief Batched microfacet distribution of half vectors. */
+typedef void (*eiMicrofacet_bsdf_batch)(
+	eiScalar * const D, 
+	const eiDirBatch *wh, 
+	void *param, 
+	const eiInt n);
+
+eiAPI void ei_lambert_bsdf_batch(
+	eiScalar * const f, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiInt n);
+eiAPI void ei_lambert_pdf_batch(
+	eiScalar * const pdf, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiInt n);
+
+eiAPI void ei_specularreflection_sample_bsdf_batch(
+	const eiDirBatch *wo, 
+	eiDirBatch * const wi, 
+	const eiInt n);
+/** \brief Returns the mask of lanes which are not totally
+ * internally reflected, bit i for lane i. */
+eiAPI eiUint ei_speculartransmission_sample_bsdf_batch(
+	const eiDirBatch *wo, 
+	eiDirBatch * const wi, 
+	const eiScalar etai, 
+	const eiScalar etat, 
+	const eiInt n);
+
+eiAPI void ei_fresnel_dielectric_batch(
+	eiScalar * const F, 
+	const eiScalar *cosi, 
+	const eiScalar eta_i, 
+	const eiScalar eta_t, 
+	const eiInt n);
+eiAPI void ei_fresnelblend_bsdf_batch(
+	eiColorBatch * const f, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiVector *Rd, 
+	const eiVector *Rs, 
+	eiMicrofacet_bsdf_batch dist, 
+	void *dist_param, 
+	const eiInt n);
+
+eiAPI void ei_blinn_microfacet_bsdf_batch(
+	eiScalar * const D, 
+	const eiDirBatch *wh, 
+	void *param, 
+	const eiInt n);
+eiAPI void ei_blinn_bsdf_batch(
+	eiScalar * const f, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiScalar exponent, 
+	const eiInt n);
+eiAPI void ei_blinn_pdf_batch(
+	eiScalar * const pdf, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiScalar exponent, 
+	const eiInt n);
+
+eiAPI void ei_ward_microfacet_bsdf_batch(
+	eiScalar * const D, 
+	const eiDirBatch *wh, 
+	void *param, 
+	const eiInt n);
+eiAPI void ei_ward_bsdf_batch(
+	eiScalar * const f, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiScalar shiny_u, const eiScalar shiny_v, 
+	const eiInt n);
+eiAPI void ei_ward_pdf_batch(
+	eiScalar * const pdf, 
+	const eiDirBatch *wo, 
+	const eiDirBatch *wi, 
+	const eiScalar shiny_u, const eiScalar shiny_v, 
+	const eiInt n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,6 +14,7 @@
  */
 
 #include <eiAPI/ei_camera.h>
+#include <eiCORE/ei_matrix_batch.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_assert.h>
 
@@ -178,18 +179,18 @@ void ei_camera_get_ray_dir(
 	p->z = - cam->focal;
 }
 
-void ei_camera_object_to_screen(
+/** \brief Project a point from view space to screen space, 
+ * p_pos may be v_pos. */
+static void view_to_screen(
 	eiCamera *cam, 
 	eiVector *p_pos, 
-	const eiVector *o_pos, 
-	const eiMatrix *object_to_view)
+	const eiVector *v_pos_in)
 {
 	eiVector	v_pos;
 	eiScalar	z;
 	eiScalar	k;
 
-	/* transform from object space to view space */
-	point_transform(&v_pos, o_pos, object_to_view);
+	movv(&v_pos, v_pos_in);
 
 	/* prevent from invalid projection division */
 	if (v_pos.z > cam->project_near_clip)
@@ -205,6 +206,38 @@ void ei_camera_object_to_screen(
 	p_pos->y = cam->image_center_y - v_pos.y * k * cam->camera_to_pixel_y;
 }
 
+void ei_camera_object_to_screen(
+	eiCamera *cam, 
+	eiVector *p_pos, 
+	const eiVector *o_pos, 
+	const eiMatrix *object_to_view)
+{
+	eiVector	v_pos;
+
+	/* transform from object space to view space */
+	point_transform(&v_pos, o_pos, object_to_view);
+
+	view_to_screen(cam, p_pos, &v_pos);
+}
+
+void ei_camera_object_to_screen_array(
+	eiCamera *cam, 
+	eiVector *p_pos, 
+	const eiVector *o_pos, 
+	const eiInt n, 
+	const eiMatrix *object_to_view)
+{
+	eiInt	i;
+
+	/* transform all points from object space to view space at once */
+	ei_point_transform_array(p_pos, o_pos, n, object_to_view);
+
+	for (i = 0; i < n; ++i)
+	{
+		view_to_screen(cam, &p_pos[i], &p_pos[i]);
+	}
+}
+
 void ei_camera_object_to_screen_box(
 	eiCamera *cam, 
 	eiBound *screen_box, 
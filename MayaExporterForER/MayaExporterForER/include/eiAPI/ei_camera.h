@@ -105,6 +105,14 @@ void ei_camera_object_to_screen(
 	eiVector *p_pos, 
 	const eiVector *o_pos, 
 	const eiMatrix *object_to_view);
+/** \brief Project an array of n points from object space to screen 
+ * space, p_pos may be o_pos. */
+eiAPI void ei_camera_object_to_screen_array(
+	eiCamera *cam, 
+	eiVector *p_pos, 
+	const eiVector *o_pos, 
+	const eiInt n, 
+	const eiMatrix *object_to_view);
 /** \brief Project a bounding box from object space to screen space. */
 void ei_camera_object_to_screen_box(
 	eiCamera *cam, 
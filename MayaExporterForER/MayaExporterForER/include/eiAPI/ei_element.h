@@ -64,6 +64,9 @@ typedef struct eiObjectRepCache {
 	eiTag				object_instances;
 	/* the light instances created during scene pre-processing */
 	eiTag				light_instances;
+	/* whether the scheduled tessellation jobs should defer dicing 
+	   to the hosts that access the tessellations */
+	eiBool				local_dice;
 } eiObjectRepCache;
 
 /** \brief The callback for instancing this element into 
@@ -454,6 +454,7 @@ void ei_sample_finalgather(
 	eiScalar				inv_MN;
 	eiVector				u_axis, v_axis;
 	eiScalar				offset_x, offset_y;
+	eiUint					seed;
 	eiUint					instance_offset = 0;
 	eiUint					j, k;
 	eiScalar				inv_Ri = BIG_NUM;
@@ -497,8 +498,11 @@ void ei_sample_finalgather(
 	ortho_basis(&state->N, &u_axis, &v_axis);
 
 	/* get an offset point from the global sequence for current dimension */
-	offset_x = (eiScalar)ei_sigma(state->dimension, state->instance_number);
-	offset_y = (eiScalar)ei_sigma(state->dimension + 1, state->instance_number);
+	offset_x = (eiScalar)ei_state_sigma(state, state->dimension, state->instance_number);
+	offset_y = (eiScalar)ei_state_sigma(state, state->dimension + 1, state->instance_number);
+	seed = ei_qmc_hash_combine(
+		ei_qmc_hash_combine(state->qmc_seed, state->instance_number), 
+		state->dimension);
 
 	for (k = 0; k < N; ++k)
 	{
@@ -512,9 +516,18 @@ void ei_sample_finalgather(
 			eiVector			local_u_axis, local_v_axis, local_w_axis;
 			eiHemisphereSample	hsample;
 
-			/* a Hammersley point set is used here for better discrepancy */
-			randVar[0] = fmodf(offset_x + (eiScalar)instance_offset * inv_MN, 1.0f);
-			randVar[1] = fmodf(offset_y + (eiScalar)ei_sigma(0, instance_offset), 1.0f);
+			if (state->opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+			{
+				/* a Sobol point set scrambled for this shading point */
+				randVar[0] = (eiScalar)ei_sobol(0, instance_offset, seed);
+				randVar[1] = (eiScalar)ei_sobol(1, instance_offset, seed);
+			}
+			else
+			{
+				/* a Hammersley point set is used here for better discrepancy */
+				randVar[0] = fmodf(offset_x + (eiScalar)instance_offset * inv_MN, 1.0f);
+				randVar[1] = fmodf(offset_y + (eiScalar)ei_sigma(0, instance_offset), 1.0f);
+			}
 
 			ei_state_init(&fg_ray, eiRAY_FINALGATHER, state->bucket);
 
@@ -527,6 +540,7 @@ void ei_sample_finalgather(
 			initv(&fg_ray.result->opacity);
 
 			fg_ray.instance_number = state->instance_number + instance_offset;
+			fg_ray.qmc_seed = state->qmc_seed;
 
 			sin_theta = sqrtf(((eiScalar)j + randVar[0]) * inv_M);
 			cos_theta = sqrtf(1.0f - sin_theta * sin_theta);
@@ -190,8 +190,8 @@ void ei_compute_irradiance(eiVector * const irrad, eiState * const state)
 
 				ortho_basis(&state->N, &u_axis, &v_axis);
 
-				u1 = (eiScalar)ei_sigma(state->dimension, state->instance_number);
-				u2 = (eiScalar)ei_sigma(state->dimension + 1, state->instance_number);
+				u1 = (eiScalar)ei_state_sigma(state, state->dimension, state->instance_number);
+				u2 = (eiScalar)ei_state_sigma(state, state->dimension + 1, state->instance_number);
 				state->dimension += 2;
 
 				ei_cosine_sample_hemisphere(&dir, u1, u2);
@@ -220,6 +220,7 @@ void ei_compute_irradiance(eiVector * const irrad, eiState * const state)
 				initv(&fg_ray.result->opacity);
 
 				fg_ray.instance_number = state->instance_number;
+				fg_ray.qmc_seed = state->qmc_seed;
 
 				fg_ray.org = ray_src;
 				fg_ray.dir = dir;
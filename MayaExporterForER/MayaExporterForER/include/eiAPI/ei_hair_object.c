@@ -15,7 +15,10 @@
 
 #include <eiAPI/ei_hair_object.h>
 #include <eiAPI/ei_rayhair.h>
+#include <eiAPI/ei_rayhair_packet.h>
+#include <eiAPI/ei.h>
 #include <eiCORE/ei_data_table.h>
+#include <eiCORE/ei_atomic_ops.h>
 #include <eiCORE/ei_assert.h>
 
 /** \brief The internal tessellable representation(sub-object) of 
@@ -29,11 +32,36 @@ typedef struct eiHairTessel {
 	eiTag		hair_list;
 } eiHairTessel;
 
+/** \brief Create the hair packets, they are only needed when the 
+ * object is intersected as packets. */
+static void ei_hair_object_create_packets(eiDatabase *db, eiHairObject *hair, const eiTag obj_tag)
+{
+	eiRayHairPackets	*packets;
+
+	packets = (eiRayHairPackets *)ei_db_create(
+		db, 
+		&hair->packets, 
+		EI_DATA_TYPE_RAY_HAIR_PACKETS, 
+		sizeof(eiRayHairPackets), 
+		EI_DB_FLUSHABLE);
+
+	packets->obj_tag = obj_tag;
+	packets->degree = 1;
+	packets->num_keys = 1;
+	packets->num_nodes = 0;
+	packets->num_segments = 1;
+	packets->num_packets = 0;
+	packets->packet_size = 0;
+	initb(&packets->box);
+
+	ei_db_end(db, hair->packets);
+}
+
 void ei_hair_object_init(eiNodeSystem *nodesys, eiNode *node)
 {
-	eiDatabase		*db;
-	eiHairObject	*hair;
-	eiRayHairTree	*bsptree;
+	eiDatabase			*db;
+	eiHairObject		*hair;
+	eiRayHairTree		*bsptree;
 
 	ei_object_init(nodesys, node);
 
@@ -47,6 +75,9 @@ void ei_hair_object_init(eiNodeSystem *nodesys, eiNode *node)
 	hair->bsp_size = 10;
 	hair->bsp_depth = 20;
 	hair->bsptree = eiNULL_TAG;
+	hair->intersect_mode = EI_HAIR_INTERSECT_BSP;
+	hair->packets = eiNULL_TAG;
+	hair->motion_segments = 8;
 
 	bsptree = (eiRayHairTree *)ei_db_create(
 		db, 
@@ -71,6 +102,12 @@ void ei_hair_object_exit(eiNodeSystem *nodesys, eiNode *node)
 	db = nodesys->m_db;
 	hair = (eiHairObject *)node;
 
+	if (hair->packets != eiNULL_TAG)
+	{
+		ei_db_delete(db, hair->packets);
+		hair->packets = eiNULL_TAG;
+	}
+
 	if (hair->bsptree != eiNULL_TAG)
 	{
 		ei_db_delete(db, hair->bsptree);
@@ -120,6 +157,44 @@ void ei_hair_object_changed(eiNodeSystem *nodesys, eiNode *node)
 	{
 		ei_db_dirt(db, hair->bsptree);
 	}
+
+	/* the packets exist only in packet mode, create them when the 
+	   mode is switched to packets and delete them when switched back */
+	if (hair->intersect_mode == EI_HAIR_INTERSECT_PACKET)
+	{
+		if (hair->packets == eiNULL_TAG)
+		{
+			ei_hair_object_create_packets(db, hair, node->tag);
+		}
+		else
+		{
+			ei_db_dirt(db, hair->packets);
+		}
+	}
+	else if (hair->packets != eiNULL_TAG)
+	{
+		ei_db_delete(db, hair->packets);
+		hair->packets = eiNULL_TAG;
+	}
+}
+
+/* let every host generate the data from the hair lists on its own 
+   instead of receiving the data generated by other hosts */
+static void ei_hair_object_gen_local(eiDatabase *db, const eiTag tag)
+{
+	eiData	*pData;
+
+	if (tag == eiNULL_TAG)
+	{
+		return;
+	}
+
+	/* don't trigger the generation here, only modify the flags */
+	pData = ei_db_access_info_defer_init(db, tag);
+
+	ei_atomic_set_mask(&pData->flag, EI_DB_GEN_LOCAL);
+
+	ei_db_end(db, tag);
 }
 
 eiTag ei_hair_object_create(
@@ -164,6 +239,15 @@ eiTag ei_hair_object_create(
 
 	ei_db_end(db, tessellable);
 
+	/* hairs are not diced, the ray-traceable BSP-tree and packets are 
+	   generated on first access, when local dicing is enabled every 
+	   host builds them from the hair lists it already has */
+	if (job->local_dice)
+	{
+		ei_hair_object_gen_local(db, src_hair->bsptree);
+		ei_hair_object_gen_local(db, src_hair->packets);
+	}
+
 	return tessellable;
 }
 
@@ -736,6 +820,42 @@ eiBool ei_hair_object_interp_vertex(
 	}
 }
 
+/** \brief Intersect with the hair BSP-tree or hair packets according 
+ * to the intersection mode of the object. */
+static void ei_hair_object_intersect_by_mode(
+	eiObject *obj, 
+	const eiTag tessel_tag, 
+	const eiIndex tessel_instance_index, 
+	const eiIndex parent_bsptree, 
+	eiState *state, 
+	ei_array *hit_info_array, 
+	const eiBool sort_by_distance)
+{
+	if (((eiHairObject *)obj)->intersect_mode == EI_HAIR_INTERSECT_PACKET && 
+		((eiHairObject *)obj)->packets != eiNULL_TAG)
+	{
+		ei_hair_object_intersect_packet(
+			obj, 
+			tessel_tag, 
+			tessel_instance_index, 
+			parent_bsptree, 
+			state, 
+			hit_info_array, 
+			sort_by_distance);
+	}
+	else
+	{
+		ei_hair_object_intersect(
+			obj, 
+			tessel_tag, 
+			tessel_instance_index, 
+			parent_bsptree, 
+			state, 
+			hit_info_array, 
+			sort_by_distance);
+	}
+}
+
 eiNodeObject *ei_create_hair_object_node_object(void *param)
 {
 	eiObjectElement	*element;
@@ -754,7 +874,7 @@ eiNodeObject *ei_create_hair_object_node_object(void *param)
 	element->dice = ei_hair_object_dice;
 	element->deferred_dice = ei_hair_object_deferred_dice;
 	element->split = ei_hair_object_split;
-	element->intersect = ei_hair_object_intersect;
+	element->intersect = ei_hair_object_intersect_by_mode;
 	element->interp_varying = ei_hair_object_interp_varying;
 	element->interp_vertex = ei_hair_object_interp_vertex;
 
@@ -828,6 +948,27 @@ void ei_install_hair_object_node(eiNodeSystem *nodesys)
 		EI_DATA_TYPE_TAG, 
 		"bsptree", 
 		&default_tag);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"intersect_mode", 
+		&default_int);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_TAG, 
+		"packets", 
+		&default_tag);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"motion_segments", 
+		&default_int);
 
 	ei_nodesys_end_node_desc(nodesys, desc, desc_tag);
 }
@@ -39,6 +39,10 @@ typedef struct eiHairObject {
 	eiInt			bsp_size;
 	eiInt			bsp_depth;
 	eiTag			bsptree;
+	eiInt			intersect_mode;
+	/* only created in packet mode, eiNULL_TAG otherwise */
+	eiTag			packets;
+	eiInt			motion_segments;
 } eiHairObject;
 #pragma pack(pop)
 
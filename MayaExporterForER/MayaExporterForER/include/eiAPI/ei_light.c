@@ -19,6 +19,7 @@
 #include <eiAPI/ei_shadesys.h>
 #include <eiAPI/ei_raytracer.h>
 #include <eiAPI/ei_photon.h>
+#include <eiCORE/ei_matrix_batch.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_data_table.h>
 #include <eiCORE/ei_assert.h>
@@ -189,27 +190,33 @@ static eiBool generate_photon_ray(
 	return eiTRUE;
 }
 
+void ei_light_instance_get_light_to_camera(
+	eiLightInstance *inst, 
+	eiCamera *cam, 
+	eiMatrix *light_to_camera)
+{
+	ei_mulmm_simd(light_to_camera, &inst->light_to_world, &cam->world_to_camera);
+}
+
 void ei_light_instance_shoot_photon(
 	eiLightInstance *light_inst, 
+	const eiMatrix *light_to_camera, 
 	const eiInt photon_type, 
 	eiInt *halton_num, 
 	eiBaseBucket *bucket)
 {
 	eiDatabase		*db;
 	eiOptions		*opt;
-	eiCamera		*cam;
 	eiRayTracer		*rt;
 	eiNodeSystem	*nodesys;
 	eiLight			*light;
 	eiVector		ray_src, ray_dir;
-	eiVector		temp_src, temp_dir;
 	eiUint			dimension = 2;
 	eiSampleInfo	sample_info;
 	eiState			photon_ray;
 
 	db = bucket->db;
 	opt = bucket->opt;
-	cam = bucket->cam;
 
 	/* get ray-tracer interface */
 	rt = (eiRayTracer *)ei_db_globals_interface(
@@ -245,10 +252,8 @@ void ei_light_instance_shoot_photon(
 	}
 
 	/* transform from light space to camera space */
-	point_transform(&temp_src, &ray_src, &light_inst->light_to_world);
-	point_transform(&ray_src, &temp_src, &cam->world_to_camera);
-	vector_transform(&temp_dir, &ray_dir, &light_inst->light_to_world);
-	vector_transform(&ray_dir, &temp_dir, &cam->world_to_camera);
+	point_transformi(&ray_src, light_to_camera);
+	vector_transformi(&ray_dir, light_to_camera);
 	normalizei(&ray_dir);
 
 	/* a fixed size sample info is considered sufficient for 
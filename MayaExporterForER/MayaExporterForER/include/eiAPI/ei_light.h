@@ -92,8 +92,15 @@ void ei_light_instance_transform(
 eiScalar ei_light_instance_get_max_flux(
 	eiLightInstance *inst, 
 	eiDatabase *db);
+/** \brief Concatenate the transformation from light space to 
+ * camera space, to be computed once for many photons. */
+void ei_light_instance_get_light_to_camera(
+	eiLightInstance *inst, 
+	eiCamera *cam, 
+	eiMatrix *light_to_camera);
 void ei_light_instance_shoot_photon(
 	eiLightInstance *light_inst, 
+	const eiMatrix *light_to_camera, 
 	const eiInt photon_type, 
 	eiInt *halton_num, 
 	eiBaseBucket *bucket);
@@ -1300,6 +1300,7 @@ void generate_node(
 
 	/* build parameter map */
 	ei_symbol_table_init(&node->param_table, (void *)eiNULL_INDEX);
+	ei_symbol_table_reserve(&node->param_table, node->num_params);
 
 	for (i = 0; i < node->num_params; ++i)
 	{
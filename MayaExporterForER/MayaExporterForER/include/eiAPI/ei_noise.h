@@ -22,6 +22,7 @@
  */
 
 #include <eiAPI/ei_noise_table.h>
+#include <eiCORE/ei_simd.h>
 
 #define FADE(t) ( t * t * t * ( t * ( t * 6 - 15 ) + 10 ) )
 #define FASTFLOOR(x) ( ((x)>0) ? ((int)x) : ((int)x-1 ) )
@@ -446,6 +447,290 @@ inline T pnoise( T x, T y, T z, float w, int px, int py, int pz, int pw, const u
     return 0.5f * (1.0f + 0.87f * ( LERP( s, n0, n1 ) ) );
 }
 
+/* SIMD variants of the noise templates, evaluating EI_VF_WIDTH
+   points at once. the permutation table lookups are done for each
+   lane, the rest follows the scalar templates operation by operation,
+   so the results match them up to rounding. */
+
+/* the same as FASTFLOOR, returns the fractional part and stores
+   the integral part of each lane */
+inline eiVf noise_floor( const eiVf x, eiInt *ix )
+{
+    eiVf	t;
+
+    ei_vf_store_int( ix, x );
+    t = ei_vi_to_vf( ei_vi_load( ix ) );
+    t = ei_vf_sub( t, ei_vf_select( ei_vf_gt( x, ei_vf_set1( 0.0f ) ), ei_vf_set1( 0.0f ), ei_vf_set1( 1.0f ) ) );
+    ei_vf_store_int( ix, t );
+
+    return ei_vf_sub( x, t );
+}
+
+/* wrap the lattice coordinates of a cell, period 0 is not periodic */
+inline void noise_wrap( const int i, const int period, int & i0, int & i1 )
+{
+    if (period > 0)
+    {
+        i0 = ( i % period ) & 0xff;
+        i1 = (( i + 1 ) % period) & 0xff;
+    }
+    else
+    {
+        i0 = i & 0xff;
+        i1 = ( i + 1 ) & 0xff;
+    }
+}
+
+inline eiVf noise_fade( const eiVf t )
+{
+    return ei_vf_mul( ei_vf_mul( ei_vf_mul( t, t ), t ),
+        ei_vf_add( ei_vf_mul( t, ei_vf_sub( ei_vf_mul( t, ei_vf_set1( 6.0f ) ), ei_vf_set1( 15.0f ) ) ), ei_vf_set1( 10.0f ) ) );
+}
+
+inline eiVf noise_lerp( const eiVf t, const eiVf a, const eiVf b )
+{
+    return ei_vf_add( a, ei_vf_mul( t, ei_vf_sub( b, a ) ) );
+}
+
+/* negate the lanes where the bit of hash is set */
+inline eiVf noise_flip( const eiVi h, const eiInt bit, const eiVf a )
+{
+    return ei_vf_select( ei_vi_eq( ei_vi_and( h, ei_vi_set1( bit ) ), ei_vi_set1( bit ) ),
+        ei_vf_sub( ei_vf_set1( 0.0f ), a ), a );
+}
+
+inline eiVf grad_vf( eiVi h, const eiVf x )
+{
+    eiVf	grad;
+
+    h		= ei_vi_and( h, ei_vi_set1( 15 ) );
+    grad	= ei_vf_add( ei_vf_set1( 1.0f ), ei_vi_to_vf( ei_vi_and( h, ei_vi_set1( 7 ) ) ) );
+    return ei_vf_mul( noise_flip( h, 8, grad ), x );
+}
+
+inline eiVf grad_vf( eiVi h, const eiVf x, const eiVf y )
+{
+    eiVf	low, u, v;
+
+    h	= ei_vi_and( h, ei_vi_set1( 7 ) );
+    low	= ei_vi_lt( h, ei_vi_set1( 4 ) );
+    u	= ei_vf_select( low, x, y );
+    v	= ei_vf_select( low, y, x );
+    return ei_vf_add( noise_flip( h, 1, u ), noise_flip( h, 2, ei_vf_mul( ei_vf_set1( 2.0f ), v ) ) );
+}
+
+inline eiVf grad_vf( eiVi h, const eiVf x, const eiVf y, const eiVf z )
+{
+    eiVf	u, v, xz;
+
+    h	= ei_vi_and( h, ei_vi_set1( 15 ) );
+    u	= ei_vf_select( ei_vi_lt( h, ei_vi_set1( 8 ) ), x, y );
+    xz	= ei_vf_select( ei_vf_or( ei_vi_eq( h, ei_vi_set1( 12 ) ), ei_vi_eq( h, ei_vi_set1( 14 ) ) ), x, z );
+    v	= ei_vf_select( ei_vi_lt( h, ei_vi_set1( 4 ) ), y, xz );
+    return ei_vf_add( noise_flip( h, 1, u ), noise_flip( h, 2, v ) );
+}
+
+inline eiVf grad_vf( eiVi h, const eiVf x, const eiVf y, const eiVf z, const eiVf t )
+{
+    eiVf	u, v, w;
+
+    h	= ei_vi_and( h, ei_vi_set1( 31 ) );
+    u	= ei_vf_select( ei_vi_lt( h, ei_vi_set1( 24 ) ), x, y );
+    v	= ei_vf_select( ei_vi_lt( h, ei_vi_set1( 16 ) ), y, z );
+    w	= ei_vf_select( ei_vi_lt( h, ei_vi_set1( 8 ) ), z, t );
+    return ei_vf_add( ei_vf_add( noise_flip( h, 1, u ), noise_flip( h, 2, v ) ), noise_flip( h, 4, w ) );
+}
+
+inline eiVf noise_vf( const eiVf x, const unsigned char *perm, const int px = 0 )
+{
+    eiInt	ix[ EI_VF_WIDTH ];
+    eiInt	h0[ EI_VF_WIDTH ], h1[ EI_VF_WIDTH ];
+    eiVf	fx0, fx1;
+    eiVf	s, n0, n1;
+
+    fx0 = noise_floor( x, ix );
+    fx1 = ei_vf_sub( fx0, ei_vf_set1( 1.0f ) );
+
+    for (int l = 0; l < EI_VF_WIDTH; ++l)
+    {
+        int	ix0, ix1;
+
+        noise_wrap( ix[l], px, ix0, ix1 );
+        h0[l] = perm[ ix0 ];
+        h1[l] = perm[ ix1 ];
+    }
+
+    s	= noise_fade( fx0 );
+
+    n0	= grad_vf( ei_vi_load( h0 ), fx0 );
+    n1	= grad_vf( ei_vi_load( h1 ), fx1 );
+    return ei_vf_mul( ei_vf_set1( 0.5f ), ei_vf_add( ei_vf_set1( 1.0f ), ei_vf_mul( ei_vf_set1( 0.188f ), noise_lerp( s, n0, n1 ) ) ) );
+}
+
+inline eiVf noise_vf( const eiVf x, const eiVf y, const unsigned char *perm, const int px = 0, const int py = 0 )
+{
+    eiInt	ix[ EI_VF_WIDTH ], iy[ EI_VF_WIDTH ];
+    eiInt	h[4][ EI_VF_WIDTH ];
+    eiVf	fx0, fy0, fx1, fy1;
+    eiVf	s, t, nx0, nx1, n0, n1;
+
+    fx0 = noise_floor( x, ix );
+    fy0 = noise_floor( y, iy );
+    fx1 = ei_vf_sub( fx0, ei_vf_set1( 1.0f ) );
+    fy1 = ei_vf_sub( fy0, ei_vf_set1( 1.0f ) );
+
+    for (int l = 0; l < EI_VF_WIDTH; ++l)
+    {
+        int	ix0, ix1, iy0, iy1;
+
+        noise_wrap( ix[l], px, ix0, ix1 );
+        noise_wrap( iy[l], py, iy0, iy1 );
+        h[0][l] = perm[ix0 + perm[iy0]];
+        h[1][l] = perm[ix0 + perm[iy1]];
+        h[2][l] = perm[ix1 + perm[iy0]];
+        h[3][l] = perm[ix1 + perm[iy1]];
+    }
+
+    t = noise_fade( fy0 );
+    s = noise_fade( fx0 );
+
+    nx0 = grad_vf( ei_vi_load( h[0] ), fx0, fy0 );
+    nx1 = grad_vf( ei_vi_load( h[1] ), fx0, fy1 );
+    n0 = noise_lerp( t, nx0, nx1 );
+
+    nx0 = grad_vf( ei_vi_load( h[2] ), fx1, fy0 );
+    nx1 = grad_vf( ei_vi_load( h[3] ), fx1, fy1 );
+    n1 = noise_lerp( t, nx0, nx1 );
+
+    return ei_vf_mul( ei_vf_set1( 0.5f ), ei_vf_add( ei_vf_set1( 1.0f ), ei_vf_mul( ei_vf_set1( 0.507f ), noise_lerp( s, n0, n1 ) ) ) );
+}
+
+inline eiVf noise_vf( const eiVf x, const eiVf y, const eiVf z, const unsigned char *perm,
+                      const int px = 0, const int py = 0, const int pz = 0 )
+{
+    eiInt	ix[ EI_VF_WIDTH ], iy[ EI_VF_WIDTH ], iz[ EI_VF_WIDTH ];
+    eiInt	h[8][ EI_VF_WIDTH ];
+    eiVf	fx0, fy0, fz0, fx1, fy1, fz1;
+    eiVf	s, t, r;
+    eiVf	nxy0, nxy1, nx0, nx1, n0, n1;
+
+    fx0 = noise_floor( x, ix );
+    fy0 = noise_floor( y, iy );
+    fz0 = noise_floor( z, iz );
+    fx1 = ei_vf_sub( fx0, ei_vf_set1( 1.0f ) );
+    fy1 = ei_vf_sub( fy0, ei_vf_set1( 1.0f ) );
+    fz1 = ei_vf_sub( fz0, ei_vf_set1( 1.0f ) );
+
+    for (int l = 0; l < EI_VF_WIDTH; ++l)
+    {
+        int	ix0, ix1, iy0, iy1, iz0, iz1;
+
+        noise_wrap( ix[l], px, ix0, ix1 );
+        noise_wrap( iy[l], py, iy0, iy1 );
+        noise_wrap( iz[l], pz, iz0, iz1 );
+        h[0][l] = perm[ix0 + perm[iy0 + perm[iz0]]];
+        h[1][l] = perm[ix0 + perm[iy0 + perm[iz1]]];
+        h[2][l] = perm[ix0 + perm[iy1 + perm[iz0]]];
+        h[3][l] = perm[ix0 + perm[iy1 + perm[iz1]]];
+        h[4][l] = perm[ix1 + perm[iy0 + perm[iz0]]];
+        h[5][l] = perm[ix1 + perm[iy0 + perm[iz1]]];
+        h[6][l] = perm[ix1 + perm[iy1 + perm[iz0]]];
+        h[7][l] = perm[ix1 + perm[iy1 + perm[iz1]]];
+    }
+
+    r = noise_fade( fz0 );
+    t = noise_fade( fy0 );
+    s = noise_fade( fx0 );
+
+    nxy0 = grad_vf( ei_vi_load( h[0] ), fx0, fy0, fz0 );
+    nxy1 = grad_vf( ei_vi_load( h[1] ), fx0, fy0, fz1 );
+    nx0 = noise_lerp( r, nxy0, nxy1 );
+
+    nxy0 = grad_vf( ei_vi_load( h[2] ), fx0, fy1, fz0 );
+    nxy1 = grad_vf( ei_vi_load( h[3] ), fx0, fy1, fz1 );
+    nx1 = noise_lerp( r, nxy0, nxy1 );
+
+    n0 = noise_lerp( t, nx0, nx1 );
+
+    nxy0 = grad_vf( ei_vi_load( h[4] ), fx1, fy0, fz0 );
+    nxy1 = grad_vf( ei_vi_load( h[5] ), fx1, fy0, fz1 );
+    nx0 = noise_lerp( r, nxy0, nxy1 );
+
+    nxy0 = grad_vf( ei_vi_load( h[6] ), fx1, fy1, fz0 );
+    nxy1 = grad_vf( ei_vi_load( h[7] ), fx1, fy1, fz1 );
+    nx1 = noise_lerp( r, nxy0, nxy1 );
+
+    n1 = noise_lerp( t, nx0, nx1 );
+
+    return ei_vf_mul( ei_vf_set1( 0.5f ), ei_vf_add( ei_vf_set1( 1.0f ), ei_vf_mul( ei_vf_set1( 0.936f ), noise_lerp( s, n0, n1 ) ) ) );
+}
+
+inline eiVf noise_vf( const eiVf x, const eiVf y, const eiVf z, const eiVf w, const unsigned char *perm,
+                      const int px = 0, const int py = 0, const int pz = 0, const int pw = 0 )
+{
+    eiInt	ix[ EI_VF_WIDTH ], iy[ EI_VF_WIDTH ], iz[ EI_VF_WIDTH ], iw[ EI_VF_WIDTH ];
+    eiInt	h[16][ EI_VF_WIDTH ];
+    eiVf	f0[4], f1[4];
+    eiVf	s, t, r, q;
+    eiVf	nxy[2], nx[2], n[2];
+
+    f0[0] = noise_floor( x, ix );
+    f0[1] = noise_floor( y, iy );
+    f0[2] = noise_floor( z, iz );
+    f0[3] = noise_floor( w, iw );
+    for (int i = 0; i < 4; ++i)
+    {
+        f1[i] = ei_vf_sub( f0[i], ei_vf_set1( 1.0f ) );
+    }
+
+    for (int l = 0; l < EI_VF_WIDTH; ++l)
+    {
+        int	ixs[2], iys[2], izs[2], iws[2];
+
+        noise_wrap( ix[l], px, ixs[0], ixs[1] );
+        noise_wrap( iy[l], py, iys[0], iys[1] );
+        noise_wrap( iz[l], pz, izs[0], izs[1] );
+        noise_wrap( iw[l], pw, iws[0], iws[1] );
+
+        /* corner index is (dx << 3) | (dy << 2) | (dz << 1) | dw */
+        for (int c = 0; c < 16; ++c)
+        {
+            h[c][l] = perm[ixs[c >> 3] + perm[iys[(c >> 2) & 1] + perm[izs[(c >> 1) & 1] + perm[iws[c & 1]]]]];
+        }
+    }
+
+    q = noise_fade( f0[3] );
+    r = noise_fade( f0[2] );
+    t = noise_fade( f0[1] );
+    s = noise_fade( f0[0] );
+
+    for (int dx = 0; dx < 2; ++dx)
+    {
+        const eiVf	fx = dx ? f1[0] : f0[0];
+
+        for (int dy = 0; dy < 2; ++dy)
+        {
+            const eiVf	fy = dy ? f1[1] : f0[1];
+
+            for (int dz = 0; dz < 2; ++dz)
+            {
+                const eiVf	fz = dz ? f1[2] : f0[2];
+                const int	c = (dx << 3) | (dy << 2) | (dz << 1);
+
+                nxy[dz] = noise_lerp( q,
+                    grad_vf( ei_vi_load( h[c] ), fx, fy, fz, f0[3] ),
+                    grad_vf( ei_vi_load( h[c | 1] ), fx, fy, fz, f1[3] ) );
+            }
+
+            nx[dy] = noise_lerp( r, nxy[0], nxy[1] );
+        }
+
+        n[dx] = noise_lerp( t, nx[0], nx[1] );
+    }
+
+    return ei_vf_mul( ei_vf_set1( 0.5f ), ei_vf_add( ei_vf_set1( 1.0f ), ei_vf_mul( ei_vf_set1( 0.87f ), noise_lerp( s, n[0], n[1] ) ) ) );
+}
+
 inline float noise( float arg )
 {
 	return noise<float>( arg, permX );
@@ -850,4 +1135,207 @@ inline color cellnoise_color( const point & arg, float w )
 					randN[permN[permN[i]]] );
 }
 
+/* batched noise, evaluating n points with EI_VF_WIDTH points
+   per iteration, the results match the scalar functions up to
+   rounding. */
+
+inline void noise_batch( const float *u, float *result, const int n )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = MIN( n - i, EI_VF_WIDTH );
+
+        for (int l = 0; l < EI_VF_WIDTH; ++l)
+        {
+            x[l] = u[ i + MIN( l, m - 1 ) ];
+        }
+        ei_vf_store( r, noise_vf( ei_vf_load( x ), permX ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+inline void noise_batch( const float *u, const float *v, float *result, const int n )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = MIN( n - i, EI_VF_WIDTH );
+
+        for (int l = 0; l < EI_VF_WIDTH; ++l)
+        {
+            x[l] = u[ i + MIN( l, m - 1 ) ];
+            y[l] = v[ i + MIN( l, m - 1 ) ];
+        }
+        ei_vf_store( r, noise_vf( ei_vf_load( x ), ei_vf_load( y ), permX ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+/* load a chunk of points in structure-of-arrays layout, lanes
+   beyond the count repeat the last point */
+inline int noise_load( const point *p, const int i, const int n, float *x, float *y, float *z )
+{
+    int		m = MIN( n - i, EI_VF_WIDTH );
+
+    for (int l = 0; l < EI_VF_WIDTH; ++l)
+    {
+        const point & v = p[ i + MIN( l, m - 1 ) ];
+
+        x[l] = v.x;
+        y[l] = v.y;
+        z[l] = v.z;
+    }
+
+    return m;
+}
+
+inline void noise_batch( const point *p, float *result, const int n )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], z[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = noise_load( p, i, n, x, y, z );
+
+        ei_vf_store( r, noise_vf( ei_vf_load( x ), ei_vf_load( y ), ei_vf_load( z ), permX ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+inline void noise_batch( const point *p, const float *w, float *result, const int n )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], z[ EI_VF_WIDTH ], t[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = noise_load( p, i, n, x, y, z );
+
+        for (int l = 0; l < EI_VF_WIDTH; ++l)
+        {
+            t[l] = w[ i + MIN( l, m - 1 ) ];
+        }
+        ei_vf_store( r, noise_vf( ei_vf_load( x ), ei_vf_load( y ), ei_vf_load( z ), ei_vf_load( t ), permX ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+inline void pnoise_batch( const point *p, const point & periods, float *result, const int n )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], z[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = noise_load( p, i, n, x, y, z );
+
+        ei_vf_store( r, noise_vf( ei_vf_load( x ), ei_vf_load( y ), ei_vf_load( z ), permX,
+            MAX( (int)periods.x, 1 ), MAX( (int)periods.y, 1 ), MAX( (int)periods.z, 1 ) ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+/* fractal sums of octaves of noise remapped to [-1, 1], the
+   frequency is multiplied by lacunarity and the amplitude by gain
+   for each octave. fbm sums the signed noise, turbulence sums its
+   absolute value. */
+
+inline float fbm( const point & p, const int octaves, const float lacunarity = 2.0f, const float gain = 0.5f )
+{
+    float	sum = 0.0f;
+    float	amp = 1.0f;
+    point	q = p;
+
+    for (int i = 0; i < octaves; ++i)
+    {
+        sum += amp * ( 2.0f * noise( q ) - 1.0f );
+        q *= lacunarity;
+        amp *= gain;
+    }
+
+    return sum;
+}
+
+inline float turbulence( const point & p, const int octaves, const float lacunarity = 2.0f, const float gain = 0.5f )
+{
+    float	sum = 0.0f;
+    float	amp = 1.0f;
+    point	q = p;
+
+    for (int i = 0; i < octaves; ++i)
+    {
+        sum += amp * absf( 2.0f * noise( q ) - 1.0f );
+        q *= lacunarity;
+        amp *= gain;
+    }
+
+    return sum;
+}
+
+inline eiVf fbm_vf( eiVf x, eiVf y, eiVf z, const int octaves, const float lacunarity, const float gain, const bool absolute )
+{
+    eiVf	sum = ei_vf_set1( 0.0f );
+    float	amp = 1.0f;
+
+    for (int i = 0; i < octaves; ++i)
+    {
+        eiVf	n = ei_vf_sub( ei_vf_mul( ei_vf_set1( 2.0f ), noise_vf( x, y, z, permX ) ), ei_vf_set1( 1.0f ) );
+
+        if (absolute)
+        {
+            n = ei_vf_abs( n );
+        }
+        sum = ei_vf_add( sum, ei_vf_mul( ei_vf_set1( amp ), n ) );
+        x = ei_vf_mul( x, ei_vf_set1( lacunarity ) );
+        y = ei_vf_mul( y, ei_vf_set1( lacunarity ) );
+        z = ei_vf_mul( z, ei_vf_set1( lacunarity ) );
+        amp *= gain;
+    }
+
+    return sum;
+}
+
+inline void fbm_batch( const point *p, float *result, const int n,
+                       const int octaves, const float lacunarity = 2.0f, const float gain = 0.5f )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], z[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = noise_load( p, i, n, x, y, z );
+
+        ei_vf_store( r, fbm_vf( ei_vf_load( x ), ei_vf_load( y ), ei_vf_load( z ), octaves, lacunarity, gain, false ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
+inline void turbulence_batch( const point *p, float *result, const int n,
+                              const int octaves, const float lacunarity = 2.0f, const float gain = 0.5f )
+{
+    for (int i = 0; i < n; i += EI_VF_WIDTH)
+    {
+        float	x[ EI_VF_WIDTH ], y[ EI_VF_WIDTH ], z[ EI_VF_WIDTH ], r[ EI_VF_WIDTH ];
+        int		m = noise_load( p, i, n, x, y, z );
+
+        ei_vf_store( r, fbm_vf( ei_vf_load( x ), ei_vf_load( y ), ei_vf_load( z ), octaves, lacunarity, gain, true ) );
+        for (int l = 0; l < m; ++l)
+        {
+            result[ i + l ] = r[l];
+        }
+    }
+}
+
 #endif
@@ -19,6 +19,7 @@
 #include <eiAPI/ei_instance.h>
 #include <eiAPI/ei_material.h>
 #include <eiAPI/ei_shadesys.h>
+#include <eiAPI/ei_pin_cache.h>
 #include <eiAPI/ei_base_bucket.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_data_table.h>
@@ -247,6 +248,7 @@ void ei_object_rep_cache_init(
 {
 	cache->cam_tag = cam_tag;
 	cache->light_instances = light_insts;
+	cache->local_dice = eiFALSE;
 	ei_btree_init(&cache->objects, ei_tag_node_compare, ei_tag_node_delete, NULL);
 	cache->object_rep_jobs = ei_create_job_queue();
 	cache->object_instances = ei_create_data_array(db, EI_DATA_TYPE_TAG);
@@ -601,7 +603,13 @@ static eiBool interp_vertex_prim_var(
 	return eiTRUE;
 }
 
-eiBool ei_get_prim_var(
+/** \brief Bind a primitive variable of the hit object which has been 
+ * looked up, the parameter can be NULL for built-in primitive variables 
+ * which are not added as node parameters. */
+static eiBool ei_bind_prim_var(
+	eiNodeSystem *nodesys, 
+	eiNode *node, 
+	eiNodeParam *param, 
 	eiState * const state, 
 	const char *name, 
 	const eiInt type, 
@@ -609,41 +617,9 @@ eiBool ei_get_prim_var(
 	eiByte * const dx1, 
 	eiByte * const dx2)
 {
-	eiDatabase			*db;
-	eiSizet				type_size;
-	eiNodeSystem		*nodesys;
-	eiNode				*node;
-	eiIndex				param_index;
-	eiNodeParam			*param;
-	eiBool				result;
-
-	/* must have hit object for binding */
-	if (state->hit_obj == eiNULL_TAG)
-	{
-		return eiFALSE;
-	}
+	eiBool		result;
 
-	db = state->db;
-	type_size = ei_db_type_size(db, type);
-
-	/* cannot interpolate for varying-sized data element */
-	if (type_size == 0)
-	{
-		return eiFALSE;
-	}
-
-	/* get node system interface */
-	nodesys = (eiNodeSystem *)ei_db_globals_interface(
-		db, 
-		EI_INTERFACE_TYPE_NODE_SYSTEM);
-	eiDBG_ASSERT(nodesys != NULL);
-
-	/* lookup the node parameter */
-	node = (eiNode *)ei_db_access(db, state->hit_obj);
-
-	param_index = ei_nodesys_lookup_parameter(nodesys, node, name);
-
-	if (param_index == eiNULL_INDEX)
+	if (param == NULL)
 	{
 		/* cannot find the parameter, try custom parameter binding, 
 		   this is for some built-in parameters that are not added 
@@ -663,8 +639,6 @@ eiBool ei_get_prim_var(
 			dx1, 
 			dx2))
 		{
-			ei_db_end(db, state->hit_obj);
-
 			return eiTRUE;
 		}
 
@@ -683,19 +657,13 @@ eiBool ei_get_prim_var(
 			dx1, 
 			dx2))
 		{
-			ei_db_end(db, state->hit_obj);
-
 			return eiTRUE;
 		}
 
 		/* still cannot bind, failed */
-		ei_db_end(db, state->hit_obj);
-
 		return eiFALSE;
 	}
 
-	param = ei_nodesys_read_parameter(nodesys, node, param_index);
-
 	/* bind node parameter according to storage class */
 	result = eiFALSE;
 
@@ -769,11 +737,103 @@ eiBool ei_get_prim_var(
 		break;
 	}
 
-	ei_db_end(db, state->hit_obj);
-
 	return result;
 }
 
+eiBool ei_get_prim_var(
+	eiState * const state, 
+	const char *name, 
+	const eiInt type, 
+	eiByte * const x, 
+	eiByte * const dx1, 
+	eiByte * const dx2)
+{
+	eiPrimVarHandle		handle;
+
+	/* the handle will be resolved for the hit object */
+	ei_prim_var_handle_init(&handle, name);
+
+	return ei_get_prim_var_h(state, &handle, type, x, dx1, dx2);
+}
+
+eiPrimVarHandle ei_resolve_prim_var(
+	eiNodeSystem *nodesys, 
+	eiNode *node, 
+	const char *name)
+{
+	eiPrimVarHandle		handle;
+
+	ei_prim_var_handle_init(&handle, name);
+	handle.obj = node->tag;
+	handle.param = ei_nodesys_lookup_parameter(nodesys, node, name);
+
+	return handle;
+}
+
+eiBool ei_get_prim_var_h(
+	eiState * const state, 
+	eiPrimVarHandle *handle, 
+	const eiInt type, 
+	eiByte * const x, 
+	eiByte * const dx1, 
+	eiByte * const dx2)
+{
+	eiNode				*node;
+
+	/* must have hit object for binding */
+	if (state->hit_obj == eiNULL_TAG)
+	{
+		return eiFALSE;
+	}
+
+	/* cannot interpolate for varying-sized data element */
+	if (ei_db_type_size(state->db, type) == 0)
+	{
+		return eiFALSE;
+	}
+
+	/* the hit object is kept accessed by the state */
+	node = ei_state_access_hit_obj(state);
+
+	/* the cached pointers are not resolved for the object being 
+	   accessed, resolve them again */
+	if (handle->node != node || handle->obj != state->hit_obj)
+	{
+		/* get node system interface */
+		handle->nodesys = (eiNodeSystem *)ei_db_globals_interface(
+			state->db, 
+			EI_INTERFACE_TYPE_NODE_SYSTEM);
+		eiDBG_ASSERT(handle->nodesys != NULL);
+
+		/* the handle was resolved for another object, lookup the 
+		   node parameter again */
+		if (handle->obj != state->hit_obj)
+		{
+			handle->obj = state->hit_obj;
+			handle->param = ei_nodesys_lookup_parameter(handle->nodesys, node, handle->name);
+		}
+
+		handle->node = node;
+		handle->node_param = NULL;
+
+		if (handle->param != eiNULL_INDEX)
+		{
+			handle->node_param = ei_nodesys_read_parameter(handle->nodesys, node, handle->param);
+		}
+	}
+
+	return ei_bind_prim_var(
+		handle->nodesys, 
+		node, 
+		handle->node_param, 
+		state, 
+		handle->name, 
+		type, 
+		x, 
+		dx1, 
+		dx2);
+}
+
 void ei_object_update_instance(
 	eiNodeSystem *nodesys, 
 	eiObjectRepCache *cache, 
@@ -969,6 +1029,7 @@ void ei_object_update_instance(
 		tessel_job->raytraceable = obj_rep_tag;
 		tessel_job->subdiv = 0;
 		tessel_job->deferred_dice = eiFALSE;
+		tessel_job->local_dice = cache->local_dice;
 		tessel_job->object_desc = obj->node.desc;
 		tessel_job->tessellable = obj_fn->create_obj(rt->db, obj, tessel_job);
 
@@ -1347,6 +1408,7 @@ void byteswap_job_tessel(eiDatabase *db, void *data, const eiUint size)
 	ei_byteswap_int(&job->tessellable);
 	ei_byteswap_int(&job->raytraceable);
 	ei_byteswap_int(&job->deferred_dice);
+	ei_byteswap_int(&job->local_dice);
 }
 
 static eiFORCEINLINE eiScalar get_edge_angle(
@@ -1358,24 +1420,20 @@ static eiFORCEINLINE eiScalar get_edge_angle(
 	return acosf(a);
 }
 
-static void ei_calc_tessel_vertex_normals(
+/** \brief Find the vertex channels of varying normals in 
+ * the tessellation, returns false if not available. */
+static eiBool ei_get_tessel_normal_channels(
 	eiDatabase *db, 
+	eiNodeSystem *nodesys, 
 	eiRayTessel *tessel, 
-	const eiTag obj_tag)
+	const eiTag obj_tag, 
+	eiScalar **N0, 
+	eiScalar **N1, 
+	eiScalar **N2)
 {
-	eiNodeSystem		*nodesys;
 	eiNode				*node;
 	eiIndex				param_index;
 	eiNodeParam			*param;
-	eiScalar			*N0, *N1, *N2;
-	eiUint				num_vertices;
-	eiUint				num_triangles;
-	eiUint				i;
-
-	/* get node system interface */
-	nodesys = (eiNodeSystem *)ei_db_globals_interface(
-		db, 
-		EI_INTERFACE_TYPE_NODE_SYSTEM);
 
 	node = (eiNode *)ei_db_access(db, obj_tag);
 
@@ -1385,7 +1443,7 @@ static void ei_calc_tessel_vertex_normals(
 	{
 		ei_db_end(db, obj_tag);
 
-		return;
+		return eiFALSE;
 	}
 
 	param = ei_nodesys_read_parameter(nodesys, node, param_index);
@@ -1394,39 +1452,171 @@ static void ei_calc_tessel_vertex_normals(
 	{
 		ei_db_end(db, obj_tag);
 
-		return;
+		return eiFALSE;
 	}
 
-	N0 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 0);
-	N1 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 1);
-	N2 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 2);
+	*N0 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 0);
+	*N1 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 1);
+	*N2 = ei_rt_tessel_get_vertex_channel(tessel, param->channel_offset + 2);
 
 	ei_db_end(db, obj_tag);
 
-	if (N0 == NULL || N1 == NULL || N2 == NULL)
+	return (*N0 != NULL && *N1 != NULL && *N2 != NULL);
+}
+
+/* the minimum number of triangles to calculate vertex normals with 
+   multiple threads, smaller tessellations are not worth the threads */
+#define EI_PARALLEL_NORMALS_MIN_TRIANGLES	(1 << 16)
+/* the maximum number of threads to calculate vertex normals of a mesh */
+#define EI_MAX_NORMALS_THREADS				EI_MAX_TASK_THREADS
+
+/* the pool of threads jobs may take for splitting their work, 
+   shared by all jobs so that they never exceed the rendering threads */
+static eiLock	g_TaskThreadsLock;
+static eiBool	g_TaskThreadsReady = eiFALSE;
+static eiUint	g_NumFreeTaskThreads = 0;
+
+void ei_init_task_threads(const eiUint num_threads)
+{
+	ei_create_lock(&g_TaskThreadsLock);
+
+	/* the thread of the job is one of them */
+	g_NumFreeTaskThreads = (num_threads > 1) ? (num_threads - 1) : 0;
+	g_TaskThreadsReady = eiTRUE;
+}
+
+void ei_exit_task_threads()
+{
+	if (!g_TaskThreadsReady)
 	{
 		return;
 	}
 
-	num_vertices = ei_rt_tessel_get_num_vertices(tessel);
-	num_triangles = ei_rt_tessel_get_num_triangles(tessel);
+	g_TaskThreadsReady = eiFALSE;
+	g_NumFreeTaskThreads = 0;
 
-	/* zero vertex normals */
-	for (i = 0; i < num_vertices; ++i)
+	ei_delete_lock(&g_TaskThreadsLock);
+}
+
+eiUint ei_acquire_task_threads(const eiUint num_wanted)
+{
+	eiUint	num_taken;
+
+	if (!g_TaskThreadsReady)
 	{
-		N0[i] = 0.0f;
-		N1[i] = 0.0f;
-		N2[i] = 0.0f;
+		return 0;
 	}
 
-	/* calculate face normal and average for each sharing vertices */
-	for (i = 0; i < num_triangles; ++i)
+	ei_lock(&g_TaskThreadsLock);
+	num_taken = MIN(num_wanted, g_NumFreeTaskThreads);
+	g_NumFreeTaskThreads -= num_taken;
+	ei_unlock(&g_TaskThreadsLock);
+
+	return num_taken;
+}
+
+void ei_release_task_threads(const eiUint num_taken)
+{
+	if (num_taken == 0)
+	{
+		return;
+	}
+
+	ei_lock(&g_TaskThreadsLock);
+	g_NumFreeTaskThreads += num_taken;
+	ei_unlock(&g_TaskThreadsLock);
+}
+
+void ei_run_tasks(
+	eiThreadFunction func, 
+	void *tasks, 
+	const eiSizet task_size, 
+	const eiUint num_tasks)
+{
+	eiThreadHandle	threads[ EI_MAX_TASK_THREADS ];
+	eiBool			started[ EI_MAX_TASK_THREADS ];
+	eiUint			i;
+
+	eiDBG_ASSERT(num_tasks <= EI_MAX_TASK_THREADS);
+
+	for (i = 1; i < num_tasks; ++i)
+	{
+		eiUint	error;
+
+		error = 0;
+		threads[i] = ei_create_thread(func, (eiByte *)tasks + i * task_size, &error);
+
+#ifdef EI_OS_WINDOWS
+		started[i] = (threads[i] != NULL);
+#else
+		/* the result of pthread_create is returned as thread ID */
+		started[i] = (error == 0);
+#endif
+	}
+
+	if (num_tasks > 0)
+	{
+		func(tasks);
+	}
+
+	/* join all threads before returning, so the caller sees 
+	   everything they wrote */
+	for (i = 1; i < num_tasks; ++i)
+	{
+		if (started[i])
+		{
+			ei_wait_thread(threads[i]);
+			ei_delete_thread(threads[i]);
+		}
+		else
+		{
+			func((eiByte *)tasks + i * task_size);
+		}
+	}
+}
+
+/** \brief Get the vertex indices of a triangle of a tessellation. */
+static void ei_get_tessel_triangle(
+	void *data, 
+	const eiUint i, 
+	eiUint *v1, 
+	eiUint *v2, 
+	eiUint *v3)
+{
+	eiRayTriangle	*tri;
+
+	tri = ei_rt_tessel_get_triangle((eiRayTessel *)data, i);
+
+	*v1 = tri->v1;
+	*v2 = tri->v2;
+	*v3 = tri->v3;
+}
+
+/** \brief Accumulate angle weighted face normals of a range of 
+ * triangles into vertex normals, the vertex normals are indexed 
+ * by vertex index minus base. */
+static void ei_accum_face_normals(
+	void *data, 
+	const eiUint first_tri, 
+	const eiUint last_tri, 
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint base)
+{
+	eiRayTessel	*tessel;
+	eiUint		i;
+
+	tessel = (eiRayTessel *)data;
+
+	for (i = first_tri; i < last_tri; ++i)
 	{
 		eiRayTriangle	*tri;
 		eiRayVertex		*v1, *v2, *v3;
 		eiVector4		fn;
 		eiVector		e1, e2, e3;
 		eiScalar		w1, w2, w3;
+		eiUint			i1, i2, i3;
 
 		tri = ei_rt_tessel_get_triangle(tessel, i);
 		v1 = ei_rt_tessel_get_vertex(tessel, tri->v1);
@@ -1447,33 +1637,316 @@ static void ei_calc_tessel_vertex_normals(
 		w2 = get_edge_angle(&e2, &e1);
 		w3 = get_edge_angle(&e3, &e2);
 
-		N0[tri->v1] += w1 * fn.x;
-		N1[tri->v1] += w1 * fn.y;
-		N2[tri->v1] += w1 * fn.z;
+		i1 = tri->v1 - base;
+		i2 = tri->v2 - base;
+		i3 = tri->v3 - base;
+
+		N0[i1] += w1 * fn.x;
+		N1[i1] += w1 * fn.y;
+		N2[i1] += w1 * fn.z;
+
+		N0[i2] += w2 * fn.x;
+		N1[i2] += w2 * fn.y;
+		N2[i2] += w2 * fn.z;
+
+		N0[i3] += w3 * fn.x;
+		N1[i3] += w3 * fn.y;
+		N2[i3] += w3 * fn.z;
+	}
+}
+
+/** \brief Normalize a range of vertex normals in place. */
+static void ei_normalize_vertex_normals(
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint first, 
+	const eiUint last)
+{
+	eiUint		i;
+
+	/* plain loop over separate channels, friendly to compiler vectorization */
+	for (i = first; i < last; ++i)
+	{
+		eiScalar	l;
+
+		l = invsqrtf(MAX(N0[i] * N0[i] + N1[i] * N1[i] + N2[i] * N2[i], eiSCALAR_EPS));
+
+		N0[i] *= l;
+		N1[i] *= l;
+		N2[i] *= l;
+	}
+}
+
+/** \brief The task of one thread for calculating vertex normals. */
+typedef struct eiVertexNormalsTask {
+	eiVertexNormalsMesh				*mesh;
+	/* the range of triangles to accumulate */
+	eiUint							first_tri;
+	eiUint							last_tri;
+	/* the range of vertices referenced by the triangles */
+	eiUint							first_vtx;
+	eiUint							last_vtx;
+	/* the normals accumulated by this task, indexed 
+	   by vertex index minus first_vtx */
+	eiScalar						*N0;
+	eiScalar						*N1;
+	eiScalar						*N2;
+	/* the range of output vertices to sum */
+	eiUint							first_out;
+	eiUint							last_out;
+	/* the output normals */
+	eiScalar						*out_N0;
+	eiScalar						*out_N1;
+	eiScalar						*out_N2;
+	/* all tasks, for summing */
+	struct eiVertexNormalsTask		*tasks;
+	eiUint							num_tasks;
+} eiVertexNormalsTask;
+
+static eiTHREAD_FUNC ei_vertex_normals_range_thread(void *param)
+{
+	eiVertexNormalsTask		*task;
+	eiUint					i;
+
+	task = (eiVertexNormalsTask *)param;
+
+	task->first_vtx = eiNULL_INDEX;
+	task->last_vtx = 0;
+
+	for (i = task->first_tri; i < task->last_tri; ++i)
+	{
+		eiUint	v1, v2, v3;
+
+		task->mesh->get_triangle(task->mesh->data, i, &v1, &v2, &v3);
+
+		task->first_vtx = MIN(task->first_vtx, MIN(v1, MIN(v2, v3)));
+		task->last_vtx = MAX(task->last_vtx, MAX(v1, MAX(v2, v3)) + 1);
+	}
+
+	if (task->first_vtx > task->last_vtx)
+	{
+		task->first_vtx = task->last_vtx;
+	}
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiTHREAD_FUNC ei_vertex_normals_accum_thread(void *param)
+{
+	eiVertexNormalsTask		*task;
+
+	task = (eiVertexNormalsTask *)param;
+
+	task->mesh->accum_face_normals(
+		task->mesh->data, 
+		task->first_tri, 
+		task->last_tri, 
+		task->N0, 
+		task->N1, 
+		task->N2, 
+		task->first_vtx);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiTHREAD_FUNC ei_vertex_normals_sum_thread(void *param)
+{
+	eiVertexNormalsTask		*task;
+	eiUint					i, j;
+
+	task = (eiVertexNormalsTask *)param;
+
+	for (i = task->first_out; i < task->last_out; ++i)
+	{
+		task->out_N0[i] = 0.0f;
+		task->out_N1[i] = 0.0f;
+		task->out_N2[i] = 0.0f;
+	}
+
+	/* sum the normals of all tasks overlapping our range, 
+	   in the order of tasks, so results never depend on timing */
+	for (j = 0; j < task->num_tasks; ++j)
+	{
+		eiVertexNormalsTask		*src;
+		eiUint					first, last;
+
+		src = &task->tasks[j];
+		first = MAX(task->first_out, src->first_vtx);
+		last = MIN(task->last_out, src->last_vtx);
+
+		for (i = first; i < last; ++i)
+		{
+			task->out_N0[i] += src->N0[i - src->first_vtx];
+			task->out_N1[i] += src->N1[i - src->first_vtx];
+			task->out_N2[i] += src->N2[i - src->first_vtx];
+		}
+	}
+
+	ei_normalize_vertex_normals(
+		task->out_N0, 
+		task->out_N1, 
+		task->out_N2, 
+		task->first_out, 
+		task->last_out);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+/** \brief Calculate vertex normals with multiple threads, returns 
+ * false if the vertex ranges of the tasks overlap too much to be 
+ * worth the memory. */
+static eiBool ei_calc_vertex_normals_parallel(
+	eiVertexNormalsMesh *mesh, 
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint num_tasks)
+{
+	eiVertexNormalsTask		tasks[ EI_MAX_NORMALS_THREADS ];
+	eiUint64				private_size;
+	eiUint					i;
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		tasks[i].mesh = mesh;
+		tasks[i].first_tri = (eiUint)(((eiUint64)mesh->num_triangles * i) / num_tasks);
+		tasks[i].last_tri = (eiUint)(((eiUint64)mesh->num_triangles * (i + 1)) / num_tasks);
+		tasks[i].N0 = NULL;
+		tasks[i].N1 = NULL;
+		tasks[i].N2 = NULL;
+		tasks[i].first_out = (eiUint)(((eiUint64)mesh->num_vertices * i) / num_tasks);
+		tasks[i].last_out = (eiUint)(((eiUint64)mesh->num_vertices * (i + 1)) / num_tasks);
+		tasks[i].out_N0 = N0;
+		tasks[i].out_N1 = N1;
+		tasks[i].out_N2 = N2;
+		tasks[i].tasks = tasks;
+		tasks[i].num_tasks = num_tasks;
+	}
+
+	ei_run_tasks(ei_vertex_normals_range_thread, tasks, sizeof(eiVertexNormalsTask), num_tasks);
+
+	/* diced tessellations are spatially coherent, so the vertex ranges 
+	   of adjacent triangle ranges barely overlap, fall back to serial 
+	   calculation if this is not the case */
+	private_size = 0;
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		private_size += tasks[i].last_vtx - tasks[i].first_vtx;
+	}
+
+	if (private_size > (eiUint64)mesh->num_vertices * 2)
+	{
+		return eiFALSE;
+	}
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		eiSizet	size;
+
+		size = sizeof(eiScalar) * MAX(1, tasks[i].last_vtx - tasks[i].first_vtx);
+
+		tasks[i].N0 = (eiScalar *)ei_allocate(size);
+		tasks[i].N1 = (eiScalar *)ei_allocate(size);
+		tasks[i].N2 = (eiScalar *)ei_allocate(size);
+
+		memset(tasks[i].N0, 0, size);
+		memset(tasks[i].N1, 0, size);
+		memset(tasks[i].N2, 0, size);
+	}
+
+	ei_run_tasks(ei_vertex_normals_accum_thread, tasks, sizeof(eiVertexNormalsTask), num_tasks);
+	ei_run_tasks(ei_vertex_normals_sum_thread, tasks, sizeof(eiVertexNormalsTask), num_tasks);
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		eiCHECK_FREE(tasks[i].N2);
+		eiCHECK_FREE(tasks[i].N1);
+		eiCHECK_FREE(tasks[i].N0);
+	}
+
+	return eiTRUE;
+}
+
+void ei_calc_vertex_normals(
+	eiVertexNormalsMesh *mesh, 
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint num_threads)
+{
+	eiUint	num_tasks;
+	eiUint	i;
 
-		N0[tri->v2] += w2 * fn.x;
-		N1[tri->v2] += w2 * fn.y;
-		N2[tri->v2] += w2 * fn.z;
+	num_tasks = MIN(num_threads, EI_MAX_NORMALS_THREADS);
+	num_tasks = MIN(num_tasks, mesh->num_triangles);
 
-		N0[tri->v3] += w3 * fn.x;
-		N1[tri->v3] += w3 * fn.y;
-		N2[tri->v3] += w3 * fn.z;
+	if (num_tasks >= 2 && 
+		ei_calc_vertex_normals_parallel(mesh, N0, N1, N2, num_tasks))
+	{
+		return;
+	}
+
+	/* zero vertex normals */
+	for (i = 0; i < mesh->num_vertices; ++i)
+	{
+		N0[i] = 0.0f;
+		N1[i] = 0.0f;
+		N2[i] = 0.0f;
 	}
 
+	/* calculate face normal and average for each sharing vertices */
+	mesh->accum_face_normals(mesh->data, 0, mesh->num_triangles, N0, N1, N2, 0);
+
 	/* normalize vertex normals */
-	for (i = 0; i < num_vertices; ++i)
+	ei_normalize_vertex_normals(N0, N1, N2, 0, mesh->num_vertices);
+}
+
+static void ei_calc_tessel_vertex_normals(
+	eiDatabase *db, 
+	eiRayTessel *tessel, 
+	const eiTag obj_tag)
+{
+	eiNodeSystem		*nodesys;
+	eiScalar			*N0, *N1, *N2;
+	eiVertexNormalsMesh	mesh;
+	eiUint				num_extra_threads;
+
+	/* get node system interface */
+	nodesys = (eiNodeSystem *)ei_db_globals_interface(
+		db, 
+		EI_INTERFACE_TYPE_NODE_SYSTEM);
+
+	if (!ei_get_tessel_normal_channels(db, nodesys, tessel, obj_tag, &N0, &N1, &N2))
 	{
-		eiVector	vn;
+		return;
+	}
+
+	mesh.data = tessel;
+	mesh.num_vertices = ei_rt_tessel_get_num_vertices(tessel);
+	mesh.num_triangles = ei_rt_tessel_get_num_triangles(tessel);
+	mesh.get_triangle = ei_get_tessel_triangle;
+	mesh.accum_face_normals = ei_accum_face_normals;
 
-		setv(&vn, N0[i], N1[i], N2[i]);
-		normalizei(&vn);
+	/* large tessellations become the critical path of tessellation 
+	   jobs, they take the threads other jobs are not using */
+	num_extra_threads = 0;
 
-		N0[i] = vn.x;
-		N1[i] = vn.y;
-		N2[i] = vn.z;
+	if (mesh.num_triangles >= EI_PARALLEL_NORMALS_MIN_TRIANGLES)
+	{
+		num_extra_threads = ei_acquire_task_threads(
+			MIN(EI_MAX_NORMALS_THREADS, mesh.num_triangles / (EI_PARALLEL_NORMALS_MIN_TRIANGLES / 4)) - 1);
 	}
+
+	ei_calc_vertex_normals(&mesh, N0, N1, N2, num_extra_threads + 1);
+
+	ei_release_task_threads(num_extra_threads);
 }
 
+/* the number of vertices to be displaced in one batch */
+#define EI_DISPLACE_BATCH_SIZE		64
+
 void ei_displace_tessel(
 	eiDatabase *db, 
 	const eiTag displace_list, 
@@ -1485,8 +1958,25 @@ void ei_displace_tessel(
 	eiRayTessel		*tessel;
 	eiBound			displaced_box;
 	eiBaseBucket	displace_bucket;
+	eiState			state;
+	eiDataArray		*shader_instances;
+	eiScalar		*N0, *N1, *N2;
+	eiBool			has_normals;
+	eiScalar		Px[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		Py[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		Pz[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		Nx[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		Ny[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		Nz[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		dPdtimex[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		dPdtimey[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		dPdtimez[ EI_DISPLACE_BATCH_SIZE ];
+	eiScalar		dtime[ EI_DISPLACE_BATCH_SIZE ];
+	eiDisplaceBatch	batch;
 	eiUint			num_vertices;
+	eiUint			first;
 	eiUint			i;
+	eiInt			k;
 
 	if (displace_list == eiNULL_TAG)
 	{
@@ -1509,51 +1999,136 @@ void ei_displace_tessel(
 		db, 
 		0);
 
+	/* the shading state is shared by all vertices of the tessellation, 
+	   only the vertex related members will be updated per-vertex */
+	ei_state_init(&state, eiRAY_DISPLACE, &displace_bucket);
+	state.result = NULL;
+	initv(&state.Ng);
+
+	/* resolve the channels of normals only once for the tessellation */
+	has_normals = ei_get_tessel_normal_channels(db, nodesys, tessel, obj_tag, &N0, &N1, &N2);
+
+	batch.Px = Px;
+	batch.Py = Py;
+	batch.Pz = Pz;
+	batch.Nx = Nx;
+	batch.Ny = Ny;
+	batch.Nz = Nz;
+	batch.dPdtimex = dPdtimex;
+	batch.dPdtimey = dPdtimey;
+	batch.dPdtimez = dPdtimez;
+	batch.dtime = dtime;
+
+	shader_instances = (eiDataArray *)ei_db_access(db, displace_list);
+
 	num_vertices = ei_rt_tessel_get_num_vertices(tessel);
 
-	for (i = 0; i < num_vertices; ++i)
+	for (first = 0; first < num_vertices; first += EI_DISPLACE_BATCH_SIZE)
 	{
-		eiRayVertex		*vtx;
-		eiState			state;
-		eiVector4		result;
+		batch.count = MIN(EI_DISPLACE_BATCH_SIZE, num_vertices - first);
 
-		vtx = ei_rt_tessel_get_vertex(tessel, i);
-
-		ei_state_init(&state, eiRAY_DISPLACE, &displace_bucket);
-		
-		state.result = NULL;
-		state.P = vtx->pos;
-		sub(&state.dPdtime, &vtx->m_pos, &vtx->pos);
-		state.dtime = 1.0f;
-
-		initv(&state.Ng);
-		initv(&state.N);
-		ei_get_prim_var(
-			&state, 
-			"N", 
-			EI_DATA_TYPE_VECTOR, 
-			(eiByte *)(&state.N), 
-			NULL, 
-			NULL);
+		/* gather a block of vertices */
+		for (i = 0; i < batch.count; ++i)
+		{
+			eiRayVertex		*vtx;
 
-		initv4(&result);
+			vtx = ei_rt_tessel_get_vertex(tessel, first + i);
 
-		ei_call_shader_instance_list(nodesys, &result, &state, displace_list, NULL);
+			Px[i] = vtx->pos.x;
+			Py[i] = vtx->pos.y;
+			Pz[i] = vtx->pos.z;
+			dPdtimex[i] = vtx->m_pos.x - vtx->pos.x;
+			dPdtimey[i] = vtx->m_pos.y - vtx->pos.y;
+			dPdtimez[i] = vtx->m_pos.z - vtx->pos.z;
+			dtime[i] = 1.0f;
 
-		vtx->pos = state.P;
-		addbv(&displaced_box, &state.P);
+			if (has_normals)
+			{
+				Nx[i] = N0[first + i];
+				Ny[i] = N1[first + i];
+				Nz[i] = N2[first + i];
+			}
+			else
+			{
+				Nx[i] = 0.0f;
+				Ny[i] = 0.0f;
+				Nz[i] = 0.0f;
+			}
+		}
 
-		if (motion)
+		/* all shader instances in the list are applied in sequence, 
+		   vertices are independent of each other, so each shader 
+		   instance can process the whole block before the next one */
+		for (k = 0; k < shader_instances->size; ++k)
 		{
-			mulvf(&vtx->m_pos, &state.dPdtime, state.dtime);
-			addi(&vtx->m_pos, &state.P);
+			eiTag	shader;
 
-			addbv(&displaced_box, &vtx->m_pos);
+			shader = *((eiTag *)ei_data_array_get(db, shader_instances, k));
+
+			if (shader == eiNULL_TAG)
+			{
+				continue;
+			}
+
+			if (ei_call_shader_instance_batch(nodesys, &state, shader, &batch, NULL))
+			{
+				continue;
+			}
+
+			/* the shader cannot be called in batch, displace the 
+			   vertices one by one */
+			for (i = 0; i < batch.count; ++i)
+			{
+				eiVector4		result;
+
+				setv(&state.P, Px[i], Py[i], Pz[i]);
+				setv(&state.N, Nx[i], Ny[i], Nz[i]);
+				setv(&state.dPdtime, dPdtimex[i], dPdtimey[i], dPdtimez[i]);
+				state.dtime = dtime[i];
+
+				initv4(&result);
+
+				ei_call_shader_instance(nodesys, &result, &state, shader, NULL);
+
+				Px[i] = state.P.x;
+				Py[i] = state.P.y;
+				Pz[i] = state.P.z;
+				Nx[i] = state.N.x;
+				Ny[i] = state.N.y;
+				Nz[i] = state.N.z;
+				dPdtimex[i] = state.dPdtime.x;
+				dPdtimey[i] = state.dPdtime.y;
+				dPdtimez[i] = state.dPdtime.z;
+				dtime[i] = state.dtime;
+			}
 		}
 
-		ei_state_exit(&state);
+		/* scatter the displaced block back to the tessellation */
+		for (i = 0; i < batch.count; ++i)
+		{
+			eiRayVertex		*vtx;
+
+			vtx = ei_rt_tessel_get_vertex(tessel, first + i);
+
+			setv(&vtx->pos, Px[i], Py[i], Pz[i]);
+			addbv(&displaced_box, &vtx->pos);
+
+			if (motion)
+			{
+				setv(&vtx->m_pos, 
+					Px[i] + dPdtimex[i] * dtime[i], 
+					Py[i] + dPdtimey[i] * dtime[i], 
+					Pz[i] + dPdtimez[i] * dtime[i]);
+
+				addbv(&displaced_box, &vtx->m_pos);
+			}
+		}
 	}
 
+	ei_db_end(db, displace_list);
+
+	ei_state_exit(&state);
+
 	ei_rt_tessel_box(tessel, &displaced_box);
 
 	/* recalculate vertex normals since we displaced vertices */
@@ -1586,6 +2161,9 @@ eiBool execute_job_tessel(eiDatabase *db, eiBaseWorker *pWorker, void *job, void
 	
 	pJob = (eiTesselJob *)job;
 
+	/* displacement shaders pin data while dicing */
+	ei_pin_cache_begin_job(db);
+
 	/* copy this because it may be cleared to eiNULL_TAG from the 
 	   job if the dicing is deferred */
 	tessellable = pJob->tessellable;
@@ -1638,6 +2216,8 @@ eiBool execute_job_tessel(eiDatabase *db, eiBaseWorker *pWorker, void *job, void
 	/* delete the tessellable object since it has been processed */
 	obj_fn->delete_obj(db, pJob);
 
+	ei_pin_cache_end_job(db);
+
 	return eiTRUE;
 }
 
@@ -32,6 +32,8 @@ extern "C" {
 #endif
 
 #define EI_MAX_USER_CHANNEL_DIM		16
+/* the maximum number of threads a job splits its work into */
+#define EI_MAX_TASK_THREADS			16
 
 /** \brief The tessellation job stored in database */
 typedef struct eiTesselJob {
@@ -67,6 +69,9 @@ typedef struct eiTesselJob {
 	eiUint			subdiv;
 	/* whether this job is a deferred dicing job */
 	eiBool			deferred_dice;
+	/* whether the diced tessellations should be generated locally 
+	   by each host on demand instead of being diced by the master */
+	eiBool			local_dice;
 } eiTesselJob;
 
 /** \brief The node for mapping object representation key to 
@@ -170,6 +175,60 @@ eiBool ei_get_prim_var(
 	eiByte * const dx1, 
 	eiByte * const dx2);
 
+/** \brief The pre-resolved handle of a primitive variable, saves 
+ * the lookup by name for each interpolation. */
+typedef struct eiPrimVarHandle {
+	/* the object which the handle was resolved for */
+	eiTag				obj;
+	/* the index of node parameter, or eiNULL_INDEX for built-in 
+	   primitive variables which are not node parameters */
+	eiIndex				param;
+	/* the name of the primitive variable, must be kept valid 
+	   while the handle is being used */
+	const char			*name;
+	/* the pointers resolved for the hit object accessed by the 
+	   state, they are valid while the state keeps the object 
+	   accessed, and will be resolved again otherwise */
+	eiNodeSystem		*nodesys;
+	eiNode				*node;
+	eiNodeParam			*node_param;
+} eiPrimVarHandle;
+
+/** \brief Initialize an unresolved handle of primitive variable, 
+ * it will be resolved for the hit object on the first use. */
+eiFORCEINLINE void ei_prim_var_handle_init(
+	eiPrimVarHandle *handle, 
+	const char *name)
+{
+	handle->obj = eiNULL_TAG;
+	handle->param = eiNULL_INDEX;
+	handle->name = name;
+	handle->nodesys = NULL;
+	handle->node = NULL;
+	handle->node_param = NULL;
+}
+
+/** \brief Resolve a primitive variable of an object by name, the 
+ * handle can be resolved once and used for all shading points on 
+ * the object. */
+eiAPI eiPrimVarHandle ei_resolve_prim_var(
+	eiNodeSystem *nodesys, 
+	eiNode *node, 
+	const char *name);
+
+/** \brief Interpolate primitive variable by pre-resolved handle, 
+ * the handle will be resolved again if the hit object is not the 
+ * one it was resolved for, the hit object is accessed only once 
+ * for the duration of the state, returns the same as 
+ * ei_get_prim_var. */
+eiAPI eiBool ei_get_prim_var_h(
+	eiState * const state, 
+	eiPrimVarHandle *handle, 
+	const eiInt type, 
+	eiByte * const x, 
+	eiByte * const dx1, 
+	eiByte * const dx2);
+
 /** \brief Instance this element into global scene database or update 
  * the existing element */
 void ei_object_update_instance(
@@ -314,6 +373,63 @@ void ei_user_data_array_exit(
 	ei_array *varyings, 
 	ei_array *vertices);
 
+/** \brief A triangle mesh for calculating vertex normals, 
+ * the callbacks read the triangles of the mesh in data. */
+typedef struct eiVertexNormalsMesh {
+	void		*data;
+	eiUint		num_vertices;
+	eiUint		num_triangles;
+	/* get the vertex indices of a triangle */
+	void		(*get_triangle)(
+		void *data, 
+		const eiUint i, 
+		eiUint *v1, 
+		eiUint *v2, 
+		eiUint *v3);
+	/* accumulate angle weighted face normals of the triangles 
+	   in [first_tri, last_tri) into vertex normals, which are 
+	   indexed by vertex index minus base */
+	void		(*accum_face_normals)(
+		void *data, 
+		const eiUint first_tri, 
+		const eiUint last_tri, 
+		eiScalar *N0, 
+		eiScalar *N1, 
+		eiScalar *N2, 
+		const eiUint base);
+} eiVertexNormalsMesh;
+
+/** \brief Calculate normalized vertex normals of a mesh into 
+ * separate channels. with more than one thread, the triangles 
+ * are split into ranges, each thread accumulates its range into 
+ * normals of its own, which are summed at last. */
+eiAPI void ei_calc_vertex_normals(
+	eiVertexNormalsMesh *mesh, 
+	eiScalar *N0, 
+	eiScalar *N1, 
+	eiScalar *N2, 
+	const eiUint num_threads);
+
+/** \brief Set the number of threads jobs may take together for 
+ * splitting their work into tasks, such as calculating vertex 
+ * normals of large tessellations, which is the number of rendering 
+ * threads, no thread is taken before. */
+void ei_init_task_threads(const eiUint num_threads);
+void ei_exit_task_threads();
+/** \brief Take up to a number of extra threads from the pool, 
+ * returns the number of threads taken, which may be 0. */
+eiUint ei_acquire_task_threads(const eiUint num_wanted);
+/** \brief Return extra threads to the pool. */
+void ei_release_task_threads(const eiUint num_taken);
+/** \brief Run a function on an array of tasks and wait for all 
+ * of them, the current thread takes the first task, and any task 
+ * whose thread cannot be created. */
+void ei_run_tasks(
+	eiThreadFunction func, 
+	void *tasks, 
+	const eiSizet task_size, 
+	const eiUint num_tasks);
+
 /** \brief Call this function to apply displacement 
  * to tessellations. */
 eiAPI void ei_displace_tessel(
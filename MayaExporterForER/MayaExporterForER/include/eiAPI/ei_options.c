@@ -128,6 +128,14 @@ void ei_options_set_defaults(eiOptions *opt, eiDatabase *db)
 	opt->finalgather_falloff_stop = 0.0f;
 	opt->finalgather_filter_size = 4.0f;
 	opt->diagnostic_mode = EI_DIAGNOSTIC_MODE_NONE;
+	opt->sampling_mode = EI_SAMPLING_MODE_CONTRAST;
+	opt->noise_threshold = 0.01f;
+	opt->sampling_time_limit = 0.0f;
+	opt->variance_min_samples = 4;
+	opt->progressive = eiFALSE;
+	opt->progressive_time_limit = 0.0f;
+	opt->progressive_samples = 0;
+	opt->qmc_sequence = EI_QMC_SEQUENCE_HALTON;
 }
 
 eiNodeObject *ei_create_options_node_object(void *param)
@@ -624,6 +632,62 @@ void ei_install_options_node(eiNodeSystem *nodesys)
 		EI_DATA_TYPE_INT, 
 		"diagnostic_mode", 
 		&default_int);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"sampling_mode", 
+		&default_int);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_SCALAR, 
+		"noise_threshold", 
+		&default_scalar);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_SCALAR, 
+		"sampling_time_limit", 
+		&default_scalar);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"variance_min_samples", 
+		&default_int);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_BOOL, 
+		"progressive", 
+		&default_bool);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_SCALAR, 
+		"progressive_time_limit", 
+		&default_scalar);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"progressive_samples", 
+		&default_int);
+	ei_nodesys_add_parameter(
+		nodesys, 
+		desc, 
+		eiCONSTANT, 
+		EI_DATA_TYPE_INT, 
+		"qmc_sequence", 
+		&default_int);
 
 	ei_nodesys_end_node_desc(nodesys, desc, desc_tag);
 }
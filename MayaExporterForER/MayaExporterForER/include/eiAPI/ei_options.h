@@ -46,6 +46,24 @@ enum {
 	EI_DIAGNOSTIC_MODE_COUNT, 
 };
 
+/** \brief The sampling modes */
+enum {
+	/* refine the sample lattice by the contrast of neighboring samples */
+	EI_SAMPLING_MODE_CONTRAST = 0, 
+	/* spend samples on the pixels with highest estimated variance */
+	EI_SAMPLING_MODE_VARIANCE, 
+	EI_SAMPLING_MODE_COUNT, 
+};
+
+/** \brief The low-discrepancy sequences for QMC sampling */
+enum {
+	/* permuted Halton sequence, limited to QMC_MAX_DIM dimensions */
+	EI_QMC_SEQUENCE_HALTON = 0, 
+	/* Owen-scrambled Sobol sequence, decorrelated per pixel */
+	EI_QMC_SEQUENCE_SOBOL, 
+	EI_QMC_SEQUENCE_COUNT, 
+};
+
 /** \brief The class encapsulates all global options 
  * of the renderer. */
 #pragma pack(push, 1)
@@ -116,6 +134,14 @@ typedef struct eiOptions {
 	eiScalar				quantize_dither_amplitude;
 	eiInt					face;
 	eiInt					diagnostic_mode;
+	eiInt					sampling_mode;
+	eiScalar				noise_threshold;
+	eiScalar				sampling_time_limit;
+	eiInt					variance_min_samples;
+	eiBool					progressive;
+	eiScalar				progressive_time_limit;
+	eiInt					progressive_samples;
+	eiInt					qmc_sequence;
 } eiOptions;
 #pragma pack(pop)
 
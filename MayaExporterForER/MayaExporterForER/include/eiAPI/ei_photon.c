@@ -18,6 +18,7 @@
 #include <eiAPI/ei_light.h>
 #include <eiAPI/ei_material.h>
 #include <eiAPI/ei_shadesys.h>
+#include <eiAPI/ei_pin_cache.h>
 #include <eiAPI/ei.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_data_table.h>
@@ -389,6 +390,9 @@ static void ei_photon_bucket_init(
 	eiPhotonJob *job, 
 	eiDatabase *db)
 {
+	eiInt	num_light_insts;
+	eiInt	i;
+
 	ei_base_bucket_init(
 		&bucket->base, 
 		db, 
@@ -407,11 +411,31 @@ static void ei_photon_bucket_init(
 	}
 	
 	bucket->job = job;
+
+	/* concatenate the transformations once for each light 
+	   instance instead of once for each photon */
+	num_light_insts = ei_data_table_size(bucket->base.light_insts_iter.tab);
+	bucket->light_to_camera = (eiMatrix *)ei_allocate(sizeof(eiMatrix) * MAX(1, num_light_insts));
+
+	for (i = 0; i < num_light_insts; ++i)
+	{
+		eiLightInstance		*light_inst;
+
+		light_inst = (eiLightInstance *)ei_data_table_read(&bucket->base.light_insts_iter, i);
+
+		ei_light_instance_get_light_to_camera(
+			light_inst, 
+			bucket->base.cam, 
+			&bucket->light_to_camera[i]);
+	}
 }
 
 static eiBool ei_photon_bucket_exit(
 	eiPhotonBucket *bucket)
 {
+	ei_free(bucket->light_to_camera);
+	bucket->light_to_camera = NULL;
+
 	if (bucket->job->caustic_photons != eiNULL_TAG)
 	{
 		ei_data_array_flush(bucket->base.db, bucket->job->caustic_photons);
@@ -497,6 +521,7 @@ static eiBool ei_photon_bucket_run(
 			
 			ei_light_instance_shoot_photon(
 				light_inst, 
+				&bucket->light_to_camera[light_index], 
 				job->photon_type, 
 				&job->halton_num, 
 				&bucket->base);
@@ -740,6 +765,7 @@ eiBool ei_photon_reflection_specular(
 
 	photon_ray.dimension = state->dimension;
 	photon_ray.instance_number = state->instance_number;
+	photon_ray.qmc_seed = state->qmc_seed;
 
 	movv(&photon_ray.org, &src);
 	movv(&photon_ray.dir, dir);
@@ -826,6 +852,7 @@ eiBool ei_photon_reflection_diffuse(
 
 	photon_ray.dimension = state->dimension;
 	photon_ray.instance_number = state->instance_number;
+	photon_ray.qmc_seed = state->qmc_seed;
 
 	movv(&photon_ray.org, &src);
 	movv(&photon_ray.dir, dir);
@@ -911,6 +938,7 @@ eiBool ei_photon_transparent(
 
 	photon_ray.dimension = state->dimension;
 	photon_ray.instance_number = state->instance_number;
+	photon_ray.qmc_seed = state->qmc_seed;
 
 	movv(&photon_ray.org, &src);
 	movv(&photon_ray.dir, &state->I);
@@ -997,6 +1025,7 @@ eiBool ei_photon_transmission_specular(
 
 	photon_ray.dimension = state->dimension;
 	photon_ray.instance_number = state->instance_number;
+	photon_ray.qmc_seed = state->qmc_seed;
 
 	movv(&photon_ray.org, &src);
 	movv(&photon_ray.dir, dir);
@@ -1049,10 +1078,15 @@ eiBool execute_job_photon(eiDatabase *db, eiBaseWorker *pWorker, void *job, void
 {
 	eiPhotonJob		*pJob;
 	eiPhotonBucket		bucket;
+	eiBool			result;
 	
 	pJob = (eiPhotonJob *)job;
 
-	return ei_photon_bucket_run(&bucket, pJob, db, pWorker);
+	ei_pin_cache_begin_job(db);
+	result = ei_photon_bucket_run(&bucket, pJob, db, pWorker);
+	ei_pin_cache_end_job(db);
+
+	return result;
 }
 
 eiUint count_job_photon(eiDatabase *db, void *job)
@@ -153,6 +153,9 @@ typedef struct eiPhotonJob {
 typedef struct eiPhotonBucket {
 	eiBaseBucket	base;
 	eiPhotonJob		*job;
+	/* the transformations from light space to camera space 
+	   of all light instances, indexed by light index */
+	eiMatrix		*light_to_camera;
 } eiPhotonBucket;
 
 /** \brief Shoot a photon ray to do intersection test against the scene. */
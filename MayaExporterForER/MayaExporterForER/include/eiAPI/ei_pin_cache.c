@@ -0,0 +1,201 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiAPI/ei_pin_cache.h>
+#include <eiCORE/ei_assert.h>
+
+/* the global epoch, only modified by the main thread 
+   while no rendering thread is running */
+static volatile eiUint g_PinEpoch = 1;
+
+static eiFORCEINLINE eiUint ei_pin_cache_slot(const eiTag tag)
+{
+	eiUint	h;
+
+	h = tag * 2654435761U;
+
+	return (h >> 16) & (EI_PIN_CACHE_SIZE - EI_PIN_CACHE_WAYS);
+}
+
+static void ei_pin_cache_clear(eiPinCache *cache)
+{
+	eiUint	i;
+
+	for (i = 0; i < EI_PIN_CACHE_SIZE; ++i)
+	{
+		cache->entries[i].tag = eiNULL_TAG;
+		cache->entries[i].ptr = NULL;
+	}
+
+	cache->num_pinned = 0;
+}
+
+static void ei_pin_cache_end_all(eiPinCache *cache)
+{
+	eiTag		*retired_tags;
+	eiIntptr	num_retired;
+	eiIntptr	i;
+
+	if (cache->num_pinned != 0)
+	{
+		for (i = 0; i < EI_PIN_CACHE_SIZE; ++i)
+		{
+			if (cache->entries[i].tag != eiNULL_TAG)
+			{
+				ei_db_end(cache->db, cache->entries[i].tag);
+			}
+		}
+
+		retired_tags = (eiTag *)ei_array_data(&cache->retired);
+		num_retired = ei_array_size(&cache->retired);
+
+		for (i = 0; i < num_retired; ++i)
+		{
+			ei_db_end(cache->db, retired_tags[i]);
+		}
+	}
+
+	ei_array_clear(&cache->retired);
+	ei_pin_cache_clear(cache);
+}
+
+void ei_pin_cache_init(eiPinCache *cache)
+{
+	cache->db = NULL;
+	cache->epoch = 0;
+	cache->job_depth = 0;
+	cache->num_hits = 0;
+	cache->num_misses = 0;
+
+	ei_array_init(&cache->retired, sizeof(eiTag));
+	ei_pin_cache_clear(cache);
+}
+
+void ei_pin_cache_exit(eiPinCache *cache)
+{
+	/* the database has been deleted when thread local storages 
+	   are cleaned up, so we cannot end the accesses here */
+	if (cache->num_pinned != 0)
+	{
+		ei_warning("%d data still pinned on exit.\n", cache->num_pinned);
+	}
+
+	ei_array_clear(&cache->retired);
+	ei_pin_cache_clear(cache);
+}
+
+void ei_pin_cache_release(eiPinCache *cache)
+{
+	ei_pin_cache_end_all(cache);
+}
+
+void ei_pin_cache_reset_stats(eiPinCache *cache)
+{
+	cache->num_hits = 0;
+	cache->num_misses = 0;
+}
+
+void ei_pin_cache_begin_job(eiDatabase *db)
+{
+	eiPinCache		*cache;
+
+	cache = (eiPinCache *)ei_tls_get_interface(ei_db_get_tls(db), EI_TLS_TYPE_PIN_CACHE);
+
+	++ cache->job_depth;
+}
+
+void ei_pin_cache_end_job(eiDatabase *db)
+{
+	eiPinCache		*cache;
+
+	cache = (eiPinCache *)ei_tls_get_interface(ei_db_get_tls(db), EI_TLS_TYPE_PIN_CACHE);
+
+	eiDBG_ASSERT(cache->job_depth > 0);
+
+	/* callers of nested jobs may still hold pinned pointers */
+	if (-- cache->job_depth == 0)
+	{
+		ei_pin_cache_end_all(cache);
+	}
+}
+
+void ei_pin_cache_invalidate()
+{
+	++ g_PinEpoch;
+}
+
+eiUint ei_pin_cache_epoch()
+{
+	return g_PinEpoch;
+}
+
+void *ei_pin_access(eiDatabase *db, const eiTag tag)
+{
+	eiPinCache		*cache;
+	eiPinCacheEntry	*set;
+	eiPinCacheEntry	*entry;
+	eiUint			i;
+
+	eiDBG_ASSERT(tag != eiNULL_TAG);
+
+	cache = (eiPinCache *)ei_tls_get_interface(ei_db_get_tls(db), EI_TLS_TYPE_PIN_CACHE);
+
+	if (cache->epoch != g_PinEpoch || cache->db != db)
+	{
+		ei_pin_cache_end_all(cache);
+
+		cache->db = db;
+		cache->epoch = g_PinEpoch;
+	}
+
+	set = &cache->entries[ ei_pin_cache_slot(tag) ];
+	entry = NULL;
+
+	for (i = 0; i < EI_PIN_CACHE_WAYS; ++i)
+	{
+		if (set[i].tag == tag)
+		{
+			++ cache->num_hits;
+
+			return set[i].ptr;
+		}
+
+		if (entry == NULL && set[i].tag == eiNULL_TAG)
+		{
+			entry = &set[i];
+		}
+	}
+
+	/* replace in round-robin order when the set is full */
+	if (entry == NULL)
+	{
+		entry = &set[ cache->num_misses & (EI_PIN_CACHE_WAYS - 1) ];
+	}
+
+	++ cache->num_misses;
+
+	/* retire the colliding data, the pointer may still be held 
+	   by the caller, so its access ends with the others */
+	if (entry->tag != eiNULL_TAG)
+	{
+		ei_array_push_back(&cache->retired, &entry->tag);
+	}
+
+	entry->tag = tag;
+	entry->ptr = ei_db_access(db, tag);
+	++ cache->num_pinned;
+
+	return entry->ptr;
+}
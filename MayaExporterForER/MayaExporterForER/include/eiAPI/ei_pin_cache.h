@@ -0,0 +1,105 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef EI_PIN_CACHE_H
+#define EI_PIN_CACHE_H
+
+/** \brief The thread local front-end of database accesses
+ * \file ei_pin_cache.h
+ */
+
+#include <eiAPI/ei_api.h>
+#include <eiCORE/ei_dataflow.h>
+#include <eiCORE/ei_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the number of slots in the pin cache, must be power of 2 */
+#define EI_PIN_CACHE_SIZE		1024
+/* the number of slots a tag can be placed in, must be power of 2 */
+#define EI_PIN_CACHE_WAYS		4
+
+/** \brief A data pinned by the cache. */
+typedef struct eiPinCacheEntry {
+	eiTag			tag;
+	void			*ptr;
+} eiPinCacheEntry;
+
+/** \brief The thread local pin cache. data accessed through the cache 
+ * stays accessed until the outermost job of the thread ends, so repeated 
+ * accesses of the same tag by this thread are resolved by one probe into 
+ * a small set associative table, without going through the database. 
+ * only small data which will not be modified during rendering, such as 
+ * lights, shader instances and their parameter tables, should be 
+ * accessed through the cache, flushable data cannot be flushed while 
+ * it's pinned. all pins are dropped when the global epoch changes. 
+ * pins are only ever ended by the owner thread. */
+typedef struct eiPinCache {
+	eiDatabase		*db;
+	/* the global epoch when the pins were taken */
+	eiUint			epoch;
+	eiUint			num_pinned;
+	/* the nesting depth of jobs running on the owner thread */
+	eiUint			job_depth;
+	eiPinCacheEntry	entries[ EI_PIN_CACHE_SIZE ];
+	/* the tags evicted from the table, they remain pinned because 
+	   callers may still be using them */
+	ei_array		retired;
+	/* the number of database round trips saved */
+	eiUint64		num_hits;
+	eiUint64		num_misses;
+} eiPinCache;
+
+/** \brief Initialize thread local storage. for internal use only. */
+eiAPI void ei_pin_cache_init(eiPinCache *cache);
+
+/** \brief Cleanup thread local storage. for internal use only. */
+eiAPI void ei_pin_cache_exit(eiPinCache *cache);
+
+/** \brief End the accesses of all pinned data. must only be 
+ * called by the owner thread. */
+eiAPI void ei_pin_cache_release(eiPinCache *cache);
+
+/** \brief Clear the statistics. must not be called while the 
+ * owner thread is rendering. */
+eiAPI void ei_pin_cache_reset_stats(eiPinCache *cache);
+
+/** \brief Begin a job on current thread, jobs may be nested when 
+ * data is generated on demand. */
+eiAPI void ei_pin_cache_begin_job(eiDatabase *db);
+
+/** \brief End a job on current thread, the accesses of all data 
+ * pinned by this thread end with its outermost job. */
+eiAPI void ei_pin_cache_end_job(eiDatabase *db);
+
+/** \brief Invalidate the pin caches of all threads, should be 
+ * called when the scene changes. */
+eiAPI void ei_pin_cache_invalidate();
+
+/** \brief Get the global epoch, other thread local caches of scene 
+ * data can use it for invalidation. */
+eiAPI eiUint ei_pin_cache_epoch();
+
+/** \brief Access a data through the pin cache of current thread, 
+ * the caller should not call ei_db_end on the returned pointer. */
+eiAPI void *ei_pin_access(eiDatabase *db, const eiTag tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,6 +18,8 @@
 #include <eiAPI/ei_camera.h>
 #include <eiAPI/ei_raytracer.h>
 #include <eiAPI/ei_buffer.h>
+#include <eiAPI/ei_tessel_cache.h>
+#include <eiCORE/ei_matrix_batch.h>
 #include <eiCORE/ei_algorithm.h>
 #include <eiCORE/ei_pool.h>
 #include <eiCORE/ei_assert.h>
@@ -271,9 +273,9 @@ static void build_edge_estimator(
 				cam = (eiCamera *)ei_db_access(db, job->cam);
 				inst = (eiRayObjectInstance *)ei_db_access(db, job->inst);
 
-				mulmm(&estimate_length_params->object_to_view, 
+				ei_mulmm_simd(&estimate_length_params->object_to_view, 
 					&inst->object_to_world, &cam->world_to_camera);
-				mulmm(&estimate_length_params->motion_object_to_view, 
+				ei_mulmm_simd(&estimate_length_params->motion_object_to_view, 
 					&inst->motion_object_to_world, &cam->motion_world_to_camera);
 
 				ei_db_end(db, job->inst);
@@ -791,6 +793,9 @@ static eiTag ei_poly_object_indirect_dice(
 
 	ei_rt_end_defer_tessel(rt, tessel, tessel_tag);
 
+	/* re-dice on demand instead of paging out when it's flushed */
+	ei_tessel_cache_defer(db, tessel_tag);
+
 	return tessel_tag;
 }
 
@@ -2215,6 +2220,12 @@ void ei_poly_object_deferred_dice(
 
 	/* call displacement shader right after dicing */
 	ei_displace_tessel(db, job->displace_list, deferred_tessel_tag, poly->object, job->motion);
+
+	ei_tessel_cache_diced(
+		(eiTesselCache *)ei_db_globals_interface(db, EI_INTERFACE_TYPE_TESSEL_CACHE), 
+		db, 
+		deferred_tessel_tag, 
+		poly->object);
 }
 
 eiTag ei_poly_object_dice(
@@ -2240,8 +2251,18 @@ eiTag ei_poly_object_dice(
 
 	poly = (eiPolyTessel *)obj;
 
+	if (job->local_dice)
+	{
+		/* when rendering with remote hosts, don't dice on the master, 
+		   create a deferred tessellation so that each host dices and 
+		   displaces the sub-object locally when rays first reach it, 
+		   only the sub-object and the small dicing job are transferred. 
+		   the edge estimator falls back to one segment per edge when 
+		   approximation is off, so this matches direct dicing. */
+		tessel_tag = ei_poly_object_indirect_dice(db, rt, job, poly, box);
+	}
 	/* disable approximation if the object is polygon and displacement is off */
-	if (job->displace_list == eiNULL_TAG)
+	else if (job->displace_list == eiNULL_TAG)
 	{
 		/* no approximation, dice directly */
 		tessel_tag = ei_poly_object_direct_dice(db, rt, poly, box);
@@ -2893,6 +2914,7 @@ static void ei_poly_object_parametric_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, tessel_job_tag1);
 
@@ -2913,6 +2935,7 @@ static void ei_poly_object_parametric_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, tessel_job_tag2);
 
@@ -2933,6 +2956,7 @@ static void ei_poly_object_parametric_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, tessel_job_tag3);
 
@@ -2953,6 +2977,7 @@ static void ei_poly_object_parametric_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, tessel_job_tag4);
 
@@ -3456,6 +3481,7 @@ static void ei_poly_object_spatial_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, left_tessel_job_tag);
 
@@ -3476,6 +3502,7 @@ static void ei_poly_object_spatial_split(
 	tessel_job->subdiv = job->subdiv + 1;
 	tessel_job->displace_list = job->displace_list;
 	tessel_job->deferred_dice = eiFALSE;
+	tessel_job->local_dice = job->local_dice;
 
 	ei_db_end(db, right_tessel_job_tag);
 
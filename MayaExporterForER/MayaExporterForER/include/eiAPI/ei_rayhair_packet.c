@@ -0,0 +1,1508 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiAPI/ei_rayhair_packet.h>
+#include <eiAPI/ei_hair_object.h>
+#include <eiAPI/ei_state.h>
+#include <eiCORE/ei_data_table.h>
+#include <eiCORE/ei_simd.h>
+#include <eiCORE/ei_assert.h>
+
+/** \brief The ray in ray space, where it starts from the origin 
+ * and points to +z, distances in ray space are measured in the 
+ * units of object space. */
+typedef struct eiHairRay {
+	/* the ray origin in object space */
+	eiVector		org;
+	/* the inverse ray direction in object space */
+	eiVector		inv_dir;
+	/* the axes of ray space in object space */
+	eiVector		X, Y, Z;
+	/* the length of ray direction in object space */
+	eiScalar		dir_len;
+	eiScalar		time;
+} eiHairRay;
+
+/** \brief The hit on a curve segment. */
+typedef struct eiHairHit {
+	/* the hit distance in ray space */
+	eiScalar		z;
+	/* the curve parameter and the parameter across the curve */
+	eiScalar		u, v;
+	eiIndex			prim;
+	eiIndex			seg;
+} eiHairHit;
+
+/** \brief The callback for each hit, returns the new far 
+ * distance in ray space. */
+typedef eiScalar (*eiHairHitProc)(void *param, const eiHairHit *hit, const eiScalar z_far);
+
+/** \brief A piece of a curve segment when generating packets, 
+ * which is gathered together for accessing in Morton order. */
+typedef struct eiHairPiece {
+	/* the offset of the first control point of the segment */
+	eiUint			offset;
+	eiIndex			prim;
+	eiIndex			seg;
+	/* the range of the curve parameter within the segment */
+	eiScalar		u0, u1;
+} eiHairPiece;
+
+/* spread the lower 10 bits to every third bit */
+static eiUint morton_spread(eiUint v)
+{
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+
+	return v;
+}
+
+/* the Morton code of a point within a box */
+static eiUint morton_code(const eiVector *c, const eiBound *box)
+{
+	eiVector	scale;
+
+	setv(&scale, 
+		1023.0f / MAX(box->xmax - box->xmin, eiSCALAR_EPS), 
+		1023.0f / MAX(box->ymax - box->ymin, eiSCALAR_EPS), 
+		1023.0f / MAX(box->zmax - box->zmin, eiSCALAR_EPS));
+
+	return 
+		(morton_spread((eiUint)((c->x - box->xmin) * scale.x)) << 2) | 
+		(morton_spread((eiUint)((c->y - box->ymin) * scale.y)) << 1) | 
+		morton_spread((eiUint)((c->z - box->zmin) * scale.z));
+}
+
+/* sort the indices by their keys, 8 bits per pass, the 
+   sorted results are in the input arrays after 4 passes */
+static void radix_sort(
+	eiUint *keys, 
+	eiUint *indices, 
+	eiUint *temp_keys, 
+	eiUint *temp_indices, 
+	const eiUint n)
+{
+	eiUint	shift;
+	eiUint	i;
+
+	for (shift = 0; shift < 32; shift += 8)
+	{
+		eiUint	count[ 256 ];
+		eiUint	offset;
+		eiUint	*t;
+
+		memset(count, 0, sizeof(count));
+
+		for (i = 0; i < n; ++i)
+		{
+			++ count[ (keys[i] >> shift) & 0xff ];
+		}
+
+		offset = 0;
+		for (i = 0; i < 256; ++i)
+		{
+			eiUint	c = count[i];
+
+			count[i] = offset;
+			offset += c;
+		}
+
+		for (i = 0; i < n; ++i)
+		{
+			eiUint	j = count[ (keys[i] >> shift) & 0xff ] ++;
+
+			temp_keys[j] = keys[i];
+			temp_indices[j] = indices[i];
+		}
+
+		t = keys;
+		keys = temp_keys;
+		temp_keys = t;
+		t = indices;
+		indices = temp_indices;
+		temp_indices = t;
+	}
+}
+
+/* count the curve segments of all hairs, and output the primitive 
+   index and segment index of each segment if the arrays are not 
+   NULL. each hair is described by the offset of its first vertex 
+   and its number of segments in the hair list. */
+static eiUint count_hair_segments(
+	const eiIndex *hairs, 
+	const eiUint num_hairs, 
+	const eiUint num_vertices, 
+	const eiInt degree, 
+	eiIndex *seg_prim, 
+	eiIndex *seg_index)
+{
+	eiUint	num_segments;
+	eiUint	i, j;
+
+	num_segments = 0;
+
+	for (i = 0; i < num_hairs; ++i)
+	{
+		eiUint	offset = hairs[ i * 2 + 0 ];
+		eiUint	n = hairs[ i * 2 + 1 ];
+
+		if (offset >= num_vertices)
+		{
+			continue;
+		}
+		/* ignore segments beyond the vertex list */
+		n = MIN(n, (num_vertices - 1 - offset) / degree);
+
+		if (seg_prim != NULL)
+		{
+			for (j = 0; j < n; ++j)
+			{
+				seg_prim[ num_segments + j ] = i;
+				seg_index[ num_segments + j ] = j;
+			}
+		}
+
+		num_segments += n;
+	}
+
+	return num_segments;
+}
+
+/* the Bezier basis of the curves at parameter u, the 
+   same as ei_curve1/2/3_eval_scalars */
+static eiFORCEINLINE void bezier_basis(const eiInt degree, const eiScalar u, eiScalar * const w)
+{
+	const eiScalar	s = 1.0f - u;
+
+	switch (degree)
+	{
+	case 1:
+		w[0] = s;
+		w[1] = u;
+		break;
+
+	case 2:
+		w[0] = s * s;
+		w[1] = 2.0f * s * u;
+		w[2] = u * u;
+		break;
+
+	default:
+		w[0] = s * s * s;
+		w[1] = 3.0f * s * s * u;
+		w[2] = 3.0f * s * u * u;
+		w[3] = u * u * u;
+		break;
+	}
+}
+
+/* split a curve segment at the curve parameter u by de Casteljau's 
+   algorithm, left or right can be NULL if not needed */
+static void split_hair_curve(
+	const eiInt degree, 
+	const eiVector4 *cvs, 
+	const eiScalar u, 
+	eiVector4 *left, 
+	eiVector4 *right)
+{
+	eiVector4	t[4];
+	eiInt		i, k;
+
+	for (i = 0; i <= degree; ++i)
+	{
+		movv4(&t[i], &cvs[i]);
+	}
+
+	for (k = 0; k <= degree; ++k)
+	{
+		if (left != NULL)
+		{
+			movv4(&left[k], &t[0]);
+		}
+		if (right != NULL)
+		{
+			movv4(&right[ degree - k ], &t[ degree - k ]);
+		}
+
+		for (i = 0; i < degree - k; ++i)
+		{
+			eiVector4	d;
+
+			lerp4(&d, &t[i], &t[ i + 1 ], u);
+			movv4(&t[i], &d);
+		}
+	}
+}
+
+/* the control points of the piece of a curve segment between 
+   the curve parameters u0 and u1 */
+static void get_hair_curve_piece(
+	const eiInt degree, 
+	const eiVector4 *cvs, 
+	const eiScalar u0, 
+	const eiScalar u1, 
+	eiVector4 *piece)
+{
+	eiVector4	left[4];
+
+	split_hair_curve(degree, cvs, u1, left, NULL);
+	split_hair_curve(degree, left, u0 / u1, NULL, piece);
+}
+
+/* the second differences of the control points of a curve, the 
+   maximum length is returned, and the maximum radius in rmax */
+static eiScalar get_hair_curve_flatness(
+	const eiInt degree, 
+	const eiVector4 *cvs, 
+	eiScalar * const rmax)
+{
+	eiScalar	L;
+	eiInt		j;
+
+	L = 0.0f;
+	*rmax = cvs[0].w;
+
+	for (j = 0; j + 2 <= degree; ++j)
+	{
+		eiVector	dd;
+
+		setv(&dd, 
+			cvs[j].x - 2.0f * cvs[ j + 1 ].x + cvs[ j + 2 ].x, 
+			cvs[j].y - 2.0f * cvs[ j + 1 ].y + cvs[ j + 2 ].y, 
+			cvs[j].z - 2.0f * cvs[ j + 1 ].z + cvs[ j + 2 ].z);
+		L = MAX(L, len(&dd));
+	}
+	for (j = 1; j <= degree; ++j)
+	{
+		*rmax = MAX(*rmax, cvs[j].w);
+	}
+
+	return L;
+}
+
+/* the number of pieces a curve segment is split into, so that 
+   every piece needs at most EI_HAIR_SPLIT_SUBDIV linear pieces for 
+   intersection at all motion keys. the number of linear pieces 
+   follows the bound of Nakamaru and Ohno on the second differences 
+   of control points, which also bounds the number needed in any 
+   ray space, because the axes of ray space are orthonormal. */
+static eiUint count_hair_curve_pieces(
+	const eiInt degree, 
+	const eiVector4 *cvs, 
+	const eiVector4 *motion_cvs)
+{
+	const eiScalar	tol = 0.05f * (eiScalar)(EI_HAIR_SPLIT_SUBDIV * EI_HAIR_SPLIT_SUBDIV);
+	eiScalar		L, rmax, c;
+	eiUint			n, i;
+	eiInt			k;
+
+	if (degree < 2)
+	{
+		return 1;
+	}
+
+	/* guess by the whole segment */
+	c = 1.41421356f * (eiScalar)(degree * (degree - 1)) / 8.0f;
+	n = 1;
+	for (k = 0; k < 2; ++k)
+	{
+		const eiVector4	*v = (k == 0) ? cvs : motion_cvs;
+
+		if (v != NULL)
+		{
+			L = get_hair_curve_flatness(degree, v, &rmax);
+			n = MAX(n, (eiUint)ceilf(sqrtf(c * L / MAX(tol * rmax, eiSCALAR_EPS))));
+		}
+	}
+
+	/* the second differences of a piece of 1/n are at most 1/n^2 
+	   of the segment's, but the radii of pieces may be smaller than 
+	   the maximum radius, the maximum radius of a piece is at least 
+	   the radii at its ends. */
+	for (; n < EI_HAIR_MAX_SPLIT; ++n)
+	{
+		eiBool	flat = eiTRUE;
+
+		for (k = 0; k < 2 && flat; ++k)
+		{
+			const eiVector4	*v = (k == 0) ? cvs : motion_cvs;
+			eiScalar		w[4];
+			eiScalar		r0, r1;
+			eiInt			j;
+
+			if (v == NULL)
+			{
+				break;
+			}
+
+			L = get_hair_curve_flatness(degree, v, &rmax) / (eiScalar)(n * n);
+			r0 = v[0].w;
+
+			for (i = 1; i <= n && flat; ++i)
+			{
+				bezier_basis(degree, (eiScalar)i / (eiScalar)n, w);
+				r1 = 0.0f;
+				for (j = 0; j <= degree; ++j)
+				{
+					r1 += w[j] * v[j].w;
+				}
+
+				flat = (c * L <= tol * MAX(r0, r1));
+				r0 = r1;
+			}
+		}
+
+		if (flat)
+		{
+			break;
+		}
+	}
+
+	return n;
+}
+
+/* count the pieces of all curve segments, and output the number 
+   of pieces of each segment */
+static eiUint count_hair_pieces(
+	const eiVector4 *vertices, 
+	const eiVector4 *motion_vertices, 
+	const eiIndex *hairs, 
+	const eiInt degree, 
+	const eiIndex *seg_prim, 
+	const eiIndex *seg_index, 
+	const eiUint num_segments, 
+	eiUint *seg_pieces)
+{
+	eiUint	num_pieces;
+	eiUint	i;
+
+	num_pieces = 0;
+
+	for (i = 0; i < num_segments; ++i)
+	{
+		eiUint	offset = hairs[ seg_prim[i] * 2 ] + degree * seg_index[i];
+
+		seg_pieces[i] = count_hair_curve_pieces(
+			degree, 
+			&vertices[ offset ], 
+			(motion_vertices != NULL) ? &motion_vertices[ offset ] : NULL);
+		num_pieces += seg_pieces[i];
+	}
+
+	return num_pieces;
+}
+
+/* build the hierarchy over packets in the range [begin, end) of 
+   the sorted order, keys are the sorted Morton codes, order is the 
+   packet of each position, or NULL if packets are in sorted order, 
+   returns the index of the node */
+static eiUint build_packet_node(
+	eiRayHairPacketNode *nodes, 
+	eiUint *num_nodes, 
+	const eiBound *boxes, 
+	const eiUint *keys, 
+	const eiUint *order, 
+	const eiUint begin, 
+	const eiUint end)
+{
+	eiRayHairPacketNode	*node;
+	eiUint				index;
+
+	index = (*num_nodes) ++;
+	node = &nodes[ index ];
+
+	if ((end - begin) == 1)
+	{
+		node->index = (order != NULL) ? order[ begin ] : begin;
+		movb(&node->box, &boxes[ node->index ]);
+		node->leaf = eiTRUE;
+	}
+	else
+	{
+		eiUint	mid = (begin + end) / 2;
+		eiUint	diff = keys[ begin ] ^ keys[ end - 1 ];
+
+		/* split at the highest bit where the Morton codes differ, 
+		   which is a spatial median, or halve the range if all 
+		   codes are the same */
+		if (diff != 0)
+		{
+			eiUint	bit = 0x80000000;
+			eiUint	lo = begin;
+			eiUint	hi = end - 1;
+
+			while ((diff & bit) == 0)
+			{
+				bit >>= 1;
+			}
+
+			/* find the first packet with the bit set */
+			while (lo + 1 < hi)
+			{
+				eiUint	m = (lo + hi) / 2;
+
+				if ((keys[m] & bit) != 0)
+				{
+					hi = m;
+				}
+				else
+				{
+					lo = m;
+				}
+			}
+
+			mid = hi;
+		}
+
+		build_packet_node(nodes, num_nodes, boxes, keys, order, begin, mid);
+		node->index = build_packet_node(nodes, num_nodes, boxes, keys, order, mid, end);
+		node->leaf = eiFALSE;
+		movb(&node->box, &nodes[ index + 1 ].box);
+		addb(&node->box, &nodes[ node->index ].box);
+	}
+
+	return index;
+}
+
+/* get the box of a packet over the time range [t0, t1], since 
+   control points move linearly, the boxes at both ends enclose 
+   the motion in between */
+static void get_hair_packet_box(
+	eiBound *box, 
+	const eiScalar *packet, 
+	const eiInt num_cvs, 
+	const eiScalar t0, 
+	const eiScalar t1)
+{
+	const eiScalar	*key0 = packet;
+	const eiScalar	*key1 = packet + num_cvs * 4 * EI_HAIR_PACKET_SIZE;
+	eiInt			c, lane, k;
+
+	initb(box);
+
+	for (c = 0; c < num_cvs; ++c)
+	{
+		const eiScalar	*v0 = key0 + c * 4 * EI_HAIR_PACKET_SIZE;
+		const eiScalar	*v1 = key1 + c * 4 * EI_HAIR_PACKET_SIZE;
+
+		for (lane = 0; lane < EI_HAIR_PACKET_SIZE; ++lane)
+		{
+			for (k = 0; k < 2; ++k)
+			{
+				eiScalar	t = (k == 0) ? t0 : t1;
+				eiScalar	p[4];
+				eiVector	r;
+				eiInt		j;
+
+				for (j = 0; j < 4; ++j)
+				{
+					p[j] = v0[ j * EI_HAIR_PACKET_SIZE + lane ] 
+						+ t * (v1[ j * EI_HAIR_PACKET_SIZE + lane ] - v0[ j * EI_HAIR_PACKET_SIZE + lane ]);
+				}
+
+				setv(&r, p[0] - p[3], p[1] - p[3], p[2] - p[3]);
+				addbv(box, &r);
+				setv(&r, p[0] + p[3], p[1] + p[3], p[2] + p[3]);
+				addbv(box, &r);
+			}
+		}
+	}
+}
+
+/** \brief The task of one thread for building the hierarchies of 
+ * time segments, each task builds every num_tasks-th segment with 
+ * scratch arrays of its own. */
+typedef struct eiHairSegmentTask {
+	eiRayHairPackets		*packets;
+	eiUint					first_segment;
+	eiUint					num_tasks;
+	/* the number of segments built with the expected number of nodes */
+	eiUint					num_built;
+} eiHairSegmentTask;
+
+static eiTHREAD_FUNC build_hair_segments_thread(void *param)
+{
+	eiHairSegmentTask		*task;
+	eiRayHairPackets		*packets;
+	eiRayHairPacketNode		*nodes;
+	const eiScalar			*packet_data;
+	eiBound					*boxes;
+	eiBound					centers;
+	eiVector				*centers_list;
+	eiUint					*keys;
+	eiUint					*order;
+	eiUint					*temp;
+	eiUint					num_packets;
+	eiUint					num_nodes;
+	eiUint					s, p;
+
+	task = (eiHairSegmentTask *)param;
+	packets = task->packets;
+	task->num_built = 0;
+	num_packets = packets->num_packets;
+	nodes = (eiRayHairPacketNode *)(packets + 1);
+	packet_data = (const eiScalar *)(nodes + packets->num_segments * packets->num_nodes);
+
+	boxes = (eiBound *)ei_allocate(sizeof(eiBound) * num_packets);
+	centers_list = (eiVector *)ei_allocate(sizeof(eiVector) * num_packets);
+	keys = (eiUint *)ei_allocate(sizeof(eiUint) * num_packets * 4);
+	order = keys + num_packets;
+	temp = order + num_packets;
+
+	for (s = task->first_segment; s < packets->num_segments; s += task->num_tasks)
+	{
+		eiScalar	t0 = (eiScalar)s / (eiScalar)packets->num_segments;
+		eiScalar	t1 = (eiScalar)(s + 1) / (eiScalar)packets->num_segments;
+
+		/* packets are sorted by the pieces at the shutter open, 
+		   re-sort them by where they are during this segment */
+		initb(&centers);
+		for (p = 0; p < num_packets; ++p)
+		{
+			get_hair_packet_box(&boxes[p], packet_data + p * packets->packet_size, 
+				packets->degree + 1, t0, t1);
+			bcenter(&centers_list[p], &boxes[p]);
+			addbv(&centers, &centers_list[p]);
+		}
+
+		for (p = 0; p < num_packets; ++p)
+		{
+			keys[p] = morton_code(&centers_list[p], &centers);
+			order[p] = p;
+		}
+
+		radix_sort(keys, order, temp, temp + num_packets, num_packets);
+
+		/* each segment only writes its own range of nodes */
+		num_nodes = 0;
+		build_packet_node(nodes + s * packets->num_nodes, &num_nodes, boxes, keys, order, 0, num_packets);
+
+		if (num_nodes == packets->num_nodes)
+		{
+			++ task->num_built;
+		}
+	}
+
+	ei_free(keys);
+	ei_free(centers_list);
+	ei_free(boxes);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+/* build the hierarchies of all time segments, packets must have 
+   been filled. large packets take extra threads from the pool of 
+   the renderer, segments are independent, so the result does not 
+   depend on the number of threads. */
+static void build_hair_segments(eiRayHairPackets *packets)
+{
+	eiHairSegmentTask	tasks[ EI_MAX_TASK_THREADS ];
+	eiUint				num_extra_threads;
+	eiUint				num_tasks;
+	eiUint				num_built;
+	eiUint				i;
+
+	num_extra_threads = 0;
+
+	if (packets->num_packets >= EI_HAIR_PARALLEL_MIN_PACKETS)
+	{
+		num_extra_threads = ei_acquire_task_threads(
+			MIN(packets->num_segments, EI_MAX_TASK_THREADS) - 1);
+	}
+
+	num_tasks = num_extra_threads + 1;
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		tasks[i].packets = packets;
+		tasks[i].first_segment = i;
+		tasks[i].num_tasks = num_tasks;
+		tasks[i].num_built = 0;
+	}
+
+	ei_run_tasks(build_hair_segments_thread, tasks, sizeof(eiHairSegmentTask), num_tasks);
+
+	ei_release_task_threads(num_extra_threads);
+
+	/* all tasks have been joined, every segment must be complete */
+	num_built = 0;
+
+	for (i = 0; i < num_tasks; ++i)
+	{
+		num_built += tasks[i].num_built;
+	}
+
+	eiDBG_ASSERT(num_built == packets->num_segments);
+}
+
+/* fill packets and the hierarchy, the counts in the header must 
+   have been set, motion_vertices is only used with 2 motion keys. */
+static void fill_hair_packets(
+	eiRayHairPackets *packets, 
+	const eiVector4 *vertices, 
+	const eiVector4 *motion_vertices, 
+	const eiIndex *hairs, 
+	const eiIndex *seg_prim, 
+	const eiIndex *seg_index, 
+	const eiUint *seg_pieces, 
+	const eiUint num_segments, 
+	const eiUint num_pieces)
+{
+	const eiInt				degree = packets->degree;
+	const eiInt				num_cvs = degree + 1;
+	eiRayHairPacketNode		*nodes;
+	eiScalar				*packet;
+	eiBound					*boxes;
+	eiBound					centers;
+	eiUint					*keys;
+	eiUint					*order;
+	eiUint					*temp;
+	eiHairPiece				*pieces;
+	eiVector				*centers_list;
+	eiUint					num_nodes;
+	eiUint					i, j, p;
+
+	initb(&packets->box);
+
+	if (num_pieces == 0)
+	{
+		return;
+	}
+
+	keys = (eiUint *)ei_allocate(sizeof(eiUint) * num_pieces * 4);
+	order = keys + num_pieces;
+	temp = order + num_pieces;
+	pieces = (eiHairPiece *)ei_allocate(sizeof(eiHairPiece) * num_pieces);
+	centers_list = (eiVector *)ei_allocate(sizeof(eiVector) * num_pieces);
+
+	/* sort pieces by the Morton codes of their centers */
+	initb(&centers);
+	p = 0;
+	for (i = 0; i < num_segments; ++i)
+	{
+		eiUint	offset = hairs[ seg_prim[i] * 2 ] + degree * seg_index[i];
+
+		for (j = 0; j < seg_pieces[i]; ++j)
+		{
+			eiHairPiece	*piece = &pieces[p];
+			eiVector4	cvs[4];
+
+			piece->offset = offset;
+			piece->prim = seg_prim[i];
+			piece->seg = seg_index[i];
+			piece->u0 = (eiScalar)j / (eiScalar)seg_pieces[i];
+			piece->u1 = (eiScalar)(j + 1) / (eiScalar)seg_pieces[i];
+
+			get_hair_curve_piece(degree, &vertices[ offset ], piece->u0, piece->u1, cvs);
+			add(&centers_list[p], &cvs[0].xyz, &cvs[ degree ].xyz);
+			mulvfi(&centers_list[p], 0.5f);
+			addbv(&centers, &centers_list[p]);
+			++ p;
+		}
+	}
+
+	for (i = 0; i < num_pieces; ++i)
+	{
+		keys[i] = morton_code(&centers_list[i], &centers);
+		order[i] = i;
+	}
+
+	ei_free(centers_list);
+
+	radix_sort(keys, order, temp, temp + num_pieces, num_pieces);
+
+	nodes = (eiRayHairPacketNode *)(packets + 1);
+	packet = (eiScalar *)(nodes + packets->num_segments * packets->num_nodes);
+	boxes = (eiBound *)ei_allocate(sizeof(eiBound) * packets->num_packets);
+
+	for (p = 0; p < packets->num_packets; ++p)
+	{
+		eiIndex		*prims;
+		eiIndex		*segs;
+		eiScalar	*u0;
+		eiScalar	*u1;
+		eiInt		lane, k, c;
+
+		prims = (eiIndex *)(packet + packets->num_keys * num_cvs * 4 * EI_HAIR_PACKET_SIZE);
+		segs = prims + EI_HAIR_PACKET_SIZE;
+		u0 = (eiScalar *)(segs + EI_HAIR_PACKET_SIZE);
+		u1 = u0 + EI_HAIR_PACKET_SIZE;
+
+		initb(&boxes[p]);
+
+		for (lane = 0; lane < EI_HAIR_PACKET_SIZE; ++lane)
+		{
+			eiUint		s = p * EI_HAIR_PACKET_SIZE + lane;
+			eiHairPiece	*piece;
+
+			/* unused lanes repeat the last piece, they are 
+			   marked so that their hits will be ignored */
+			piece = &pieces[ order[ MIN(s, num_pieces - 1) ] ];
+
+			if (s < num_pieces)
+			{
+				prims[ lane ] = piece->prim;
+				segs[ lane ] = piece->seg;
+			}
+			else
+			{
+				prims[ lane ] = eiNULL_INDEX;
+				segs[ lane ] = eiNULL_INDEX;
+			}
+			u0[ lane ] = piece->u0;
+			u1[ lane ] = piece->u1;
+
+			for (k = 0; k < packets->num_keys; ++k)
+			{
+				const eiVector4	*v = (k == 0) ? vertices : motion_vertices;
+				eiVector4		cvs[4];
+
+				get_hair_curve_piece(degree, &v[ piece->offset ], piece->u0, piece->u1, cvs);
+
+				for (c = 0; c < num_cvs; ++c)
+				{
+					const eiVector4	*cv = &cvs[c];
+					eiScalar		*dst = packet + ((k * num_cvs + c) * 4) * EI_HAIR_PACKET_SIZE + lane;
+					eiVector		r;
+
+					dst[ 0 * EI_HAIR_PACKET_SIZE ] = cv->x;
+					dst[ 1 * EI_HAIR_PACKET_SIZE ] = cv->y;
+					dst[ 2 * EI_HAIR_PACKET_SIZE ] = cv->z;
+					dst[ 3 * EI_HAIR_PACKET_SIZE ] = cv->w;
+
+					/* curves lie in the convex hull of their control 
+					   points, expanded by the radius */
+					setv(&r, cv->x - cv->w, cv->y - cv->w, cv->z - cv->w);
+					addbv(&boxes[p], &r);
+					setv(&r, cv->x + cv->w, cv->y + cv->w, cv->z + cv->w);
+					addbv(&boxes[p], &r);
+				}
+			}
+		}
+
+		addb(&packets->box, &boxes[p]);
+
+		packet += packets->packet_size;
+	}
+
+	if (packets->num_segments > 1)
+	{
+		build_hair_segments(packets);
+	}
+	else
+	{
+		/* the Morton codes of the first pieces of packets */
+		for (p = 0; p < packets->num_packets; ++p)
+		{
+			keys[p] = keys[ p * EI_HAIR_PACKET_SIZE ];
+		}
+
+		num_nodes = 0;
+		build_packet_node(nodes, &num_nodes, boxes, keys, NULL, 0, packets->num_packets);
+		eiDBG_ASSERT(num_nodes == packets->num_nodes);
+	}
+
+	ei_free(boxes);
+	ei_free(pieces);
+	ei_free(keys);
+}
+
+void generate_ray_hair_packets(
+	eiDatabase *db, 
+	const eiTag data_tag, 
+	eiData *pData, 
+	eiTLS *pTls)
+{
+	eiRayHairPackets		*packets;
+	eiHairObject			*hair;
+	eiDataTableIterator		iter;
+	eiVector4				*vertices;
+	eiVector4				*motion_vertices;
+	eiIndex					*hairs;
+	eiIndex					*seg_prim;
+	eiIndex					*seg_index;
+	eiUint					*seg_pieces;
+	eiUint					num_vertices;
+	eiUint					num_hairs;
+	eiUint					num_segments;
+	eiUint					num_pieces;
+	eiInt					degree;
+	eiInt					num_keys;
+	eiInt					motion_segments;
+	eiUint					max_segments;
+	eiUint					i;
+
+	eiDBG_ASSERT(pData != NULL && pData->ptr != NULL);
+	packets = (eiRayHairPackets *)pData->ptr;
+
+	hair = (eiHairObject *)ei_db_access(db, packets->obj_tag);
+
+	degree = MAX(1, MIN(3, hair->degree));
+	motion_segments = hair->motion_segments;
+	num_keys = 1;
+	vertices = NULL;
+	motion_vertices = NULL;
+	hairs = NULL;
+	num_vertices = 0;
+	num_hairs = 0;
+
+	if (hair->vertex_list != eiNULL_TAG && hair->hair_list != eiNULL_TAG)
+	{
+		ei_data_table_begin(db, hair->vertex_list, &iter);
+		num_vertices = iter.tab->item_count;
+		vertices = (eiVector4 *)ei_allocate(sizeof(eiVector4) * MAX(1, num_vertices));
+		for (i = 0; i < num_vertices; ++i)
+		{
+			movv4(&vertices[i], (eiVector4 *)ei_data_table_read(&iter, i));
+		}
+		ei_data_table_end(&iter);
+
+		/* the motion vertex list is the vertex list when 
+		   there is no motion */
+		if (hair->motion_vertex_list != eiNULL_TAG && 
+			hair->motion_vertex_list != hair->vertex_list)
+		{
+			num_keys = 2;
+			ei_data_table_begin(db, hair->motion_vertex_list, &iter);
+			motion_vertices = (eiVector4 *)ei_allocate(sizeof(eiVector4) * MAX(1, num_vertices));
+			for (i = 0; i < num_vertices; ++i)
+			{
+				movv4(&motion_vertices[i], (eiVector4 *)ei_data_table_read(&iter, i));
+			}
+			ei_data_table_end(&iter);
+		}
+
+		ei_data_table_begin(db, hair->hair_list, &iter);
+		num_hairs = iter.tab->item_count / 2;
+		hairs = (eiIndex *)ei_allocate(sizeof(eiIndex) * MAX(1, num_hairs * 2));
+		for (i = 0; i < num_hairs * 2; ++i)
+		{
+			hairs[i] = *((eiIndex *)ei_data_table_read(&iter, i));
+		}
+		ei_data_table_end(&iter);
+	}
+
+	ei_db_end(db, packets->obj_tag);
+
+	num_segments = count_hair_segments(hairs, num_hairs, num_vertices, degree, NULL, NULL);
+	seg_prim = (eiIndex *)ei_allocate(sizeof(eiIndex) * MAX(1, num_segments) * 3);
+	seg_index = seg_prim + MAX(1, num_segments);
+	seg_pieces = (eiUint *)(seg_index + MAX(1, num_segments));
+	count_hair_segments(hairs, num_hairs, num_vertices, degree, seg_prim, seg_index);
+	num_pieces = count_hair_pieces(vertices, motion_vertices, hairs, degree, 
+		seg_prim, seg_index, num_segments, seg_pieces);
+
+	packets->degree = degree;
+	packets->num_keys = num_keys;
+	packets->num_packets = (num_pieces + EI_HAIR_PACKET_SIZE - 1) / EI_HAIR_PACKET_SIZE;
+	packets->num_nodes = (packets->num_packets > 0) ? (packets->num_packets * 2 - 1) : 0;
+	packets->packet_size = num_keys * (degree + 1) * 4 * EI_HAIR_PACKET_SIZE + 4 * EI_HAIR_PACKET_SIZE;
+
+	/* split the shutter into time segments for moving hairs, 
+	   the hierarchies of all segments together should not take 
+	   more memory than the packets themselves */
+	packets->num_segments = 1;
+	if (num_keys == 2 && packets->num_nodes > 0)
+	{
+		max_segments = (eiUint)((sizeof(eiScalar) * packets->packet_size * packets->num_packets) 
+			/ (sizeof(eiRayHairPacketNode) * packets->num_nodes));
+		packets->num_segments = MAX(1, MIN(EI_HAIR_MAX_MOTION_SEGMENTS, motion_segments));
+		packets->num_segments = MAX(1, MIN(max_segments, packets->num_segments));
+	}
+
+	packets = (eiRayHairPackets *)ei_db_resize(db, 
+		data_tag, 
+		sizeof(eiRayHairPackets) 
+		+ sizeof(eiRayHairPacketNode) * packets->num_segments * packets->num_nodes 
+		+ sizeof(eiScalar) * packets->packet_size * packets->num_packets);
+
+	fill_hair_packets(
+		packets, 
+		vertices, 
+		motion_vertices, 
+		hairs, 
+		seg_prim, 
+		seg_index, 
+		seg_pieces, 
+		num_segments, 
+		num_pieces);
+
+	ei_free(seg_prim);
+	eiCHECK_FREE(hairs);
+	eiCHECK_FREE(motion_vertices);
+	eiCHECK_FREE(vertices);
+}
+
+static eiFORCEINLINE eiVf vf_lerp(const eiVf a, const eiVf b, const eiVf t)
+{
+	return ei_vf_add(a, ei_vf_mul(ei_vf_sub(b, a), t));
+}
+
+static eiFORCEINLINE eiVf vf_dot3(const eiVf x, const eiVf y, const eiVf z, const eiVector *axis)
+{
+	return ei_vf_add(
+		ei_vf_add(ei_vf_mul(x, ei_vf_set1(axis->x)), ei_vf_mul(y, ei_vf_set1(axis->y))), 
+		ei_vf_mul(z, ei_vf_set1(axis->z)));
+}
+
+/* intersect a ray with all segments of a packet between z_near 
+   and z_far in ray space, returns the mask of lanes which are hit, 
+   bit i for lane i. the curves are ribbons facing the ray, they 
+   are subdivided into linear pieces uniformly, the number of pieces 
+   is determined by the flatness of the control polygons in ray 
+   space like the recursive subdivision of the hair BSP-tree. */
+static eiUint intersect_hair_packet(
+	const eiRayHairPackets *packets, 
+	const eiScalar *packet, 
+	const eiHairRay *ray, 
+	const eiScalar z_near, 
+	const eiScalar z_far, 
+	eiScalar * const hit_z, 
+	eiScalar * const hit_u, 
+	eiScalar * const hit_v)
+{
+	const eiInt		degree = packets->degree;
+	const eiInt		num_cvs = degree + 1;
+	const eiVf		zero = ei_vf_set1(0.0f);
+	const eiVf		one = ei_vf_set1(1.0f);
+	const eiScalar	*range;
+	eiUint			mask;
+	eiInt			c, j;
+
+	mask = 0;
+	/* skip the primitive indices and the segment indices */
+	range = packet + packets->num_keys * num_cvs * 4 * EI_HAIR_PACKET_SIZE + 2 * EI_HAIR_PACKET_SIZE;
+
+	for (c = 0; c < EI_HAIR_PACKET_SIZE; c += EI_VF_WIDTH)
+	{
+		eiVf		px[4], py[4], pz[4], pr[4];
+		eiVf		u0, u1;
+		eiVf		xmin, xmax, ymin, ymax, zmin, zmax, rmax;
+		eiVf		dx, dy, cmin, cmax, dmin, dmax, e, co, dot_o;
+		eiVf		active, best_z, best_u, best_v;
+		eiVf		ax, ay, az, ar;
+		eiScalar	w[4];
+		eiInt		num_pieces, i, l;
+		eiInt		lanes;
+
+		/* transform control points into ray space */
+		for (j = 0; j < num_cvs; ++j)
+		{
+			const eiScalar	*cv = packet + j * 4 * EI_HAIR_PACKET_SIZE + c;
+			eiVf			x, y, z, r;
+
+			x = ei_vf_load(cv + 0 * EI_HAIR_PACKET_SIZE);
+			y = ei_vf_load(cv + 1 * EI_HAIR_PACKET_SIZE);
+			z = ei_vf_load(cv + 2 * EI_HAIR_PACKET_SIZE);
+			r = ei_vf_load(cv + 3 * EI_HAIR_PACKET_SIZE);
+
+			if (packets->num_keys == 2)
+			{
+				const eiScalar	*cv1 = cv + num_cvs * 4 * EI_HAIR_PACKET_SIZE;
+				const eiVf		time = ei_vf_set1(ray->time);
+
+				x = vf_lerp(x, ei_vf_load(cv1 + 0 * EI_HAIR_PACKET_SIZE), time);
+				y = vf_lerp(y, ei_vf_load(cv1 + 1 * EI_HAIR_PACKET_SIZE), time);
+				z = vf_lerp(z, ei_vf_load(cv1 + 2 * EI_HAIR_PACKET_SIZE), time);
+				r = vf_lerp(r, ei_vf_load(cv1 + 3 * EI_HAIR_PACKET_SIZE), time);
+			}
+
+			x = ei_vf_sub(x, ei_vf_set1(ray->org.x));
+			y = ei_vf_sub(y, ei_vf_set1(ray->org.y));
+			z = ei_vf_sub(z, ei_vf_set1(ray->org.z));
+
+			px[j] = vf_dot3(x, y, z, &ray->X);
+			py[j] = vf_dot3(x, y, z, &ray->Y);
+			pz[j] = vf_dot3(x, y, z, &ray->Z);
+			pr[j] = r;
+		}
+
+		/* early out by the bounding box in ray space */
+		xmin = xmax = px[0];
+		ymin = ymax = py[0];
+		zmin = zmax = pz[0];
+		rmax = pr[0];
+		for (j = 1; j < num_cvs; ++j)
+		{
+			xmin = ei_vf_min(xmin, px[j]);
+			xmax = ei_vf_max(xmax, px[j]);
+			ymin = ei_vf_min(ymin, py[j]);
+			ymax = ei_vf_max(ymax, py[j]);
+			zmin = ei_vf_min(zmin, pz[j]);
+			zmax = ei_vf_max(zmax, pz[j]);
+			rmax = ei_vf_max(rmax, pr[j]);
+		}
+
+		active = ei_vf_and(
+			ei_vf_and(ei_vf_ge(rmax, xmin), ei_vf_ge(xmax, ei_vf_sub(zero, rmax))), 
+			ei_vf_and(ei_vf_ge(rmax, ymin), ei_vf_ge(ymax, ei_vf_sub(zero, rmax))));
+		active = ei_vf_and(active, ei_vf_and(
+			ei_vf_ge(ei_vf_add(zmax, rmax), ei_vf_set1(z_near)), 
+			ei_vf_ge(ei_vf_set1(z_far), ei_vf_sub(zmin, rmax))));
+
+		if (ei_vf_movemask(active) == 0)
+		{
+			continue;
+		}
+
+		/* early out by the slab oriented along the chord, which 
+		   bounds the control polygon in ray space. distances are 
+		   scaled by the chord length to avoid divisions. */
+		dx = ei_vf_sub(px[degree], px[0]);
+		dy = ei_vf_sub(py[degree], py[0]);
+		cmin = cmax = dmin = dmax = zero;
+		for (j = 1; j < num_cvs; ++j)
+		{
+			eiVf	qx = ei_vf_sub(px[j], px[0]);
+			eiVf	qy = ei_vf_sub(py[j], py[0]);
+			eiVf	cr = ei_vf_sub(ei_vf_mul(dx, qy), ei_vf_mul(dy, qx));
+			eiVf	dt = ei_vf_add(ei_vf_mul(dx, qx), ei_vf_mul(dy, qy));
+
+			cmin = ei_vf_min(cmin, cr);
+			cmax = ei_vf_max(cmax, cr);
+			dmin = ei_vf_min(dmin, dt);
+			dmax = ei_vf_max(dmax, dt);
+		}
+		e = ei_vf_mul(rmax, ei_vf_sqrt(ei_vf_add(ei_vf_mul(dx, dx), ei_vf_mul(dy, dy))));
+		co = ei_vf_sub(ei_vf_mul(dy, px[0]), ei_vf_mul(dx, py[0]));
+		dot_o = ei_vf_sub(zero, ei_vf_add(ei_vf_mul(dx, px[0]), ei_vf_mul(dy, py[0])));
+
+		active = ei_vf_and(active, ei_vf_and(
+			ei_vf_and(ei_vf_ge(co, ei_vf_sub(cmin, e)), ei_vf_ge(ei_vf_add(cmax, e), co)), 
+			ei_vf_and(ei_vf_ge(dot_o, ei_vf_sub(dmin, e)), ei_vf_ge(ei_vf_add(dmax, e), dot_o))));
+
+		lanes = ei_vf_movemask(active);
+		if (lanes == 0)
+		{
+			continue;
+		}
+
+		/* the number of pieces for the flattest active lane to be 
+		   within a fraction of the radius, following the bound of 
+		   Nakamaru and Ohno on the second differences */
+		num_pieces = 1;
+		if (degree >= 2)
+		{
+			eiVf		L = zero;
+			eiScalar	n2[ EI_VF_WIDTH ];
+
+			for (j = 0; j + 2 < num_cvs; ++j)
+			{
+				eiVf	ddx = ei_vf_add(ei_vf_sub(px[j], ei_vf_mul(ei_vf_set1(2.0f), px[j + 1])), px[j + 2]);
+				eiVf	ddy = ei_vf_add(ei_vf_sub(py[j], ei_vf_mul(ei_vf_set1(2.0f), py[j + 1])), py[j + 2]);
+
+				L = ei_vf_max(L, ei_vf_max(ei_vf_abs(ddx), ei_vf_abs(ddy)));
+			}
+
+			ei_vf_store(n2, ei_vf_div(
+				ei_vf_mul(L, ei_vf_set1(1.41421356f * (eiScalar)(degree * (degree - 1)) / 8.0f)), 
+				ei_vf_max(ei_vf_mul(rmax, ei_vf_set1(0.05f)), ei_vf_set1(eiSCALAR_EPS))));
+
+			for (l = 0; l < EI_VF_WIDTH; ++l)
+			{
+				if ((lanes >> l) & 1)
+				{
+					eiScalar	n = MIN(sqrtf(n2[l]), (eiScalar)EI_HAIR_MAX_SUBDIV);
+
+					num_pieces = MAX(num_pieces, (eiInt)ceilf(n));
+				}
+			}
+		}
+
+		best_z = ei_vf_set1(z_far);
+		best_u = zero;
+		best_v = zero;
+		u0 = ei_vf_load(range + c);
+		u1 = ei_vf_load(range + EI_HAIR_PACKET_SIZE + c);
+
+		ax = px[0];
+		ay = py[0];
+		az = pz[0];
+		ar = pr[0];
+
+		for (i = 1; i <= num_pieces; ++i)
+		{
+			eiVf	bx, by, bz, br;
+			eiVf	sx, sy, t, cx, cy, d2, r, z, sd, v, hit;
+
+			if (i == num_pieces)
+			{
+				bx = px[degree];
+				by = py[degree];
+				bz = pz[degree];
+				br = pr[degree];
+			}
+			else
+			{
+				bezier_basis(degree, (eiScalar)i / (eiScalar)num_pieces, w);
+
+				bx = ei_vf_mul(px[0], ei_vf_set1(w[0]));
+				by = ei_vf_mul(py[0], ei_vf_set1(w[0]));
+				bz = ei_vf_mul(pz[0], ei_vf_set1(w[0]));
+				br = ei_vf_mul(pr[0], ei_vf_set1(w[0]));
+				for (j = 1; j < num_cvs; ++j)
+				{
+					bx = ei_vf_add(bx, ei_vf_mul(px[j], ei_vf_set1(w[j])));
+					by = ei_vf_add(by, ei_vf_mul(py[j], ei_vf_set1(w[j])));
+					bz = ei_vf_add(bz, ei_vf_mul(pz[j], ei_vf_set1(w[j])));
+					br = ei_vf_add(br, ei_vf_mul(pr[j], ei_vf_set1(w[j])));
+				}
+			}
+
+			/* the closest point to the ray on the piece */
+			sx = ei_vf_sub(bx, ax);
+			sy = ei_vf_sub(by, ay);
+			t = ei_vf_div(
+				ei_vf_sub(zero, ei_vf_add(ei_vf_mul(ax, sx), ei_vf_mul(ay, sy))), 
+				ei_vf_max(ei_vf_add(ei_vf_mul(sx, sx), ei_vf_mul(sy, sy)), ei_vf_set1(1.0e-30f)));
+
+			/* the ends of the curve segment are cut flat, but 
+			   not the ends of its pieces */
+			hit = active;
+			if (i == 1)
+			{
+				hit = ei_vf_and(hit, ei_vf_or(ei_vf_ge(t, zero), ei_vf_gt(u0, zero)));
+			}
+			if (i == num_pieces)
+			{
+				hit = ei_vf_and(hit, ei_vf_or(ei_vf_ge(one, t), ei_vf_gt(one, u1)));
+			}
+			t = ei_vf_min(ei_vf_max(t, zero), one);
+
+			cx = ei_vf_add(ax, ei_vf_mul(t, sx));
+			cy = ei_vf_add(ay, ei_vf_mul(t, sy));
+			d2 = ei_vf_add(ei_vf_mul(cx, cx), ei_vf_mul(cy, cy));
+			r = vf_lerp(ar, br, t);
+			z = vf_lerp(az, bz, t);
+
+			hit = ei_vf_and(hit, ei_vf_and(
+				ei_vf_ge(ei_vf_mul(r, r), d2), 
+				ei_vf_and(ei_vf_ge(z, ei_vf_set1(z_near)), ei_vf_lt(z, best_z))));
+
+			if (ei_vf_movemask(hit) != 0)
+			{
+				/* v goes across the ribbon from 0 to 1 */
+				sd = ei_vf_mul(ei_vf_set1(0.5f), ei_vf_div(ei_vf_sqrt(d2), ei_vf_max(r, ei_vf_set1(1.0e-30f))));
+				v = ei_vf_select(
+					ei_vf_ge(ei_vf_sub(ei_vf_mul(sx, cy), ei_vf_mul(sy, cx)), zero), 
+					ei_vf_add(ei_vf_set1(0.5f), sd), 
+					ei_vf_sub(ei_vf_set1(0.5f), sd));
+
+				best_z = ei_vf_select(hit, z, best_z);
+				best_u = ei_vf_select(hit, 
+					vf_lerp(u0, u1, ei_vf_mul(ei_vf_add(ei_vf_set1((eiScalar)(i - 1)), t), ei_vf_set1(1.0f / (eiScalar)num_pieces))), 
+					best_u);
+				best_v = ei_vf_select(hit, v, best_v);
+			}
+
+			ax = bx;
+			ay = by;
+			az = bz;
+			ar = br;
+		}
+
+		ei_vf_store(hit_z + c, best_z);
+		ei_vf_store(hit_u + c, best_u);
+		ei_vf_store(hit_v + c, best_v);
+		mask |= ((eiUint)ei_vf_movemask(ei_vf_lt(best_z, ei_vf_set1(z_far)))) << c;
+	}
+
+	return mask;
+}
+
+/* traverse the hierarchy of packets with a ray between t_near 
+   and t_far, and call hit_proc for each hit */
+static void trace_hair_packets(
+	const eiRayHairPackets *packets, 
+	const eiHairRay *ray, 
+	const eiScalar t_near, 
+	const eiScalar t_far, 
+	eiHairHitProc hit_proc, 
+	void *param)
+{
+	const eiRayHairPacketNode	*nodes;
+	const eiScalar				*packet_data;
+	eiUint						stack[ EI_HAIR_PACKET_STACK_SIZE ];
+	eiInt						top;
+	eiInt						segment;
+	eiScalar					z_near, z_far;
+
+	if (packets->num_packets == 0)
+	{
+		return;
+	}
+
+	/* select the hierarchy of the time segment of the ray */
+	segment = (eiInt)(ray->time * (eiScalar)packets->num_segments);
+	segment = MAX(0, MIN((eiInt)packets->num_segments - 1, segment));
+
+	nodes = (const eiRayHairPacketNode *)(packets + 1);
+	packet_data = (const eiScalar *)(nodes + packets->num_segments * packets->num_nodes);
+	nodes += segment * packets->num_nodes;
+	z_near = t_near * ray->dir_len;
+	z_far = t_far * ray->dir_len;
+
+	top = 0;
+	stack[ top ++ ] = 0;
+
+	while (top > 0)
+	{
+		const eiRayHairPacketNode	*node;
+		eiScalar					tmin, tmax;
+
+		node = &nodes[ stack[ -- top ] ];
+
+		/* test here rather than before pushing, the far 
+		   distance may have been shortened in between */
+		if (!intersect_box(&ray->org, &ray->inv_dir, &node->box, &tmin, &tmax) || 
+			tmin * ray->dir_len > z_far || tmax * ray->dir_len < z_near)
+		{
+			continue;
+		}
+
+		if (node->leaf)
+		{
+			const eiScalar	*packet;
+			const eiIndex	*prims;
+			eiScalar		hit_z[ EI_HAIR_PACKET_SIZE ];
+			eiScalar		hit_u[ EI_HAIR_PACKET_SIZE ];
+			eiScalar		hit_v[ EI_HAIR_PACKET_SIZE ];
+			eiUint			mask;
+			eiInt			lane;
+
+			packet = packet_data + node->index * packets->packet_size;
+			prims = (const eiIndex *)(packet + packets->num_keys * (packets->degree + 1) * 4 * EI_HAIR_PACKET_SIZE);
+
+			mask = intersect_hair_packet(packets, packet, ray, z_near, z_far, hit_z, hit_u, hit_v);
+
+			for (lane = 0; mask != 0; ++lane, mask >>= 1)
+			{
+				if ((mask & 1) && prims[ lane ] != eiNULL_INDEX && hit_z[ lane ] < z_far)
+				{
+					eiHairHit	hit;
+
+					hit.z = hit_z[ lane ];
+					hit.u = hit_u[ lane ];
+					hit.v = hit_v[ lane ];
+					hit.prim = prims[ lane ];
+					hit.seg = prims[ lane + EI_HAIR_PACKET_SIZE ];
+
+					z_far = hit_proc(param, &hit, z_far);
+				}
+			}
+		}
+		else
+		{
+			eiUint		left = (eiUint)(node - nodes) + 1;
+			eiUint		right = node->index;
+			eiVector	d;
+
+			/* visit the nearer child first */
+			add(&d, &nodes[ right ].box.min, &nodes[ right ].box.max);
+			subi(&d, &nodes[ left ].box.min);
+			subi(&d, &nodes[ left ].box.max);
+
+			eiDBG_ASSERT(top + 2 <= EI_HAIR_PACKET_STACK_SIZE);
+
+			if (dot(&d, &ray->Z) > 0.0f)
+			{
+				stack[ top ++ ] = right;
+				stack[ top ++ ] = left;
+			}
+			else
+			{
+				stack[ top ++ ] = left;
+				stack[ top ++ ] = right;
+			}
+		}
+	}
+}
+
+static void init_hair_ray(
+	eiHairRay *ray, 
+	const eiVector *org, 
+	const eiVector *dir, 
+	const eiScalar time)
+{
+	movv(&ray->org, org);
+	calc_inv_dir(&ray->inv_dir, dir);
+	movv(&ray->Z, dir);
+	ray->dir_len = normalize_with_len(&ray->Z);
+	ortho_basis(&ray->Z, &ray->X, &ray->Y);
+	/* distances in ray space need exact normalization */
+	normalizei(&ray->X);
+	normalizei(&ray->Y);
+	ray->time = time;
+}
+
+/** \brief The parameters for reporting hits to the ray-tracer. */
+typedef struct eiHairHitParams {
+	eiState			*state;
+	ei_array		*hit_info_array;
+	eiTag			tessel_tag;
+	eiIndex			tessel_instance_index;
+	eiIndex			parent_bsptree;
+	eiBool			motion;
+	const eiHairRay	*ray;
+} eiHairHitParams;
+
+static eiScalar hair_nearest_hit(void *param, const eiHairHit *hit, const eiScalar z_far)
+{
+	eiHairHitParams	*params;
+	eiState			*state;
+
+	params = (eiHairHitParams *)param;
+	state = params->state;
+
+	state->found_hit = eiTRUE;
+	state->hit_t = hit->z / params->ray->dir_len;
+	state->hit_bsp = params->parent_bsptree;
+	state->hit_tessel_inst = params->tessel_instance_index;
+	state->hit_tessel = params->tessel_tag;
+	state->hit_tri = hit->seg;
+	state->hit_prim = hit->prim;
+	state->hit_motion = params->motion;
+	setv(&state->bary, hit->u, hit->v, 0.0f);
+	/* the ribbon faces the ray, which is used by interpolating P */
+	movv((eiVector *)state->user_data, &params->ray->Z);
+
+	return hit->z;
+}
+
+static eiScalar hair_sorted_hit(void *param, const eiHairHit *hit, const eiScalar z_far)
+{
+	eiHairHitParams	*params;
+	eiRayHitInfo	hit_info;
+
+	params = (eiHairHitParams *)param;
+
+	ei_ray_hit_info_init(&hit_info);
+	hit_info.hit_bsp = params->parent_bsptree;
+	hit_info.hit_tessel_inst = params->tessel_instance_index;
+	hit_info.hit_tri = hit->seg;
+	hit_info.hit_prim = hit->prim;
+	hit_info.hit_motion = params->motion;
+	hit_info.hit_t = hit->z / params->ray->dir_len;
+	setv(&hit_info.bary, hit->u, hit->v, 0.0f);
+	movv((eiVector *)hit_info.user_data, &params->ray->Z);
+
+	ei_array_push_back(params->hit_info_array, &hit_info);
+	params->state->found_hit = eiTRUE;
+
+	return z_far;
+}
+
+void ei_hair_object_intersect_packet(
+	eiObject *obj, 
+	const eiTag tessel_tag, 
+	const eiIndex tessel_instance_index, 
+	const eiIndex parent_bsptree, 
+	eiState *state, 
+	ei_array *hit_info_array, 
+	const eiBool sort_by_distance)
+{
+	eiDatabase			*db;
+	eiHairObject		*hair;
+	eiRayHairPackets	*packets;
+	eiHairRay			ray;
+	eiHairHitParams		params;
+	eiScalar			t_far;
+
+	db = state->db;
+	hair = (eiHairObject *)obj;
+
+	if (hair->packets == eiNULL_TAG)
+	{
+		return;
+	}
+
+	packets = (eiRayHairPackets *)ei_db_access(db, hair->packets);
+
+	init_hair_ray(&ray, &state->obj_org, &state->obj_dir, state->time);
+
+	params.state = state;
+	params.hit_info_array = hit_info_array;
+	params.tessel_tag = tessel_tag;
+	params.tessel_instance_index = tessel_instance_index;
+	params.parent_bsptree = parent_bsptree;
+	params.motion = (packets->num_keys == 2);
+	params.ray = &ray;
+
+	if (sort_by_distance)
+	{
+		trace_hair_packets(packets, &ray, state->t_near, state->t_far, hair_sorted_hit, &params);
+	}
+	else
+	{
+		t_far = state->t_far;
+		if (state->found_hit && state->hit_t < t_far)
+		{
+			t_far = state->hit_t;
+		}
+
+		trace_hair_packets(packets, &ray, state->t_near, t_far, hair_nearest_hit, &params);
+	}
+
+	ei_db_end(db, hair->packets);
+}
+
+void byteswap_ray_hair_packets(eiDatabase *db, void *data, const eiUint size)
+{
+	eiRayHairPackets	*packets;
+	eiRayHairPacketNode	*nodes;
+	eiUint				*words;
+	eiUint				num_words;
+	eiUint				num_nodes;
+	eiUint				i;
+
+	packets = (eiRayHairPackets *)data;
+
+	/* the packets may not have been generated yet */
+	if (size > sizeof(eiRayHairPackets))
+	{
+		nodes = (eiRayHairPacketNode *)(packets + 1);
+		num_nodes = packets->num_segments * packets->num_nodes;
+
+		for (i = 0; i < num_nodes; ++i)
+		{
+			ei_byteswap_bound(&nodes[i].box);
+			ei_byteswap_int(&nodes[i].index);
+			ei_byteswap_int(&nodes[i].leaf);
+		}
+
+		/* packets only contain 4-byte scalars and indices */
+		words = (eiUint *)(nodes + num_nodes);
+		num_words = packets->packet_size * packets->num_packets;
+
+		for (i = 0; i < num_words; ++i)
+		{
+			ei_byteswap_int(&words[i]);
+		}
+	}
+
+	/* must byte-swap these at the end because they 
+	   will still be used in previous code. */
+	ei_byteswap_int(&packets->obj_tag);
+	ei_byteswap_int(&packets->degree);
+	ei_byteswap_int(&packets->num_keys);
+	ei_byteswap_int(&packets->num_nodes);
+	ei_byteswap_int(&packets->num_segments);
+	ei_byteswap_int(&packets->num_packets);
+	ei_byteswap_int(&packets->packet_size);
+	ei_byteswap_bound(&packets->box);
+}
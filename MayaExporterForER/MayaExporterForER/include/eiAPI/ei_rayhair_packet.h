@@ -0,0 +1,118 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_RAYHAIR_PACKET_H
+#define EI_RAYHAIR_PACKET_H
+
+/** \brief The packet hair intersector, an alternative to the hair 
+ * BSP-tree which tests a ray against several curve segments at once. 
+ * curve segments are split into pieces flat enough for a few linear 
+ * pieces, sorted along a Morton curve and grouped into packets, which 
+ * store control points in structure-of-arrays layout and are organized 
+ * by a bounding volume hierarchy.
+ * \file ei_rayhair_packet.h
+ */
+
+#include <eiAPI/ei_rayhair.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the number of curve segments in a packet */
+#define EI_HAIR_PACKET_SIZE				8
+/* the maximum number of linear pieces a curve segment is 
+   subdivided into for intersection */
+#define EI_HAIR_MAX_SUBDIV				16
+/* the number of linear pieces a curve segment should need at most 
+   in object space, segments which need more are split into pieces 
+   when generating packets */
+#define EI_HAIR_SPLIT_SUBDIV			8
+/* the maximum number of pieces a curve segment is split into */
+#define EI_HAIR_MAX_SPLIT				64
+/* the maximum number of time segments with their own hierarchies */
+#define EI_HAIR_MAX_MOTION_SEGMENTS		64
+/* the minimum number of packets to build the hierarchies of time 
+   segments with multiple threads */
+#define EI_HAIR_PARALLEL_MIN_PACKETS	1024
+/* the maximum depth of the hierarchy of packets */
+#define EI_HAIR_PACKET_STACK_SIZE		64
+
+/** \brief The ray-traceable hair packets, followed by the nodes 
+ * of the hierarchies of all time segments and the packets. moving 
+ * hairs divide the shutter interval into time segments, each time 
+ * segment has its own hierarchy whose boxes only enclose the motion 
+ * within the time segment, the ray selects the hierarchy by its time. 
+ * all hierarchies share the packets. each packet stores the control 
+ * points of its segments as [key][control point][x, y, z, radius][lane] 
+ * scalars, followed by the primitive indices, the segment indices, 
+ * and the ranges of the curve parameter of its lanes, because long 
+ * or curly segments are split into pieces. unused lanes repeat the 
+ * last piece of the packet. */
+typedef struct eiRayHairPackets {
+	/* source hair object tag */
+	eiTag			obj_tag;
+	/* the degree of curves */
+	eiInt			degree;
+	/* the number of motion keys, 1 or 2 */
+	eiInt			num_keys;
+	/* the number of nodes of the hierarchy of a time segment */
+	eiUint			num_nodes;
+	/* the number of time segments */
+	eiUint			num_segments;
+	/* the number of packets */
+	eiUint			num_packets;
+	/* the size of a packet in scalars */
+	eiUint			packet_size;
+	/* the bounding box of this hair object in object space */
+	eiBound			box;
+} eiRayHairPackets;
+
+/** \brief The node of the hierarchy of packets, the left child 
+ * of an interior node immediately follows the node. */
+typedef struct eiRayHairPacketNode {
+	eiBound			box;
+	/* the right child of an interior node, or the packet of a leaf */
+	eiUint			index;
+	/* whether this node is a leaf */
+	eiUint			leaf;
+} eiRayHairPacketNode;
+
+/** \brief Generate hair packets, for internal use only. */
+void generate_ray_hair_packets(
+	eiDatabase *db, 
+	const eiTag data_tag, 
+	eiData *pData, 
+	eiTLS *pTls);
+
+/** \brief Perform intersection test with this object using hair packets, 
+ * same as ei_hair_object_intersect. */
+void ei_hair_object_intersect_packet(
+	eiObject *obj, 
+	const eiTag tessel_tag, 
+	const eiIndex tessel_instance_index, 
+	const eiIndex parent_bsptree, 
+	eiState *state, 
+	ei_array *hit_info_array, 
+	const eiBool sort_by_distance);
+
+/* for internal use only */
+void byteswap_ray_hair_packets(eiDatabase *db, void *data, const eiUint size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
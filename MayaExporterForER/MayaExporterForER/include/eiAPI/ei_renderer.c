@@ -16,6 +16,7 @@
 #include <eiAPI/ei_renderer.h>
 #include <eiAPI/ei_state.h>
 #include <eiAPI/ei_raytracer.h>
+#include <eiAPI/ei_object.h>
 #include <eiAPI/ei_globillum.h>
 #include <eiAPI/ei_photon.h>
 #include <eiAPI/ei_api.h>
@@ -23,12 +24,16 @@
 #include <eiAPI/ei_scenemgr.h>
 #include <eiAPI/ei_image.h>
 #include <eiAPI/ei_texture.h>
+#include <eiAPI/ei_tessel_cache.h>
+#include <eiAPI/ei_pin_cache.h>
+#include <eiAPI/ei_shadesys.h>
 #include <eiAPI/ei.h>
 #include <eiCORE/ei_platform.h>
 #include <eiCORE/ei_atomic_ops.h>
 #include <eiCORE/ei_dataflow.h>
 #include <eiCORE/ei_data_gen.h>
 #include <eiCORE/ei_message.h>
+#include <eiCORE/ei_msg_batch.h>
 #include <eiCORE/ei_timer.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_data_table.h>
@@ -291,6 +296,23 @@ static void sort_buckets(
 	ei_free(hg);
 }
 
+/** \brief The state of an interactive rendering session, the 
+ * scene and acceleration structures are kept across renderings, 
+ * and only rebuilt for the kinds of edits which require it. */
+typedef struct eiRenderSession {
+	eiBool				active;
+	eiTag				root_instgrp;
+	eiTag				cam_inst;
+	eiTag				opt;
+	/* the accumulated edits since last rendering */
+	eiInt				edits;
+	eiBool				has_framebuffers;
+	eiBool				has_scene;
+	eiUint				user_output_size;
+	/* the objects whose geometry was edited since last rendering */
+	ei_array			edited_objects;
+} eiRenderSession;
+
 /** \brief An internal class encapsulates all rendering 
  * functionalities of this renderer. */
 struct eiRenderer {
@@ -309,6 +331,9 @@ struct eiRenderer {
 	eiBuffer			buckets;
 	eiTag				colorFrameBuffer;
 	eiTag				opacityFrameBuffer;
+	/* the samples per pixel accumulated by progressive passes, 
+	   which is not an output, eiNULL_TAG without progressive rendering */
+	eiTag				sampleCountFrameBuffer;
 	eiTag				frameBuffers;
 	eiFrameBufferMap	frameBufferMap;
 	eiTag				lightInstances;
@@ -316,6 +341,25 @@ struct eiRenderer {
 	eiTag				globillumMap;
 	eiTag				irradCache;
 	ei_array			passIrradBuffers;
+	/* the shared memory data arena for render servers 
+	   on this host, NULL if it is off */
+	eiShmArena			*shm_arena;
+	/* the current pass of progressive rendering */
+	eiInt				progressive_pass;
+	/* whether the client application requested abort */
+	eiBool				abort_requested;
+	/* the time spent on progressive rendering, and the time 
+	   limit in milliseconds, which is checked on every bucket */
+	eiTimer				progressive_timer;
+	eiInt				progressive_time_limit;
+	/* whether progressive rendering ran out of time */
+	eiBool				time_limit_exceeded;
+	/* whether we are rendering with remote hosts */
+	eiBool				distributed;
+	/* the statistics of data sent to remote hosts by data type */
+	eiLock				net_stats_lock;
+	eiMsgTransferStats	net_stats[ EI_DATA_TYPE_COUNT ];
+	eiRenderSession		session;
 };
 
 /** \brief The main rendering process. */
@@ -413,6 +457,32 @@ static eiBool ei_render_process_progress(
 		pProcess->last_percent = percent;
 	}
 
+	if (to_abort && pProcess->rend != NULL)
+	{
+		pProcess->rend->abort_requested = eiTRUE;
+	}
+
+	/* stop in the middle of a progressive pass when running out 
+	   of time, buckets not rendered by this pass keep the samples 
+	   accumulated by previous passes */
+	if (!to_abort && pProcess->rend != NULL && 
+		pProcess->rend->progressive_pass > 0 && 
+		pProcess->rend->progressive_time_limit > 0)
+	{
+		eiRenderer	*rend;
+
+		rend = pProcess->rend;
+
+		ei_timer_stop(&rend->progressive_timer);
+		ei_timer_start(&rend->progressive_timer);
+
+		if (rend->progressive_timer.duration >= rend->progressive_time_limit)
+		{
+			rend->time_limit_exceeded = eiTRUE;
+			to_abort = eiTRUE;
+		}
+	}
+
 	/* if you want to abort the rendering, just return eiTRUE here. */
 	return to_abort;
 }
@@ -523,7 +593,9 @@ static void ei_render_process_update(
 	{
 	case EI_MSG_BUCKET_STARTED:
 		{
-			if (pProcess->rend != NULL)
+			/* keep the image of previous pass on display 
+			   while refining progressively */
+			if (pProcess->rend != NULL && pProcess->rend->progressive_pass == 0)
 			{
 				ei_renderer_clear_tile(pProcess->rend, 
 					msg->bucket_started_params.rect.left, 
@@ -680,6 +752,9 @@ void ei_init_globals(eiGlobals *globals, eiDatabase *db)
 	ei_nodesys_init((eiNodeSystem *)globals->interfaces[ EI_INTERFACE_TYPE_NODE_SYSTEM ], 
 		db);
 
+	globals->interfaces[ EI_INTERFACE_TYPE_TESSEL_CACHE ] = (eiInterface)ei_allocate(sizeof(eiTesselCache));
+	ei_tessel_cache_init((eiTesselCache *)globals->interfaces[ EI_INTERFACE_TYPE_TESSEL_CACHE ]);
+
 	/* setup callbacks for the ray-tracer */
 	rt = (eiRayTracer *)globals->interfaces[ EI_INTERFACE_TYPE_RAYTRACER ];
 
@@ -746,6 +821,9 @@ void ei_exit_globals(eiGlobals *globals, eiDatabase *db)
 		ei_delete_server_context(ei_context(NULL));
 	}
 
+	ei_tessel_cache_exit((eiTesselCache *)globals->interfaces[ EI_INTERFACE_TYPE_TESSEL_CACHE ]);
+	eiCHECK_FREE(globals->interfaces[ EI_INTERFACE_TYPE_TESSEL_CACHE ]);
+
 	ei_nodesys_exit((eiNodeSystem *)globals->interfaces[ EI_INTERFACE_TYPE_NODE_SYSTEM ]);
 	eiCHECK_FREE(globals->interfaces[ EI_INTERFACE_TYPE_NODE_SYSTEM ]);
 
@@ -758,6 +836,10 @@ void ei_exit_globals(eiGlobals *globals, eiDatabase *db)
 
 void ei_init_tls(eiTLS *tls)
 {
+	/* bind the thread before allocating its local storage, so the 
+	   memory is first touched on its own node */
+	ei_bind_worker_thread();
+
 	ei_tls_allocate_interfaces(tls, EI_TLS_TYPE_COUNT);
 
 	ei_tls_set_interface(tls, EI_TLS_TYPE_NONE, NULL);
@@ -767,10 +849,28 @@ void ei_init_tls(eiTLS *tls)
 
 	ei_tls_set_interface(tls, EI_TLS_TYPE_GLOBILLUM, (eiInterface)ei_allocate(sizeof(eiGlobillumTLS)));
 	ei_globillum_tls_init((eiGlobillumTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_GLOBILLUM));
+
+	ei_tls_set_interface(tls, EI_TLS_TYPE_SAMPLER, (eiInterface)ei_allocate(sizeof(eiSamplerTLS)));
+	ei_sampler_tls_init((eiSamplerTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_SAMPLER));
+
+	ei_tls_set_interface(tls, EI_TLS_TYPE_PIN_CACHE, (eiInterface)ei_allocate(sizeof(eiPinCache)));
+	ei_pin_cache_init((eiPinCache *)ei_tls_get_interface(tls, EI_TLS_TYPE_PIN_CACHE));
+
+	ei_tls_set_interface(tls, EI_TLS_TYPE_SHADER, (eiInterface)ei_allocate(sizeof(eiShaderTLS)));
+	ei_shader_tls_init((eiShaderTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_SHADER));
 }
 
 void ei_exit_tls(eiTLS *tls)
 {
+	ei_shader_tls_exit((eiShaderTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_SHADER));
+	ei_tls_free_interface(tls, EI_TLS_TYPE_SHADER);
+
+	ei_pin_cache_exit((eiPinCache *)ei_tls_get_interface(tls, EI_TLS_TYPE_PIN_CACHE));
+	ei_tls_free_interface(tls, EI_TLS_TYPE_PIN_CACHE);
+
+	ei_sampler_tls_exit((eiSamplerTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_SAMPLER));
+	ei_tls_free_interface(tls, EI_TLS_TYPE_SAMPLER);
+
 	ei_globillum_tls_exit((eiGlobillumTLS *)ei_tls_get_interface(tls, EI_TLS_TYPE_GLOBILLUM));
 	ei_tls_free_interface(tls, EI_TLS_TYPE_GLOBILLUM);
 
@@ -821,6 +921,9 @@ eiBool ei_update_scene_callback(eiGlobals *globals, eiDatabase *db)
 	rt = (eiRayTracer *)globals->interfaces[ EI_INTERFACE_TYPE_RAYTRACER ];
 	eiDBG_ASSERT(rt != NULL);
 
+	/* data pinned by rendering threads may have been changed */
+	ei_pin_cache_invalidate();
+
 	/* re-read the ray-traceable scene */
 	ei_db_end(db, rt->scene_tag);
 	rt->scene = (eiRayScene *)ei_db_access(db, rt->scene_tag);
@@ -859,6 +962,15 @@ static void ei_renderer_verbose_print(
 
 static void ei_renderer_init_stats(eiRenderer *rend)
 {
+	ei_lock(&rend->net_stats_lock);
+	memset(rend->net_stats, 0, sizeof(rend->net_stats));
+	ei_unlock(&rend->net_stats_lock);
+
+	ei_pin_cache_invalidate();
+
+	ei_tessel_cache_clear((eiTesselCache *)ei_db_globals_interface(
+		rend->db, 
+		EI_INTERFACE_TYPE_TESSEL_CACHE));
 }
 
 static void print_cache_hit_rate(eiTLS *pTls, void *param)
@@ -866,13 +978,81 @@ static void print_cache_hit_rate(eiTLS *pTls, void *param)
 	ei_info("thread %d cache hit rate: %f %%\n", ei_tls_get_thread_id(pTls), ei_tls_get_cache_hit_rate(pTls) * 100.0);
 }
 
+static void print_sampler_stats(eiTLS *pTls, void *param)
+{
+	eiSamplerTLS	*pSamplerTls;
+
+	pSamplerTls = (eiSamplerTLS *)ei_tls_get_interface(pTls, EI_TLS_TYPE_SAMPLER);
+
+	ei_info("thread %d sample arena peak: %f MB, %d buckets, %lld samples, %lld blocks allocated, %lld pool banks saved\n", 
+		ei_tls_get_thread_id(pTls), 
+		(eiGeoScalar)pSamplerTls->sampleArena.peakSize / (eiGeoScalar)(1024 * 1024), 
+		pSamplerTls->num_buckets, 
+		pSamplerTls->num_samples_created, 
+		pSamplerTls->sampleArena.numBlocks, 
+		pSamplerTls->num_pool_banks - pSamplerTls->sampleArena.numBlocks);
+}
+
+static void release_pin_cache(eiTLS *pTls, void *param)
+{
+	eiPinCache		*pCache;
+	eiShaderTLS		*pShaderTls;
+
+	pCache = (eiPinCache *)ei_tls_get_interface(pTls, EI_TLS_TYPE_PIN_CACHE);
+	pShaderTls = (eiShaderTLS *)ei_tls_get_interface(pTls, EI_TLS_TYPE_SHADER);
+
+	ei_info("thread %d pin cache: %lld db round trips saved, %lld misses, %lld parameters folded\n", 
+		ei_tls_get_thread_id(pTls), 
+		pCache->num_hits, 
+		pCache->num_misses, 
+		pShaderTls->num_folded);
+
+	ei_pin_cache_reset_stats(pCache);
+
+	/* worker threads end their pins with their jobs, only the 
+	   pins taken by current thread can be ended here */
+	if (pTls == (eiTLS *)param)
+	{
+		ei_pin_cache_release(pCache);
+	}
+}
+
 static void ei_renderer_finish_stats(eiRenderer *rend)
 {
+	eiInt		i;
+
 	ei_exec_traverse_tls(ei_db_executor(rend->db), print_cache_hit_rate, NULL);
+	ei_exec_traverse_tls(ei_db_executor(rend->db), print_sampler_stats, NULL);
+	ei_exec_traverse_tls(ei_db_executor(rend->db), release_pin_cache, ei_db_get_tls(rend->db));
 
 	ei_info("db page file peak: %f MB\n", (eiGeoScalar)ei_db_pagefile_peak(rend->db) / (eiGeoScalar)(1024 * 1024));
 	ei_info("db memory peak: %f MB\n", (eiGeoScalar)ei_db_mem_peak(rend->db) / (eiGeoScalar)(1024 * 1024));
 	ei_info("db virtual memory peak: %f MB\n", (eiGeoScalar)ei_db_virtual_mem_peak(rend->db) / (eiGeoScalar)(1024 * 1024));
+
+	ei_tessel_cache_print_stats((eiTesselCache *)ei_db_globals_interface(
+		rend->db, 
+		EI_INTERFACE_TYPE_TESSEL_CACHE), rend->db);
+
+	ei_lock(&rend->net_stats_lock);
+
+	for (i = 0; i < EI_DATA_TYPE_COUNT; ++i)
+	{
+		eiMsgTransferStats	*stats;
+
+		stats = &rend->net_stats[i];
+
+		if (stats->num_items != 0)
+		{
+			ei_info("net data type %d: %lld items, %f MB raw, %f MB on wire, %f s\n", 
+				i, 
+				stats->num_items, 
+				(eiGeoScalar)stats->raw_bytes / (eiGeoScalar)(1024 * 1024), 
+				(eiGeoScalar)stats->wire_bytes / (eiGeoScalar)(1024 * 1024), 
+				(eiGeoScalar)stats->time / 1000.0);
+		}
+	}
+
+	ei_unlock(&rend->net_stats_lock);
 }
 
 /** \brief Initialize frame buffers, calculate user output size. */
@@ -929,6 +1109,21 @@ static void ei_renderer_init_framebuffers(
 		&rend->frameBufferMap, 
 		&opacityOutvar);
 
+	/* progressive passes blend each pixel by the samples it took */
+	rend->sampleCountFrameBuffer = eiNULL_TAG;
+
+	if (opt->progressive)
+	{
+		rend->sampleCountFrameBuffer = ei_create_framebuffer(
+			rend->db, 
+			"sample_count", 
+			EI_DATA_TYPE_SCALAR, 
+			0, 
+			region_width, 
+			region_height, 
+			opt->bucket_size);
+	}
+
 	/* add user outputs */
 	rend->frameBuffers = ei_create_data_array(rend->db, EI_DATA_TYPE_TAG);
 
@@ -1007,6 +1202,10 @@ static void ei_renderer_delete_framebuffers(eiRenderer *rend)
 	}
 	ei_delete_data_array(rend->db, rend->frameBuffers);
 
+	if (rend->sampleCountFrameBuffer != eiNULL_TAG)
+	{
+		ei_delete_framebuffer(rend->db, rend->sampleCountFrameBuffer);
+	}
 	ei_delete_framebuffer(rend->db, rend->opacityFrameBuffer);
 	ei_delete_framebuffer(rend->db, rend->colorFrameBuffer);
 
@@ -1231,6 +1430,7 @@ static void ei_renderer_create_buckets(
 			job->cam = cam_tag;
 			job->colorFrameBuffer = rend->colorFrameBuffer;
 			job->opacityFrameBuffer = rend->opacityFrameBuffer;
+			job->sampleCountFrameBuffer = rend->sampleCountFrameBuffer;
 			job->frameBuffers = rend->frameBuffers;
 			job->lightInstances = rend->lightInstances;
 			job->causticMap = rend->causticMap;
@@ -1246,6 +1446,10 @@ static void ei_renderer_create_buckets(
 				ei_array_push_back(&rend->passIrradBuffers, &job->passIrradBuffer);
 			}
 			job->bucket_id = bucket_id ++;
+			job->min_samples = opt->min_samples;
+			job->max_samples = opt->max_samples;
+			job->progressive_pass = 0;
+			job->accum_weight = 0.0f;
 
 			ei_db_end(rend->db, job_tag);
 
@@ -1282,6 +1486,7 @@ static void ei_renderer_create_buckets(
 		job->cam = cam_tag;
 		job->colorFrameBuffer = rend->colorFrameBuffer;
 		job->opacityFrameBuffer = rend->opacityFrameBuffer;
+		job->sampleCountFrameBuffer = rend->sampleCountFrameBuffer;
 		job->frameBuffers = rend->frameBuffers;
 		job->lightInstances = rend->lightInstances;
 		job->causticMap = rend->causticMap;
@@ -1297,6 +1502,10 @@ static void ei_renderer_create_buckets(
 			ei_array_push_back(&rend->passIrradBuffers, &job->passIrradBuffer);
 		}
 		job->bucket_id = bucket_id ++;
+		job->min_samples = opt->min_samples;
+		job->max_samples = opt->max_samples;
+		job->progressive_pass = 0;
+		job->accum_weight = 0.0f;
 
 		ei_db_end(rend->db, job_tag);
 
@@ -1328,6 +1537,7 @@ static void ei_renderer_create_buckets(
 		job->cam = cam_tag;
 		job->colorFrameBuffer = rend->colorFrameBuffer;
 		job->opacityFrameBuffer = rend->opacityFrameBuffer;
+		job->sampleCountFrameBuffer = rend->sampleCountFrameBuffer;
 		job->frameBuffers = rend->frameBuffers;
 		job->lightInstances = rend->lightInstances;
 		job->causticMap = rend->causticMap;
@@ -1343,6 +1553,10 @@ static void ei_renderer_create_buckets(
 			ei_array_push_back(&rend->passIrradBuffers, &job->passIrradBuffer);
 		}
 		job->bucket_id = bucket_id ++;
+		job->min_samples = opt->min_samples;
+		job->max_samples = opt->max_samples;
+		job->progressive_pass = 0;
+		job->accum_weight = 0.0f;
 
 		ei_db_end(rend->db, job_tag);
 
@@ -1372,6 +1586,7 @@ static void ei_renderer_create_buckets(
 	job->cam = cam_tag;
 	job->colorFrameBuffer = rend->colorFrameBuffer;
 	job->opacityFrameBuffer = rend->opacityFrameBuffer;
+	job->sampleCountFrameBuffer = rend->sampleCountFrameBuffer;
 	job->frameBuffers = rend->frameBuffers;
 	job->lightInstances = rend->lightInstances;
 	job->causticMap = rend->causticMap;
@@ -1387,6 +1602,10 @@ static void ei_renderer_create_buckets(
 		ei_array_push_back(&rend->passIrradBuffers, &job->passIrradBuffer);
 	}
 	job->bucket_id = bucket_id ++;
+	job->min_samples = opt->min_samples;
+	job->max_samples = opt->max_samples;
+	job->progressive_pass = 0;
+	job->accum_weight = 0.0f;
 
 	ei_db_end(rend->db, job_tag);
 
@@ -1555,9 +1774,11 @@ static void ei_renderer_output_images(
 
 static eiBool scene_message_proc(eiDatabase *db, SOCKET sock, void *param)
 {
+	eiRenderer	*rend;
 	eiData		*pData;
 	eiMessage	msg;
-	eiMessage	inf;
+
+	rend = (eiRenderer *)param;
 
 	/* monitor the job execution and do any requested 
 	   supplements for the server thread. */
@@ -1596,15 +1817,35 @@ static eiBool scene_message_proc(eiDatabase *db, SOCKET sock, void *param)
 
 				if (pData != NULL && pData->ptr != NULL && pData->size != 0)
 				{
-					/* first, let it know the current size of the data. */
-					inf.type = EI_MSG_INF_DATA_INFO;
-					inf.data_info_params.size = pData->size;
-					inf.data_info_params.inited = (ei_atomic_read(&pData->flag) & EI_DB_INITED) ? eiTRUE : eiFALSE;
-
-					ei_net_send(sock, (eiByte *)&inf, sizeof(eiMessage));
-
-					/* now we can send the actual data content. */
-					ei_net_send(sock, (eiByte *)pData->ptr, pData->size);
+					eiInt	start_time;
+					eiUint	wire_size;
+
+					start_time = ei_get_time();
+
+					/* only compress for requesters which explicitly accept it, 
+					   and only use the shared memory arena for requesters which 
+					   have mapped it, rendering servers convert messages from and 
+					   to the byte order of the manager, as for other messages here */
+					ei_msg_send_data(
+						sock, 
+						(eiByte *)pData->ptr, 
+						pData->size, 
+						(ei_atomic_read(&pData->flag) & EI_DB_INITED) ? eiTRUE : eiFALSE, 
+						(msg.send_data_params.accept_compressed == eiTRUE), 
+						eiFALSE, 
+						(rend != NULL && msg.send_data_params.accept_shm == eiTRUE) ? rend->shm_arena : NULL, 
+						&wire_size);
+
+					if (rend != NULL && pData->type >= 0 && pData->type < EI_DATA_TYPE_COUNT)
+					{
+						ei_lock(&rend->net_stats_lock);
+						ei_msg_transfer_stats_add(
+							&rend->net_stats[pData->type], 
+							pData->size, 
+							wire_size, 
+							(eiUint)(ei_get_time() - start_time));
+						ei_unlock(&rend->net_stats_lock);
+					}
 				}
 				else
 				{
@@ -1643,6 +1884,10 @@ static void ei_renderer_startup(eiRenderer *rend)
 	/* general initialization steps for rendering manager. */
 	rend->master = ei_create_master();
 	rend->exec = ei_create_exec(EI_EXECUTOR_TYPE_MANAGER, g_InitTLS);
+
+	/* set the policy after the executor of this thread has been 
+	   created, only worker threads are bound when they start */
+	ei_set_thread_affinity(config.affinity);
 	ei_master_set_executor(rend->master, rend->exec);
 	rend->db = ei_create_db(config.memlimit, 
 		EI_DEFAULT_FILE_SIZE_LIMIT, 
@@ -1652,7 +1897,12 @@ static void ei_renderer_startup(eiRenderer *rend)
 	/* set user data generators immediately for this renderer. */
 	ei_db_data_gen_table(rend->db, &g_DataGenTable);
 
+	ei_create_lock(&rend->net_stats_lock);
+	memset(rend->net_stats, 0, sizeof(rend->net_stats));
+
 	/* add all rendering hosts for distributed rendering. */
+	rend->distributed = eiFALSE;
+
 	if (config.distributed)
 	{
 		for (i = 0; i < ei_array_size(&config.servers); ++i)
@@ -1662,12 +1912,32 @@ static void ei_renderer_startup(eiRenderer *rend)
 			host_desc = (eiHostDesc *)ei_array_get(&config.servers, i);
 
 			ei_master_add_host(rend->master, host_desc->host_name, host_desc->port_number);
+
+			rend->distributed = eiTRUE;
+		}
+	}
+
+	/* render servers on this host which have mapped the arena 
+	   receive data through it instead of sockets */
+	rend->shm_arena = NULL;
+
+	if (rend->distributed && strlen(config.shmarena) > 0 && config.shmsize > 0)
+	{
+		rend->shm_arena = ei_shm_create_arena(config.shmarena, (eiUint64)config.shmsize * 1024 * 1024);
+
+		if (rend->shm_arena == NULL)
+		{
+			ei_warning("Shared memory data arena is not available, sending data through sockets.\n");
 		}
 	}
 
 	/* create workers for processing, connect to hosts. */
 	ei_master_create_workers(rend->master, config.nthreads, config.distributed, g_InitTLS);
 
+	/* jobs share the rendering threads of this host for splitting 
+	   large tessellations and hair packets into tasks */
+	ei_init_task_threads((config.nthreads > 0) ? (eiUint)config.nthreads : ei_get_number_threads());
+
 	/* create global object and set it to database. */
 	/* must initialize global objects after the rendering threads 
 	   have been created, since global objects might create some 
@@ -1719,7 +1989,7 @@ static void ei_renderer_startup(eiRenderer *rend)
 	req.type = EI_MSG_REQ_SET_SCENE;
 	req.set_scene_params.scene_tag = rend->rt->scene_tag;
 
-	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, NULL);
+	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, rend);
 }
 
 static void ei_renderer_shutdown(eiRenderer *rend)
@@ -1729,7 +1999,7 @@ static void ei_renderer_shutdown(eiRenderer *rend)
 	/* synchronize the end of scene editing */
 	req.type = EI_MSG_REQ_END_SCENE;
 
-	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, NULL);
+	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, rend);
 
 	/* end editing to the ray-traceable scene */
 	ei_rt_end_scene(rend->rt);
@@ -1755,6 +2025,13 @@ static void ei_renderer_shutdown(eiRenderer *rend)
 	/* delete master after executor because executor may 
 	   have some dependencies on master. */
 	ei_delete_master(rend->master);
+
+	ei_shm_close_arena(rend->shm_arena);
+	rend->shm_arena = NULL;
+
+	ei_exit_task_threads();
+
+	ei_delete_lock(&rend->net_stats_lock);
 }
 
 static void ei_renderer_run_process(eiRenderer *rend)
@@ -1775,6 +2052,124 @@ static void ei_renderer_run_process(eiRenderer *rend)
 	ei_render_process_exit(&process);
 }
 
+/* the samples per pixel of a pass with the sample rate */
+static eiScalar ei_progressive_pass_weight(const eiInt depth)
+{
+	return ldexpf(1.0f, 2 * depth);
+}
+
+/* render the frame progressively, in successive passes through 
+   the same bucket jobs. the sample rate increases by one level 
+   per pass until the maximum sample rate, after which passes of 
+   the maximum rate repeat with different samples while the time 
+   limit or sample budget allows. the samples of every pass are 
+   accumulated with those of previous passes in frame buffers, 
+   and every finished bucket updates its tile on the client 
+   application, so an image of the whole frame is available 
+   after the first pass. */
+static void ei_renderer_run_progressive_process(eiRenderer *rend, eiOptions *opt)
+{
+	eiScalar	accum_weight;
+	eiInt		first_depth;
+	eiInt		last_depth;
+	eiInt		depth;
+	eiInt		pass;
+	eiInt		i, j;
+
+	/* start from one sample per pixel, or lower if users want */
+	first_depth = MIN(0, opt->max_samples);
+	last_depth = MAX(first_depth, opt->max_samples);
+
+	rend->abort_requested = eiFALSE;
+	rend->time_limit_exceeded = eiFALSE;
+	rend->progressive_time_limit = (eiInt)(opt->progressive_time_limit * 1000.0f);
+
+	ei_timer_reset(&rend->progressive_timer);
+	ei_timer_start(&rend->progressive_timer);
+
+	accum_weight = 0.0f;
+	depth = first_depth;
+
+	for (pass = 0; ; ++pass)
+	{
+		/* update the sample rate of all bucket jobs */
+		for (j = 0; j < rend->noYBuckets; ++j)
+		{
+			for (i = 0; i < rend->noXBuckets; ++i)
+			{
+				eiTag		job_tag;
+				eiBucketJob	*job;
+
+				job_tag = *((eiTag *)ei_buffer_getptr(&rend->buckets, i, j));
+				job = (eiBucketJob *)ei_db_access(rend->db, job_tag);
+
+				job->min_samples = MIN(opt->min_samples, depth);
+				job->max_samples = depth;
+				job->progressive_pass = pass;
+				job->accum_weight = accum_weight;
+
+				ei_db_end(rend->db, job_tag);
+				ei_db_dirt(rend->db, job_tag);
+			}
+		}
+
+		/* jobs were consumed by previous pass, add them again */
+		if (pass != 0)
+		{
+			sort_buckets(0, 0, rend->noXBuckets, rend->noYBuckets, &rend->buckets, rend->master);
+		}
+
+		rend->progressive_pass = pass;
+
+		ei_renderer_run_process(rend);
+
+		accum_weight += ei_progressive_pass_weight(depth);
+
+		ei_timer_stop(&rend->progressive_timer);
+		ei_info("Finished progressive pass %d with sample rate %d %d, %f samples per pixel, %f seconds elapsed.\n", 
+			pass, 
+			MIN(opt->min_samples, depth), 
+			depth, 
+			accum_weight, 
+			(eiScalar)rend->progressive_timer.duration / 1000.0f);
+		ei_timer_start(&rend->progressive_timer);
+
+		if (rend->abort_requested)
+		{
+			break;
+		}
+
+		if (rend->time_limit_exceeded || 
+			(rend->progressive_time_limit > 0 && 
+			rend->progressive_timer.duration >= rend->progressive_time_limit))
+		{
+			ei_info("Progressive rendering stopped by time limit.\n");
+			break;
+		}
+
+		/* without any budget, stop after the maximum sample rate */
+		if (depth == last_depth && 
+			rend->progressive_time_limit <= 0 && 
+			opt->progressive_samples <= 0)
+		{
+			break;
+		}
+
+		depth = MIN(depth + 1, last_depth);
+
+		/* stop when the next pass would exceed the sample budget */
+		if (opt->progressive_samples > 0 && 
+			accum_weight + ei_progressive_pass_weight(depth) > (eiScalar)opt->progressive_samples)
+		{
+			break;
+		}
+	}
+
+	ei_timer_stop(&rend->progressive_timer);
+
+	rend->progressive_pass = 0;
+}
+
 static void ei_renderer_run_photon_process(eiRenderer *rend)
 {
 	eiPhotonProcess		process;
@@ -2300,6 +2695,8 @@ static void ei_renderer_init(eiRenderer *rend)
 /** \brief Destruct the renderer. */
 static void ei_renderer_exit(eiRenderer *rend)
 {
+	ei_renderer_end_session(rend);
+
 	ei_attr_exit(&rend->default_attr, rend->db);
 
 	ei_renderer_shutdown(rend);
@@ -2346,50 +2743,23 @@ eiNodeSystem * const ei_renderer_node_system(eiRenderer *rend)
 	return rend->nodesys;
 }
 
-void ei_renderer_render(
+/* traverse the scene graph to update all instances, and update the 
+   ray-traceable options and camera. light instances must have been 
+   created before calling this function. */
+static void ei_renderer_update_scene(
 	eiRenderer *rend, 
-	const eiTag root_instgrp_tag, 
-	const eiTag cam_inst_tag, 
-	const eiTag opt_tag)
+	eiOptions *opt, 
+	eiInstance *cam_inst, 
+	eiCamera *cam, 
+	const eiTag root_instgrp_tag)
 {
 	eiInt			hours, minutes;
 	eiScalar		seconds;
-	eiTimer			timer;
 	eiTimer			local_timer;
-	eiOptions		*opt;
-	eiInstance		*cam_inst;
-	eiCamera		*cam;
-	eiUint			user_output_size;
 	eiRayOptions	*ray_opt;
 	eiRayCamera		*ray_cam;
 	eiMessage		req;
-	eiBool			need_irrad_cache;
-
-	/* override verbosity callback */
-	ei_verbose_callback(ei_renderer_verbose_print, (void *)rend->con);
-
-	ei_renderer_init_stats(rend);
-	ei_info("\n");
-	ei_info("Start rendering...\n");
-
-	ei_timer_reset(&timer);
-	ei_timer_start(&timer);
-
-	/* begin accessing global options */
-	opt = (eiOptions *)ei_db_access(rend->db, opt_tag);
 
-	/* begin accessing camera instance and camera */
-	cam_inst = (eiInstance *)ei_db_access(rend->db, cam_inst_tag);
-	cam = (eiCamera *)ei_db_access(rend->db, cam_inst->element);
-
-	/* build frame buffers */
-	user_output_size = 0;
-
-	ei_renderer_init_framebuffers(rend, opt, cam, &user_output_size);
-
-	/* build light instances */
-	ei_renderer_init_light_instances(rend);
-	
 	/* pre-processing the scene */
 	ei_info("Pre-processing...\n");
 
@@ -2400,18 +2770,38 @@ void ei_renderer_render(
 	   down DAG attributes, create any instance that is not created */
 	ei_attr_set_defaults(&rend->default_attr, opt, rend->db);
 
-	ei_scene_update_instances(
-		rend->master, 
-		rend->con, 
-		rend->nodesys, 
-		cam_inst->element, 
-		ei_rt_scene_root(rend->rt), 
-		rend->lightInstances, 
-		root_instgrp_tag, 
-		&rend->default_attr, 
-		&g_IdentityMatrix, 
-		&g_IdentityMatrix, 
-		NULL);
+	if (rend->distributed)
+	{
+		/* let every host dice the geometry it needs locally instead of 
+		   dicing everything on the master and transferring the results */
+		ei_scene_update_distributed_instances(
+			rend->master, 
+			rend->con, 
+			rend->nodesys, 
+			cam_inst->element, 
+			ei_rt_scene_root(rend->rt), 
+			rend->lightInstances, 
+			root_instgrp_tag, 
+			&rend->default_attr, 
+			&g_IdentityMatrix, 
+			&g_IdentityMatrix, 
+			NULL);
+	}
+	else
+	{
+		ei_scene_update_instances(
+			rend->master, 
+			rend->con, 
+			rend->nodesys, 
+			cam_inst->element, 
+			ei_rt_scene_root(rend->rt), 
+			rend->lightInstances, 
+			root_instgrp_tag, 
+			&rend->default_attr, 
+			&g_IdentityMatrix, 
+			&g_IdentityMatrix, 
+			NULL);
+	}
 
 	/* edit the ray-traceable options */
 	ray_opt = ei_rt_options(rend->rt);
@@ -2429,7 +2819,7 @@ void ei_renderer_render(
 	/* synchronize the update of scene editing */
 	req.type = EI_MSG_REQ_UPDATE_SCENE;
 
-	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, NULL);
+	ei_master_broadcast(rend->master, &req, 0, scene_message_proc, rend);
 
 	/* precompute parameters, ei_scene_update_instance must be called before this, 
 	   because this function depends on some precomputed camera parameters. */
@@ -2456,6 +2846,54 @@ void ei_renderer_render(
 	ei_info("Finished building initial acceleration structures.\n");
 	ei_info("Elapsed time: %d hours %d minutes %f seconds.\n", 
 		hours, minutes, seconds);
+}
+
+/* recompute the origins of all light instances from their lights, 
+   so that edits of light parameters take effect without traversing 
+   the scene graph again. */
+static void ei_renderer_refresh_light_instances(
+	eiRenderer *rend, 
+	eiCamera *cam)
+{
+	eiInt				numLightInstances;
+	eiDataTableIterator	lightInstancesIter;
+	eiInt				i;
+
+	ei_data_table_begin(rend->db, rend->lightInstances, &lightInstancesIter);
+	numLightInstances = lightInstancesIter.tab->item_count;
+
+	for (i = 0; i < numLightInstances; ++i)
+	{
+		eiLightInstance		*inst;
+		eiLight				*light;
+
+		inst = (eiLightInstance *)ei_data_table_write(&lightInstancesIter, i);
+		light = (eiLight *)ei_db_access(rend->db, inst->light);
+
+		point_transform(&inst->origin, &light->origin, &inst->light_to_world);
+
+		ei_db_end(rend->db, inst->light);
+
+		ei_light_instance_transform(inst, &cam->world_to_camera, &cam->motion_world_to_camera);
+	}
+
+	ei_data_table_end(&lightInstancesIter);
+}
+
+/* run prepasses to generate photon maps and final gather points, 
+   returns whether the irradiance cache was built. */
+static eiBool ei_renderer_run_prepasses(
+	eiRenderer *rend, 
+	eiOptions *opt, 
+	eiCamera *cam, 
+	const eiTag opt_tag, 
+	eiInstance *cam_inst, 
+	const eiUint user_output_size)
+{
+	eiInt			hours, minutes;
+	eiScalar		seconds;
+	eiTimer			local_timer;
+	eiBool			need_irrad_cache;
 
 	/* run photon emission pass to generate photon maps */
 	if (opt->caustic || opt->globillum)
@@ -2510,6 +2948,43 @@ void ei_renderer_render(
 			hours, minutes, seconds);
 	}
 
+	return need_irrad_cache;
+}
+
+/* delete the photon maps and irradiance cache built by prepasses. */
+static void ei_renderer_delete_prepasses(
+	eiRenderer *rend, 
+	eiOptions *opt, 
+	eiCamera *cam, 
+	const eiBool need_irrad_cache)
+{
+	/* delete irradiance cache */
+	if (need_irrad_cache)
+	{
+		ei_renderer_delete_irrad_cache(rend, opt, cam);
+	}
+
+	/* delete photon maps */
+	if (opt->caustic || opt->globillum)
+	{
+		ei_renderer_delete_photon_maps(rend);
+	}
+}
+
+/* create buckets and render the frame. */
+static void ei_renderer_render_frame(
+	eiRenderer *rend, 
+	eiOptions *opt, 
+	eiCamera *cam, 
+	const eiTag opt_tag, 
+	eiInstance *cam_inst, 
+	const eiUint user_output_size, 
+	const eiBool progressive)
+{
+	eiInt			hours, minutes;
+	eiScalar		seconds;
+	eiTimer			local_timer;
+
 	/* buckets must be created after frame buffers */
 	ei_renderer_create_buckets(
 		rend, opt, cam, opt_tag, cam_inst->element, user_output_size, 
@@ -2522,35 +2997,32 @@ void ei_renderer_render(
 	ei_timer_start(&local_timer);
 
 	/* run the main rendering process */
-	ei_renderer_run_process(rend);
+	if (progressive)
+	{
+		ei_renderer_run_progressive_process(rend, opt);
+	}
+	else
+	{
+		ei_renderer_run_process(rend);
+	}
 
 	ei_timer_stop(&local_timer);
 	ei_timer_format(&local_timer, &hours, &minutes, &seconds);
 	ei_info("Finished frame rendering.\n");
 	ei_info("Elapsed time: %d hours %d minutes %f seconds.\n", 
 		hours, minutes, seconds);
+}
 
-	ei_rt_end_tracing(rend->rt);
-
-	/* delete irradiance cache */
-	if (need_irrad_cache)
-	{
-		ei_renderer_delete_irrad_cache(rend, opt, cam);
-	}
-
-	/* delete photon maps */
-	if (opt->caustic || opt->globillum)
-	{
-		ei_renderer_delete_photon_maps(rend);
-	}
-
-	/* delete buckets */
-	ei_renderer_delete_buckets(rend);
-
-	/* delete light instances */
-	ei_renderer_delete_light_instances(rend);
+/* write all output images. */
+static void ei_renderer_write_images(
+	eiRenderer *rend, 
+	eiOptions *opt, 
+	eiCamera *cam)
+{
+	eiInt			hours, minutes;
+	eiScalar		seconds;
+	eiTimer			local_timer;
 
-	/* output images */
 	ei_info("Outputing images...\n");
 
 	ei_timer_reset(&local_timer);
@@ -2563,6 +3035,74 @@ void ei_renderer_render(
 	ei_info("Finished outputing images.\n");
 	ei_info("Elapsed time: %d hours %d minutes %f seconds.\n", 
 		hours, minutes, seconds);
+}
+
+void ei_renderer_render(
+	eiRenderer *rend, 
+	const eiTag root_instgrp_tag, 
+	const eiTag cam_inst_tag, 
+	const eiTag opt_tag)
+{
+	eiInt			hours, minutes;
+	eiScalar		seconds;
+	eiTimer			timer;
+	eiOptions		*opt;
+	eiInstance		*cam_inst;
+	eiCamera		*cam;
+	eiUint			user_output_size;
+	eiBool			need_irrad_cache;
+
+	if (rend->session.active)
+	{
+		ei_error("Cannot render while an interactive session is active.\n");
+		return;
+	}
+
+	/* override verbosity callback */
+	ei_verbose_callback(ei_renderer_verbose_print, (void *)rend->con);
+
+	ei_renderer_init_stats(rend);
+	ei_info("\n");
+	ei_info("Start rendering...\n");
+
+	ei_timer_reset(&timer);
+	ei_timer_start(&timer);
+
+	/* begin accessing global options */
+	opt = (eiOptions *)ei_db_access(rend->db, opt_tag);
+
+	/* begin accessing camera instance and camera */
+	cam_inst = (eiInstance *)ei_db_access(rend->db, cam_inst_tag);
+	cam = (eiCamera *)ei_db_access(rend->db, cam_inst->element);
+
+	/* build frame buffers */
+	user_output_size = 0;
+
+	ei_renderer_init_framebuffers(rend, opt, cam, &user_output_size);
+
+	/* build light instances */
+	ei_renderer_init_light_instances(rend);
+
+	ei_renderer_update_scene(rend, opt, cam_inst, cam, root_instgrp_tag);
+
+	need_irrad_cache = ei_renderer_run_prepasses(
+		rend, opt, cam, opt_tag, cam_inst, user_output_size);
+
+	ei_renderer_render_frame(
+		rend, opt, cam, opt_tag, cam_inst, user_output_size, opt->progressive);
+
+	ei_rt_end_tracing(rend->rt);
+
+	ei_renderer_delete_prepasses(rend, opt, cam, need_irrad_cache);
+
+	/* delete buckets */
+	ei_renderer_delete_buckets(rend);
+
+	/* delete light instances */
+	ei_renderer_delete_light_instances(rend);
+
+	/* output images */
+	ei_renderer_write_images(rend, opt, cam);
 
 	/* delete frame buffers */
 	ei_renderer_delete_framebuffers(rend);
@@ -2585,3 +3125,227 @@ void ei_renderer_render(
 	/* clear verbosity callback */
 	ei_verbose_callback(NULL, NULL);
 }
+
+void ei_renderer_begin_session(
+	eiRenderer *rend, 
+	const eiTag root_instgrp_tag, 
+	const eiTag cam_inst_tag, 
+	const eiTag opt_tag)
+{
+	eiRenderSession		*session;
+
+	session = &rend->session;
+
+	if (session->active)
+	{
+		ei_renderer_end_session(rend);
+	}
+
+	session->active = eiTRUE;
+	session->root_instgrp = root_instgrp_tag;
+	session->cam_inst = cam_inst_tag;
+	session->opt = opt_tag;
+	/* nothing has been built yet */
+	session->edits = EI_EDIT_ALL;
+	session->has_framebuffers = eiFALSE;
+	session->has_scene = eiFALSE;
+	session->user_output_size = 0;
+	ei_array_init(&session->edited_objects, sizeof(eiTag));
+}
+
+void ei_renderer_update_session(
+	eiRenderer *rend, 
+	const eiInt edits, 
+	const eiTag node)
+{
+	if (!rend->session.active)
+	{
+		ei_error("No interactive session to update.\n");
+		return;
+	}
+
+	rend->session.edits |= edits;
+
+	if ((edits & EI_EDIT_GEOMETRY) && node != eiNULL_TAG)
+	{
+		ei_array_push_back(&rend->session.edited_objects, &node);
+	}
+}
+
+/* invalidate the tessellations of edited objects, touching the 
+   time-stamp of an object misses all its cached representations, 
+   so it will be tessellated again when updating the scene, and 
+   the old representations will be deleted as unreferenced. the 
+   object is also notified as changed to dirt its derived data. */
+static void ei_renderer_invalidate_edited_objects(eiRenderer *rend)
+{
+	eiRenderSession		*session;
+	eiIntptr			i;
+
+	session = &rend->session;
+
+	for (i = 0; i < ei_array_size(&session->edited_objects); ++i)
+	{
+		eiTag		tag;
+		eiNode		*node;
+
+		tag = *((eiTag *)ei_array_get(&session->edited_objects, i));
+		node = (eiNode *)ei_db_access(rend->db, tag);
+
+		/* ends the access to node */
+		ei_nodesys_end_node(rend->nodesys, node);
+	}
+
+	ei_array_clear(&session->edited_objects);
+}
+
+void ei_renderer_render_session(eiRenderer *rend)
+{
+	eiRenderSession		*session;
+	eiInt				hours, minutes;
+	eiScalar			seconds;
+	eiTimer				timer;
+	eiOptions			*opt;
+	eiInstance			*cam_inst;
+	eiCamera			*cam;
+	eiBool				need_irrad_cache;
+
+	session = &rend->session;
+
+	if (!session->active)
+	{
+		ei_error("No interactive session to render.\n");
+		return;
+	}
+
+	/* override verbosity callback */
+	ei_verbose_callback(ei_renderer_verbose_print, (void *)rend->con);
+
+	ei_renderer_init_stats(rend);
+	ei_info("\n");
+	ei_info("Start interactive rendering...\n");
+
+	ei_timer_reset(&timer);
+	ei_timer_start(&timer);
+
+	opt = (eiOptions *)ei_db_access(rend->db, session->opt);
+	cam_inst = (eiInstance *)ei_db_access(rend->db, session->cam_inst);
+	cam = (eiCamera *)ei_db_access(rend->db, cam_inst->element);
+
+	/* the resolution and outputs may have been changed */
+	if (session->edits & (EI_EDIT_CAMERA | EI_EDIT_OPTIONS))
+	{
+		if (session->has_framebuffers)
+		{
+			ei_renderer_delete_framebuffers(rend);
+		}
+
+		session->user_output_size = 0;
+
+		ei_renderer_init_framebuffers(rend, opt, cam, &session->user_output_size);
+
+		session->has_framebuffers = eiTRUE;
+	}
+
+	if (session->edits & EI_EDIT_GEOMETRY)
+	{
+		ei_renderer_invalidate_edited_objects(rend);
+	}
+
+	if (session->edits & (EI_EDIT_CAMERA | EI_EDIT_INSTANCE | EI_EDIT_GEOMETRY | EI_EDIT_OPTIONS))
+	{
+		/* object representations are cached by their source objects, 
+		   so only the changed objects will be tessellated again */
+		if (session->has_scene)
+		{
+			ei_rt_end_tracing(rend->rt);
+			ei_renderer_delete_light_instances(rend);
+		}
+
+		ei_renderer_init_light_instances(rend);
+
+		ei_renderer_update_scene(rend, opt, cam_inst, cam, session->root_instgrp);
+
+		session->has_scene = eiTRUE;
+	}
+	else if (session->edits & EI_EDIT_LIGHT)
+	{
+		ei_info("Reusing scene, updating light instances...\n");
+
+		ei_renderer_refresh_light_instances(rend, cam);
+	}
+	else
+	{
+		ei_info("Reusing scene and acceleration structures...\n");
+	}
+
+	session->edits = EI_EDIT_NONE;
+
+	/* the lighting depends on all kinds of edits, so photon maps 
+	   and final gather points are always generated again */
+	need_irrad_cache = ei_renderer_run_prepasses(
+		rend, opt, cam, session->opt, cam_inst, session->user_output_size);
+
+	ei_renderer_render_frame(
+		rend, opt, cam, session->opt, cam_inst, session->user_output_size, eiTRUE);
+
+	ei_renderer_delete_prepasses(rend, opt, cam, need_irrad_cache);
+
+	ei_renderer_delete_buckets(rend);
+
+	ei_db_end(rend->db, cam_inst->element);
+	ei_db_end(rend->db, session->cam_inst);
+	ei_db_end(rend->db, session->opt);
+
+	ei_timer_stop(&timer);
+	ei_timer_format(&timer, &hours, &minutes, &seconds);
+	ei_info("Finished interactive rendering.\n");
+	ei_info("Elapsed time: %d hours %d minutes %f seconds.\n", 
+		hours, minutes, seconds);
+
+	ei_renderer_finish_stats(rend);
+
+	/* clear verbosity callback */
+	ei_verbose_callback(NULL, NULL);
+}
+
+void ei_renderer_end_session(eiRenderer *rend)
+{
+	eiRenderSession		*session;
+	eiOptions			*opt;
+	eiInstance			*cam_inst;
+	eiCamera			*cam;
+
+	session = &rend->session;
+
+	if (!session->active)
+	{
+		return;
+	}
+
+	if (session->has_scene)
+	{
+		ei_rt_end_tracing(rend->rt);
+		ei_renderer_delete_light_instances(rend);
+	}
+
+	if (session->has_framebuffers)
+	{
+		opt = (eiOptions *)ei_db_access(rend->db, session->opt);
+		cam_inst = (eiInstance *)ei_db_access(rend->db, session->cam_inst);
+		cam = (eiCamera *)ei_db_access(rend->db, cam_inst->element);
+
+		/* output the images of last rendering */
+		ei_renderer_write_images(rend, opt, cam);
+
+		ei_renderer_delete_framebuffers(rend);
+
+		ei_db_end(rend->db, cam_inst->element);
+		ei_db_end(rend->db, session->cam_inst);
+		ei_db_end(rend->db, session->opt);
+	}
+
+	ei_array_clear(&session->edited_objects);
+
+	memset(session, 0, sizeof(eiRenderSession));
+}
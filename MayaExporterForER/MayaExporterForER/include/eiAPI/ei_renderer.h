@@ -40,6 +40,25 @@ typedef struct eiOptions		eiOptions;
 typedef struct eiCamera			eiCamera;
 typedef struct eiRenderer		eiRenderer;
 
+/** \brief The kinds of scene edits in an interactive session, 
+ * each kind invalidates only the data depending on it. */
+enum {
+	EI_EDIT_NONE = 0, 
+	/* shader parameters, keep the scene and acceleration structures */
+	EI_EDIT_SHADER = (1 << 0), 
+	/* light parameters, only update light instances */
+	EI_EDIT_LIGHT = (1 << 1), 
+	/* camera moves, update the scene for view-dependent tessellation */
+	EI_EDIT_CAMERA = (1 << 2), 
+	/* instance transforms, reuse the tessellation of all objects */
+	EI_EDIT_INSTANCE = (1 << 3), 
+	/* geometry changes, tessellate the changed objects again */
+	EI_EDIT_GEOMETRY = (1 << 4), 
+	/* global options, rebuild frame buffers and the scene */
+	EI_EDIT_OPTIONS = (1 << 5), 
+	EI_EDIT_ALL = 0xFFFF, 
+};
+
 /** \brief Initialize session global objects for the renderer. */
 eiAPI void ei_init_globals(eiGlobals *globals, eiDatabase *db);
 /** \brief Cleanup session global objects for the renderer. */
@@ -78,6 +97,26 @@ void ei_renderer_render(
 	const eiTag cam_inst_tag, 
 	const eiTag opt_tag);
 
+/** \brief Begin an interactive session, the scene will be kept 
+ * across renderings until the session ends. */
+void ei_renderer_begin_session(
+	eiRenderer *rend, 
+	const eiTag root_instgrp_tag, 
+	const eiTag cam_inst_tag, 
+	const eiTag opt_tag);
+/** \brief Notify the session of scene edits, edits is a 
+ * combination of EI_EDIT_* flags, node is the edited node. */
+void ei_renderer_update_session(
+	eiRenderer *rend, 
+	const eiInt edits, 
+	const eiTag node);
+/** \brief Render the session progressively, only rebuilding 
+ * what the edits since last rendering invalidated. */
+void ei_renderer_render_session(eiRenderer *rend);
+/** \brief End the interactive session, output images of 
+ * last rendering and release the scene. */
+void ei_renderer_end_session(eiRenderer *rend);
+
 #ifdef __cplusplus
 }
 #endif
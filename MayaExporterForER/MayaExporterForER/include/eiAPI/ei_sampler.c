@@ -22,17 +22,33 @@
 #include <eiAPI/ei_object.h>
 #include <eiAPI/ei_raytracer.h>
 #include <eiAPI/ei_shadesys.h>
+#include <eiAPI/ei_pin_cache.h>
 #include <eiAPI/ei.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_random.h>
 #include <eiCORE/ei_qmc.h>
+#include <eiCORE/ei_algorithm.h>
 
 #define EI_SAMPLES_PER_BANK		4096
 
+void ei_sampler_tls_init(eiSamplerTLS *pTls)
+{
+	ei_arena_init(&pTls->sampleArena, 
+		ei_arena_aligned_size(sizeof(eiSampleInfo)) * EI_SAMPLES_PER_BANK);
+	pTls->num_samples_created = 0;
+	pTls->num_pool_banks = 0;
+	pTls->num_buckets = 0;
+}
+
+void ei_sampler_tls_exit(eiSamplerTLS *pTls)
+{
+	ei_arena_clear(&pTls->sampleArena);
+}
+
 /** \brief Precompute the weights of samples by the filter, 
  * despite of stochastic sampling, the weights will always 
  * be calculated at regular sampling points. */
-static void ei_filter_table_init(
+void ei_filter_table_init(
 	eiFilterTable *tab, 
 	const eiInt num_subpixels, const eiScalar filter_rad, const eiInt filter)
 {
@@ -108,7 +124,7 @@ static void ei_filter_table_init(
 	}
 }
 
-static void ei_filter_table_exit(eiFilterTable *tab)
+void ei_filter_table_exit(eiFilterTable *tab)
 {
 	ei_buffer_clear(&tab->table);
 	ei_buffer_clear(&tab->weights);
@@ -146,6 +162,7 @@ static eiFORCEINLINE eiInt ei_filter_table_get_filter_radius(eiFilterTable *tab)
  * containing a list of sub-pixels within this pixel. */
 typedef struct eiPixelInfo {
 	ei_slist		sample_list;
+	eiSampleStats	stats;
 } eiPixelInfo;
 
 static void ei_pixel_info_init(void *item)
@@ -153,6 +170,7 @@ static void ei_pixel_info_init(void *item)
 	eiPixelInfo *info = (eiPixelInfo *)item;
 
 	ei_slist_init(&info->sample_list, NULL);
+	ei_sample_stats_init(&info->stats);
 }
 
 static void ei_pixel_info_exit(void *item)
@@ -181,11 +199,12 @@ static void ei_pixel_info_copy(void *dst_item, const void *src_item, const eiInt
 static void ei_render_params_init(
 	eiRenderParams *par, 
 	eiOptions *opt, 
+	eiBucketJob *job, 
 	const eiScalar scene_diag)
 {
 	par->filter_radius = opt->filter_size * 0.5f;
-	par->min_depth = opt->min_samples;
-	par->max_depth = opt->max_samples;
+	par->min_depth = job->min_samples;
+	par->max_depth = job->max_samples;
 	/* make sure the parameter is valid */
 	if (par->max_depth < par->min_depth ) {
 		par->max_depth = par->min_depth;
@@ -202,6 +221,10 @@ static void ei_render_params_init(
 	par->sample_filter_radius = lceilf(par->filter_radius * par->inv_num_spans);
 	par->subpixel_to_pixel = par->num_spans * par->inv_num_subpixels;
 	par->inv_subpixel_to_pixel = 1.0f / par->subpixel_to_pixel;
+	/* we need at least two samples to estimate the variance of a 
+	   pixel, and allow as many samples as the densest lattice would take */
+	par->min_spp = MAX(2, opt->variance_min_samples);
+	par->max_spp = MAX(par->min_spp, par->num_subpixels * par->num_subpixels);
 
 	/* initialize filter table */
 	ei_filter_table_init(&par->filterTable, 
@@ -247,6 +270,35 @@ static void ei_render_params_exit(eiRenderParams *par)
 	ei_filter_table_exit(&par->filterTable);
 }
 
+void ei_recon_samples_init(eiReconSamples *recon)
+{
+	recon->pixel_offsets = NULL;
+	recon->x = NULL;
+	recon->y = NULL;
+	recon->weight = NULL;
+	recon->channels = NULL;
+	recon->round_channels = NULL;
+	recon->filter_weights = NULL;
+	recon->sums = NULL;
+	recon->num_pixels_x = 0;
+	recon->num_pixels_y = 0;
+	recon->num_samples = 0;
+	recon->num_channels = 0;
+	recon->max_row_samples = 0;
+}
+
+void ei_recon_samples_exit(eiReconSamples *recon)
+{
+	eiCHECK_FREE(recon->pixel_offsets);
+	eiCHECK_FREE(recon->x);
+	eiCHECK_FREE(recon->y);
+	eiCHECK_FREE(recon->weight);
+	eiCHECK_FREE(recon->channels);
+	eiCHECK_FREE(recon->round_channels);
+	eiCHECK_FREE(recon->filter_weights);
+	eiCHECK_FREE(recon->sums);
+}
+
 static void ei_bucket_init(
 	eiBucket *bucket, eiBucketJob *job, eiDatabase *db)
 {
@@ -269,7 +321,7 @@ static void ei_bucket_init(
 	ei_buffer_init(&bucket->pixelBuffer, sizeof(eiPixelInfo), 
 		ei_pixel_info_init, ei_pixel_info_exit, ei_pixel_info_copy, NULL, NULL, NULL);
 
-	ei_render_params_init(&bucket->par, bucket->base.opt, ei_rt_scene_diag(bucket->base.rt));
+	ei_render_params_init(&bucket->par, bucket->base.opt, job, ei_rt_scene_diag(bucket->base.rt));
 
 	bucket->rect_width = job->rect.right - job->rect.left + 1;
 	bucket->rect_height = job->rect.bottom - job->rect.top + 1;
@@ -291,6 +343,17 @@ static void ei_bucket_init(
 		bucket->rect_height, 
 		job->pos_i, 
 		job->pos_j);
+	if (job->sampleCountFrameBuffer != eiNULL_TAG)
+	{
+		ei_framebuffer_cache_init(
+			&bucket->sampleCountFrameBufferCache, 
+			db, 
+			job->sampleCountFrameBuffer, 
+			bucket->rect_width, 
+			bucket->rect_height, 
+			job->pos_i, 
+			job->pos_j);
+	}
 
 	numFrameBuffers = ei_data_array_size(db, job->frameBuffers);
 
@@ -314,18 +377,31 @@ static void ei_bucket_init(
 			job->pos_j);
 	}
 
-	/* create sample pool */
-	ei_fixed_pool_init(&bucket->samplePool, 
-		sizeof(eiSampleInfo) + job->user_output_size, EI_SAMPLES_PER_BANK);
+	/* samples are allocated from the arena of current thread, 
+	   which is reset when the bucket finishes */
+	bucket->samplerTls = (eiSamplerTLS *)ei_tls_get_interface(ei_db_get_tls(db), EI_TLS_TYPE_SAMPLER);
+	bucket->sampleSize = sizeof(eiSampleInfo) + job->user_output_size;
+	bucket->freeSamples = NULL;
+	++ bucket->samplerTls->num_buckets;
+
+	ei_recon_samples_init(&bucket->reconSamples);
 }
 
 static eiBool ei_bucket_exit(eiBucket *bucket)
 {
+	eiInt64		num_samples;
 	eiIntptr	i;
 
 	ei_buffer_clear(&bucket->pixelBuffer);
 	ei_buffer_clear(&bucket->sampleBuffer);
-	ei_fixed_pool_clear(&bucket->samplePool);
+	/* the pool reused freed samples as we do, so it held as 
+	   many samples as the arena, in banks of EI_SAMPLES_PER_BANK */
+	num_samples = (eiInt64)(bucket->samplerTls->sampleArena.usedSize / ei_arena_aligned_size(bucket->sampleSize));
+	bucket->samplerTls->num_pool_banks += (num_samples + EI_SAMPLES_PER_BANK - 1) / EI_SAMPLES_PER_BANK;
+	/* all samples of this bucket are released at once */
+	bucket->freeSamples = NULL;
+	ei_arena_reset(&bucket->samplerTls->sampleArena);
+	ei_recon_samples_exit(&bucket->reconSamples);
 
 	for (i = 0; i < ei_array_size(&bucket->frameBufferCaches); ++i)
 	{
@@ -338,6 +414,11 @@ static eiBool ei_bucket_exit(eiBucket *bucket)
 	}
 	ei_array_clear(&bucket->frameBufferCaches);
 
+	if (bucket->job->sampleCountFrameBuffer != eiNULL_TAG)
+	{
+		ei_framebuffer_cache_flush(&bucket->sampleCountFrameBufferCache);
+		ei_framebuffer_cache_exit(&bucket->sampleCountFrameBufferCache);
+	}
 	ei_framebuffer_cache_flush(&bucket->opacityFrameBufferCache);
 	ei_framebuffer_cache_exit(&bucket->opacityFrameBufferCache);
 	ei_framebuffer_cache_flush(&bucket->colorFrameBufferCache);
@@ -362,7 +443,17 @@ eiSampleInfo *create_sample_info(eiBucket *bucket)
 {
 	eiSampleInfo	*info;
 
-	info = (eiSampleInfo *)ei_fixed_pool_allocate(&bucket->samplePool);
+	if (bucket->freeSamples != NULL)
+	{
+		info = (eiSampleInfo *)bucket->freeSamples;
+		bucket->freeSamples = bucket->freeSamples->next;
+	}
+	else
+	{
+		info = (eiSampleInfo *)ei_arena_allocate(&bucket->samplerTls->sampleArena, bucket->sampleSize);
+	}
+	++ bucket->samplerTls->num_samples_created;
+
 	ei_sample_info_init(info, bucket->job->user_output_size);
 
 	return info;
@@ -371,7 +462,10 @@ eiSampleInfo *create_sample_info(eiBucket *bucket)
 void delete_sample_info(eiBucket *bucket, eiSampleInfo * const info)
 {
 	ei_sample_info_exit(info);
-	ei_fixed_pool_free(&bucket->samplePool, info);
+	/* the memory is returned to arena when the bucket finishes, 
+	   keep it for reuse by temporary samples until then */
+	info->node.next = bucket->freeSamples;
+	bucket->freeSamples = &info->node;
 }
 
 /* reset the sample info and reuse the allocated memory */
@@ -403,6 +497,99 @@ static eiFORCEINLINE void write_sample(
 	}
 }
 
+/* blend a sample with the samples accumulated in frame buffer 
+   by previous progressive passes, weighted by the samples each 
+   pass took in this pixel, which adaptive and variance-driven 
+   sampling vary per pixel. integer channels such as identifiers 
+   are not averaged. */
+static void accumulate_sample(
+	eiBucket *bucket, const eiInt x, const eiInt y, eiSampleInfo *color, 
+	const eiScalar num_samples)
+{
+	eiScalar	a, b;
+	eiVector	prev;
+	eiIntptr	i;
+
+	a = 0.0f;
+
+	if (bucket->job->accum_weight > 0.0f)
+	{
+		ei_framebuffer_cache_get(&bucket->sampleCountFrameBufferCache, x, y, &a);
+	}
+
+	b = a + num_samples;
+	ei_framebuffer_cache_set(&bucket->sampleCountFrameBufferCache, x, y, &b);
+
+	if (a <= 0.0f)
+	{
+		return;
+	}
+
+	a = a / b;
+	b = 1.0f - a;
+
+	ei_framebuffer_cache_get(&bucket->colorFrameBufferCache, x, y, &prev);
+	mulvfi(&color->color, b);
+	mulvfi(&prev, a);
+	addi(&color->color, &prev);
+
+	ei_framebuffer_cache_get(&bucket->opacityFrameBufferCache, x, y, &prev);
+	mulvfi(&color->opacity, b);
+	mulvfi(&prev, a);
+	addi(&color->opacity, &prev);
+
+	for (i = 0; i < ei_array_size(&bucket->frameBufferCaches); ++i)
+	{
+		eiFrameBufferCache	*fb_cache;
+		eiByte				*data;
+
+		fb_cache = (eiFrameBufferCache *)ei_array_get(&bucket->frameBufferCaches, i);
+
+		data = ((eiByte *)color) + ei_framebuffer_cache_get_data_offset(fb_cache);
+
+		switch (ei_framebuffer_cache_get_type(fb_cache))
+		{
+		case EI_DATA_TYPE_SCALAR:
+			{
+				eiScalar	prev_scalar;
+
+				ei_framebuffer_cache_get(fb_cache, x, y, &prev_scalar);
+				*((eiScalar *)data) = *((eiScalar *)data) * b + prev_scalar * a;
+			}
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			{
+				ei_framebuffer_cache_get(fb_cache, x, y, &prev);
+				mulvfi((eiVector *)data, b);
+				mulvfi(&prev, a);
+				addi((eiVector *)data, &prev);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/* the scrambling seed of a pixel, successive progressive passes 
+   use different seeds so that they take different samples. the 
+   Halton sequence is shared by all pixels and only rotated by 
+   the seed of the pass, the first pass takes the sequence itself. */
+static eiFORCEINLINE eiUint ei_bucket_pixel_seed(
+	eiBucket *bucket, const eiInt x, const eiInt y)
+{
+	eiUint	pass_seed;
+
+	pass_seed = ei_qmc_pass_seed(bucket->job->progressive_pass);
+
+	if (bucket->base.opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+	{
+		return ei_qmc_pixel_seed(x, y) ^ pass_seed;
+	}
+
+	return pass_seed;
+}
+
 /* paint a sample into frame buffer. */
 static eiFORCEINLINE void paint_sample(
 	eiBucket *bucket, const eiInt x, const eiInt y, const eiInt r, eiSampleInfo *color)
@@ -648,6 +835,32 @@ static eiFORCEINLINE void set_raster_pos(eiBucket *bucket, const eiInt x, const
 	bucket->rasterPos.y = (eiScalar)y * par->subpixel_to_pixel + bucket->local_to_screen_y;
 }
 
+/* the QMC dimension of the vertical positions in pixels drawn 
+   by variance-driven sampling with the Halton sequence, reserved 
+   before the shading dimensions of eye rays. the horizontal 
+   positions are drawn from dimension 0. */
+#define EYE_HALTON_PIXEL_Y_DIMENSION	2
+
+/* the QMC dimension of the sampling time of eye rays. the Sobol 
+   sequence keeps the first group of dimensions for the positions 
+   in pixels and the second one for time, and starts shading at 
+   the third group so that shading samples form 2D nets. */
+static eiFORCEINLINE eiUint eye_time_dimension(const eiOptions *opt)
+{
+	return (opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL) ? QMC_SOBOL_DIM : 1;
+}
+
+static eiFORCEINLINE eiUint eye_shading_dimension(const eiOptions *opt)
+{
+	if (opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+	{
+		return 2 * QMC_SOBOL_DIM;
+	}
+
+	return (opt->sampling_mode == EI_SAMPLING_MODE_VARIANCE) ? 
+		EYE_HALTON_PIXEL_Y_DIMENSION + 1 : 2;
+}
+
 /** \brief Sample the lens, either by calling 
  * lens shader or tracing a ray */
 static void sample_lens(
@@ -656,7 +869,8 @@ static void sample_lens(
 	const eiScalar time, 
 	const eiVector2 *rpos, 
 	eiBool * const pass_motion, 
-	const eiUint ray_instance_number)
+	const eiUint ray_instance_number, 
+	const eiUint qmc_seed)
 {
 	eiOptions	*opt;
 	eiCamera	*cam;
@@ -667,6 +881,7 @@ static void sample_lens(
 	ei_state_init(&eye_ray, eiRAY_EYE, &bucket->base);
 
 	eye_ray.instance_number = ray_instance_number;
+	eye_ray.qmc_seed = qmc_seed;
 
 	/* perspective projection */
 	if (cam->focal != eiMAX_SCALAR)
@@ -692,7 +907,7 @@ static void sample_lens(
 	       antialiasing:   0
 		   motion blur:    1
 	   so here we set current available dimension to be 2 */
-	eye_ray.dimension = 2;
+	eye_ray.dimension = eye_shading_dimension(opt);
 	eye_ray.time = time;
 	eye_ray.dtime = opt->shutter_close - opt->shutter_open;
 	eye_ray.raster = *rpos;
@@ -803,48 +1018,21 @@ static eiFORCEINLINE void put_sample(
 	}
 }
 
-/* sample a sub-pixel location. set_raster_pos should be called properly 
-   before calling this function. */
-static eiSampleInfo *sample(
+/* trace a sample at raster position, the trajectory is split 
+   over motion segments if motion blur is enabled. */
+static void sample_raster(
 	eiBucket *bucket, 
-	const eiInt x, const eiInt y, const eiInt depth, 
-	eiSampleInfo *s1, eiSampleInfo *s2, eiSampleInfo *s3, eiSampleInfo *s4, 
-	const eiScalar sf)
+	eiSampleInfo *c, 
+	const eiVector2 *rpos, 
+	const eiUint ray_instance_number, 
+	const eiUint qmc_seed)
 {
-	eiRenderParams	*par;
 	eiOptions		*opt;
-	eiCamera		*cam;
-	eiSampleInfo	*c;
-	eiScalar		sx, sy;
-	eiVector2		rpos;
-	eiUint			ray_instance_number;
-	eiGeoScalar		jx, jy;
 	eiScalar		time0, time;
 	eiBool			pass_motion;
-	
-	par = &bucket->par;
-	opt = bucket->base.opt;
-	cam = bucket->base.cam;
-	c = create_sample_info(bucket);
-
-	/* compute pixel location */
-	ei_filter_table_reg(&par->filterTable, x, y, &sx, &sy);
-
-	sx = sx * (eiScalar)par->num_spans + bucket->rasterPos.x;
-	sy = sy * (eiScalar)par->num_spans + bucket->rasterPos.y;
 
-	ray_instance_number = 0;
-	jx = 0.0;
-	jy = 0.0;
-	ei_sample_subpixel(&ray_instance_number, &jx, &jy, 
-		(eiInt)(sx * par->inv_subpixel_to_pixel), 
-		(eiInt)(sy * par->inv_subpixel_to_pixel));
-
-	sx += (eiScalar)((jx - 0.5) * par->subpixel_to_pixel);
-	sy += (eiScalar)((jy - 0.5) * par->subpixel_to_pixel);
-
-	setv2(&rpos, sx, sy);
-	time0 = (eiScalar)ei_sigma(1, ray_instance_number);
+	opt = bucket->base.opt;
+	time0 = (eiScalar)ei_qmc_sample(opt, eye_time_dimension(opt), ray_instance_number, qmc_seed);
 	pass_motion = eiFALSE;
 
 	if (opt->motion && opt->motion_segments > 0)
@@ -866,7 +1054,7 @@ static eiSampleInfo *sample(
 			reset_sample_info(bucket, sub_c);
 
 			/* decorrelating */
-			sample_lens(bucket, sub_c, time, &rpos, &pass_motion, ray_instance_number + i);
+			sample_lens(bucket, sub_c, time, rpos, &pass_motion, ray_instance_number + i, qmc_seed);
 
 			ei_sample_info_add(bucket, c, sub_c);
 			++ actualNumTemporalSamples;
@@ -885,8 +1073,51 @@ static eiSampleInfo *sample(
 	}
 	else
 	{
-		sample_lens(bucket, c, time0, &rpos, &pass_motion, ray_instance_number);
+		sample_lens(bucket, c, time0, rpos, &pass_motion, ray_instance_number, qmc_seed);
 	}
+}
+
+/* sample a sub-pixel location. set_raster_pos should be called properly 
+   before calling this function. */
+static eiSampleInfo *sample(
+	eiBucket *bucket, 
+	const eiInt x, const eiInt y, const eiInt depth, 
+	eiSampleInfo *s1, eiSampleInfo *s2, eiSampleInfo *s3, eiSampleInfo *s4, 
+	const eiScalar sf)
+{
+	eiRenderParams	*par;
+	eiSampleInfo	*c;
+	eiScalar		sx, sy;
+	eiVector2		rpos;
+	eiUint			ray_instance_number;
+	eiUint			qmc_seed;
+	eiGeoScalar		jx, jy;
+	
+	par = &bucket->par;
+	c = create_sample_info(bucket);
+
+	/* compute pixel location */
+	ei_filter_table_reg(&par->filterTable, x, y, &sx, &sy);
+
+	sx = sx * (eiScalar)par->num_spans + bucket->rasterPos.x;
+	sy = sy * (eiScalar)par->num_spans + bucket->rasterPos.y;
+
+	qmc_seed = ei_bucket_pixel_seed(bucket, lfloorf(sx), lfloorf(sy));
+
+	ray_instance_number = 0;
+	jx = 0.0;
+	jy = 0.0;
+	ei_sample_subpixel(&ray_instance_number, &jx, &jy, 
+		(eiInt)(sx * par->inv_subpixel_to_pixel), 
+		(eiInt)(sy * par->inv_subpixel_to_pixel));
+	ei_shift_subpixel(&jx, &jy, ei_qmc_pass_seed(bucket->job->progressive_pass));
+
+	sx += (eiScalar)((jx - 0.5) * par->subpixel_to_pixel);
+	sy += (eiScalar)((jy - 0.5) * par->subpixel_to_pixel);
+
+	setv2(&rpos, sx, sy);
+
+	sample_raster(bucket, c, &rpos, ray_instance_number, qmc_seed);
 
 	put_sample(
 		bucket, 
@@ -911,6 +1142,7 @@ void fg_sample(
 	eiSampleInfo	*c;
 	eiVector2		rpos;
 	eiUint			ray_instance_number;
+	eiUint			qmc_seed;
 	eiGeoScalar		jx, jy;
 	eiScalar		time0;
 	eiBool			pass_motion;
@@ -928,11 +1160,13 @@ void fg_sample(
 		(eiInt)(sx * par->inv_subpixel_to_pixel), 
 		(eiInt)(sy * par->inv_subpixel_to_pixel));
 
+	qmc_seed = ei_bucket_pixel_seed(bucket, lfloorf(sx), lfloorf(sy));
+
 	setv2(&rpos, sx, sy);
-	time0 = (eiScalar)ei_sigma(1, ray_instance_number);
+	time0 = (eiScalar)ei_qmc_sample(opt, eye_time_dimension(opt), ray_instance_number, qmc_seed);
 	pass_motion = eiFALSE;
 
-	sample_lens(bucket, c, time0, &rpos, &pass_motion, ray_instance_number);
+	sample_lens(bucket, c, time0, &rpos, &pass_motion, ray_instance_number, qmc_seed);
 
 	switch (opt->finalgather_progress)
 	{
@@ -1075,42 +1309,509 @@ static void supersample(eiBucket *bucket, eiInt left, eiInt top)
 	}
 }
 
-/* reconstruct a specified pixel and write to frame buffer. */
-static void contribute(eiBucket *bucket, const eiInt px, const eiInt py)
+/* an entry of the queue of variance-driven sampling */
+typedef struct eiPixelError {
+	eiInt		index;
+	eiScalar	error;
+} eiPixelError;
+
+/* sort pixels by descending error */
+static eiInt ei_pixel_error_compare(void *lhs, void *rhs)
+{
+	eiScalar	a, b;
+
+	a = ((eiPixelError *)lhs)->error;
+	b = ((eiPixelError *)rhs)->error;
+
+	if (a > b)
+	{
+		return -1;
+	}
+	else if (a < b)
+	{
+		return 1;
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+void ei_sample_stats_init(eiSampleStats *stats)
+{
+	stats->num_samples = 0;
+	initv(&stats->mean);
+	initv(&stats->m2);
+}
+
+/* update the running mean and variance with a new sample 
+   color by Welford's online algorithm. */
+void ei_sample_stats_add(eiSampleStats *stats, const eiVector *color)
+{
+	eiVector	delta, delta2;
+
+	++ stats->num_samples;
+
+	sub(&delta, color, &stats->mean);
+	mulvf(&delta2, &delta, 1.0f / (eiScalar)stats->num_samples);
+	addi(&stats->mean, &delta2);
+	sub(&delta2, color, &stats->mean);
+	muli(&delta, &delta2);
+	addi(&stats->m2, &delta);
+}
+
+/* the estimated standard error of the mean color, 
+   the maximum of all color channels. */
+eiScalar ei_sample_stats_error(const eiSampleStats *stats)
+{
+	eiScalar	m2;
+
+	if (stats->num_samples < 2)
+	{
+		return eiMAX_SCALAR;
+	}
+
+	m2 = MAX(stats->m2.x, MAX(stats->m2.y, stats->m2.z));
+
+	return sqrtf(MAX(0.0f, m2) / ((eiScalar)(stats->num_samples - 1) * (eiScalar)stats->num_samples));
+}
+
+/* add more samples to a pixel of the sample grid. the samples 
+   are stratified by a low-discrepancy sequence which continues 
+   where the previous samples of the pixel stopped, and scrambled 
+   by the global position of the pixel. */
+static void variance_sample(
+	eiBucket *bucket, 
+	const eiInt i, const eiInt j, 
+	const eiInt num_samples)
 {
 	eiRenderParams	*par;
-	eiSampleInfo	*factor, *total;
-	ei_slist		*sample_list;
-	eiScalar		x, y, filter_radius;
-	eiInt			xmin, xmax, ymin, ymax;
-	eiInt			lx, ly;
-	eiScalar		sum_weight, weight;
-	eiInt			i, j;
+	eiOptions		*opt;
+	eiPixelInfo		*pixel;
+	eiScalar		sx, sy;
+	eiUint			ray_instance_number;
+	eiUint			qmc_seed;
+	eiGeoScalar		jx, jy;
+	eiInt			k, end;
 
 	par = &bucket->par;
+	opt = bucket->base.opt;
+	pixel = (eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, i, j);
 
-	factor = create_sample_info(bucket);
-	total = create_sample_info(bucket);
+	/* the center of the pixel in raster space */
+	sx = (eiScalar)i * par->num_spans + bucket->local_to_screen_x;
+	sy = (eiScalar)j * par->num_spans + bucket->local_to_screen_y;
 
-	x = ((eiScalar)px + 0.5f) * par->inv_num_spans + (eiScalar)par->sample_filter_radius;
-	y = ((eiScalar)py + 0.5f) * par->inv_num_spans + (eiScalar)par->sample_filter_radius;
+	ray_instance_number = 0;
+	jx = 0.0;
+	jy = 0.0;
+	ei_sample_subpixel(&ray_instance_number, &jx, &jy, 
+		(eiInt)(sx * par->inv_subpixel_to_pixel), 
+		(eiInt)(sy * par->inv_subpixel_to_pixel));
+	qmc_seed = ei_bucket_pixel_seed(bucket, lfloorf(sx), lfloorf(sy));
 
-	filter_radius = bucket->base.opt->filter_size * 0.5f * par->inv_num_spans;
+	end = pixel->stats.num_samples + num_samples;
 
-	xmin = lfloorf(x - filter_radius);
-	xmax = lceilf(x + filter_radius);
-	ymin = lfloorf(y - filter_radius);
-	ymax = lceilf(y + filter_radius);
+	for (k = pixel->stats.num_samples; k < end; ++k)
+	{
+		eiSampleInfo	*c;
+		eiScalar		u, v;
+		eiVector2		rpos;
 
-	lx = (eiInt)(x * (eiScalar)par->num_subpixels);
-	ly = (eiInt)(y * (eiScalar)par->num_subpixels);
+		c = create_sample_info(bucket);
 
-	sum_weight = 0.0f;
+		if (opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+		{
+			/* the samples of the pixel form a scrambled Sobol 
+			   sequence of their own */
+			u = (eiScalar)ei_sobol(0, k, qmc_seed) - 0.5f;
+			v = (eiScalar)ei_sobol(1, k, qmc_seed) - 0.5f;
 
-	for (j = ymin; j <= ymax; ++j)
+			setv2(&rpos, sx + u * par->num_spans, sy + v * par->num_spans);
+
+			sample_raster(bucket, c, &rpos, k, qmc_seed);
+		}
+		else
+		{
+			/* the positions are indexed by the ray instance like 
+			   time and shading, from dimensions no other sample 
+			   of the eye ray draws from */
+			u = (eiScalar)fmod(ei_halton(0, ray_instance_number + k, qmc_seed) + jx, 1.0) - 0.5f;
+			v = (eiScalar)fmod(ei_halton(EYE_HALTON_PIXEL_Y_DIMENSION, ray_instance_number + k, qmc_seed) + jy, 1.0) - 0.5f;
+
+			setv2(&rpos, sx + u * par->num_spans, sy + v * par->num_spans);
+
+			sample_raster(bucket, c, &rpos, ray_instance_number + k, qmc_seed);
+		}
+
+		c->x = lfloorf(((eiScalar)i + u) * (eiScalar)par->num_subpixels + 0.5f);
+		c->y = lfloorf(((eiScalar)j + v) * (eiScalar)par->num_subpixels + 0.5f);
+		c->weight = 1.0f;
+
+		ei_slist_push_back(&pixel->sample_list, &c->node);
+		ei_sample_stats_add(&pixel->stats, &c->color);
+	}
+}
+
+/* variance-driven adaptive sampling. every pixel of the sample 
+   grid takes min_spp samples first, then sampling runs in rounds, 
+   each round visits the pixels whose estimated error is above 
+   the noise threshold in order of decreasing error and doubles 
+   their samples, until all pixels converge or reach max_spp, or 
+   the time limit of the bucket is exceeded. the progress of the 
+   rounds is the share of samples traced in all samples up to 
+   max_spp, so pixels which converge early are not counted. */
+static eiBool variance_sampling(
+	eiBucket *bucket, eiBucketJob *job, eiBaseWorker *pWorker, 
+	const eiInt sample_width, const eiInt sample_height)
+{
+	eiOptions		*opt;
+	eiRenderParams	*par;
+	eiPixelError	*queue;
+	eiInt			num_pixels_x;
+	eiInt			num_pixels;
+	eiInt			num_active;
+	eiInt			num_rounds;
+	eiInt			num_samples;
+	eiInt			time_limit;
+	eiInt			start_time;
+	eiBool			out_of_time;
+	eiInt64			max_adaptive_samples;
+	eiInt64			num_adaptive_samples;
+	eiInt64			round_progress;
+	eiInt64			progress;
+	eiInt			i, j, k;
+
+	opt = bucket->base.opt;
+	par = &bucket->par;
+	num_pixels_x = sample_width + 1;
+	num_pixels = num_pixels_x * (sample_height + 1);
+	time_limit = (eiInt)(opt->sampling_time_limit * 1000.0f);
+	start_time = ei_get_time();
+
+	/* initial pass */
+	for (j = 0; j <= sample_height; ++j)
 	{
-		for (i = xmin; i <= xmax; ++i)
+		if (!ei_base_worker_is_running(pWorker))
+		{
+			return eiFALSE;
+		}
+
+		for (i = 0; i <= sample_width; ++i)
+		{
+			variance_sample(bucket, i, j, par->min_spp);
+		}
+
+		ei_base_worker_step_progress(pWorker, bucket->rect_width / 3);
+	}
+
+	queue = (eiPixelError *)ei_allocate(sizeof(eiPixelError) * num_pixels);
+	num_rounds = 0;
+	out_of_time = eiFALSE;
+	max_adaptive_samples = (eiInt64)num_pixels * (eiInt64)(par->max_spp - par->min_spp);
+	num_adaptive_samples = 0;
+	round_progress = (eiInt64)(bucket->rect_width / 3) * (eiInt64)sample_height;
+	progress = 0;
+
+	while (!out_of_time)
+	{
+		/* collect the pixels which have not converged */
+		num_active = 0;
+
+		for (k = 0; k < num_pixels; ++k)
 		{
+			eiPixelInfo		*pixel;
+			eiScalar		error;
+
+			pixel = (eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, k % num_pixels_x, k / num_pixels_x);
+
+			if (pixel->stats.num_samples >= par->max_spp)
+			{
+				continue;
+			}
+
+			error = ei_sample_stats_error(&pixel->stats);
+
+			if (error > opt->noise_threshold)
+			{
+				queue[num_active].index = k;
+				queue[num_active].error = error;
+				++ num_active;
+			}
+		}
+
+		if (num_active == 0)
+		{
+			break;
+		}
+
+		/* spend samples on the noisiest pixels first, so that 
+		   the time limit cuts off the least important work */
+		ei_heapsort(queue, num_active, sizeof(eiPixelError), ei_pixel_error_compare);
+
+		for (k = 0; k < num_active; ++k)
+		{
+			eiPixelInfo		*pixel;
+
+			if (!ei_base_worker_is_running(pWorker))
+			{
+				eiCHECK_FREE(queue);
+				return eiFALSE;
+			}
+
+			if (time_limit > 0 && (ei_get_time() - start_time) >= time_limit)
+			{
+				out_of_time = eiTRUE;
+				break;
+			}
+
+			i = queue[k].index % num_pixels_x;
+			j = queue[k].index / num_pixels_x;
+			pixel = (eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, i, j);
+			num_samples = MIN(pixel->stats.num_samples, par->max_spp - pixel->stats.num_samples);
+
+			variance_sample(bucket, i, j, num_samples);
+			num_adaptive_samples += num_samples;
+		}
+
+		++ num_rounds;
+
+		if (max_adaptive_samples > 0)
+		{
+			eiInt64		new_progress;
+
+			new_progress = round_progress * num_adaptive_samples / max_adaptive_samples;
+			ei_base_worker_step_progress(pWorker, (eiUint)(new_progress - progress));
+			progress = new_progress;
+		}
+	}
+
+	eiCHECK_FREE(queue);
+
+	ei_debug("Bucket %d finished variance-driven sampling after %d rounds, %d pixels not converged%s.\n", 
+		job->bucket_id, 
+		num_rounds, 
+		num_active, 
+		out_of_time ? " (time limit exceeded)" : "");
+
+	return eiTRUE;
+}
+
+/* get the number of scalar channels of a sample, including 
+   color, opacity and all user outputs, and mark the integer 
+   channels if round_channels is not NULL. */
+static eiInt ei_recon_samples_count_channels(eiBucket *bucket, eiBool *round_channels)
+{
+	eiIntptr	numFrameBuffers;
+	eiIntptr	i;
+	eiInt		num_channels;
+
+	/* color and opacity */
+	num_channels = 6;
+
+	numFrameBuffers = ei_array_size(&bucket->frameBufferCaches);
+
+	for (i = 0; i < numFrameBuffers; ++i)
+	{
+		eiFrameBufferCache	*fb_cache;
+
+		fb_cache = (eiFrameBufferCache *)ei_array_get(&bucket->frameBufferCaches, i);
+
+		switch (ei_framebuffer_cache_get_type(fb_cache))
+		{
+		case EI_DATA_TYPE_INT:
+			if (round_channels != NULL)
+			{
+				round_channels[num_channels] = eiTRUE;
+			}
+			num_channels += 1;
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			num_channels += 1;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			num_channels += 3;
+			break;
+		default:
+			/* error */
+			break;
+		}
+	}
+
+	return num_channels;
+}
+
+/* scatter the outputs of a sample into channel arrays. */
+static eiFORCEINLINE void ei_recon_samples_store(
+	eiBucket *bucket, 
+	eiReconSamples *recon, 
+	const eiInt k, 
+	eiSampleInfo *info)
+{
+	eiIntptr	numFrameBuffers;
+	eiIntptr	i;
+	eiScalar	*ch;
+	eiInt		n;
+
+	n = recon->num_samples;
+	ch = recon->channels + k;
+
+	recon->x[k] = info->x;
+	recon->y[k] = info->y;
+	recon->weight[k] = MAX(0.0f, info->weight);
+
+	ch[0] = info->color.r;
+	ch[n] = info->color.g;
+	ch[2 * n] = info->color.b;
+	ch[3 * n] = info->opacity.r;
+	ch[4 * n] = info->opacity.g;
+	ch[5 * n] = info->opacity.b;
+	ch += 6 * n;
+
+	numFrameBuffers = ei_array_size(&bucket->frameBufferCaches);
+
+	for (i = 0; i < numFrameBuffers; ++i)
+	{
+		eiFrameBufferCache	*fb_cache;
+		eiByte				*data;
+
+		fb_cache = (eiFrameBufferCache *)ei_array_get(&bucket->frameBufferCaches, i);
+
+		data = (eiByte *)info + ei_framebuffer_cache_get_data_offset(fb_cache);
+
+		switch (ei_framebuffer_cache_get_type(fb_cache))
+		{
+		case EI_DATA_TYPE_INT:
+			ch[0] = (eiScalar)(*((eiInt *)data));
+			ch += n;
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			ch[0] = *((eiScalar *)data);
+			ch += n;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			ch[0] = ((eiVector *)data)->x;
+			ch[n] = ((eiVector *)data)->y;
+			ch[2 * n] = ((eiVector *)data)->z;
+			ch += 3 * n;
+			break;
+		default:
+			/* error */
+			break;
+		}
+	}
+}
+
+/* gather the filtered channels back into a sample info. */
+static eiFORCEINLINE void ei_recon_samples_load(
+	eiBucket *bucket, 
+	eiReconSamples *recon, 
+	eiSampleInfo *info, 
+	const eiScalar *sums, 
+	const eiScalar inv_sum_weight)
+{
+	eiIntptr	numFrameBuffers;
+	eiIntptr	i;
+
+	setv(&info->color, sums[0] * inv_sum_weight, sums[1] * inv_sum_weight, sums[2] * inv_sum_weight);
+	setv(&info->opacity, sums[3] * inv_sum_weight, sums[4] * inv_sum_weight, sums[5] * inv_sum_weight);
+	sums += 6;
+
+	numFrameBuffers = ei_array_size(&bucket->frameBufferCaches);
+
+	for (i = 0; i < numFrameBuffers; ++i)
+	{
+		eiFrameBufferCache	*fb_cache;
+		eiByte				*data;
+
+		fb_cache = (eiFrameBufferCache *)ei_array_get(&bucket->frameBufferCaches, i);
+
+		data = (eiByte *)info + ei_framebuffer_cache_get_data_offset(fb_cache);
+
+		switch (ei_framebuffer_cache_get_type(fb_cache))
+		{
+		case EI_DATA_TYPE_INT:
+			*((eiInt *)data) = roundf(sums[0] * inv_sum_weight);
+			sums += 1;
+			break;
+		case EI_DATA_TYPE_SCALAR:
+			*((eiScalar *)data) = sums[0] * inv_sum_weight;
+			sums += 1;
+			break;
+		case EI_DATA_TYPE_VECTOR:
+			setv((eiVector *)data, sums[0] * inv_sum_weight, sums[1] * inv_sum_weight, sums[2] * inv_sum_weight);
+			sums += 3;
+			break;
+		default:
+			/* error */
+			break;
+		}
+	}
+}
+
+/* flatten the linked sample lists of all pixels into 
+   structure-of-arrays, must be called after super-sampling 
+   and before reconstruction. */
+static void ei_recon_samples_build(eiBucket *bucket, eiReconSamples *recon)
+{
+	eiInt		num_pixels;
+	eiInt		num_samples;
+	eiInt		row_samples;
+	eiInt		i, j, k;
+
+	recon->num_pixels_x = ei_buffer_get_width(&bucket->pixelBuffer);
+	recon->num_pixels_y = ei_buffer_get_height(&bucket->pixelBuffer);
+	num_pixels = recon->num_pixels_x * recon->num_pixels_y;
+
+	recon->pixel_offsets = (eiInt *)ei_allocate(sizeof(eiInt) * (num_pixels + 1));
+
+	/* count samples and compute the offsets of pixels */
+	num_samples = 0;
+	recon->max_row_samples = 0;
+
+	for (j = 0; j < recon->num_pixels_y; ++j)
+	{
+		row_samples = num_samples;
+
+		for (i = 0; i < recon->num_pixels_x; ++i)
+		{
+			ei_slist	*sample_list;
+
+			sample_list = &(((eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, i, j))->sample_list);
+
+			recon->pixel_offsets[i + j * recon->num_pixels_x] = num_samples;
+			num_samples += (eiInt)ei_slist_size(sample_list);
+		}
+
+		recon->max_row_samples = MAX(recon->max_row_samples, num_samples - row_samples);
+	}
+
+	recon->pixel_offsets[num_pixels] = num_samples;
+	recon->num_samples = num_samples;
+	recon->num_channels = ei_recon_samples_count_channels(bucket, NULL);
+
+	recon->x = (eiInt *)ei_allocate(sizeof(eiInt) * MAX(1, num_samples));
+	recon->y = (eiInt *)ei_allocate(sizeof(eiInt) * MAX(1, num_samples));
+	recon->weight = (eiScalar *)ei_allocate(sizeof(eiScalar) * MAX(1, num_samples));
+	recon->channels = (eiScalar *)ei_allocate(sizeof(eiScalar) * MAX(1, num_samples) * recon->num_channels);
+	recon->filter_weights = (eiScalar *)ei_allocate(sizeof(eiScalar) * MAX(1, recon->max_row_samples));
+	recon->sums = (eiScalar *)ei_allocate(sizeof(eiScalar) * recon->num_channels);
+	recon->round_channels = (eiBool *)ei_allocate(sizeof(eiBool) * recon->num_channels);
+
+	for (i = 0; i < recon->num_channels; ++i)
+	{
+		recon->round_channels[i] = eiFALSE;
+	}
+	ei_recon_samples_count_channels(bucket, recon->round_channels);
+
+	/* scatter samples into arrays */
+	k = 0;
+
+	for (j = 0; j < recon->num_pixels_y; ++j)
+	{
+		for (i = 0; i < recon->num_pixels_x; ++i)
+		{
+			ei_slist		*sample_list;
 			eiSampleInfo	*info;
 
 			sample_list = &(((eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, i, j))->sample_list);
@@ -1119,41 +1820,164 @@ static void contribute(eiBucket *bucket, const eiInt px, const eiInt py)
 				info != (eiSampleInfo *)ei_slist_end(sample_list); 
 				info = (eiSampleInfo *)info->node.next)
 			{
-				memcpy(factor, info, sizeof(eiSampleInfo) + bucket->job->user_output_size);
+				ei_recon_samples_store(bucket, recon, k, info);
+				++ k;
+			}
+		}
+	}
+}
 
-				weight = ei_filter_table_get_weight(&par->filterTable, abs(info->x - lx), abs(info->y - ly));
-				weight *= MAX(0.0f, info->weight);
+/* the samples of each row of pixels in the filter footprint 
+   are contiguous, so we compute the filter weights of a row 
+   first, then accumulate each channel as a dot product over 
+   a contiguous array which the compiler can vectorize. */
+eiScalar ei_recon_samples_filter(
+	eiReconSamples *recon, 
+	eiFilterTable *tab, 
+	const eiInt xmin, const eiInt xmax, 
+	const eiInt ymin, const eiInt ymax, 
+	const eiInt lx, const eiInt ly)
+{
+	eiScalar	sum_weight;
+	eiInt		c, j, k;
+
+	sum_weight = 0.0f;
+
+	for (c = 0; c < recon->num_channels; ++c)
+	{
+		recon->sums[c] = 0.0f;
+	}
+
+	for (j = ymin; j <= ymax; ++j)
+	{
+		eiInt		first, count;
+		eiScalar	*w;
+
+		first = recon->pixel_offsets[xmin + j * recon->num_pixels_x];
+		count = recon->pixel_offsets[xmax + 1 + j * recon->num_pixels_x] - first;
+		w = recon->filter_weights;
+
+		for (k = 0; k < count; ++k)
+		{
+			w[k] = ei_filter_table_get_weight(tab, 
+				abs(recon->x[first + k] - lx), abs(recon->y[first + k] - ly)) * recon->weight[first + k];
+			sum_weight += w[k];
+		}
+
+		for (c = 0; c < recon->num_channels; ++c)
+		{
+			const eiScalar	*ch;
+			eiScalar		sum;
 
-				ei_sample_info_mul(bucket, factor, weight);
-				sum_weight += weight;
+			ch = recon->channels + c * recon->num_samples + first;
+			sum = 0.0f;
 
-				ei_sample_info_add(bucket, total, factor);
+			if (recon->round_channels[c])
+			{
+				/* integer outputs are rounded after weighting 
+				   each sample, as ei_sample_info_mul does */
+				for (k = 0; k < count; ++k)
+				{
+					sum += roundf(w[k] * ch[k]);
+				}
+			}
+			else
+			{
+				for (k = 0; k < count; ++k)
+				{
+					sum += w[k] * ch[k];
+				}
 			}
+
+			recon->sums[c] += sum;
 		}
 	}
 
-	ei_sample_info_mul(bucket, total, 1.0f / sum_weight);	/* cost of a division. */
+	return sum_weight;
+}
+
+/* reconstruct a specified pixel and write to frame buffer. */
+static void contribute(eiBucket *bucket, const eiInt px, const eiInt py)
+{
+	eiRenderParams	*par;
+	eiReconSamples	*recon;
+	eiSampleInfo	*total;
+	eiScalar		x, y, filter_radius;
+	eiInt			xmin, xmax, ymin, ymax;
+	eiInt			lx, ly;
+	eiScalar		sum_weight;
+
+	par = &bucket->par;
+	recon = &bucket->reconSamples;
+
+	total = create_sample_info(bucket);
+
+	x = ((eiScalar)px + 0.5f) * par->inv_num_spans + (eiScalar)par->sample_filter_radius;
+	y = ((eiScalar)py + 0.5f) * par->inv_num_spans + (eiScalar)par->sample_filter_radius;
+
+	filter_radius = bucket->base.opt->filter_size * 0.5f * par->inv_num_spans;
+
+	xmin = lfloorf(x - filter_radius);
+	xmax = lceilf(x + filter_radius);
+	ymin = lfloorf(y - filter_radius);
+	ymax = lceilf(y + filter_radius);
+
+	clampi(xmin, 0, recon->num_pixels_x - 1);
+	clampi(xmax, 0, recon->num_pixels_x - 1);
+	clampi(ymin, 0, recon->num_pixels_y - 1);
+	clampi(ymax, 0, recon->num_pixels_y - 1);
+
+	lx = (eiInt)(x * (eiScalar)par->num_subpixels);
+	ly = (eiInt)(y * (eiScalar)par->num_subpixels);
+
+	sum_weight = ei_recon_samples_filter(recon, &par->filterTable, 
+		xmin, xmax, ymin, ymax, lx, ly);
+
+	ei_recon_samples_load(bucket, recon, total, recon->sums, 1.0f / sum_weight);	/* cost of a division. */
 
 	/* compute sampling rate for diagnostics */
 	if (bucket->base.opt->diagnostic_mode == EI_DIAGNOSTIC_MODE_SAMPLING_RATE)
 	{
 		eiScalar	sampling_rate;
+		eiInt		pixel_index;
+
+		pixel_index = (eiInt)x + (eiInt)y * recon->num_pixels_x;
 
-		sample_list = &(((eiPixelInfo *)ei_buffer_getptr(&bucket->pixelBuffer, (eiInt)x, (eiInt)y))->sample_list);
-		sampling_rate = (eiScalar)(ei_slist_size(sample_list) - 1) * par->inv_num_subpixels;
+		if (bucket->base.opt->sampling_mode == EI_SAMPLING_MODE_VARIANCE)
+		{
+			/* samples per pixel relative to the maximum */
+			sampling_rate = (eiScalar)(recon->pixel_offsets[pixel_index + 1] - recon->pixel_offsets[pixel_index]) / (eiScalar)par->max_spp;
+		}
+		else
+		{
+			sampling_rate = (eiScalar)(recon->pixel_offsets[pixel_index + 1] - recon->pixel_offsets[pixel_index] - 1) * par->inv_num_subpixels;
+		}
 		clampi(sampling_rate, 0.0f, 1.0f);
 		setvf(&total->color, sampling_rate);
 	}
 
+	if (bucket->job->sampleCountFrameBuffer != eiNULL_TAG)
+	{
+		eiInt	pixel_index;
+
+		/* the samples of a pixel of the sample grid spread over 
+		   all the pixels it spans */
+		pixel_index = (eiInt)x + (eiInt)y * recon->num_pixels_x;
+
+		accumulate_sample(bucket, px, py, total, 
+			(eiScalar)(recon->pixel_offsets[pixel_index + 1] - recon->pixel_offsets[pixel_index]) * 
+			par->inv_num_spans * par->inv_num_spans);
+	}
+
 	write_sample(bucket, px, py, total);
 
 	delete_sample_info(bucket, total);
-	delete_sample_info(bucket, factor);
 }
 
 static void ei_bucket_run_frame(
 	eiBucket *bucket, eiBucketJob *job, eiDatabase *db, eiBaseWorker *pWorker)
 {
+	eiOptions		*opt;
 	eiRenderParams	*par;
 	eiInt			recon_width;
 	eiInt			recon_height;
@@ -1164,6 +1988,7 @@ static void ei_bucket_run_frame(
 	eiInt			i, j;
 
 	/* initialize some parameters */
+	opt = bucket->base.opt;
 	par = &bucket->par;
 	recon_width = lceilf((eiScalar)bucket->rect_width  * par->inv_num_spans);
 	recon_height = lceilf((eiScalar)bucket->rect_height * par->inv_num_spans);
@@ -1175,46 +2000,70 @@ static void ei_bucket_run_frame(
 	bucket->local_to_screen_x = (eiScalar)job->rect.left - (eiScalar)par->sample_filter_radius * par->num_spans;
 	bucket->local_to_screen_y = (eiScalar)job->rect.top - (eiScalar)par->sample_filter_radius * par->num_spans;
 
-	/* sampleBuffer is used to prevent from sampling repeatedly at the same point */
-	ei_buffer_allocate(&bucket->sampleBuffer, pb_width + 1, pb_height + 1);
-	ei_buffer_zero_memory(&bucket->sampleBuffer);
+	if (opt->sampling_mode == EI_SAMPLING_MODE_VARIANCE)
+	{
+		/* reserve the arena for the samples of the initial pass, 
+		   plus a few temporaries */
+		ei_arena_reserve(&bucket->samplerTls->sampleArena, 
+			ei_arena_aligned_size(bucket->sampleSize) * ((sample_width + 1) * (sample_height + 1) * par->min_spp + EI_SAMPLES_PER_BANK / 64));
 
-	ei_buffer_allocate(&bucket->pixelBuffer, sample_width + 1, sample_height + 1);
+		ei_buffer_allocate(&bucket->pixelBuffer, sample_width + 1, sample_height + 1);
 
-	/* do basic sampling */
-	for (j = 0; j <= pb_height; j += par->num_subpixels)
-	{
-		if (!ei_base_worker_is_running(pWorker))
+		if (!variance_sampling(bucket, job, pWorker, sample_width, sample_height))
 		{
 			return;
 		}
+	}
+	else
+	{
+		/* reserve the arena for the maximum number of samples 
+		   on the lattice, plus a few temporaries */
+		ei_arena_reserve(&bucket->samplerTls->sampleArena, 
+			ei_arena_aligned_size(bucket->sampleSize) * ((pb_width + 1) * (pb_height + 1) + EI_SAMPLES_PER_BANK / 64));
+
+		/* sampleBuffer is used to prevent from sampling repeatedly at the same point */
+		ei_buffer_allocate(&bucket->sampleBuffer, pb_width + 1, pb_height + 1);
+		ei_buffer_zero_memory(&bucket->sampleBuffer);
 
-		for (i = 0; i <= pb_width; i += par->num_subpixels)
+		ei_buffer_allocate(&bucket->pixelBuffer, sample_width + 1, sample_height + 1);
+
+		/* do basic sampling */
+		for (j = 0; j <= pb_height; j += par->num_subpixels)
 		{
-			set_raster_pos(bucket, i, j);
+			if (!ei_base_worker_is_running(pWorker))
+			{
+				return;
+			}
 
-			sample(bucket, 0, 0, par->min_depth, NULL, NULL, NULL, NULL, 0.0f);
-		}
+			for (i = 0; i <= pb_width; i += par->num_subpixels)
+			{
+				set_raster_pos(bucket, i, j);
 
-		ei_base_worker_step_progress(pWorker, bucket->rect_width / 3);
-	}
+				sample(bucket, 0, 0, par->min_depth, NULL, NULL, NULL, NULL, 0.0f);
+			}
 
-	/* do super-sampling for anti-aliasing */
-	for (j = 0; j < sample_height; ++j)
-	{
-		if (!ei_base_worker_is_running(pWorker))
-		{
-			return;
+			ei_base_worker_step_progress(pWorker, bucket->rect_width / 3);
 		}
 
-		for (i = 0; i < sample_width; ++i)
+		/* do super-sampling for anti-aliasing */
+		for (j = 0; j < sample_height; ++j)
 		{
-			supersample(bucket, i, j);
-		}
+			if (!ei_base_worker_is_running(pWorker))
+			{
+				return;
+			}
 
-		ei_base_worker_step_progress(pWorker, bucket->rect_width / 3);
+			for (i = 0; i < sample_width; ++i)
+			{
+				supersample(bucket, i, j);
+			}
+
+			ei_base_worker_step_progress(pWorker, bucket->rect_width / 3);
+		}
 	}
 
+	ei_recon_samples_build(bucket, &bucket->reconSamples);
+
 	/* create a block of image from the buffer with filtering */
 	for (j = 0; j < bucket->rect_height; ++j)
 	{
@@ -1346,6 +2195,7 @@ void byteswap_job_bucket(eiDatabase *db, void *job, const eiUint size)
 	ei_byteswap_int(&pJob->cam);
 	ei_byteswap_int(&pJob->colorFrameBuffer);
 	ei_byteswap_int(&pJob->opacityFrameBuffer);
+	ei_byteswap_int(&pJob->sampleCountFrameBuffer);
 	ei_byteswap_int(&pJob->frameBuffers);
 	ei_byteswap_int(&pJob->lightInstances);
 	ei_byteswap_int(&pJob->causticMap);
@@ -1355,16 +2205,25 @@ void byteswap_job_bucket(eiDatabase *db, void *job, const eiUint size)
 	ei_byteswap_scalar(&pJob->point_spacing);
 	ei_byteswap_int(&pJob->passIrradBuffer);
 	ei_byteswap_int(&pJob->bucket_id);
+	ei_byteswap_int(&pJob->min_samples);
+	ei_byteswap_int(&pJob->max_samples);
+	ei_byteswap_int(&pJob->progressive_pass);
+	ei_byteswap_scalar(&pJob->accum_weight);
 }
 
 eiBool execute_job_bucket(eiDatabase *db, eiBaseWorker *pWorker, void *job, void *param)
 {
 	eiBucketJob		*pJob;
 	eiBucket		bucket;
+	eiBool			result;
 	
 	pJob = (eiBucketJob *)job;
 
-	return ei_bucket_run(&bucket, pJob, db, pWorker);
+	ei_pin_cache_begin_job(db);
+	result = ei_bucket_run(&bucket, pJob, db, pWorker);
+	ei_pin_cache_end_job(db);
+
+	return result;
 }
 
 eiUint count_job_bucket(eiDatabase *db, void *job)
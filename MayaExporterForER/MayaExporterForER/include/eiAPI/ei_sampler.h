@@ -28,7 +28,7 @@
 #include <eiCORE/ei_rect.h>
 #include <eiCORE/ei_slist.h>
 #include <eiCORE/ei_array.h>
-#include <eiCORE/ei_fixed_pool.h>
+#include <eiCORE/ei_arena.h>
 #include <eiAPI/ei_buffer.h>
 #include <eiAPI/ei_nodesys.h>
 #include <eiAPI/ei_base_bucket.h>
@@ -59,6 +59,13 @@ typedef struct eiFilterTable {
 	eiInt			num_subpixels;
 } eiFilterTable;
 
+/** \brief Precompute the filter table. for internal use only. */
+eiAPI void ei_filter_table_init(
+	eiFilterTable *tab, 
+	const eiInt num_subpixels, const eiScalar filter_rad, const eiInt filter);
+/** \brief Cleanup the filter table. for internal use only. */
+eiAPI void ei_filter_table_exit(eiFilterTable *tab);
+
 /** \brief Precomputed parameters so that we don't 
  * recompute them during rendering. */
 typedef struct eiRenderParams {
@@ -76,6 +83,9 @@ typedef struct eiRenderParams {
 	eiInt						bound_max_depth;
 	eiInt						num_subpixels;
 	eiInt						sample_filter_radius;
+	/* sample counts of variance-driven sampling */
+	eiInt						min_spp;
+	eiInt						max_spp;
 	/* photon mapping parameters */
 	eiScalar					caustic_radius;
 	eiScalar					globillum_radius;
@@ -106,6 +116,9 @@ typedef struct eiBucketJob {
 	eiTag			cam;
 	eiTag			colorFrameBuffer;
 	eiTag			opacityFrameBuffer;
+	/* the samples per pixel accumulated by progressive passes, 
+	   eiNULL_TAG without progressive rendering */
+	eiTag			sampleCountFrameBuffer;
 	/* the data array of frame buffer tags */
 	eiTag			frameBuffers;
 	/* the data table of light instances */
@@ -123,8 +136,98 @@ typedef struct eiBucketJob {
 	eiTag			passIrradBuffer;
 	/* the bucket identifier */
 	eiInt			bucket_id;
+	/* the sample rate of this pass, which may be lower than 
+	   the options during progressive rendering */
+	eiInt			min_samples;
+	eiInt			max_samples;
+	/* the index of progressive pass, which scrambles samples so 
+	   that successive passes take different samples */
+	eiInt			progressive_pass;
+	/* the nominal samples per pixel accumulated by previous 
+	   passes in the frame buffers, 0 if there is nothing to 
+	   accumulate, pixels are blended by their own sample counts */
+	eiScalar		accum_weight;
 } eiBucketJob;
 
+/** \brief Thread local storage of the sampler. the sample 
+ * arena lives across buckets, so after the first few buckets 
+ * sample allocation never reaches the system allocator. */
+typedef struct eiSamplerTLS {
+	ei_arena		sampleArena;
+	/* the number of sample infos handed out */
+	eiInt64			num_samples_created;
+	/* the number of banks the sample pool of each bucket 
+	   would have allocated before samples used the arena */
+	eiInt64			num_pool_banks;
+	/* the number of buckets rendered by this thread */
+	eiInt			num_buckets;
+} eiSamplerTLS;
+
+/** \brief Running statistics of sample colors for variance-driven 
+ * sampling. */
+typedef struct eiSampleStats {
+	eiInt			num_samples;
+	eiVector		mean;
+	eiVector		m2;
+} eiSampleStats;
+
+/** \brief Initialize the statistics. for internal use only. */
+eiAPI void ei_sample_stats_init(eiSampleStats *stats);
+/** \brief Add a sample color to the statistics. for internal use only. */
+eiAPI void ei_sample_stats_add(eiSampleStats *stats, const eiVector *color);
+/** \brief The estimated standard error of the mean color, eiMAX_SCALAR 
+ * with less than 2 samples. for internal use only. */
+eiAPI eiScalar ei_sample_stats_error(const eiSampleStats *stats);
+
+/** \brief Initialize thread local storage. for internal use only. */
+eiAPI void ei_sampler_tls_init(eiSamplerTLS *pTls);
+
+/** \brief Cleanup thread local storage. for internal use only. */
+eiAPI void ei_sampler_tls_exit(eiSamplerTLS *pTls);
+
+/** \brief The samples of a bucket stored in structure-of-arrays 
+ * layout for fast reconstruction. samples are sorted by the pixel 
+ * they belong to, so the samples of a row of pixels in the filter 
+ * footprint are contiguous in memory. */
+typedef struct eiReconSamples {
+	/* the index of the first sample of each pixel, 
+	   contains num_pixels + 1 entries */
+	eiInt			*pixel_offsets;
+	/* the location of referenced sub-pixel */
+	eiInt			*x;
+	eiInt			*y;
+	eiScalar		*weight;
+	/* num_channels contiguous arrays of num_samples scalars, 
+	   color and opacity come first, then user outputs */
+	eiScalar		*channels;
+	/* non-zero for integer channels, whose weighted samples 
+	   are rounded one by one before they are summed */
+	eiBool			*round_channels;
+	/* scratch memory for filter weights and accumulation */
+	eiScalar		*filter_weights;
+	eiScalar		*sums;
+	eiInt			num_pixels_x;
+	eiInt			num_pixels_y;
+	eiInt			num_samples;
+	eiInt			num_channels;
+	eiInt			max_row_samples;
+} eiReconSamples;
+
+/** \brief Initialize the samples for reconstruction. for internal use only. */
+eiAPI void ei_recon_samples_init(eiReconSamples *recon);
+/** \brief Free the arrays of the samples. for internal use only. */
+eiAPI void ei_recon_samples_exit(eiReconSamples *recon);
+/** \brief Filter the samples of the pixels from (xmin, ymin) to 
+ * (xmax, ymax) centered at sub-pixel (lx, ly), the weighted sums of 
+ * channels are written to recon->sums, returns the sum of weights. 
+ * for internal use only. */
+eiAPI eiScalar ei_recon_samples_filter(
+	eiReconSamples *recon, 
+	eiFilterTable *tab, 
+	const eiInt xmin, const eiInt xmax, 
+	const eiInt ymin, const eiInt ymax, 
+	const eiInt lx, const eiInt ly);
+
 /** \brief The working memory of bucket rendering. */
 typedef struct eiBucket {
 	eiBaseBucket			base;
@@ -141,11 +244,19 @@ typedef struct eiBucket {
 	eiBuffer				pixelBuffer;
 	eiFrameBufferCache		colorFrameBufferCache;
 	eiFrameBufferCache		opacityFrameBufferCache;
+	eiFrameBufferCache		sampleCountFrameBufferCache;
 	/* the array of eiFrameBufferCache */
 	ei_array				frameBufferCaches;
 	eiBucketJob				*job;
 	eiRenderParams			par;
-	ei_fixed_pool			samplePool;
+	/* the sampler TLS of current thread */
+	eiSamplerTLS			*samplerTls;
+	/* the size of eiSampleInfo including user outputs */
+	eiUint					sampleSize;
+	/* the list of deleted eiSampleInfo for reuse */
+	ei_slist_node			*freeSamples;
+	/* the samples prepared for reconstruction */
+	eiReconSamples			reconSamples;
 } eiBucket;
 
 eiSampleInfo *create_sample_info(eiBucket *bucket);
@@ -111,7 +111,7 @@ static eiInt schedule_job(const eiTag job, void *param)
 	return ei_master_add_job(master, job);
 }
 
-void ei_scene_update_instances(
+static void ei_scene_update_instances_imp(
 	eiMaster *master, 
 	eiConnection *con, 
 	eiNodeSystem *nodesys, 
@@ -122,7 +122,8 @@ void ei_scene_update_instances(
 	const eiAttributes *attr, 
 	const eiMatrix *transform, 
 	const eiMatrix *motion_transform, 
-	eiNode *instancer)
+	eiNode *instancer, 
+	const eiBool local_dice)
 {
 	eiInstgroup			*root_instgrp;
 	eiElement			*element;
@@ -131,6 +132,7 @@ void ei_scene_update_instances(
 
 	/* initialize the object representation cache */
 	ei_object_rep_cache_init(&cache, nodesys->m_db, cam_tag, light_insts);
+	cache.local_dice = local_dice;
 
 	root_instgrp = (eiInstgroup *)ei_db_access(nodesys->m_db, root_instgrp_tag);
 
@@ -175,8 +177,10 @@ void ei_scene_update_instances(
 		ei_master_set_process(master, &process.base);
 
 		/* we are updating the root scene, use multi-threaded job processing. 
-		   we don't need to flush dirty data to other hosts since currently 
-		   we don't distribute tessellation jobs to remote hosts. */
+		   splitting results are pushed into the local job queues, so splitting 
+		   jobs are not sent to remote hosts. when local dicing is enabled, 
+		   the leaves are not diced here, every host generates their 
+		   tessellations on demand from the deferred dicing jobs. */
 		ei_master_run_process(master, eiTRUE);
 
 		/* cleanup splitting process. */
@@ -201,3 +205,59 @@ void ei_scene_update_instances(
 	/* cleanup the object representation cache */
 	ei_object_rep_cache_exit(&cache, nodesys->m_db);
 }
+
+void ei_scene_update_instances(
+	eiMaster *master, 
+	eiConnection *con, 
+	eiNodeSystem *nodesys, 
+	const eiTag cam_tag, 
+	const eiTag scene_tag, 
+	const eiTag light_insts, 
+	const eiTag root_instgrp_tag, 
+	const eiAttributes *attr, 
+	const eiMatrix *transform, 
+	const eiMatrix *motion_transform, 
+	eiNode *instancer)
+{
+	ei_scene_update_instances_imp(
+		master, 
+		con, 
+		nodesys, 
+		cam_tag, 
+		scene_tag, 
+		light_insts, 
+		root_instgrp_tag, 
+		attr, 
+		transform, 
+		motion_transform, 
+		instancer, 
+		eiFALSE);
+}
+
+void ei_scene_update_distributed_instances(
+	eiMaster *master, 
+	eiConnection *con, 
+	eiNodeSystem *nodesys, 
+	const eiTag cam_tag, 
+	const eiTag scene_tag, 
+	const eiTag light_insts, 
+	const eiTag root_instgrp_tag, 
+	const eiAttributes *attr, 
+	const eiMatrix *transform, 
+	const eiMatrix *motion_transform, 
+	eiNode *instancer)
+{
+	ei_scene_update_instances_imp(
+		master, 
+		con, 
+		nodesys, 
+		cam_tag, 
+		scene_tag, 
+		light_insts, 
+		root_instgrp_tag, 
+		attr, 
+		transform, 
+		motion_transform, 
+		instancer, 
+		eiTRUE);
+}
@@ -54,6 +54,25 @@ eiAPI void ei_scene_update_instances(
 	const eiMatrix *transform, 
 	const eiMatrix *motion_transform, 
 	eiNode *instancer);
+/** \brief Update the instances of a scene rendered with remote hosts, 
+ * the master only splits the objects, the dicing of the split 
+ * sub-objects is deferred so that every host generates the 
+ * tessellations it needs locally. polygon objects are diced by 
+ * each host, hair objects are not diced but each host builds their 
+ * BSP-trees and packets itself. disc and procedural objects create 
+ * no tessellations in update_instance, so they are not affected. */
+eiAPI void ei_scene_update_distributed_instances(
+	eiMaster *master, 
+	eiConnection *con, 
+	eiNodeSystem *nodesys, 
+	const eiTag cam_tag, 
+	const eiTag scene_tag, 
+	const eiTag light_insts, 
+	const eiTag root_instgrp_tag, 
+	const eiAttributes *attr, 
+	const eiMatrix *transform, 
+	const eiMatrix *motion_transform, 
+	eiNode *instancer);
 
 #ifdef __cplusplus
 }
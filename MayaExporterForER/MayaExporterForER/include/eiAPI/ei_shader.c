@@ -21,6 +21,7 @@
 #include <eiAPI/ei_material.h>
 #include <eiAPI/ei_texture.h>
 #include <eiAPI/ei_sampler.h>
+#include <eiAPI/ei_pin_cache.h>
 #include <eiCORE/ei_qmc.h>
 #include <eiCORE/ei_random.h>
 #include <eiCORE/ei_data_array.h>
@@ -37,6 +38,7 @@ void ei_shader_init(eiShader *shader)
 	shader->main = NULL;
 	shader->size = 0;
 	shader->state = NULL;
+	shader->main_batch = NULL;
 }
 
 void ei_shader_exit(eiShader *shader)
@@ -100,6 +102,27 @@ void *ei_call_xy(eiState *state, const eiIndex param_index, eiByte * const dXdx,
 	return ei_eval_imp(state, param_index, eiFALSE, dXdx, dXdy);
 }
 
+/* an independently scrambled Sobol point set for the trajectory 
+   of current state, used instead of offset Halton point sets */
+static void sample_sobol_set(
+	eiState * const state, 
+	eiGeoScalar *samples, 
+	const eiUint i, 
+	const eiUint dimension)
+{
+	eiUint	seed;
+	eiUint	dim;
+
+	seed = ei_qmc_hash_combine(
+		ei_qmc_hash_combine(state->qmc_seed, state->instance_number), 
+		state->temp_dimension);
+
+	for (dim = 0; dim < dimension; ++dim)
+	{
+		samples[dim] = ei_sobol(dim, i, seed);
+	}
+}
+
 eiBool ei_sample(
 	eiState * const state, 
 	eiGeoScalar *samples, 
@@ -122,7 +145,7 @@ eiBool ei_sample(
 			/* single sample */
 			for (dim = 0; dim < dimension; ++dim)
 			{
-				samples[dim] = ei_sigma(state->dimension + dim, state->instance_number);
+				samples[dim] = ei_state_sigma(state, state->dimension + dim, state->instance_number);
 			}
 			state->dimension += dimension;
 
@@ -141,16 +164,23 @@ eiBool ei_sample(
 				state->dimension += dimension;
 			}
 
-			/* compute the offset vector */
-			for (dim = 0; dim < dimension; ++dim)
+			if (state->opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
 			{
-				samples[dim] = ei_sigma(state->temp_dimension + dim, state->instance_number);
+				sample_sobol_set(state, samples, *instance_number, dimension);
 			}
-
-			/* a Halton point set is used here for adaptive sampling */
-			for (dim = 0; dim < dimension; ++dim)
+			else
 			{
-				samples[dim] = fmodf((eiScalar)samples[dim] + (eiScalar)ei_sigma(dim, *instance_number), 1.0f);
+				/* compute the offset vector */
+				for (dim = 0; dim < dimension; ++dim)
+				{
+					samples[dim] = ei_state_sigma(state, state->temp_dimension + dim, state->instance_number);
+				}
+
+				/* a Halton point set is used here for adaptive sampling */
+				for (dim = 0; dim < dimension; ++dim)
+				{
+					samples[dim] = fmodf((eiScalar)samples[dim] + (eiScalar)ei_sigma(dim % QMC_MAX_DIM, *instance_number), 1.0f);
+				}
 			}
 
 			++ *instance_number;
@@ -183,17 +213,25 @@ eiBool ei_sample(
 				return eiFALSE;
 			}
 
-			/* compute the offset vector */
-			for (dim = 0; dim < dimension; ++dim)
+			if (state->opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
 			{
-				samples[dim] = ei_sigma(state->temp_dimension + dim, state->instance_number);
+				/* the first 2^k Sobol points are stratified as well */
+				sample_sobol_set(state, samples, *instance_number, dimension);
 			}
-
-			/* a Hammersley point set is used here for better discrepancy */
-			samples[0] = fmodf((eiScalar)samples[0] + (eiScalar)(*instance_number) / (eiScalar)(*n), 1.0f);
-			for (dim = 1; dim < dimension; ++dim)
+			else
 			{
-				samples[dim] = fmodf((eiScalar)samples[dim] + (eiScalar)ei_sigma(dim - 1, *instance_number), 1.0f);
+				/* compute the offset vector */
+				for (dim = 0; dim < dimension; ++dim)
+				{
+					samples[dim] = ei_state_sigma(state, state->temp_dimension + dim, state->instance_number);
+				}
+
+				/* a Hammersley point set is used here for better discrepancy */
+				samples[0] = fmodf((eiScalar)samples[0] + (eiScalar)(*instance_number) / (eiScalar)(*n), 1.0f);
+				for (dim = 1; dim < dimension; ++dim)
+				{
+					samples[dim] = fmodf((eiScalar)samples[dim] + (eiScalar)ei_sigma((dim - 1) % QMC_MAX_DIM, *instance_number), 1.0f);
+				}
 			}
 
 			++ *instance_number;
@@ -268,7 +306,9 @@ eiBool ei_illuminance(
 		eiBool				accept_light;
 
 		light_inst = (eiLightInstance *)ei_data_table_read(light_insts_iter, state->current_light_index);
-		light = (eiLight *)ei_db_access(state->db, light_inst->light);
+		/* lights are accessed for every shading point, resolve 
+		   them through the pin cache of this thread */
+		light = (eiLight *)ei_pin_access(state->db, light_inst->light);
 
 		accept_light = eiTRUE;
 
@@ -318,8 +358,6 @@ eiBool ei_illuminance(
 
 		movv(&light_org, &light_inst->origin);
 
-		ei_db_end(state->db, light_inst->light);
-
 		if (accept_light)
 		{
 			sub(&light_dir, &light_org, &state->P);
@@ -375,13 +413,27 @@ eiBool ei_sample_light(eiState * const state)
 		state->db, 
 		EI_INTERFACE_TYPE_NODE_SYSTEM);
 
-	/* get an offset point from the global sequence for current dimension */
-	offset_x = (eiScalar)ei_sigma(state->dimension, state->instance_number);
-	offset_y = (eiScalar)ei_sigma(state->dimension + 1, state->instance_number);
+	if (state->opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+	{
+		eiUint	seed;
+
+		/* a Sobol point set scrambled for this shading point */
+		seed = ei_qmc_hash_combine(
+			ei_qmc_hash_combine(state->qmc_seed, state->instance_number), 
+			state->dimension);
+		u1 = (eiScalar)ei_sobol(0, state->current_area_sample, seed);
+		u2 = (eiScalar)ei_sobol(1, state->current_area_sample, seed);
+	}
+	else
+	{
+		/* get an offset point from the global sequence for current dimension */
+		offset_x = (eiScalar)ei_state_sigma(state, state->dimension, state->instance_number);
+		offset_y = (eiScalar)ei_state_sigma(state, state->dimension + 1, state->instance_number);
 
-	/* here we use a scrambled Halton sequence for adaptive sampling */
-	u1 = fmodf(offset_x + (eiScalar)ei_sigma(0, state->current_area_sample), 1.0f);
-	u2 = fmodf(offset_y + (eiScalar)ei_sigma(1, state->current_area_sample), 1.0f);
+		/* here we use a scrambled Halton sequence for adaptive sampling */
+		u1 = fmodf(offset_x + (eiScalar)ei_sigma(0, state->current_area_sample), 1.0f);
+		u2 = fmodf(offset_y + (eiScalar)ei_sigma(1, state->current_area_sample), 1.0f);
+	}
 
 	ei_state_init(&light_ray, eiRAY_LIGHT, state->bucket);
 
@@ -394,6 +446,7 @@ eiBool ei_sample_light(eiState * const state)
 	light_ray.Ng = state->Ng;
 	light_ray.dimension = state->dimension + 2;
 	light_ray.instance_number = state->instance_number + state->current_area_sample;
+	light_ray.qmc_seed = state->qmc_seed;
 	light_ray.u1 = u1;
 	light_ray.u2 = u2;
 	light_ray.time = state->time;
@@ -631,6 +684,7 @@ void ei_trace_eye(
 	eye_ray.result = color;
 	eye_ray.dimension = state->dimension;
 	eye_ray.instance_number = state->instance_number;
+	eye_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	normalizei(&ray_dir);
@@ -773,6 +827,7 @@ void ei_trace_shadow(
 	setv(&shadow_ray.Ol, 0.0f, 0.0f, 0.0f);
 	shadow_ray.dimension = state->dimension;
 	shadow_ray.instance_number = state->instance_number;
+	shadow_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	ray_len = normalize_with_len(&ray_dir);
@@ -936,6 +991,7 @@ void ei_trace_reflection(
 	initv(&refl_ray.result->opacity);
 	refl_ray.dimension = state->dimension;
 	refl_ray.instance_number = state->instance_number;
+	refl_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	normalizei(&ray_dir);
@@ -1020,6 +1076,7 @@ void ei_trace_transmission(
 	initv(&refr_ray.result->opacity);
 	refr_ray.dimension = state->dimension;
 	refr_ray.instance_number = state->instance_number;
+	refr_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	normalizei(&ray_dir);
@@ -1103,6 +1160,7 @@ void ei_trace_transparent(
 	initv(&trans_ray.result->opacity);
 	trans_ray.dimension = state->dimension;
 	trans_ray.instance_number = state->instance_number;
+	trans_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, &state->dir);
 	normalizei(&ray_dir);
@@ -1172,6 +1230,7 @@ void ei_trace_environment(
 	initv(&env_ray.result->opacity);
 	env_ray.dimension = state->dimension;
 	env_ray.instance_number = state->instance_number;
+	env_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	normalizei(&ray_dir);
@@ -1261,6 +1320,7 @@ eiBool ei_trace_probe(
 
 	probe_ray.dimension = state->dimension;
 	probe_ray.instance_number = state->instance_number;
+	probe_ray.qmc_seed = state->qmc_seed;
 
 	movv(&ray_dir, dir);
 	normalizei(&ray_dir);
@@ -1885,7 +1945,7 @@ eiScalar ei_blinn_pdf(
 {
 	eiBlinnParams	param;
 
-	param.exponent;
+	param.exponent = exponent;
 
 	return ei_blinn_microfacet_pdf(
 		wo, 
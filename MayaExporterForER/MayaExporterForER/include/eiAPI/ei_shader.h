@@ -66,6 +66,42 @@ typedef eiBool (*ei_shader_main_func)(
 	eiState * const state, 
 	void *arg);
 
+/** \brief A block of tessellated vertices to be displaced at once, 
+ * stored in structure-of-arrays layout. */
+typedef struct eiDisplaceBatch {
+	/* the number of vertices in this block */
+	eiUint			count;
+	/* the positions */
+	eiScalar		*Px;
+	eiScalar		*Py;
+	eiScalar		*Pz;
+	/* the interpolated normals, zeros if not available */
+	eiScalar		*Nx;
+	eiScalar		*Ny;
+	eiScalar		*Nz;
+	/* the motion vectors and the time intervals, the 
+	   motion positions will be P + dPdtime * dtime */
+	eiScalar		*dPdtimex;
+	eiScalar		*dPdtimey;
+	eiScalar		*dPdtimez;
+	eiScalar		*dtime;
+} eiDisplaceBatch;
+
+/** \brief The version of the binary layout of eiShader, shader 
+ * libraries built against another version must be rebuilt. 
+ * version 2 appends main_batch to eiShader. */
+#define EI_SHADER_ABI_VERSION		2
+
+/** \brief The optional batched main function of displacement 
+ * shaders, returns false if batched displacement is not 
+ * supported, then the vertices will be displaced one by one 
+ * by the main function. */
+typedef eiBool (*ei_shader_main_batch_func)(
+	eiShader *shader, 
+	eiDisplaceBatch * const batch, 
+	eiState * const state, 
+	void *arg);
+
 /** \brief The base class for all shader classes. */
 struct eiShader {
 	/* the base node object */
@@ -76,6 +112,9 @@ struct eiShader {
 	eiUint					size;
 	/* the pointer for holding current state */
 	eiState					*state;
+	/* the optional batched main function, NULL if the shader 
+	   does not override it, added in ABI version 2 */
+	ei_shader_main_batch_func	main_batch;
 };
 
 /** \brief Initialize the base shader. */
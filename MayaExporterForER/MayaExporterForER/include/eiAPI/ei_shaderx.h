@@ -25,6 +25,7 @@
 #include <eiAPI/ei.h>
 #include <eiAPI/ei_shaderx_util.h>
 #include <eiAPI/ei_noise.h>
+#include <eiAPI/ei_bsdf_batch.h>
 #include <eiCORE/ei_random.h>
 
 #define DECLARE_PARAM(param_type, param_name, default_value) \
@@ -188,6 +189,21 @@
 		return eiTRUE;\
 	}\
 	\
+	static eiBool name##_main_batch(\
+		eiShader *shader, \
+		eiDisplaceBatch * const batch, \
+		eiState * const state, \
+		void *arg)\
+	{\
+		name	*pShader;\
+		\
+		pShader = (name *)shader;\
+		\
+		pShader->set_state(state);\
+		\
+		return pShader->main_batch(batch);\
+	}\
+	\
 	static void name##_deletethis(eiPluginObject *object)\
 	{\
 		name	*pShader;\
@@ -242,6 +258,11 @@
 		\
 		((eiPluginObject *)shader)->deletethis = name##_deletethis;\
 		shader->main = name##_main;\
+		if (&name::main_batch != \
+			(eiBool (name::*)(eiDisplaceBatch * const))&base_shader::main_batch)\
+		{\
+			shader->main_batch = name##_main_batch;\
+		}\
 		shader->size = sizeof(name);\
 		\
 		return ((eiPluginObject *)shader);\
@@ -259,6 +280,15 @@ public:
 		base.state = state;
 	}
 
+	/* displacement shaders can hide this to displace a block of 
+	   vertices at once, the parameters are evaluated only once 
+	   for the whole block. return false to displace the vertices 
+	   one by one with main. */
+	inline eiBool main_batch(eiDisplaceBatch * const batch)
+	{
+		return eiFALSE;
+	}
+
 protected:
 	eiShader		base;
 
@@ -937,6 +967,7 @@ public:
 	Microfacet()
 	{
 		m_bsdf = NULL;
+		m_bsdf_batch = NULL;
 		m_sample_bsdf = NULL;
 		m_pdf = NULL;
 		m_param = NULL;
@@ -962,6 +993,8 @@ public:
 	}
 
 	eiMicrofacet_bsdf			m_bsdf;
+	/* the batched distribution, NULL if not available */
+	eiMicrofacet_bsdf_batch		m_bsdf_batch;
 	eiMicrofacet_sample_bsdf	m_sample_bsdf;
 	eiMicrofacet_pdf			m_pdf;
 	void						*m_param;
@@ -973,6 +1006,7 @@ public:
 	{
 		m_params.exponent = exponent;
 		m_bsdf = ei_blinn_microfacet_bsdf;
+		m_bsdf_batch = ei_blinn_microfacet_bsdf_batch;
 		m_sample_bsdf = ei_blinn_microfacet_sample_bsdf;
 		m_pdf = ei_blinn_microfacet_pdf;
 		m_param = &m_params;
@@ -993,6 +1027,7 @@ public:
 		m_params.shiny_u = shiny_u;
 		m_params.shiny_v = shiny_v;
 		m_bsdf = ei_ward_microfacet_bsdf;
+		m_bsdf_batch = ei_ward_microfacet_bsdf_batch;
 		m_sample_bsdf = ei_ward_microfacet_sample_bsdf;
 		m_pdf = ei_ward_microfacet_pdf;
 		m_param = &m_params;
@@ -1021,11 +1056,71 @@ eiAPI eiScalar ei_blinn_pdf(
 	const eiVector *wi, 
 	const eiScalar exponent);
 
+inline vector get_batch(const eiDirBatch & w, const eiInt i)
+{
+	return vector(w.x[i], w.y[i], w.z[i]);
+}
+
+inline void set_batch(eiDirBatch & w, const eiInt i, const vector & v)
+{
+	w.x[i] = v.x;
+	w.y[i] = v.y;
+	w.z[i] = v.z;
+}
+
+inline void set_batch(eiColorBatch & f, const eiInt i, const color & c)
+{
+	f.r[i] = c.r;
+	f.g[i] = c.g;
+	f.b[i] = c.b;
+}
+
+/** \brief Broadcast scalar results to all channels of a color batch. */
+inline void set_batch(eiColorBatch & f, const scalar *s, const eiInt n)
+{
+	for (eiInt i = 0; i < n; ++i)
+	{
+		f.r[i] = s[i];
+		f.g[i] = s[i];
+		f.b[i] = s[i];
+	}
+}
+
+/** \brief The batched functions process n <= EI_BSDF_BATCH_SIZE
+ * directions at once, the default implementations call the scalar
+ * functions for each lane, which remain the reference.
+ */
 class BSDF {
 public:
 	virtual color bsdf(const vector & wo, const vector & wi) = 0;
 	virtual eiBool sample_bsdf(const vector & wo, vector & wi, const scalar u1, const scalar u2) = 0;
 	virtual scalar pdf(const vector & wo, const vector & wi) = 0;
+
+	virtual void eval_batch(const eiDirBatch & wo, const eiDirBatch & wi, eiColorBatch & f, const eiInt n)
+	{
+		for (eiInt i = 0; i < n; ++i)
+		{
+			set_batch(f, i, bsdf(get_batch(wo, i), get_batch(wi, i)));
+		}
+	}
+
+	virtual void sample_batch(const eiDirBatch & wo, eiDirBatch & wi, const scalar *u1, const scalar *u2, eiBool *valid, const eiInt n)
+	{
+		for (eiInt i = 0; i < n; ++i)
+		{
+			vector	dir;
+			valid[i] = sample_bsdf(get_batch(wo, i), dir, u1[i], u2[i]);
+			set_batch(wi, i, dir);
+		}
+	}
+
+	virtual void pdf_batch(const eiDirBatch & wo, const eiDirBatch & wi, scalar *pdf, const eiInt n)
+	{
+		for (eiInt i = 0; i < n; ++i)
+		{
+			pdf[i] = this->pdf(get_batch(wo, i), get_batch(wi, i));
+		}
+	}
 };
 
 class FresnelBlend : public BSDF {
@@ -1058,6 +1153,16 @@ public:
 		return ei_fresnelblend_pdf(&wo, &wi, m_microfacet->m_pdf, m_microfacet->m_param);
 	}
 
+	virtual void eval_batch(const eiDirBatch & wo, const eiDirBatch & wi, eiColorBatch & f, const eiInt n)
+	{
+		if (m_microfacet->m_bsdf_batch == NULL)
+		{
+			BSDF::eval_batch(wo, wi, f, n);
+			return;
+		}
+		ei_fresnelblend_bsdf_batch(&f, &wo, &wi, &m_Rd, &m_Rs, m_microfacet->m_bsdf_batch, m_microfacet->m_param, n);
+	}
+
 protected:
 	Microfacet		*m_microfacet;
 	color			m_Rd;
@@ -1090,6 +1195,18 @@ public:
 	{
 		return ei_lambert_pdf(&wo, &wi);
 	}
+
+	virtual void eval_batch(const eiDirBatch & wo, const eiDirBatch & wi, eiColorBatch & f, const eiInt n)
+	{
+		scalar	result[ EI_BSDF_BATCH_SIZE ];
+		ei_lambert_bsdf_batch(result, &wo, &wi, n);
+		set_batch(f, result, n);
+	}
+
+	virtual void pdf_batch(const eiDirBatch & wo, const eiDirBatch & wi, scalar *pdf, const eiInt n)
+	{
+		ei_lambert_pdf_batch(pdf, &wo, &wi, n);
+	}
 };
 
 class OrenNayar : public BSDF {
@@ -1146,6 +1263,15 @@ public:
 		return ei_specularreflection_sample_bsdf(&wo, (eiVector *)(&wi));
 	}
 
+	virtual void sample_batch(const eiDirBatch & wo, eiDirBatch & wi, const scalar *u1, const scalar *u2, eiBool *valid, const eiInt n)
+	{
+		ei_specularreflection_sample_bsdf_batch(&wo, &wi, n);
+		for (eiInt i = 0; i < n; ++i)
+		{
+			valid[i] = eiTRUE;
+		}
+	}
+
 	virtual scalar pdf(const vector & wo, const vector & wi)
 	{
 		return ei_specularreflection_pdf(&wo, &wi);
@@ -1176,6 +1302,17 @@ public:
 		return ei_speculartransmission_sample_bsdf(&wo, (eiVector *)(&wi), m_etai, m_etat);
 	}
 
+	virtual void sample_batch(const eiDirBatch & wo, eiDirBatch & wi, const scalar *u1, const scalar *u2, eiBool *valid, const eiInt n)
+	{
+		eiUint	mask;
+
+		mask = ei_speculartransmission_sample_bsdf_batch(&wo, &wi, m_etai, m_etat, n);
+		for (eiInt i = 0; i < n; ++i)
+		{
+			valid[i] = ((mask >> i) & 1) ? eiTRUE : eiFALSE;
+		}
+	}
+
 	virtual scalar pdf(const vector & wo, const vector & wi)
 	{
 		return ei_speculartransmission_pdf(&wo, &wi, m_etai, m_etat);
@@ -1221,6 +1358,18 @@ public:
 		return ei_blinn_pdf(&wo, &wi, m_exponent);
 	}
 
+	virtual void eval_batch(const eiDirBatch & wo, const eiDirBatch & wi, eiColorBatch & f, const eiInt n)
+	{
+		scalar	result[ EI_BSDF_BATCH_SIZE ];
+		ei_blinn_bsdf_batch(result, &wo, &wi, m_exponent, n);
+		set_batch(f, result, n);
+	}
+
+	virtual void pdf_batch(const eiDirBatch & wo, const eiDirBatch & wi, scalar *pdf, const eiInt n)
+	{
+		ei_blinn_pdf_batch(pdf, &wo, &wi, m_exponent, n);
+	}
+
 private:
 	scalar		m_exponent;
 };
@@ -1254,6 +1403,18 @@ public:
 		return ei_ward_pdf(&wo, &wi, m_shiny_u, m_shiny_v);
 	}
 
+	virtual void eval_batch(const eiDirBatch & wo, const eiDirBatch & wi, eiColorBatch & f, const eiInt n)
+	{
+		scalar	result[ EI_BSDF_BATCH_SIZE ];
+		ei_ward_bsdf_batch(result, &wo, &wi, m_shiny_u, m_shiny_v, n);
+		set_batch(f, result, n);
+	}
+
+	virtual void pdf_batch(const eiDirBatch & wo, const eiDirBatch & wi, scalar *pdf, const eiInt n)
+	{
+		ei_ward_pdf_batch(pdf, &wo, &wi, m_shiny_u, m_shiny_v, n);
+	}
+
 private:
 	scalar		m_shiny_u;
 	scalar		m_shiny_v;
@@ -17,6 +17,7 @@
 #include <eiAPI/ei_buffer.h>
 #include <eiAPI/ei_object.h>
 #include <eiAPI/ei_sampler.h>
+#include <eiAPI/ei_pin_cache.h>
 #include <eiCORE/ei_algorithm.h>
 #include <eiCORE/ei_btree.h>
 #include <eiCORE/ei_array.h>
@@ -29,6 +30,21 @@ enum {
 	eiShaderInstance_internal_parameter_count, 
 };
 
+/** \brief The classes of shader parameters, classified by their 
+ * connections when linking the parameter table of shader instance. */
+enum {
+	/* unconnected, the value of shader instance is used unless it's 
+	   overridden by a primitive variable of the hit object with the 
+	   same name, the override is memorized for each object */
+	EI_SHADER_PARAM_CONSTANT = 0, 
+	/* connected to the output of another shader instance */
+	EI_SHADER_PARAM_VARYING, 
+};
+
+/* whether to fold constant parameters which are not overridden 
+   by primitive variables, for testing and diagnosis */
+static eiBool g_ShaderParamFolding = eiTRUE;
+
 /** \brief The connected shader instance node. */
 typedef struct eiShaderNode {
 	/* the tag of the corresponding shader instance */
@@ -55,6 +71,9 @@ struct eiShaderInstParamTable {
 	/* the number of connected nodes in this sub-shader-graph. 
 	   the table of connected nodes will be sorted by tag. */
 	eiInt				num_sorted_nodes;
+	/* the number of user parameters of the shader instance, 
+	   their classes are stored after the connected nodes */
+	eiInt				num_params;
 };
 
 /** \brief The thread local storage of a shader parameter 
@@ -84,6 +103,70 @@ typedef struct eiShaderInstanceTLS {
 	eiVector4			result;
 } eiShaderInstanceTLS;
 
+/** \brief Get the classes of user parameters. */
+static eiFORCEINLINE eiByte *ei_shader_param_classes(eiShaderInstParamTable *tab)
+{
+	return (eiByte *)(((eiShaderNode *)(tab + 1)) + tab->num_sorted_nodes);
+}
+
+void ei_shader_tls_init(eiShaderTLS *pTls)
+{
+	eiUint	i;
+
+	pTls->epoch = 0;
+
+	for (i = 0; i < EI_PRIM_VAR_MEMO_SIZE; ++i)
+	{
+		pTls->memos[i].obj = eiNULL_TAG;
+		pTls->memos[i].inst = eiNULL_TAG;
+		pTls->memos[i].param = eiNULL_INDEX;
+		pTls->memos[i].bound = eiFALSE;
+		ei_prim_var_handle_init(&pTls->memos[i].handle, NULL);
+	}
+
+	pTls->num_folded = 0;
+}
+
+void ei_shader_tls_exit(eiShaderTLS *pTls)
+{
+	/* do nothing */
+}
+
+void ei_shader_param_folding(const eiBool enable)
+{
+	g_ShaderParamFolding = enable;
+}
+
+/** \brief Get the memorized binding of a shader parameter on an 
+ * object, returns false if it has not been memorized, then the 
+ * caller should fill the returned memo. */
+static eiFORCEINLINE eiBool ei_shader_tls_lookup_memo(
+	eiShaderTLS *pTls, 
+	const eiTag obj, 
+	const eiTag inst, 
+	const eiIndex param, 
+	eiPrimVarMemo **memo)
+{
+	eiPrimVarMemo	*entry;
+	eiUint			epoch;
+	eiUint			h;
+
+	/* the bindings may change when the scene changes */
+	epoch = ei_pin_cache_epoch();
+
+	if (pTls->epoch != epoch)
+	{
+		ei_shader_tls_init(pTls);
+		pTls->epoch = epoch;
+	}
+
+	h = (obj * 2654435761U) ^ (inst * 40503U) ^ param;
+	entry = &pTls->memos[ (h ^ (h >> 16)) & (EI_PRIM_VAR_MEMO_SIZE - 1) ];
+	*memo = entry;
+
+	return (entry->obj == obj && entry->inst == inst && entry->param == param);
+}
+
 static eiInt ei_shader_node_compare(void *lhs, void *rhs)
 {
 	/* must cast to signed types to minus correctly */
@@ -149,6 +232,7 @@ static eiTag ei_create_shader_inst_param_table(
 	tab->inst = inst_tag;
 	tab->shader_cache_size = 0;
 	tab->num_sorted_nodes = 0;
+	tab->num_params = 0;
 
 	ei_db_end(db, param_table);
 
@@ -217,10 +301,12 @@ static eiFORCEINLINE eiBool ei_call_shader_imp(
 	eiShaderCache *shader_cache, 
 	eiVector4 * const result, 
 	eiState * const state, 
-	eiByte **params)
+	eiByte **params, 
+	eiDisplaceBatch * const batch)
 {
 	eiByte		*prev_params;
 	eiByte		*prev_shader_cache;
+	eiByte		*prev_current;
 	eiTag		prev_shader;
 	eiBool		ret_val;
 
@@ -244,11 +330,21 @@ static eiFORCEINLINE eiBool ei_call_shader_imp(
 	/* push the current calling shader instance */
 	prev_shader = state->shader;
 	state->shader = shader;
+	prev_current = shader_cache->current;
+	shader_cache->current = (eiByte *)pShaderInstTls;
 
 	/* call the main function of the shader */
-	ret_val = pShader->main(pShader, result, state, shader_cache->arg);
+	if (batch != NULL)
+	{
+		ret_val = pShader->main_batch(pShader, batch, state, shader_cache->arg);
+	}
+	else
+	{
+		ret_val = pShader->main(pShader, result, state, shader_cache->arg);
+	}
 
 	/* pop the current calling shader instance */
+	shader_cache->current = prev_current;
 	state->shader = prev_shader;
 
 	/* pop the current shader cache */
@@ -269,12 +365,13 @@ static eiFORCEINLINE eiBool ei_call_shader_imp(
 	return ret_val;
 }
 
-eiBool ei_call_shader_instance(
+static eiBool ei_call_shader_instance_imp(
 	eiNodeSystem *nodesys, 
 	eiVector4 * const result, 
 	eiState * const state, 
 	const eiTag shader, 
-	void *arg)
+	void *arg, 
+	eiDisplaceBatch * const batch)
 {
 	eiNode					*pShaderInst;
 	eiTag					pShaderInstParamTableTag;
@@ -307,13 +404,28 @@ eiBool ei_call_shader_instance(
 	pShaderInstParamTable = (eiShaderInstParamTable *)ei_db_access(
 		nodesys->m_db, pShaderInstParamTableTag);
 
+	/* the parameters are evaluated only once for a batch, so batched 
+	   calls are only allowed for shaders without connected shaders, 
+	   whose parameters are constant for all vertices */
+	if (batch != NULL && 
+		(((eiShader *)pShaderInst->object)->main_batch == NULL || 
+		pShaderInstParamTable->num_sorted_nodes != 1))
+	{
+		ei_db_end(nodesys->m_db, pShaderInstParamTableTag);
+		ei_db_end(nodesys->m_db, shader);
+
+		return eiFALSE;
+	}
+
 	/* allocate shader cache from stack memory */
 	shader_cache = (eiShaderCache *)_alloca(sizeof(eiShaderCache) + pShaderInstParamTable->shader_cache_size);
 	shader_cache->root = pShaderInst;
 	shader_cache->root_param_table = pShaderInstParamTable;
+	shader_cache->current = NULL;
 	shader_cache->size = pShaderInstParamTable->shader_cache_size;
-	/* enable shader cache by default for each shader call */
-	shader_cache->enabled = eiTRUE;
+	/* enable shader cache by default for each shader call, 
+	   the cached result is meaningless for a batched call */
+	shader_cache->enabled = (batch == NULL);
 	shader_cache->arg = arg;
 
 	/* flush the shader cache */
@@ -357,7 +469,8 @@ eiBool ei_call_shader_instance(
 		shader_cache, 
 		result, 
 		state, 
-		&params);
+		&params, 
+		batch);
 
 	/* bind all output variables with shader output parameters that match the names */
 	if (state->result != NULL && 
@@ -409,6 +522,30 @@ eiBool ei_call_shader_instance(
 	return ret_val;
 }
 
+eiBool ei_call_shader_instance(
+	eiNodeSystem *nodesys, 
+	eiVector4 * const result, 
+	eiState * const state, 
+	const eiTag shader, 
+	void *arg)
+{
+	return ei_call_shader_instance_imp(nodesys, result, state, shader, arg, NULL);
+}
+
+eiBool ei_call_shader_instance_batch(
+	eiNodeSystem *nodesys, 
+	eiState * const state, 
+	const eiTag shader, 
+	eiDisplaceBatch * const batch, 
+	void *arg)
+{
+	eiVector4	result;
+
+	initv4(&result);
+
+	return ei_call_shader_instance_imp(nodesys, &result, state, shader, arg, batch);
+}
+
 eiBool ei_call_shader_instance_list(
 	eiNodeSystem *nodesys, 
 	eiVector4 * const result, 
@@ -469,6 +606,7 @@ void *ei_eval_imp(
 	eiByte					*param;
 	eiShaderParamTLS		*paramTls;
 	eiShaderLocalParamTLS	*localParamTls;
+	eiInt					param_class;
 
 	/* disable shader cache if we are calculating derivatives, 
 	   because currently we don't cache derivatives, in order 
@@ -490,8 +628,10 @@ void *ei_eval_imp(
 	/* get sorted nodes from the root */
 	root_sorted_nodes = (eiShaderNode *)(pRootShaderInstParamTable + 1);
 
-	/* get the parent shader instance that issues this evaluation */
-	pParentShaderInst = (eiNode *)ei_db_access(state->db, state->shader);
+	/* get the parent shader instance that issues this evaluation, 
+	   shader instances are resolved through the pin cache of this 
+	   thread, they will not be changed during rendering */
+	pParentShaderInst = (eiNode *)ei_pin_access(state->db, state->shader);
 
 	ei_nodesys_get_parameter_at(
 		nodesys, 
@@ -499,21 +639,36 @@ void *ei_eval_imp(
 		eiShaderInstance_param_table, 
 		&pParentShaderInstParamTableTag);
 
-	pParentShaderInstParamTable = (eiShaderInstParamTable *)ei_db_access(
+	pParentShaderInstParamTable = (eiShaderInstParamTable *)ei_pin_access(
 		state->db, pParentShaderInstParamTableTag);
 
-	/* index thread local shader parameters by shader instance */
-	parent_shader_node_key.tag = state->shader;
+	/* the thread local shader parameters of the executing shader 
+	   instance are known when it's called, otherwise index them 
+	   by shader instance */
+	pParentShaderInstTls = (eiShaderInstanceTLS *)((eiShaderCache *)state->shader_cache)->current;
 
-	pParentShaderNode = root_sorted_nodes + ei_binsearch(
-		root_sorted_nodes, 
-		pRootShaderInstParamTable->num_sorted_nodes, 
-		&parent_shader_node_key, 
-		sizeof(eiShaderNode), 
-		ei_shader_node_compare);
-	
-	pParentShaderInstTls = (eiShaderInstanceTLS *)(((eiByte *)state->shader_cache) 
-		+ pParentShaderNode->shader_cache_offset);
+	if (pParentShaderInstTls == NULL)
+	{
+		parent_shader_node_key.tag = state->shader;
+
+		pParentShaderNode = root_sorted_nodes + ei_binsearch(
+			root_sorted_nodes, 
+			pRootShaderInstParamTable->num_sorted_nodes, 
+			&parent_shader_node_key, 
+			sizeof(eiShaderNode), 
+			ei_shader_node_compare);
+		
+		pParentShaderInstTls = (eiShaderInstanceTLS *)(((eiByte *)state->shader_cache) 
+			+ pParentShaderNode->shader_cache_offset);
+	}
+
+	/* get the class of this parameter classified when linking */
+	param_class = EI_SHADER_PARAM_CONSTANT;
+
+	if ((eiInt)param_index < pParentShaderInstParamTable->num_params)
+	{
+		param_class = ei_shader_param_classes(pParentShaderInstParamTable)[ param_index ];
+	}
 
 	parentParams = ((eiByte *)(pParentShaderInstTls + 1)) + pParentShaderInst->param_table_size;
 
@@ -539,17 +694,11 @@ void *ei_eval_imp(
 		   the parameter, don't read it from shader cache, just return */
 		if (localParamTls->cached)
 		{
-			ei_db_end(state->db, pParentShaderInstParamTableTag);
-			ei_db_end(state->db, state->shader);
-
 			return param;
 		}
 		
 		memcpy(param, parentParams + param_offset, shader_param->size);
 
-		ei_db_end(state->db, pParentShaderInstParamTableTag);
-		ei_db_end(state->db, state->shader);
-
 		return param;
 	}
 
@@ -580,7 +729,7 @@ void *ei_eval_imp(
 		eiNodeParam				*output_shader_param;
 
 		/* the connected shader instance */
-		pShaderInst = (eiNode *)ei_db_access(state->db, shader_param->inst);
+		pShaderInst = (eiNode *)ei_pin_access(state->db, shader_param->inst);
 
 		/* index thread local shader parameters by shader instance */
 		shader_node_key.tag = shader_param->inst;
@@ -622,7 +771,8 @@ void *ei_eval_imp(
 			shader_cache, 
 			&result, 
 			state, 
-			&params);
+			&params, 
+			NULL);
 
 		/* pop shader cache enabled state */
 		shader_cache->enabled = prev_shader_cache_enabled;
@@ -646,12 +796,14 @@ void *ei_eval_imp(
 				(eiByte *)param, shader_param->type, 
 				(eiByte *)(&result), EI_DATA_TYPE_VECTOR4);
 		}
-
-		ei_db_end(state->db, shader_param->inst);
 	}
 	else
 	{
-		eiByte	*dX1, *dX2;
+		eiShaderTLS		*pShaderTls;
+		eiPrimVarMemo	*memo;
+		eiBool			memorized;
+		eiBool			bound;
+		eiByte			*dX1, *dX2;
 
 		dX1 = NULL;
 		dX2 = NULL;
@@ -661,14 +813,68 @@ void *ei_eval_imp(
 			dX2 = dX1 + shader_param->size;
 		}
 
-		/* bind primitive variable to this shader parameter if their names match */
-		if (ei_get_prim_var(
-			state, 
-			shader_param->name, 
-			shader_param->type, 
-			param, 
-			dX1, 
-			dX2))
+		/* the constant parameter may be overridden by a primitive 
+		   variable of the hit object if their names match, only 
+		   parameters classified as constant when linking are folded */
+		bound = eiFALSE;
+
+		if (state->hit_obj != eiNULL_TAG 
+			&& (!g_ShaderParamFolding || param_class != EI_SHADER_PARAM_CONSTANT))
+		{
+			bound = ei_get_prim_var(
+				state, 
+				shader_param->name, 
+				shader_param->type, 
+				param, 
+				dX1, 
+				dX2);
+		}
+		else if (state->hit_obj != eiNULL_TAG)
+		{
+			pShaderTls = (eiShaderTLS *)ei_tls_get_interface(state->tls, EI_TLS_TYPE_SHADER);
+
+			memorized = ei_shader_tls_lookup_memo(
+				pShaderTls, 
+				state->hit_obj, 
+				state->shader, 
+				param_index, 
+				&memo);
+
+			/* fold the parameter to constant if it has not been 
+			   overridden on this object */
+			if (memorized && !memo->bound)
+			{
+				++ pShaderTls->num_folded;
+			}
+			else
+			{
+				/* resolve the primitive variable by name for the 
+				   first evaluation on this object */
+				if (!memorized)
+				{
+					memo->obj = state->hit_obj;
+					memo->inst = state->shader;
+					memo->param = param_index;
+					ei_prim_var_handle_init(&memo->handle, shader_param->name);
+				}
+
+				bound = ei_get_prim_var_h(
+					state, 
+					&memo->handle, 
+					shader_param->type, 
+					param, 
+					dX1, 
+					dX2);
+
+				/* memorize the binding for the first evaluation */
+				if (!memorized)
+				{
+					memo->bound = bound;
+				}
+			}
+		}
+
+		if (bound)
 		{
 			if (dXdu != NULL)
 			{
@@ -700,9 +906,6 @@ void *ei_eval_imp(
 		localParamTls->cached = eiTRUE;
 	}
 
-	ei_db_end(state->db, pParentShaderInstParamTableTag);
-	ei_db_end(state->db, state->shader);
-
 	return param;
 }
 
@@ -804,6 +1007,7 @@ void generate_shader_inst_param_table(
 	eiNode					*inst;
 	ei_btree				shader_tree;
 	ei_array				shader_nodes;
+	eiByte					*param_classes;
 	eiInt					i;
 
 	/* get node system interface */
@@ -836,13 +1040,16 @@ void generate_shader_inst_param_table(
 		ei_shader_node_compare);
 	
 	tab->num_sorted_nodes = ei_array_size(&shader_nodes);
+	tab->num_params = ei_nodesys_get_parameter_count(nodesys, inst) 
+		- eiShaderInstance_internal_parameter_count;
 	
 	/* resize the data */
 	tab = (eiShaderInstParamTable *)ei_db_resize(
 		db, 
 		data_tag, 
 		sizeof(eiShaderInstParamTable) 
-		+ sizeof(eiShaderNode) * tab->num_sorted_nodes);
+		+ sizeof(eiShaderNode) * tab->num_sorted_nodes 
+		+ sizeof(eiByte) * tab->num_params);
 
 	/* fill shader cache offset for nodes */
 	tab->shader_cache_size = 0;
@@ -873,6 +1080,27 @@ void generate_shader_inst_param_table(
 	
 	ei_array_clear(&shader_nodes);
 
+	/* classify user parameters by their connections, so that the 
+	   evaluation of constant parameters can be folded */
+	param_classes = ei_shader_param_classes(tab);
+
+	for (i = 0; i < tab->num_params; ++i)
+	{
+		eiNodeParam		*param;
+
+		param = ei_nodesys_read_parameter(nodesys, inst, 
+			i + eiShaderInstance_internal_parameter_count);
+
+		if (param->inst != eiNULL_TAG)
+		{
+			param_classes[i] = EI_SHADER_PARAM_VARYING;
+		}
+		else
+		{
+			param_classes[i] = EI_SHADER_PARAM_CONSTANT;
+		}
+	}
+
 	ei_db_end(db, tab->inst);
 }
 
@@ -883,4 +1111,5 @@ void byteswap_shader_inst_param_table(eiDatabase *db, void *data, const eiUint s
 	ei_byteswap_int(&tab->inst);
 	ei_byteswap_int(&tab->shader_cache_size);
 	ei_byteswap_int(&tab->num_sorted_nodes);
+	ei_byteswap_int(&tab->num_params);
 }
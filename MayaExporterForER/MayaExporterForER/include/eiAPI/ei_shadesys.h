@@ -24,11 +24,51 @@
 #include <eiAPI/ei_api.h>
 #include <eiAPI/ei_shader.h>
 #include <eiAPI/ei_state.h>
+#include <eiAPI/ei_object.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* the number of memorized bindings of primitive variables */
+#define EI_PRIM_VAR_MEMO_SIZE		1024
+
+/** \brief Whether a shader parameter has been bound to a 
+ * primitive variable of an object, and the resolved handle 
+ * of the primitive variable if bound. */
+typedef struct eiPrimVarMemo {
+	eiTag			obj;
+	eiTag			inst;
+	eiIndex			param;
+	eiBool			bound;
+	eiPrimVarHandle	handle;
+} eiPrimVarMemo;
+
+/** \brief The thread local storage of the shading system. 
+ * unconnected shader parameters may be bound to primitive 
+ * variables of the hit object, which costs a lookup by name 
+ * for every evaluation, so we memorize the bindings, failed 
+ * ones are evaluated as constants, and successful ones are 
+ * interpolated by resolved handles. */
+typedef struct eiShaderTLS {
+	/* the global epoch of scene data when memorized */
+	eiUint			epoch;
+	eiPrimVarMemo	memos[ EI_PRIM_VAR_MEMO_SIZE ];
+	/* the number of evaluations folded to constants */
+	eiUint64		num_folded;
+} eiShaderTLS;
+
+/** \brief Initialize thread local storage. for internal use only. */
+eiAPI void ei_shader_tls_init(eiShaderTLS *pTls);
+
+/** \brief Cleanup thread local storage. for internal use only. */
+eiAPI void ei_shader_tls_exit(eiShaderTLS *pTls);
+
+/** \brief Enable or disable folding constant shader parameters, 
+ * enabled by default. the rendered results should be the same, 
+ * for testing and diagnosis only. */
+eiAPI void ei_shader_param_folding(const eiBool enable);
+
 /** \brief Begin editing a shader instance. create the shader 
  * instance if it's not created. */
 eiAPI eiNode *ei_shader_instance(
@@ -51,6 +91,17 @@ eiAPI eiBool ei_call_shader_instance(
 	const eiTag shader, 
 	void *arg);
 
+/** \brief Call the batched main function of a shader instance 
+ * over a block of vertices, returns false if the shader instance 
+ * cannot be called in batch, then the caller should call it for 
+ * each vertex instead. */
+eiAPI eiBool ei_call_shader_instance_batch(
+	eiNodeSystem *nodesys, 
+	eiState * const state, 
+	const eiTag shader, 
+	eiDisplaceBatch * const batch, 
+	void *arg);
+
 /** \brief Execute all shader instances in sequence with the same state pointer. */
 eiAPI eiBool ei_call_shader_instance_list(
 	eiNodeSystem *nodesys, 
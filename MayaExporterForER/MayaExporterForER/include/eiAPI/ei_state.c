@@ -17,6 +17,7 @@
 #include <eiAPI/ei_base_bucket.h>
 #include <eiAPI/ei_material.h>
 #include <eiCORE/ei_dataflow.h>
+#include <eiCORE/ei_qmc.h>
 #include <eiCORE/ei_assert.h>
 
 void ei_state_init(
@@ -39,7 +40,10 @@ void ei_state_init(
 	state->shader_cache = NULL;
 	state->shader = eiNULL_TAG;
 	state->current_volumes = NULL;
+	state->prim_var_obj = eiNULL_TAG;
+	state->prim_var_node = NULL;
 	state->prev_hit_t = 0.0f;
+	state->qmc_seed = 0;
 
 	ei_new_state(state);
 
@@ -60,6 +64,8 @@ void ei_state_init(
 
 void ei_state_exit(eiState *state)
 {
+	ei_state_end_hit_obj(state);
+
 	if (state->current_volumes != NULL)
 	{
 		ei_tls_free(state->tls, state->current_volumes);
@@ -67,6 +73,32 @@ void ei_state_exit(eiState *state)
 	}
 }
 
+eiNode *ei_state_access_hit_obj(eiState *state)
+{
+	if (state->prim_var_obj != state->hit_obj)
+	{
+		ei_state_end_hit_obj(state);
+
+		if (state->hit_obj != eiNULL_TAG)
+		{
+			state->prim_var_obj = state->hit_obj;
+			state->prim_var_node = (eiNode *)ei_db_access(state->db, state->prim_var_obj);
+		}
+	}
+
+	return state->prim_var_node;
+}
+
+void ei_state_end_hit_obj(eiState *state)
+{
+	if (state->prim_var_obj != eiNULL_TAG)
+	{
+		ei_db_end(state->db, state->prim_var_obj);
+		state->prim_var_obj = eiNULL_TAG;
+		state->prim_var_node = NULL;
+	}
+}
+
 void ei_flush_cache(eiState *state)
 {
 	eiShaderCache	*shader_cache;
@@ -99,6 +131,7 @@ void ei_new_state(eiState *state)
 	state->bias = EI_RAY_BIAS;
 	state->bias_scale = EI_RAY_BIAS_SCALE;
 	memset(state->user_data, 0, sizeof(eiScalar) * EI_MAX_USER_DATA_SIZE);
+	ei_state_end_hit_obj(state);
 
 	ei_flush_cache(state);
 
@@ -114,6 +147,20 @@ void ei_new_state(eiState *state)
 	}
 }
 
+eiGeoScalar ei_qmc_sample(
+	const eiOptions *opt, 
+	const eiUint dim, 
+	const eiUint i, 
+	const eiUint seed)
+{
+	if (opt->qmc_sequence == EI_QMC_SEQUENCE_SOBOL)
+	{
+		return ei_sobol(dim, i, seed);
+	}
+
+	return ei_halton(dim, i, seed);
+}
+
 void ei_state_init_volume(eiState *state, const eiTag volume)
 {
 	if (volume == eiNULL_TAG)
@@ -123,6 +123,9 @@ typedef struct eiShaderCache {
 	eiShaderInstParamTable	*root_param_table;
 	/* the beginning address of temporary shader parameters */
 	eiByte					*params;
+	/* the thread local storage of the current executing shader 
+	   instance in this cache, saves the lookup by tag */
+	eiByte					*current;
 	/* the size of the shader cache in bytes not including 
 	   this description, NOT including the sizeof(eiShaderCache) */
 	eiUint					size;
@@ -260,6 +263,9 @@ typedef struct eiState {
 	eiUint						dimension;
 	/* temporal integral dimension for sample */
 	eiUint						temp_dimension;
+	/* for Quasi-Monte Carlo integration, 
+	   the scrambling seed of the current pixel */
+	eiUint						qmc_seed;
 	/* sampling result contains user-defined output variables */
 	eiSampleInfo				*result;
 	/* the current sampling bucket */
@@ -296,6 +302,10 @@ typedef struct eiState {
 	eiUint						num_current_volumes;
 	/* the tag list of current volume shaders */
 	eiTag						*current_volumes;
+	/* the hit object being accessed for binding primitive 
+	   variables, for internal use only */
+	eiTag						prim_var_obj;
+	eiNode						*prim_var_node;
 } eiState;
 
 /** \brief Initialize the state.
@@ -309,6 +319,18 @@ eiAPI void ei_state_init(
  */
 eiAPI void ei_state_exit(eiState *state);
 
+/** \brief Begin accessing the hit object for binding primitive 
+ * variables, the object will be kept accessed until the hit is 
+ * changed or the state is reset, so that pointers into it can be 
+ * cached for the duration of the state. for internal use only.
+ */
+eiNode *ei_state_access_hit_obj(eiState *state);
+
+/** \brief End accessing the hit object for binding primitive 
+ * variables. for internal use only.
+ */
+void ei_state_end_hit_obj(eiState *state);
+
 eiFORCEINLINE void calc_inv_dir(eiVector * const inv_dir, const eiVector *dir)
 {
 	if (absf(dir->x) > eiSCALAR_EPS) {
@@ -328,6 +350,24 @@ eiFORCEINLINE void calc_inv_dir(eiVector * const inv_dir, const eiVector *dir)
 	}
 }
 
+/** \brief Get the QMC sample of dimension dim for instance number i 
+ * from the sequence selected in the options, seed selects the 
+ * scrambling of the Sobol sequence, and the rotation of the Halton 
+ * sequence, which is shared by all pixels.
+ */
+eiAPI eiGeoScalar ei_qmc_sample(
+	const eiOptions *opt, 
+	const eiUint dim, 
+	const eiUint i, 
+	const eiUint seed);
+
+/** \brief Get the QMC sample for the pixel of this state.
+ */
+eiFORCEINLINE eiGeoScalar ei_state_sigma(const eiState *state, const eiUint dim, const eiUint i)
+{
+	return ei_qmc_sample(state->opt, dim, i, state->qmc_seed);
+}
+
 /** \brief Precompute some quantities used frequently in ray-tracing.
  */
 eiFORCEINLINE void ei_state_precompute(eiState *state)
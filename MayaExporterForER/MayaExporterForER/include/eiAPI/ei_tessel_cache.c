@@ -0,0 +1,233 @@
+/* 
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiAPI/ei_tessel_cache.h>
+#include <eiAPI/ei_nodesys.h>
+#include <eiCORE/ei_atomic_ops.h>
+#include <eiCORE/ei_verbose.h>
+#include <eiCORE/ei_assert.h>
+
+/** \brief The dicing record of a deferred tessellation. */
+typedef struct eiTesselRecord {
+	ei_btree_node	node;
+	/* the tag of the tessellation, as the key */
+	eiTag			tag;
+	/* the size of the tessellation when last diced */
+	eiUint			size;
+} eiTesselRecord;
+
+/** \brief The dicing statistics of an object. */
+typedef struct eiTesselObjectStats {
+	ei_btree_node	node;
+	/* the tag of the source object, as the key */
+	eiTag			tag;
+	/* the total bytes diced for this object */
+	eiUint64		bytes;
+	/* the number of dicings */
+	eiUint			num_dices;
+	/* the number of dicings of flushed tessellations */
+	eiUint			num_redices;
+} eiTesselObjectStats;
+
+static eiIntptr ei_tessel_record_compare(ei_btree_node *lhs, ei_btree_node *rhs, void *param)
+{
+	/* must cast to signed types to minus correctly */
+	return (((eiIntptr)((eiTesselRecord *)lhs)->tag) - ((eiIntptr)((eiTesselRecord *)rhs)->tag));
+}
+
+static void ei_tessel_record_delete(ei_btree_node *node, void *param)
+{
+	if (node == NULL)
+	{
+		eiASSERT(0);
+		return;
+	}
+
+	ei_btree_node_clear(node);
+
+	eiCHECK_FREE(node);
+}
+
+static eiIntptr ei_tessel_object_stats_compare(ei_btree_node *lhs, ei_btree_node *rhs, void *param)
+{
+	/* must cast to signed types to minus correctly */
+	return (((eiIntptr)((eiTesselObjectStats *)lhs)->tag) - ((eiIntptr)((eiTesselObjectStats *)rhs)->tag));
+}
+
+static void ei_tessel_object_stats_delete(ei_btree_node *node, void *param)
+{
+	if (node == NULL)
+	{
+		eiASSERT(0);
+		return;
+	}
+
+	ei_btree_node_clear(node);
+
+	eiCHECK_FREE(node);
+}
+
+void ei_tessel_cache_init(eiTesselCache *cache)
+{
+	ei_create_lock(&cache->lock);
+	ei_btree_init(&cache->tessels, ei_tessel_record_compare, ei_tessel_record_delete, NULL);
+	ei_btree_init(&cache->objects, ei_tessel_object_stats_compare, ei_tessel_object_stats_delete, NULL);
+	cache->diced_bytes = 0;
+	cache->peak_diced_bytes = 0;
+	cache->evicted_bytes = 0;
+	cache->num_dices = 0;
+	cache->num_redices = 0;
+}
+
+void ei_tessel_cache_exit(eiTesselCache *cache)
+{
+	ei_btree_clear(&cache->objects);
+	ei_btree_clear(&cache->tessels);
+	ei_delete_lock(&cache->lock);
+}
+
+void ei_tessel_cache_clear(eiTesselCache *cache)
+{
+	ei_lock(&cache->lock);
+
+	ei_btree_clear(&cache->tessels);
+	ei_btree_clear(&cache->objects);
+	cache->diced_bytes = 0;
+	cache->peak_diced_bytes = 0;
+	cache->evicted_bytes = 0;
+	cache->num_dices = 0;
+	cache->num_redices = 0;
+
+	ei_unlock(&cache->lock);
+}
+
+void ei_tessel_cache_defer(eiDatabase *db, const eiTag tessel_tag)
+{
+	eiData	*pData;
+
+	/* don't trigger the dicing here, only modify the flags */
+	pData = ei_db_access_info_defer_init(db, tessel_tag);
+
+	ei_atomic_set_mask(&pData->flag, EI_DB_FLUSHABLE | EI_DB_GEN_ALWAYS | EI_DB_GEN_LOCAL);
+
+	ei_db_end(db, tessel_tag);
+}
+
+void ei_tessel_cache_diced(
+	eiTesselCache *cache, 
+	eiDatabase *db, 
+	const eiTag tessel_tag, 
+	const eiTag obj_tag)
+{
+	eiTesselRecord			record_key;
+	eiTesselRecord			*record;
+	eiTesselObjectStats		stats_key;
+	eiTesselObjectStats		*stats;
+	eiUint					size;
+
+	size = ei_db_size(db, tessel_tag);
+
+	ei_lock(&cache->lock);
+
+	stats_key.tag = obj_tag;
+	stats = (eiTesselObjectStats *)ei_btree_lookup(&cache->objects, &stats_key.node, NULL);
+
+	if (stats == NULL)
+	{
+		stats = (eiTesselObjectStats *)ei_allocate(sizeof(eiTesselObjectStats));
+		ei_btree_node_init(&stats->node);
+		stats->tag = obj_tag;
+		stats->bytes = 0;
+		stats->num_dices = 0;
+		stats->num_redices = 0;
+
+		ei_btree_insert(&cache->objects, &stats->node, NULL);
+	}
+
+	record_key.tag = tessel_tag;
+	record = (eiTesselRecord *)ei_btree_lookup(&cache->tessels, &record_key.node, NULL);
+
+	if (record == NULL)
+	{
+		record = (eiTesselRecord *)ei_allocate(sizeof(eiTesselRecord));
+		ei_btree_node_init(&record->node);
+		record->tag = tessel_tag;
+		record->size = 0;
+
+		ei_btree_insert(&cache->tessels, &record->node, NULL);
+	}
+	else
+	{
+		/* the tessellation has been diced before, the previous 
+		   copy must have been flushed by the database */
+		cache->diced_bytes -= record->size;
+		cache->evicted_bytes += record->size;
+		++ cache->num_redices;
+		++ stats->num_redices;
+	}
+
+	record->size = size;
+
+	cache->diced_bytes += size;
+	cache->peak_diced_bytes = MAX(cache->peak_diced_bytes, cache->diced_bytes);
+	++ cache->num_dices;
+
+	stats->bytes += size;
+	++ stats->num_dices;
+
+	ei_unlock(&cache->lock);
+}
+
+static eiInt print_tessel_object_stats(ei_btree_node *node, void *param)
+{
+	eiDatabase				*db;
+	eiTesselObjectStats		*stats;
+	eiNode					*obj;
+
+	db = (eiDatabase *)param;
+	stats = (eiTesselObjectStats *)node;
+
+	/* only objects that were re-diced are interesting for tuning */
+	if (stats->num_redices != 0)
+	{
+		obj = (eiNode *)ei_db_access(db, stats->tag);
+
+		ei_info("object %s: %d dicings, %d re-dicings, %f MB diced\n", 
+			obj->name, 
+			stats->num_dices, 
+			stats->num_redices, 
+			(eiGeoScalar)stats->bytes / (eiGeoScalar)(1024 * 1024));
+
+		ei_db_end(db, stats->tag);
+	}
+
+	return eiTRUE;
+}
+
+void ei_tessel_cache_print_stats(eiTesselCache *cache, eiDatabase *db)
+{
+	ei_lock(&cache->lock);
+
+	ei_info("deferred tessellations: %d dicings, %d re-dicings\n", 
+		cache->num_dices, 
+		cache->num_redices);
+	ei_info("deferred tessellation peak diced: %f MB (upper bound of resident), re-diced after flush: %f MB\n", 
+		(eiGeoScalar)cache->peak_diced_bytes / (eiGeoScalar)(1024 * 1024), 
+		(eiGeoScalar)cache->evicted_bytes / (eiGeoScalar)(1024 * 1024));
+
+	ei_btree_traverse(&cache->objects, print_tessel_object_stats, (void *)db);
+
+	ei_unlock(&cache->lock);
+}
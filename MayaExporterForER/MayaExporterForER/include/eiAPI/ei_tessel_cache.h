@@ -0,0 +1,85 @@
+/* 
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+ 
+#ifndef EI_TESSEL_CACHE_H
+#define EI_TESSEL_CACHE_H
+
+/** \brief The bookkeeping of deferred tessellations on local host
+ * \file ei_tessel_cache.h
+ */
+
+#include <eiAPI/ei_api.h>
+#include <eiCORE/ei_btree.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_dataflow.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Deferred tessellations are diced on demand when rays first 
+ * hit their bounding boxes, the database may flush them when the 
+ * memory limit is hit, then they will be re-diced on the next hit. 
+ * this cache tracks the dicing of these tessellations on local host, 
+ * so that we can tune the memory limit for heavily displaced scenes. */
+typedef struct eiTesselCache {
+	eiLock			lock;
+	/* the map from tessellation tag to its dicing record */
+	ei_btree		tessels;
+	/* the map from object tag to its dicing statistics */
+	ei_btree		objects;
+	/* the bytes of the latest dicing of each tessellation, the 
+	   database doesn't report flushing, so a flushed copy is only 
+	   discounted when it's re-diced, this is an upper bound of 
+	   the bytes actually resident in memory */
+	eiUint64		diced_bytes;
+	/* the peak of diced bytes */
+	eiUint64		peak_diced_bytes;
+	/* the bytes of flushed tessellations which were re-diced */
+	eiUint64		evicted_bytes;
+	/* the number of dicings */
+	eiUint			num_dices;
+	/* the number of dicings of flushed tessellations */
+	eiUint			num_redices;
+} eiTesselCache;
+
+void ei_tessel_cache_init(eiTesselCache *cache);
+void ei_tessel_cache_exit(eiTesselCache *cache);
+
+/** \brief Clear all records, call this before rendering a new frame. */
+void ei_tessel_cache_clear(eiTesselCache *cache);
+
+/** \brief Flag a newly created deferred tessellation so that 
+ * the database drops and re-dices it on local host when it's 
+ * flushed, instead of writing it into page files. */
+void ei_tessel_cache_defer(eiDatabase *db, const eiTag tessel_tag);
+
+/** \brief Record the dicing of a deferred tessellation, a dicing 
+ * of a tessellation which has been diced before is counted as 
+ * re-dicing, the previous copy must have been flushed. */
+void ei_tessel_cache_diced(
+	eiTesselCache *cache, 
+	eiDatabase *db, 
+	const eiTag tessel_tag, 
+	const eiTag obj_tag);
+
+/** \brief Print the statistics of the cache. */
+void ei_tessel_cache_print_stats(eiTesselCache *cache, eiDatabase *db);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
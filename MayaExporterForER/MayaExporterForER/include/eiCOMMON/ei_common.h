@@ -75,6 +75,8 @@ enum {
 	/* renderer */
 	EI_DATA_TYPE_JOB_PHOTON,								/* photon emission job */
 	EI_DATA_TYPE_JOB_BUCKET,								/* bucket rendering job */
+	/* ray-tracing module, appended to keep the values of other types */
+	EI_DATA_TYPE_RAY_HAIR_PACKETS,							/* ray-traceable hair packets */
 	EI_DATA_TYPE_COUNT, 
 };
 
@@ -82,6 +84,7 @@ enum {
 enum {
 	EI_INTERFACE_TYPE_RAYTRACER = EI_INTERFACE_TYPE_USER,	/* ray-tracer interface */
 	EI_INTERFACE_TYPE_NODE_SYSTEM,							/* node system interface */
+	EI_INTERFACE_TYPE_TESSEL_CACHE,							/* deferred tessellation cache interface */
 	EI_INTERFACE_TYPE_COUNT, 
 };
 
@@ -89,6 +92,9 @@ enum {
 enum {
 	EI_TLS_TYPE_RAYTRACER = EI_TLS_TYPE_USER,	/* ray-tracer TLS interface */
 	EI_TLS_TYPE_GLOBILLUM,						/* global illumination TLS interface */
+	EI_TLS_TYPE_SAMPLER,						/* sampler TLS interface */
+	EI_TLS_TYPE_PIN_CACHE,						/* database pin cache TLS interface */
+	EI_TLS_TYPE_SHADER,							/* shading system TLS interface */
 	EI_TLS_TYPE_COUNT, 
 };
 
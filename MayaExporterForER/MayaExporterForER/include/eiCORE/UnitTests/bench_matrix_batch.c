@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of batched transforms against point_transform,
+ * of the 8 corners of bounding boxes as projected by the camera, of
+ * SIMD matrix products against mulmm, and of emitting photons through
+ * two transforms or through one concatenated transform.
+ * usage: bench_matrix_batch [num_points] [num_rounds]
+ * \file bench_matrix_batch.c
+ */
+
+#include <eiCORE/ei_matrix_batch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_NUM_MATRICES	1024
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+static eiScalar bench_random()
+{
+	return 200.0f * (eiScalar)rand() / (eiScalar)RAND_MAX - 100.0f;
+}
+
+static void bench_report(const char *name, const eiUint64 elapsed_time, const double num_items)
+{
+	printf("%-24s %8.2f M/s\n", name, num_items / 1000.0 / (double)MAX(elapsed_time, 1));
+}
+
+static void bench_transform(const eiInt num_points, const eiInt num_rounds, const eiMatrix *mx)
+{
+	eiVector	*src;
+	eiVector	*dst;
+	eiScalar	*x, *y, *z;
+	eiScalar	*ox, *oy, *oz;
+	eiUint64	start_time;
+	eiScalar	sum;
+	eiInt		i, r;
+
+	src = (eiVector *)malloc(sizeof(eiVector) * num_points);
+	dst = (eiVector *)malloc(sizeof(eiVector) * num_points);
+	x = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+	y = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+	z = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+	ox = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+	oy = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+	oz = (eiScalar *)malloc(sizeof(eiScalar) * num_points);
+
+	for (i = 0; i < num_points; ++i)
+	{
+		setv(&src[i], bench_random(), bench_random(), bench_random());
+		x[i] = src[i].x;
+		y[i] = src[i].y;
+		z[i] = src[i].z;
+	}
+
+	sum = 0.0f;
+
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		for (i = 0; i < num_points; ++i)
+		{
+			point_transform(&dst[i], &src[i], mx);
+		}
+		sum += dst[r % num_points].x;
+	}
+	bench_report("point_transform", bench_time_ms() - start_time, (double)num_points * num_rounds);
+
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		ei_point_transform_array(dst, src, num_points, mx);
+		sum += dst[r % num_points].x;
+	}
+	bench_report("ei_point_transform_array", bench_time_ms() - start_time, (double)num_points * num_rounds);
+
+	start_time = bench_time_ms();
+	for (r = 0; r < num_rounds; ++r)
+	{
+		ei_point_transform_soa(ox, oy, oz, x, y, z, num_points, mx);
+		sum += ox[r % num_points];
+	}
+	bench_report("ei_point_transform_soa", bench_time_ms() - start_time, (double)num_points * num_rounds);
+
+	printf("checksum %f\n", sum);
+
+	free(oz);
+	free(oy);
+	free(ox);
+	free(z);
+	free(y);
+	free(x);
+	free(dst);
+	free(src);
+}
+
+/** \brief The 8 corners of a box one by one, as the camera does for
+ * screen-space bounds, or as one array. */
+static void bench_box(const eiInt num_boxes, const eiMatrix *mx)
+{
+	eiVector	corners[8];
+	eiVector	v;
+	eiUint64	start_time;
+	eiScalar	sum;
+	eiInt		b, i;
+
+	sum = 0.0f;
+
+	start_time = bench_time_ms();
+	for (b = 0; b < num_boxes; ++b)
+	{
+		for (i = 0; i < 8; ++i)
+		{
+			setv(&corners[i], (eiScalar)(i & 4) + (eiScalar)b, (eiScalar)(i & 2), (eiScalar)(i & 1));
+			point_transform(&v, &corners[i], mx);
+			sum += v.x;
+		}
+	}
+	bench_report("box corners, one by one", bench_time_ms() - start_time, (double)num_boxes);
+
+	start_time = bench_time_ms();
+	for (b = 0; b < num_boxes; ++b)
+	{
+		for (i = 0; i < 8; ++i)
+		{
+			setv(&corners[i], (eiScalar)(i & 4) + (eiScalar)b, (eiScalar)(i & 2), (eiScalar)(i & 1));
+		}
+		ei_point_transform_array(corners, corners, 8, mx);
+		for (i = 0; i < 8; ++i)
+		{
+			sum += corners[i].x;
+		}
+	}
+	bench_report("box corners, array", bench_time_ms() - start_time, (double)num_boxes);
+
+	printf("checksum %f\n", sum);
+}
+
+/** \brief Photon origins and directions from light space to camera
+ * space, through light to world and world to camera for each photon,
+ * or through the concatenation of both computed once. */
+static void bench_photon(const eiInt num_photons, const eiMatrix *light_to_world, const eiMatrix *world_to_camera)
+{
+	eiMatrix	light_to_camera;
+	eiVector	src, dir, temp;
+	eiUint64	start_time;
+	eiScalar	sum;
+	eiInt		i;
+
+	sum = 0.0f;
+
+	start_time = bench_time_ms();
+	for (i = 0; i < num_photons; ++i)
+	{
+		setv(&src, (eiScalar)(i & 255), 1.0f, 2.0f);
+		setv(&dir, 0.5f, (eiScalar)(i & 15), -1.0f);
+		point_transform(&temp, &src, light_to_world);
+		point_transform(&src, &temp, world_to_camera);
+		vector_transform(&temp, &dir, light_to_world);
+		vector_transform(&dir, &temp, world_to_camera);
+		sum += src.x + dir.y;
+	}
+	bench_report("photon, two transforms", bench_time_ms() - start_time, (double)num_photons);
+
+	start_time = bench_time_ms();
+	ei_mulmm_simd(&light_to_camera, light_to_world, world_to_camera);
+	for (i = 0; i < num_photons; ++i)
+	{
+		setv(&src, (eiScalar)(i & 255), 1.0f, 2.0f);
+		setv(&dir, 0.5f, (eiScalar)(i & 15), -1.0f);
+		point_transformi(&src, &light_to_camera);
+		vector_transformi(&dir, &light_to_camera);
+		sum += src.x + dir.y;
+	}
+	bench_report("photon, concatenated", bench_time_ms() - start_time, (double)num_photons);
+
+	printf("checksum %f\n", sum);
+}
+
+static void bench_mulmm(const eiInt num_rounds)
+{
+	eiMatrix	*a;
+	eiMatrix	*b;
+	eiMatrix	*r;
+	eiUint64	start_time;
+	eiScalar	sum;
+	eiInt		i, k;
+
+	a = (eiMatrix *)malloc(sizeof(eiMatrix) * BENCH_NUM_MATRICES);
+	b = (eiMatrix *)malloc(sizeof(eiMatrix) * BENCH_NUM_MATRICES);
+	r = (eiMatrix *)malloc(sizeof(eiMatrix) * BENCH_NUM_MATRICES);
+
+	for (i = 0; i < BENCH_NUM_MATRICES; ++i)
+	{
+		for (k = 0; k < 16; ++k)
+		{
+			(&a[i].m1)[k] = bench_random();
+			(&b[i].m1)[k] = bench_random();
+		}
+	}
+
+	sum = 0.0f;
+
+	start_time = bench_time_ms();
+	for (k = 0; k < num_rounds; ++k)
+	{
+		for (i = 0; i < BENCH_NUM_MATRICES; ++i)
+		{
+			mulmm(&r[i], &a[i], &b[(i + k) % BENCH_NUM_MATRICES]);
+		}
+		sum += r[k % BENCH_NUM_MATRICES].m1;
+	}
+	bench_report("mulmm", bench_time_ms() - start_time, (double)BENCH_NUM_MATRICES * num_rounds);
+
+	start_time = bench_time_ms();
+	for (k = 0; k < num_rounds; ++k)
+	{
+		for (i = 0; i < BENCH_NUM_MATRICES; ++i)
+		{
+			ei_mulmm_simd(&r[i], &a[i], &b[(i + k) % BENCH_NUM_MATRICES]);
+		}
+		sum += r[k % BENCH_NUM_MATRICES].m1;
+	}
+	bench_report("ei_mulmm_simd", bench_time_ms() - start_time, (double)BENCH_NUM_MATRICES * num_rounds);
+
+	printf("checksum %f\n", sum);
+
+	free(r);
+	free(b);
+	free(a);
+}
+
+int main(int argc, char *argv[])
+{
+	eiInt		num_points;
+	eiInt		num_rounds;
+	eiMatrix	mx;
+	eiMatrix	world_to_camera;
+	eiInt		k;
+
+	num_points = (argc > 1) ? atoi(argv[1]) : 1000000;
+	num_rounds = (argc > 2) ? atoi(argv[2]) : 20;
+	num_points = MAX(1, num_points);
+	num_rounds = MAX(1, num_rounds);
+
+	srand(1234);
+
+	for (k = 0; k < 16; ++k)
+	{
+		(&mx.m1)[k] = bench_random() * 0.1f;
+		(&world_to_camera.m1)[k] = bench_random() * 0.1f;
+	}
+
+	printf("%d points, %d rounds\n", num_points, num_rounds);
+
+	bench_transform(num_points, num_rounds, &mx);
+	bench_box(num_points * num_rounds / 8, &mx);
+	bench_photon(num_points * num_rounds, &mx, &world_to_camera);
+	bench_mulmm(num_points * num_rounds / BENCH_NUM_MATRICES);
+
+	return 0;
+}
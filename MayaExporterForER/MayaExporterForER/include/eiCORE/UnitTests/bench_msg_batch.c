@@ -0,0 +1,206 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of message batching with 32 simulated render 
+ * servers sending progress messages to one manager over local 
+ * sockets, compares unbatched and batched sending.
+ * usage: bench_msg_batch [num_servers] [num_msgs]
+ * \file bench_msg_batch.c
+ */
+
+#include <eiCORE/ei_msg_batch.h>
+#include <eiCORE/ei_platform.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_PORT				19832
+#define BENCH_MAX_SERVERS		256
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+typedef struct BenchServer {
+	SOCKET		client;
+	SOCKET		server;
+	eiMsgBatch	batch;
+	eiUint		num_msgs;
+	eiUint		num_received;
+} BenchServer;
+
+static eiTHREAD_FUNC bench_send_thread(void *param)
+{
+	BenchServer	*srv;
+	eiMessage	msg;
+	eiUint		i;
+
+	srv = (BenchServer *)param;
+
+	for (i = 0; i < srv->num_msgs; ++i)
+	{
+		ei_msg_init(&msg);
+		ei_msg_set(&msg, EI_MSG_REQ_STEP_PROGRESS);
+		msg.step_progress_params.count = 1;
+
+		ei_msg_batch_add(&srv->batch, &msg);
+	}
+
+	ei_msg_batch_flush(&srv->batch);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiTHREAD_FUNC bench_recv_thread(void *param)
+{
+	BenchServer	*srv;
+	eiMessage	*msgs;
+	eiMessage	msg;
+
+	srv = (BenchServer *)param;
+	msgs = (eiMessage *)malloc(sizeof(eiMessage) * EI_MSG_BATCH_DEFAULT_SIZE);
+
+	while (srv->num_received < srv->num_msgs && 
+		ei_net_recv(srv->server, (eiByte *)&msg, sizeof(eiMessage)))
+	{
+		if (msg.type == EI_MSG_GROUP)
+		{
+			if (msg.group.num_msgs > EI_MSG_BATCH_DEFAULT_SIZE || 
+				!ei_net_recv(srv->server, (eiByte *)msgs, sizeof(eiMessage) * msg.group.num_msgs))
+			{
+				break;
+			}
+
+			srv->num_received += msg.group.num_msgs;
+		}
+		else
+		{
+			++ srv->num_received;
+		}
+	}
+
+	free(msgs);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiBool bench_run(
+	const eiUint num_servers, 
+	const eiUint num_msgs, 
+	const eiUint batch_size)
+{
+	BenchServer		*srvs;
+	eiThreadHandle	*threads;
+	SOCKET			listener;
+	SOCKADDR_IN		addr;
+	eiUint64		start_time;
+	eiUint64		elapsed_time;
+	eiUint64		num_writes;
+	eiUint64		num_received;
+	eiUint			i;
+
+	if (!ei_net_init_server(&listener, BENCH_PORT, num_servers))
+	{
+		printf("failed to listen on port %d\n", BENCH_PORT);
+		return eiFALSE;
+	}
+
+	srvs = (BenchServer *)malloc(sizeof(BenchServer) * num_servers);
+	threads = (eiThreadHandle *)malloc(sizeof(eiThreadHandle) * num_servers * 2);
+
+	for (i = 0; i < num_servers; ++i)
+	{
+		ei_net_init_client(&srvs[i].client, BENCH_PORT, "127.0.0.1");
+		srvs[i].server = ei_net_accept(listener, &addr);
+		srvs[i].num_msgs = num_msgs;
+		srvs[i].num_received = 0;
+		ei_msg_batch_init(&srvs[i].batch, srvs[i].client, eiFALSE, batch_size);
+	}
+
+	ei_net_close_socket(&listener);
+
+	start_time = bench_time_ms();
+
+	for (i = 0; i < num_servers; ++i)
+	{
+		threads[i * 2 + 0] = ei_create_thread(bench_recv_thread, &srvs[i], NULL);
+		threads[i * 2 + 1] = ei_create_thread(bench_send_thread, &srvs[i], NULL);
+	}
+
+	for (i = 0; i < num_servers * 2; ++i)
+	{
+		ei_wait_thread(threads[i]);
+		ei_delete_thread(threads[i]);
+	}
+
+	elapsed_time = bench_time_ms() - start_time;
+
+	num_writes = 0;
+	num_received = 0;
+
+	for (i = 0; i < num_servers; ++i)
+	{
+		num_writes += srvs[i].batch.num_writes;
+		num_received += srvs[i].num_received;
+
+		ei_msg_batch_exit(&srvs[i].batch);
+		ei_net_close_socket(&srvs[i].client);
+		ei_net_close_socket(&srvs[i].server);
+	}
+
+	printf("batch size %4d: %d servers, %d messages received, %d writes, %d ms\n", 
+		batch_size, 
+		num_servers, 
+		(eiInt)num_received, 
+		(eiInt)num_writes, 
+		(eiInt)elapsed_time);
+
+	free(threads);
+	free(srvs);
+
+	return (num_received == (eiUint64)num_servers * num_msgs);
+}
+
+int main(int argc, char *argv[])
+{
+	eiUint	num_servers;
+	eiUint	num_msgs;
+	eiBool	result;
+
+	num_servers = (argc > 1) ? atoi(argv[1]) : 32;
+	num_msgs = (argc > 2) ? atoi(argv[2]) : 20000;
+	num_servers = MAX(1, MIN(num_servers, BENCH_MAX_SERVERS));
+
+	ei_net_startup();
+
+	result = bench_run(num_servers, num_msgs, 1) && 
+		bench_run(num_servers, num_msgs, EI_MSG_BATCH_DEFAULT_SIZE);
+
+	ei_net_shutdown();
+
+	return result ? 0 : 1;
+}
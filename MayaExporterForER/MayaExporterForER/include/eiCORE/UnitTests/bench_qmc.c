@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Benchmark of generating samples of the permuted Halton
+ * sequence and the Owen-scrambled Sobol sequence, and of the L2-star
+ * discrepancy of their 2D point sets.
+ * usage: bench_qmc [num_samples]
+ * \file bench_qmc.c
+ */
+
+#include <eiCORE/ei_qmc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#define BENCH_DISCREPANCY_POINTS	1024
+#define BENCH_NUM_SEEDS				8
+
+/** \brief The wall clock time in milliseconds. */
+static eiUint64 bench_time_ms()
+{
+#ifdef _WIN32
+	return (eiUint64)GetTickCount();
+#else
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (eiUint64)tp.tv_sec * 1000 + tp.tv_usec / 1000;
+#endif
+}
+
+/** \brief The L2-star discrepancy of a 2D point set by Warnock's
+ * formula. */
+static double bench_l2_star_discrepancy(const double *x, const double *y, const eiInt n)
+{
+	double	sum1, sum2;
+	eiInt	i, j;
+
+	sum1 = 0.0;
+	sum2 = 0.0;
+
+	for (i = 0; i < n; ++i)
+	{
+		sum1 += (1.0 - x[i] * x[i]) * (1.0 - y[i] * y[i]);
+
+		for (j = 0; j < n; ++j)
+		{
+			sum2 += (1.0 - MAX(x[i], x[j])) * (1.0 - MAX(y[i], y[j]));
+		}
+	}
+
+	return sqrt(1.0 / 9.0 - sum1 / (2.0 * (double)n) + sum2 / ((double)n * (double)n));
+}
+
+static void bench_generate(const eiInt num_samples)
+{
+	eiUint64	start_time;
+	eiUint64	elapsed_time;
+	eiGeoScalar	sum;
+	eiInt		i;
+
+	sum = 0.0;
+	start_time = bench_time_ms();
+	for (i = 0; i < num_samples; ++i)
+	{
+		sum += ei_sigma(i & 1, i);
+	}
+	elapsed_time = bench_time_ms() - start_time;
+	printf("Halton dimensions 0-1:   %8.2f M samples/s\n",
+		(double)num_samples / 1000.0 / (double)MAX(elapsed_time, 1));
+
+	start_time = bench_time_ms();
+	for (i = 0; i < num_samples; ++i)
+	{
+		sum += ei_sigma(60 + (i & 1), i);
+	}
+	elapsed_time = bench_time_ms() - start_time;
+	printf("Halton dimensions 60-61: %8.2f M samples/s\n",
+		(double)num_samples / 1000.0 / (double)MAX(elapsed_time, 1));
+
+	start_time = bench_time_ms();
+	for (i = 0; i < num_samples; ++i)
+	{
+		sum += ei_sobol(i & 1, (eiUint)i, 0x12345678);
+	}
+	elapsed_time = bench_time_ms() - start_time;
+	printf("Sobol:                   %8.2f M samples/s\n",
+		(double)num_samples / 1000.0 / (double)MAX(elapsed_time, 1));
+
+	printf("checksum %f\n", sum);
+}
+
+static void bench_discrepancy()
+{
+	double	x[ BENCH_DISCREPANCY_POINTS ];
+	double	y[ BENCH_DISCREPANCY_POINTS ];
+	double	halton_low, halton_high, sobol;
+	eiUint	s;
+	eiInt	i;
+
+	for (i = 0; i < BENCH_DISCREPANCY_POINTS; ++i)
+	{
+		x[i] = ei_sigma(0, i);
+		y[i] = ei_sigma(1, i);
+	}
+	halton_low = bench_l2_star_discrepancy(x, y, BENCH_DISCREPANCY_POINTS);
+
+	for (i = 0; i < BENCH_DISCREPANCY_POINTS; ++i)
+	{
+		x[i] = ei_sigma(60, i);
+		y[i] = ei_sigma(61, i);
+	}
+	halton_high = bench_l2_star_discrepancy(x, y, BENCH_DISCREPANCY_POINTS);
+
+	sobol = 0.0;
+	for (s = 0; s < BENCH_NUM_SEEDS; ++s)
+	{
+		eiUint	seed = ei_qmc_pixel_seed((eiInt)s, 0);
+
+		for (i = 0; i < BENCH_DISCREPANCY_POINTS; ++i)
+		{
+			x[i] = ei_sobol(0, (eiUint)i, seed);
+			y[i] = ei_sobol(1, (eiUint)i, seed);
+		}
+		sobol += bench_l2_star_discrepancy(x, y, BENCH_DISCREPANCY_POINTS);
+	}
+	sobol /= (double)BENCH_NUM_SEEDS;
+
+	printf("L2-star discrepancy of %d points: Halton 0-1 %.3e, Halton 60-61 %.3e, Sobol %.3e\n",
+		BENCH_DISCREPANCY_POINTS, halton_low, halton_high, sobol);
+}
+
+int main(int argc, char *argv[])
+{
+	eiInt	num_samples;
+
+	num_samples = (argc > 1) ? atoi(argv[1]) : 50000000;
+	num_samples = MAX(1, num_samples);
+
+	bench_generate(num_samples);
+	bench_discrepancy();
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_UNIT_TEST_H
+#define EI_UNIT_TEST_H
+
+/** \brief Minimal checking macros shared by unit tests.
+ * \file ei_unit_test.h
+ */
+
+#include <stdio.h>
+
+/* the number of failed checks in current test executable */
+static int g_NumFailures = 0;
+
+/** \brief Check a condition, report and count the failure 
+ * without stopping the test. */
+#define eiCHECK(cond) \
+	do {\
+		if (!(cond))\
+		{\
+			fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #cond);\
+			++ g_NumFailures;\
+		}\
+	} while (0)
+
+/** \brief Run a test function call and report it. */
+#define eiRUN_TEST(call) \
+	do {\
+		int num_failures = g_NumFailures;\
+		call;\
+		printf("%s: %s\n", #call, (g_NumFailures == num_failures) ? "passed" : "FAILED");\
+	} while (0)
+
+/** \brief The exit code of test executables. */
+#define eiTEST_RESULT()		((g_NumFailures == 0) ? 0 : 1)
+
+#endif
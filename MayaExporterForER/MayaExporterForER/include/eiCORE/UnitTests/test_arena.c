@@ -0,0 +1,226 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of the memory arena, allocations spanning many
+ * blocks, alignment, reuse of blocks after reset, and reserving the
+ * first block.
+ * \file test_arena.c
+ */
+
+#include <eiCORE/ei_arena.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <string.h>
+
+#define TEST_BLOCK_SIZE			256
+#define TEST_NUM_ALLOCATIONS	100
+#define TEST_ALLOCATION_SIZE	40
+
+/** \brief Fill the allocations with their indices and check that
+ * no allocation overwrote another one. */
+static void check_allocations(eiByte **ptrs, const eiInt num_ptrs, const eiSizet size)
+{
+	eiInt	i;
+	eiSizet	k;
+
+	for (i = 0; i < num_ptrs; ++i)
+	{
+		memset(ptrs[i], i, size);
+	}
+
+	for (i = 0; i < num_ptrs; ++i)
+	{
+		for (k = 0; k < size; ++k)
+		{
+			if (ptrs[i][k] != (eiByte)i)
+			{
+				eiCHECK(ptrs[i][k] == (eiByte)i);
+				return;
+			}
+		}
+	}
+}
+
+static void test_multiple_blocks()
+{
+	ei_arena	arena;
+	eiByte		*ptrs[ TEST_NUM_ALLOCATIONS ];
+	eiInt		i;
+
+	ei_arena_init(&arena, TEST_BLOCK_SIZE);
+
+	for (i = 0; i < TEST_NUM_ALLOCATIONS; ++i)
+	{
+		ptrs[i] = (eiByte *)ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+		eiCHECK(ptrs[i] != NULL);
+	}
+
+	check_allocations(ptrs, TEST_NUM_ALLOCATIONS, TEST_ALLOCATION_SIZE);
+
+	/* 5 aligned allocations of 48 bytes fit in a block of 256 */
+	eiCHECK(arena.numBlocks == (TEST_NUM_ALLOCATIONS + 4) / 5);
+	eiCHECK(arena.numAllocations == TEST_NUM_ALLOCATIONS);
+	eiCHECK(arena.usedSize == TEST_NUM_ALLOCATIONS * ei_arena_aligned_size(TEST_ALLOCATION_SIZE));
+	eiCHECK(arena.peakSize == arena.usedSize);
+
+	/* an allocation larger than a block gets a block of its own */
+	ptrs[0] = (eiByte *)ei_arena_allocate(&arena, TEST_BLOCK_SIZE * 3);
+	memset(ptrs[0], 0xFF, TEST_BLOCK_SIZE * 3);
+	eiCHECK(arena.numBlocks == (TEST_NUM_ALLOCATIONS + 4) / 5 + 1);
+
+	ei_arena_clear(&arena);
+
+	eiCHECK(arena.usedSize == 0);
+	eiCHECK(arena.firstBlock == NULL);
+}
+
+static void test_alignment()
+{
+	ei_arena	arena;
+	eiSizet		size;
+
+	ei_arena_init(&arena, TEST_BLOCK_SIZE);
+
+	for (size = 1; size <= TEST_BLOCK_SIZE + 1; ++size)
+	{
+		eiByte	*ptr;
+
+		ptr = (eiByte *)ei_arena_allocate(&arena, size);
+
+		eiCHECK(((eiIntptr)ptr & (EI_ARENA_ALIGNMENT - 1)) == 0);
+
+		memset(ptr, 0, size);
+	}
+
+	eiCHECK(ei_arena_aligned_size(1) == EI_ARENA_ALIGNMENT);
+	eiCHECK(ei_arena_aligned_size(EI_ARENA_ALIGNMENT) == EI_ARENA_ALIGNMENT);
+	eiCHECK(ei_arena_aligned_size(EI_ARENA_ALIGNMENT + 1) == 2 * EI_ARENA_ALIGNMENT);
+
+	ei_arena_clear(&arena);
+}
+
+static void test_reset_reuse()
+{
+	ei_arena	arena;
+	eiByte		*ptrs[ TEST_NUM_ALLOCATIONS ];
+	eiInt64		num_blocks;
+	eiSizet		peak_size;
+	eiInt		round, i;
+
+	ei_arena_init(&arena, TEST_BLOCK_SIZE);
+
+	for (i = 0; i < TEST_NUM_ALLOCATIONS; ++i)
+	{
+		ptrs[i] = (eiByte *)ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+	}
+
+	num_blocks = arena.numBlocks;
+	peak_size = arena.peakSize;
+
+	for (round = 0; round < 3; ++round)
+	{
+		ei_arena_reset(&arena);
+
+		eiCHECK(arena.usedSize == 0);
+		eiCHECK(arena.currentBlock == arena.firstBlock);
+
+		/* the same allocations get the same memory again,
+		   without allocating from the system */
+		for (i = 0; i < TEST_NUM_ALLOCATIONS; ++i)
+		{
+			eiByte	*ptr;
+
+			ptr = (eiByte *)ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+
+			eiCHECK(ptr == ptrs[i]);
+		}
+
+		check_allocations(ptrs, TEST_NUM_ALLOCATIONS, TEST_ALLOCATION_SIZE);
+
+		eiCHECK(arena.numBlocks == num_blocks);
+		eiCHECK(arena.peakSize == peak_size);
+	}
+
+	/* fewer allocations after reset never reach the later blocks */
+	ei_arena_reset(&arena);
+	ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+	eiCHECK(arena.currentBlock == arena.firstBlock);
+	eiCHECK(arena.numBlocks == num_blocks);
+
+	ei_arena_clear(&arena);
+}
+
+static void test_reserve()
+{
+	ei_arena	arena;
+	eiByte		*ptrs[ TEST_NUM_ALLOCATIONS ];
+	eiInt64		num_blocks;
+	eiInt		i;
+
+	ei_arena_init(&arena, TEST_BLOCK_SIZE);
+
+	/* reserving an empty arena creates the first block */
+	ei_arena_reserve(&arena, TEST_BLOCK_SIZE * 4);
+	eiCHECK(arena.numBlocks == 1);
+	eiCHECK(arena.usedSize == 0);
+
+	for (i = 0; i < TEST_NUM_ALLOCATIONS; ++i)
+	{
+		ptrs[i] = (eiByte *)ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+	}
+
+	check_allocations(ptrs, TEST_NUM_ALLOCATIONS, TEST_ALLOCATION_SIZE);
+
+	/* 21 allocations of 48 bytes fit in the reserved 1024 bytes */
+	eiCHECK(arena.numBlocks == 1 + (TEST_NUM_ALLOCATIONS - 21 + 4) / 5);
+	num_blocks = arena.numBlocks;
+
+	/* the precondition is usedSize == 0, reserving while memory
+	   is in use must not free the block it was handed out from */
+	ei_arena_reserve(&arena, TEST_BLOCK_SIZE * 64);
+	eiCHECK(arena.numBlocks == num_blocks);
+	check_allocations(ptrs, TEST_NUM_ALLOCATIONS, TEST_ALLOCATION_SIZE);
+
+	/* a reserve no larger than the first block does nothing */
+	ei_arena_reset(&arena);
+	ei_arena_reserve(&arena, TEST_BLOCK_SIZE);
+	eiCHECK(arena.numBlocks == num_blocks);
+
+	/* after reset, a larger reserve replaces the first block,
+	   and all allocations fit in it */
+	ei_arena_reserve(&arena, TEST_NUM_ALLOCATIONS * ei_arena_aligned_size(TEST_ALLOCATION_SIZE));
+	eiCHECK(arena.numBlocks == num_blocks + 1);
+
+	for (i = 0; i < TEST_NUM_ALLOCATIONS; ++i)
+	{
+		ptrs[i] = (eiByte *)ei_arena_allocate(&arena, TEST_ALLOCATION_SIZE);
+	}
+
+	check_allocations(ptrs, TEST_NUM_ALLOCATIONS, TEST_ALLOCATION_SIZE);
+
+	eiCHECK(arena.currentBlock == arena.firstBlock);
+	eiCHECK(arena.numBlocks == num_blocks + 1);
+
+	ei_arena_clear(&arena);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_multiple_blocks());
+	eiRUN_TEST(test_alignment());
+	eiRUN_TEST(test_reset_reuse());
+	eiRUN_TEST(test_reserve());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of batched transforms and SIMD matrix products, the
+ * results must match the scalar functions of ei_matrix.h for every
+ * array length, also in place, and nothing beyond the array length
+ * may be written.
+ * \file test_matrix_batch.c
+ */
+
+#include <eiCORE/ei_matrix_batch.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TEST_MAX_LENGTH		19
+#define TEST_CAPACITY		(TEST_MAX_LENGTH + 1)
+#define TEST_NUM_MATRICES	16
+/* relative to the magnitude of the terms, pairwise adds may round
+   differently from the scalar code */
+#define TEST_TOLERANCE		1.0e-5f
+/* the slots beyond the array length are filled with this */
+#define TEST_GUARD_VALUE	-12345.0f
+
+static eiScalar test_random(const eiScalar range)
+{
+	return range * (2.0f * (eiScalar)rand() / (eiScalar)RAND_MAX - 1.0f);
+}
+
+/** \brief A random affine matrix, or a general one with a projective
+ * last column. */
+static void test_random_matrix(eiMatrix *mx, const eiBool projective)
+{
+	eiScalar	*m = &mx->m1;
+	eiInt		i;
+
+	for (i = 0; i < 16; ++i)
+	{
+		m[i] = test_random(10.0f);
+	}
+
+	if (!projective)
+	{
+		mx->m4 = 0.0f;
+		mx->m8 = 0.0f;
+		mx->m12 = 0.0f;
+		mx->m16 = 1.0f;
+	}
+}
+
+static eiBool test_near(const eiScalar a, const eiScalar b, const eiScalar magnitude)
+{
+	return absf(a - b) <= TEST_TOLERANCE * MAX(1.0f, magnitude);
+}
+
+static void test_fill_guard(eiVector *v, const eiInt capacity)
+{
+	eiInt	i;
+
+	for (i = 0; i < capacity; ++i)
+	{
+		setv(&v[i], TEST_GUARD_VALUE, TEST_GUARD_VALUE, TEST_GUARD_VALUE);
+	}
+}
+
+/** \brief Check transformed packed vectors against the scalar
+ * transforms, and check the guard slots after them. */
+static eiBool test_check_array(
+	const eiVector *result,
+	const eiVector *src,
+	const eiInt n,
+	const eiMatrix *mx,
+	const eiBool point)
+{
+	eiBool	passed = eiTRUE;
+	eiInt	i;
+
+	for (i = 0; i < n; ++i)
+	{
+		eiVector	expected;
+
+		if (point)
+		{
+			point_transform(&expected, &src[i], mx);
+		}
+		else
+		{
+			vector_transform(&expected, &src[i], mx);
+		}
+
+		/* coordinates up to 100 times entries up to 10 */
+		if (!test_near(result[i].x, expected.x, 3000.0f) ||
+			!test_near(result[i].y, expected.y, 3000.0f) ||
+			!test_near(result[i].z, expected.z, 3000.0f))
+		{
+			passed = eiFALSE;
+		}
+	}
+
+	for (i = n; i < TEST_CAPACITY; ++i)
+	{
+		if (result[i].x != TEST_GUARD_VALUE ||
+			result[i].y != TEST_GUARD_VALUE ||
+			result[i].z != TEST_GUARD_VALUE)
+		{
+			passed = eiFALSE;
+		}
+	}
+
+	return passed;
+}
+
+static void test_random_vectors(eiVector *v, const eiInt capacity)
+{
+	eiInt	i;
+
+	for (i = 0; i < capacity; ++i)
+	{
+		setv(&v[i], test_random(100.0f), test_random(100.0f), test_random(100.0f));
+	}
+}
+
+/** \brief Transform packed arrays of every length, both into another
+ * array and in place. */
+static void test_transform_array()
+{
+	eiVector	src[ TEST_CAPACITY ];
+	eiVector	dst[ TEST_CAPACITY ];
+	eiMatrix	mx;
+	eiInt		m, n;
+
+	for (m = 0; m < TEST_NUM_MATRICES; ++m)
+	{
+		test_random_matrix(&mx, eiFALSE);
+
+		for (n = 0; n <= TEST_MAX_LENGTH; ++n)
+		{
+			test_random_vectors(src, TEST_CAPACITY);
+
+			test_fill_guard(dst, TEST_CAPACITY);
+			ei_point_transform_array(dst, src, n, &mx);
+			eiCHECK(test_check_array(dst, src, n, &mx, eiTRUE));
+
+			test_fill_guard(dst, TEST_CAPACITY);
+			ei_vector_transform_array(dst, src, n, &mx);
+			eiCHECK(test_check_array(dst, src, n, &mx, eiFALSE));
+
+			/* in place */
+			test_fill_guard(dst, TEST_CAPACITY);
+			memcpy(dst, src, sizeof(eiVector) * n);
+			ei_point_transform_array(dst, dst, n, &mx);
+			eiCHECK(test_check_array(dst, src, n, &mx, eiTRUE));
+
+			test_fill_guard(dst, TEST_CAPACITY);
+			memcpy(dst, src, sizeof(eiVector) * n);
+			ei_vector_transform_array(dst, dst, n, &mx);
+			eiCHECK(test_check_array(dst, src, n, &mx, eiFALSE));
+		}
+	}
+}
+
+/** \brief Transform structure-of-arrays of every length, both into
+ * other arrays and in place. */
+static void test_transform_soa()
+{
+	eiScalar	x[ TEST_CAPACITY ], y[ TEST_CAPACITY ], z[ TEST_CAPACITY ];
+	eiScalar	ox[ TEST_CAPACITY ], oy[ TEST_CAPACITY ], oz[ TEST_CAPACITY ];
+	eiVector	src[ TEST_CAPACITY ];
+	eiVector	dst[ TEST_CAPACITY ];
+	eiMatrix	mx;
+	eiInt		m, n, k, i;
+
+	for (m = 0; m < TEST_NUM_MATRICES; ++m)
+	{
+		test_random_matrix(&mx, eiFALSE);
+
+		for (n = 0; n <= TEST_MAX_LENGTH; ++n)
+		{
+			for (k = 0; k < 4; ++k)
+			{
+				const eiBool	point = ((k & 1) == 0);
+				const eiBool	in_place = ((k & 2) != 0);
+
+				test_random_vectors(src, TEST_CAPACITY);
+
+				for (i = 0; i < TEST_CAPACITY; ++i)
+				{
+					x[i] = src[i].x;
+					y[i] = src[i].y;
+					z[i] = src[i].z;
+					ox[i] = oy[i] = oz[i] = TEST_GUARD_VALUE;
+				}
+
+				if (in_place)
+				{
+					memcpy(ox, x, sizeof(eiScalar) * n);
+					memcpy(oy, y, sizeof(eiScalar) * n);
+					memcpy(oz, z, sizeof(eiScalar) * n);
+				}
+
+				if (point)
+				{
+					ei_point_transform_soa(ox, oy, oz,
+						in_place ? ox : x, in_place ? oy : y, in_place ? oz : z, n, &mx);
+				}
+				else
+				{
+					ei_vector_transform_soa(ox, oy, oz,
+						in_place ? ox : x, in_place ? oy : y, in_place ? oz : z, n, &mx);
+				}
+
+				for (i = 0; i < TEST_CAPACITY; ++i)
+				{
+					setv(&dst[i], ox[i], oy[i], oz[i]);
+				}
+
+				eiCHECK(test_check_array(dst, src, n, &mx, point));
+			}
+		}
+	}
+}
+
+static eiBool test_check_matrix(const eiMatrix *result, const eiMatrix *expected)
+{
+	eiInt	i;
+
+	for (i = 0; i < 16; ++i)
+	{
+		/* four products of entries up to 10 */
+		if (!test_near((&result->m1)[i], (&expected->m1)[i], 400.0f))
+		{
+			return eiFALSE;
+		}
+	}
+
+	return eiTRUE;
+}
+
+/** \brief SIMD matrix products against mulmm, also with the result
+ * stored over either operand. */
+static void test_mulmm()
+{
+	eiMatrix	a, b, r, expected;
+	eiInt		m;
+
+	for (m = 0; m < TEST_NUM_MATRICES; ++m)
+	{
+		test_random_matrix(&a, eiTRUE);
+		test_random_matrix(&b, eiTRUE);
+
+		mulmm(&expected, &a, &b);
+
+		ei_mulmm_simd(&r, &a, &b);
+		eiCHECK(test_check_matrix(&r, &expected));
+
+		movm(&r, &a);
+		ei_mulmm_simd(&r, &r, &b);
+		eiCHECK(test_check_matrix(&r, &expected));
+
+		movm(&r, &b);
+		ei_mulmm_simd(&r, &a, &r);
+		eiCHECK(test_check_matrix(&r, &expected));
+	}
+}
+
+/** \brief Arrays of 4-component vectors of every length against
+ * mulvm4, both into another array and in place. */
+static void test_mulvm4_array()
+{
+	eiVector4	src[ TEST_CAPACITY ];
+	eiVector4	dst[ TEST_CAPACITY ];
+	eiMatrix	mx;
+	eiInt		n, i, in_place;
+
+	test_random_matrix(&mx, eiTRUE);
+
+	for (n = 0; n <= TEST_MAX_LENGTH; ++n)
+	{
+		for (in_place = 0; in_place < 2; ++in_place)
+		{
+			eiBool	passed = eiTRUE;
+
+			for (i = 0; i < TEST_CAPACITY; ++i)
+			{
+				setv4(&src[i], test_random(100.0f), test_random(100.0f), test_random(100.0f), test_random(100.0f));
+				setv4(&dst[i], TEST_GUARD_VALUE, TEST_GUARD_VALUE, TEST_GUARD_VALUE, TEST_GUARD_VALUE);
+			}
+
+			if (in_place)
+			{
+				memcpy(dst, src, sizeof(eiVector4) * n);
+				ei_mulvm4_array(dst, dst, n, &mx);
+			}
+			else
+			{
+				ei_mulvm4_array(dst, src, n, &mx);
+			}
+
+			for (i = 0; i < n; ++i)
+			{
+				eiVector4	expected;
+
+				mulvm4(&expected, &src[i], &mx);
+
+				passed = passed
+					&& test_near(dst[i].x, expected.x, 4000.0f)
+					&& test_near(dst[i].y, expected.y, 4000.0f)
+					&& test_near(dst[i].z, expected.z, 4000.0f)
+					&& test_near(dst[i].w, expected.w, 4000.0f);
+			}
+
+			for (i = n; i < TEST_CAPACITY; ++i)
+			{
+				passed = passed
+					&& dst[i].x == TEST_GUARD_VALUE && dst[i].y == TEST_GUARD_VALUE
+					&& dst[i].z == TEST_GUARD_VALUE && dst[i].w == TEST_GUARD_VALUE;
+			}
+
+			eiCHECK(passed);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	srand(1234);
+
+	eiRUN_TEST(test_transform_array());
+	eiRUN_TEST(test_transform_soa());
+	eiRUN_TEST(test_mulmm());
+	eiRUN_TEST(test_mulvm4_array());
+
+	return eiTEST_RESULT();
+}
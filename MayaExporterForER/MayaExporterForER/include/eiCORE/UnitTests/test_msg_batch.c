@@ -0,0 +1,612 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of message batching and tag leasing, including 
+ * a load test of many servers batching messages concurrently.
+ * \file test_msg_batch.c
+ */
+
+#include <eiCORE/ei_msg_batch.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <string.h>
+
+#define TEST_PORT				19831
+#define TEST_NUM_SERVERS		32
+#define TEST_NUM_MSGS			20000
+/* send a request expecting a reply every this number of messages */
+#define TEST_REQUEST_INTERVAL	100
+
+/** \brief Reads messages one by one, expanding message groups. */
+typedef struct TestReader {
+	SOCKET		sock;
+	eiMessage	msgs[ EI_MSG_BATCH_DEFAULT_SIZE ];
+	eiUint		num_msgs;
+	eiUint		next_msg;
+	eiUint		num_groups;
+} TestReader;
+
+static void test_reader_init(TestReader *reader, SOCKET sock)
+{
+	reader->sock = sock;
+	reader->num_msgs = 0;
+	reader->next_msg = 0;
+	reader->num_groups = 0;
+}
+
+static eiBool test_reader_next(TestReader *reader, eiMessage *msg)
+{
+	if (reader->next_msg < reader->num_msgs)
+	{
+		*msg = reader->msgs[reader->next_msg ++];
+		return eiTRUE;
+	}
+
+	if (!ei_net_recv(reader->sock, (eiByte *)msg, sizeof(eiMessage)))
+	{
+		return eiFALSE;
+	}
+
+	if (msg->type != EI_MSG_GROUP)
+	{
+		return eiTRUE;
+	}
+
+	if (msg->group.num_msgs == 0 || msg->group.num_msgs > EI_MSG_BATCH_DEFAULT_SIZE)
+	{
+		return eiFALSE;
+	}
+
+	++ reader->num_groups;
+	reader->num_msgs = msg->group.num_msgs;
+	reader->next_msg = 0;
+
+	if (!ei_net_recv(reader->sock, (eiByte *)reader->msgs, sizeof(eiMessage) * reader->num_msgs))
+	{
+		return eiFALSE;
+	}
+
+	*msg = reader->msgs[reader->next_msg ++];
+
+	return eiTRUE;
+}
+
+/** \brief Create connected socket pairs through a local listening socket. */
+static eiBool test_connect(SOCKET *clients, SOCKET *servers, const eiUint count)
+{
+	SOCKET		listener;
+	SOCKADDR_IN	addr;
+	eiUint		i;
+
+	if (!ei_net_init_server(&listener, TEST_PORT, count))
+	{
+		return eiFALSE;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		if (!ei_net_init_client(&clients[i], TEST_PORT, "127.0.0.1"))
+		{
+			ei_net_close_socket(&listener);
+			return eiFALSE;
+		}
+
+		servers[i] = ei_net_accept(listener, &addr);
+	}
+
+	ei_net_close_socket(&listener);
+
+	return eiTRUE;
+}
+
+static void test_byteswap()
+{
+	eiShort		s;
+	eiInt		i;
+	eiLong		l;
+
+	s = 0x0102;
+	ei_byteswap_short(&s);
+	eiCHECK(s == 0x0201);
+
+	i = 0x01020304;
+	ei_byteswap_int(&i);
+	eiCHECK(i == 0x04030201);
+
+	l = 0x0102030405060708LL;
+	ei_byteswap_long(&l);
+	eiCHECK(l == 0x0807060504030201LL);
+}
+
+static void test_batchable()
+{
+	eiCHECK(ei_msg_is_batchable(EI_MSG_REQ_STEP_PROGRESS));
+	eiCHECK(ei_msg_is_batchable(EI_MSG_BUCKET_FINISHED));
+	/* requests expecting a reply must never wait in a batch */
+	eiCHECK(!ei_msg_is_batchable(EI_MSG_REQ_SEND_DATA));
+	eiCHECK(!ei_msg_is_batchable(EI_MSG_REQ_ALLOCATE_TAG_RANGE));
+	eiCHECK(!ei_msg_is_batchable(EI_MSG_REQ_CHECK_ABORT));
+}
+
+static void test_request_flushes_batch()
+{
+	SOCKET		client, server;
+	eiMsgBatch	batch;
+	TestReader	reader;
+	eiMessage	msg;
+	eiUint		i;
+
+	if (!test_connect(&client, &server, 1))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	ei_msg_batch_init(&batch, client, eiFALSE, EI_MSG_BATCH_DEFAULT_SIZE);
+
+	for (i = 0; i < 10; ++i)
+	{
+		ei_msg_init(&msg);
+		ei_msg_set(&msg, EI_MSG_REQ_STEP_PROGRESS);
+		msg.step_progress_params.count = i;
+		eiCHECK(ei_msg_batch_add(&batch, &msg));
+	}
+
+	ei_msg_init(&msg);
+	ei_msg_set(&msg, EI_MSG_REQ_SEND_DATA);
+	msg.send_data_params.data = 1234;
+	eiCHECK(ei_msg_batch_add(&batch, &msg));
+
+	/* without flushing the batch explicitly, the request and 
+	   the messages before it must have been sent in order */
+	test_reader_init(&reader, server);
+
+	for (i = 0; i < 10; ++i)
+	{
+		eiCHECK(test_reader_next(&reader, &msg));
+		eiCHECK(msg.type == EI_MSG_REQ_STEP_PROGRESS);
+		eiCHECK(msg.step_progress_params.count == i);
+	}
+
+	eiCHECK(test_reader_next(&reader, &msg));
+	eiCHECK(msg.type == EI_MSG_REQ_SEND_DATA);
+	eiCHECK(msg.send_data_params.data == 1234);
+	eiCHECK(reader.num_groups == 1);
+
+	ei_msg_batch_exit(&batch);
+	ei_net_close_socket(&client);
+	ei_net_close_socket(&server);
+}
+
+static void test_lease_keeps_remaining_tags()
+{
+	eiTagLease							lease;
+	eiMsgInfTagRangeAllocatedParams		range;
+	eiTag								tag;
+	eiUint								i;
+
+	ei_tag_lease_init(&lease);
+
+	eiCHECK(!ei_tag_lease_alloc(&lease, &tag));
+	eiCHECK(tag == eiNULL_TAG);
+
+	range.first_tag = 100;
+	range.count = 4;
+	ei_tag_lease_refill(&lease, &range);
+
+	eiCHECK(ei_tag_lease_alloc(&lease, &tag) && tag == 100);
+	eiCHECK(ei_tag_lease_available(&lease) == 3);
+
+	/* refill before the current range runs out */
+	range.first_tag = 500;
+	range.count = 2;
+	ei_tag_lease_refill(&lease, &range);
+
+	range.first_tag = 900;
+	range.count = 1;
+	ei_tag_lease_refill(&lease, &range);
+
+	eiCHECK(ei_tag_lease_available(&lease) == 6);
+
+	for (i = 101; i < 104; ++i)
+	{
+		eiCHECK(ei_tag_lease_alloc(&lease, &tag) && tag == i);
+	}
+
+	eiCHECK(ei_tag_lease_alloc(&lease, &tag) && tag == 500);
+	eiCHECK(ei_tag_lease_alloc(&lease, &tag) && tag == 501);
+	eiCHECK(ei_tag_lease_alloc(&lease, &tag) && tag == 900);
+	eiCHECK(ei_tag_lease_available(&lease) == 0);
+	eiCHECK(!ei_tag_lease_alloc(&lease, &tag));
+
+	eiCHECK(lease.num_leases == 3);
+
+	ei_tag_lease_exit(&lease);
+}
+
+#define TEST_NUM_DATA			16
+#define TEST_DATA_SIZE			(64 * 1024)
+
+/** \brief A remote host of different byte order replying data requests. */
+typedef struct TestResponder {
+	SOCKET		sock;
+	eiByte		*data;
+	/* the shared memory data arena of the responder, or NULL */
+	eiShmArena	*arena;
+	eiBool		result;
+} TestResponder;
+
+/* the number of payloads received through shared memory */
+static eiUint	g_NumShmPayloads = 0;
+
+static eiTHREAD_FUNC test_responder_thread(void *param)
+{
+	TestResponder	*resp;
+	eiMessage		req;
+	eiUint			i;
+
+	resp = (TestResponder *)param;
+	resp->result = eiTRUE;
+
+	for (i = 0; i < TEST_NUM_DATA && resp->result; ++i)
+	{
+		resp->result = ei_net_recv(resp->sock, (eiByte *)&req, sizeof(eiMessage));
+
+		/* the requests arrive in the foreign byte order */
+		ei_byteswap_int(&req.type);
+		ei_byteswap_int(&req.send_data_params.data);
+		ei_byteswap_int(&req.send_data_params.accept_compressed);
+		ei_byteswap_int(&req.send_data_params.accept_shm);
+
+		resp->result = resp->result && 
+			req.type == EI_MSG_REQ_SEND_DATA && 
+			req.send_data_params.data == i + 1 && 
+			req.send_data_params.accept_compressed == eiTRUE && 
+			req.send_data_params.accept_shm == (resp->arena != NULL) && 
+			ei_msg_send_data(
+				resp->sock, 
+				resp->data + i, 
+				TEST_DATA_SIZE, 
+				eiTRUE, 
+				eiTRUE, 
+				eiTRUE, 
+				resp->arena, 
+				NULL);
+	}
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiBool test_recv_data_proc(
+	SOCKET sock,
+	const eiTag tag,
+	const eiMsgInfDataInfoParams *info,
+	eiShmArena *arena,
+	void *param)
+{
+	eiByte		*expected;
+	eiByte		*data;
+	eiBool		result;
+
+	expected = (eiByte *)param;
+
+	if (info->size != TEST_DATA_SIZE || !info->inited)
+	{
+		return eiFALSE;
+	}
+
+	data = (eiByte *)ei_allocate(info->size);
+
+	if (info->in_shm)
+	{
+		++ g_NumShmPayloads;
+	}
+
+	result = ei_msg_recv_data(sock, info, arena, data) && 
+		memcmp(data, expected + (tag - 1), TEST_DATA_SIZE) == 0;
+
+	eiCHECK_FREE(data);
+
+	return result;
+}
+
+static void test_request_data_byteswap()
+{
+	SOCKET			client, server;
+	TestResponder	resp;
+	eiThreadHandle	thread;
+	eiTag			tags[ TEST_NUM_DATA ];
+	eiByte			*data;
+	eiUint			i;
+
+	if (!test_connect(&client, &server, 1))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	/* compressible data, each request gets a different window */
+	data = (eiByte *)ei_allocate(TEST_DATA_SIZE + TEST_NUM_DATA);
+
+	for (i = 0; i < TEST_DATA_SIZE + TEST_NUM_DATA; ++i)
+	{
+		data[i] = (eiByte)((i / 7) % 13);
+	}
+
+	for (i = 0; i < TEST_NUM_DATA; ++i)
+	{
+		tags[i] = i + 1;
+	}
+
+	resp.sock = server;
+	resp.data = data;
+	resp.arena = NULL;
+	resp.result = eiFALSE;
+
+	thread = ei_create_thread(test_responder_thread, &resp, NULL);
+
+	eiCHECK(ei_msg_request_data_pipelined(
+		client, 
+		tags, 
+		TEST_NUM_DATA, 
+		EI_MSG_PIPELINE_DEFAULT_DEPTH, 
+		eiFALSE, 
+		eiTRUE, 
+		NULL, 
+		test_recv_data_proc, 
+		data));
+
+	ei_wait_thread(thread);
+	ei_delete_thread(thread);
+
+	eiCHECK(resp.result);
+
+	eiCHECK_FREE(data);
+	ei_net_close_socket(&client);
+	ei_net_close_socket(&server);
+}
+
+#define TEST_SHM_ARENA_NAME		"/ei_test_msg_batch"
+/* the arena holds the payloads of half of the requests */
+#define TEST_SHM_ARENA_SIZE		(TEST_DATA_SIZE * TEST_NUM_DATA / 2)
+
+/** \brief A requester which has mapped the data arena of the responder 
+ * receives payloads through it, until the arena is full, after which 
+ * payloads fall back to the socket. */
+static void test_request_data_shm()
+{
+	SOCKET			client, server;
+	TestResponder	resp;
+	eiThreadHandle	thread;
+	eiShmArena		*mapped;
+	eiTag			tags[ TEST_NUM_DATA ];
+	eiByte			*data;
+	eiUint			i;
+
+	if (!test_connect(&client, &server, 1))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	data = (eiByte *)ei_allocate(TEST_DATA_SIZE + TEST_NUM_DATA);
+
+	for (i = 0; i < TEST_DATA_SIZE + TEST_NUM_DATA; ++i)
+	{
+		data[i] = (eiByte)((i / 7) % 13);
+	}
+
+	for (i = 0; i < TEST_NUM_DATA; ++i)
+	{
+		tags[i] = i + 1;
+	}
+
+	resp.sock = server;
+	resp.data = data;
+	resp.arena = ei_shm_create_arena(TEST_SHM_ARENA_NAME, TEST_SHM_ARENA_SIZE);
+	resp.result = eiFALSE;
+
+	mapped = ei_shm_open_arena(TEST_SHM_ARENA_NAME);
+
+	eiCHECK(resp.arena != NULL && mapped != NULL);
+
+	if (resp.arena == NULL || mapped == NULL)
+	{
+		ei_shm_close_arena(mapped);
+		ei_shm_close_arena(resp.arena);
+		eiCHECK_FREE(data);
+		ei_net_close_socket(&client);
+		ei_net_close_socket(&server);
+		return;
+	}
+
+	g_NumShmPayloads = 0;
+
+	thread = ei_create_thread(test_responder_thread, &resp, NULL);
+
+	eiCHECK(ei_msg_request_data_pipelined(
+		client, 
+		tags, 
+		TEST_NUM_DATA, 
+		EI_MSG_PIPELINE_DEFAULT_DEPTH, 
+		eiFALSE, 
+		eiTRUE, 
+		mapped, 
+		test_recv_data_proc, 
+		data));
+
+	ei_wait_thread(thread);
+	ei_delete_thread(thread);
+
+	eiCHECK(resp.result);
+
+	/* exactly half of the payloads fit in the arena */
+	eiCHECK(g_NumShmPayloads == TEST_NUM_DATA / 2);
+
+	ei_shm_close_arena(mapped);
+	ei_shm_close_arena(resp.arena);
+	eiCHECK_FREE(data);
+	ei_net_close_socket(&client);
+	ei_net_close_socket(&server);
+}
+
+/** \brief One simulated render server sending progress messages 
+ * and data requests to the manager. */
+typedef struct TestServer {
+	SOCKET		client;
+	SOCKET		server;
+	eiMsgBatch	batch;
+	eiBool		send_result;
+	eiBool		recv_result;
+	eiUint		num_groups;
+} TestServer;
+
+static eiTHREAD_FUNC test_server_send_thread(void *param)
+{
+	TestServer	*srv;
+	eiMessage	msg;
+	eiUint		i;
+
+	srv = (TestServer *)param;
+
+	srv->send_result = eiTRUE;
+
+	for (i = 0; i < TEST_NUM_MSGS; ++i)
+	{
+		ei_msg_init(&msg);
+
+		if ((i % TEST_REQUEST_INTERVAL) == TEST_REQUEST_INTERVAL - 1)
+		{
+			ei_msg_set(&msg, EI_MSG_REQ_SEND_DATA);
+			msg.send_data_params.data = i;
+		}
+		else
+		{
+			ei_msg_set(&msg, EI_MSG_REQ_STEP_PROGRESS);
+			msg.step_progress_params.count = i;
+		}
+
+		srv->send_result = srv->send_result && ei_msg_batch_add(&srv->batch, &msg);
+	}
+
+	srv->send_result = srv->send_result && ei_msg_batch_flush(&srv->batch);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static eiTHREAD_FUNC test_server_recv_thread(void *param)
+{
+	TestServer	*srv;
+	TestReader	reader;
+	eiMessage	msg;
+	eiUint		i;
+
+	srv = (TestServer *)param;
+
+	test_reader_init(&reader, srv->server);
+	srv->recv_result = eiTRUE;
+
+	for (i = 0; i < TEST_NUM_MSGS && srv->recv_result; ++i)
+	{
+		if (!test_reader_next(&reader, &msg))
+		{
+			srv->recv_result = eiFALSE;
+		}
+		else if ((i % TEST_REQUEST_INTERVAL) == TEST_REQUEST_INTERVAL - 1)
+		{
+			srv->recv_result = (msg.type == EI_MSG_REQ_SEND_DATA && 
+				msg.send_data_params.data == i);
+		}
+		else
+		{
+			srv->recv_result = (msg.type == EI_MSG_REQ_STEP_PROGRESS && 
+				msg.step_progress_params.count == i);
+		}
+	}
+
+	srv->num_groups = reader.num_groups;
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static void test_load_many_servers()
+{
+	SOCKET			clients[ TEST_NUM_SERVERS ];
+	SOCKET			servers[ TEST_NUM_SERVERS ];
+	TestServer		srvs[ TEST_NUM_SERVERS ];
+	eiThreadHandle	send_threads[ TEST_NUM_SERVERS ];
+	eiThreadHandle	recv_threads[ TEST_NUM_SERVERS ];
+	eiUint			i;
+
+	if (!test_connect(clients, servers, TEST_NUM_SERVERS))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	for (i = 0; i < TEST_NUM_SERVERS; ++i)
+	{
+		srvs[i].client = clients[i];
+		srvs[i].server = servers[i];
+		srvs[i].send_result = eiFALSE;
+		srvs[i].recv_result = eiFALSE;
+		srvs[i].num_groups = 0;
+		ei_msg_batch_init(&srvs[i].batch, clients[i], eiFALSE, EI_MSG_BATCH_DEFAULT_SIZE);
+	}
+
+	for (i = 0; i < TEST_NUM_SERVERS; ++i)
+	{
+		recv_threads[i] = ei_create_thread(test_server_recv_thread, &srvs[i], NULL);
+		send_threads[i] = ei_create_thread(test_server_send_thread, &srvs[i], NULL);
+	}
+
+	for (i = 0; i < TEST_NUM_SERVERS; ++i)
+	{
+		ei_wait_thread(send_threads[i]);
+		ei_delete_thread(send_threads[i]);
+		ei_wait_thread(recv_threads[i]);
+		ei_delete_thread(recv_threads[i]);
+	}
+
+	for (i = 0; i < TEST_NUM_SERVERS; ++i)
+	{
+		eiCHECK(srvs[i].send_result);
+		eiCHECK(srvs[i].recv_result);
+		/* every run of progress messages is sent as one group */
+		eiCHECK(srvs[i].num_groups == TEST_NUM_MSGS / TEST_REQUEST_INTERVAL * 
+			((TEST_REQUEST_INTERVAL - 1 + EI_MSG_BATCH_DEFAULT_SIZE - 1) / EI_MSG_BATCH_DEFAULT_SIZE));
+
+		ei_msg_batch_exit(&srvs[i].batch);
+		ei_net_close_socket(&srvs[i].client);
+		ei_net_close_socket(&srvs[i].server);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	ei_net_startup();
+
+	eiRUN_TEST(test_byteswap());
+	eiRUN_TEST(test_batchable());
+	eiRUN_TEST(test_request_flushes_batch());
+	eiRUN_TEST(test_lease_keeps_remaining_tags());
+	eiRUN_TEST(test_request_data_byteswap());
+	eiRUN_TEST(test_request_data_shm());
+	eiRUN_TEST(test_load_many_servers());
+
+	ei_net_shutdown();
+
+	return eiTEST_RESULT();
+}
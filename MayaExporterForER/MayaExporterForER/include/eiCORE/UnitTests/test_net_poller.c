@@ -0,0 +1,425 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of the network poller and message frame sizes, 
+ * including a load test of many connections.
+ * \file test_net_poller.c
+ */
+
+#include <eiCORE/ei_net_poller.h>
+#include <eiCORE/ei_msg_batch.h>
+#include <eiCORE/ei_compress.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <string.h>
+#ifdef EI_OS_LINUX
+#include <dirent.h>
+#endif
+
+#define TEST_PORT				19833
+#define TEST_NUM_CLIENTS		64
+#define TEST_NUM_FRAMES			500
+#define TEST_MAX_PAYLOAD		8192
+#define TEST_NUM_RECYCLES		500
+/* the time-out of waiting for frames in milliseconds */
+#define TEST_TIMEOUT			10000
+
+static eiBool test_connect(SOCKET *clients, SOCKET *servers, const eiUint count)
+{
+	SOCKET		listener;
+	SOCKADDR_IN	addr;
+	eiUint		i;
+
+	if (!ei_net_init_server(&listener, TEST_PORT, count))
+	{
+		return eiFALSE;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		if (!ei_net_init_client(&clients[i], TEST_PORT, "127.0.0.1"))
+		{
+			ei_net_close_socket(&listener);
+			return eiFALSE;
+		}
+
+		servers[i] = ei_net_accept(listener, &addr);
+	}
+
+	ei_net_close_socket(&listener);
+
+	return eiTRUE;
+}
+
+/** \brief Returns the number of open file descriptors of this process. */
+static eiInt test_count_fds()
+{
+	eiInt	count;
+#ifdef EI_OS_LINUX
+	DIR		*dir;
+
+	count = 0;
+	dir = opendir("/proc/self/fd");
+
+	if (dir != NULL)
+	{
+		while (readdir(dir) != NULL)
+		{
+			++ count;
+		}
+
+		closedir(dir);
+	}
+#else
+	count = 0;
+#endif
+
+	return count;
+}
+
+static void test_frame_size()
+{
+	eiMessage			msg;
+	eiMsgFrameParams	params;
+
+	ei_msg_init(&msg);
+	ei_msg_set(&msg, EI_MSG_REQ_STEP_PROGRESS);
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == sizeof(eiMessage));
+
+	ei_msg_init(&msg);
+	ei_msg_set(&msg, EI_MSG_GROUP);
+	msg.group.num_msgs = 3;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == sizeof(eiMessage) * 4);
+
+	/* corrupted group sizes are rejected instead of clamped */
+	msg.group.num_msgs = 0x7fffffff;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == 0);
+
+	ei_msg_init(&msg);
+	ei_msg_set(&msg, EI_MSG_INF_DATA_INFO);
+	msg.data_info_params.size = 1000;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == sizeof(eiMessage) + 1000);
+
+	msg.data_info_params.wire_size = 100;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == sizeof(eiMessage) + 100);
+
+	msg.data_info_params.wire_size = ei_lz_compress_bound(1000) + 1;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == 0);
+
+	msg.data_info_params.size = 0xfffffff0;
+	msg.data_info_params.wire_size = 0;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, NULL) == 0);
+
+	params.need_byteswap = eiFALSE;
+	params.max_payload_size = 4096;
+	msg.data_info_params.size = 4097;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, &params) == 0);
+	msg.data_info_params.size = 4096;
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, &params) == sizeof(eiMessage) + 4096);
+
+	/* a header in foreign byte order */
+	params.need_byteswap = eiTRUE;
+	ei_byteswap_msg(&msg);
+	eiCHECK(ei_msg_frame_size((eiByte *)&msg, &params) == sizeof(eiMessage) + 4096);
+}
+
+static void test_recycle_slots(eiNetPoller *poller)
+{
+	eiInt		num_fds;
+	eiUint		i;
+
+	num_fds = test_count_fds();
+
+	for (i = 0; i < TEST_NUM_RECYCLES; ++i)
+	{
+		SOCKET		client, server;
+		eiInt		conn;
+
+		if (!test_connect(&client, &server, 1))
+		{
+			eiCHECK(!"failed to connect");
+			return;
+		}
+
+		conn = ei_net_poller_add(poller, server);
+		eiCHECK(conn >= 0);
+
+		ei_net_poller_remove(poller, conn);
+		/* removing twice is harmless */
+		ei_net_poller_remove(poller, conn);
+
+		eiCHECK(!ei_net_poller_send(poller, conn, (eiByte *)&i, sizeof(i)));
+
+		ei_net_close_socket(&client);
+	}
+
+	/* the sockets are closed by the I/O threads asynchronously */
+	for (i = 0; i < 100 && test_count_fds() > num_fds; ++i)
+	{
+		ei_sleep(10);
+	}
+
+	eiCHECK(test_count_fds() == num_fds);
+}
+
+static void test_corrupted_header(eiNetPoller *poller)
+{
+	SOCKET			client, server;
+	eiMessage		msg;
+	eiNetFrame		*frame;
+	eiInt			conn;
+
+	if (!test_connect(&client, &server, 1))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	conn = ei_net_poller_add(poller, server);
+	eiCHECK(conn >= 0);
+
+	ei_msg_init(&msg);
+	ei_msg_set(&msg, EI_MSG_GROUP);
+	msg.group.num_msgs = 0x7fffffff;
+	eiCHECK(ei_net_send(client, (eiByte *)&msg, sizeof(eiMessage)));
+
+	/* the connection must be closed without allocating the frame */
+	frame = ei_net_poller_wait(poller, TEST_TIMEOUT);
+	eiCHECK(frame != NULL && frame->conn == conn && frame->size == 0);
+
+	if (frame != NULL)
+	{
+		ei_net_free_frame(frame);
+	}
+
+	ei_net_poller_remove(poller, conn);
+	ei_net_close_socket(&client);
+}
+
+/** \brief A client sending data frames and receiving the echoes. */
+typedef struct TestClient {
+	SOCKET		sock;
+	eiUint		index;
+	eiBool		result;
+} TestClient;
+
+static eiUint test_payload_size(const eiUint client, const eiUint frame)
+{
+	return ((client * 7919 + frame * 104729) % (TEST_MAX_PAYLOAD + 1));
+}
+
+static eiByte test_payload_byte(const eiUint client, const eiUint frame, const eiUint i)
+{
+	return (eiByte)(client + frame * 3 + i);
+}
+
+static eiTHREAD_FUNC test_client_thread(void *param)
+{
+	TestClient	*client;
+	eiByte		*buffer;
+	eiUint		i, j;
+
+	client = (TestClient *)param;
+	buffer = (eiByte *)ei_allocate(sizeof(eiMessage) + TEST_MAX_PAYLOAD);
+	client->result = eiTRUE;
+
+	for (i = 0; i < TEST_NUM_FRAMES && client->result; ++i)
+	{
+		eiMessage	msg;
+		eiUint		size;
+
+		size = test_payload_size(client->index, i);
+
+		ei_msg_init(&msg);
+		ei_msg_set(&msg, EI_MSG_INF_DATA_INFO);
+		msg.data_info_params.size = size;
+		msg.data_info_params.inited = eiTRUE;
+
+		memcpy(buffer, &msg, sizeof(eiMessage));
+
+		for (j = 0; j < size; ++j)
+		{
+			buffer[sizeof(eiMessage) + j] = test_payload_byte(client->index, i, j);
+		}
+
+		client->result = ei_net_send(client->sock, buffer, sizeof(eiMessage) + size);
+	}
+
+	/* receive the echoes of frame indices */
+	for (i = 0; i < TEST_NUM_FRAMES && client->result; ++i)
+	{
+		eiMessage	msg;
+
+		client->result = ei_net_recv(client->sock, (eiByte *)&msg, sizeof(eiMessage)) && 
+			msg.type == EI_MSG_REQ_STEP_PROGRESS && 
+			msg.step_progress_params.count == i;
+	}
+
+	eiCHECK_FREE(buffer);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+static void test_load_many_connections(eiNetPoller *poller)
+{
+	SOCKET			socks[ TEST_NUM_CLIENTS ];
+	SOCKET			servers[ TEST_NUM_CLIENTS ];
+	TestClient		clients[ TEST_NUM_CLIENTS ];
+	eiThreadHandle	threads[ TEST_NUM_CLIENTS ];
+	eiInt			conns[ TEST_NUM_CLIENTS ];
+	eiUint			num_received[ TEST_NUM_CLIENTS ];
+	eiUint			total;
+	eiBool			payload_ok;
+	eiUint			i;
+
+	if (!test_connect(socks, servers, TEST_NUM_CLIENTS))
+	{
+		eiCHECK(!"failed to connect");
+		return;
+	}
+
+	for (i = 0; i < TEST_NUM_CLIENTS; ++i)
+	{
+		conns[i] = ei_net_poller_add(poller, servers[i]);
+		eiCHECK(conns[i] >= 0);
+		num_received[i] = 0;
+
+		clients[i].sock = socks[i];
+		clients[i].index = i;
+		clients[i].result = eiFALSE;
+	}
+
+	for (i = 0; i < TEST_NUM_CLIENTS; ++i)
+	{
+		threads[i] = ei_create_thread(test_client_thread, &clients[i], NULL);
+	}
+
+	total = 0;
+	payload_ok = eiTRUE;
+
+	while (total < TEST_NUM_CLIENTS * TEST_NUM_FRAMES)
+	{
+		eiNetFrame	*frame;
+		eiMessage	echo;
+		eiUint		client;
+		eiUint		index;
+		eiUint		size;
+		eiUint		j;
+
+		frame = ei_net_poller_wait(poller, TEST_TIMEOUT);
+
+		if (frame == NULL)
+		{
+			eiCHECK(!"timed out waiting for frames");
+			break;
+		}
+
+		for (client = 0; client < TEST_NUM_CLIENTS; ++client)
+		{
+			if (conns[client] == frame->conn)
+			{
+				break;
+			}
+		}
+
+		if (client == TEST_NUM_CLIENTS || frame->size == 0)
+		{
+			eiCHECK(!"unexpected frame");
+			ei_net_free_frame(frame);
+			break;
+		}
+
+		/* frames of a connection arrive in order */
+		index = num_received[client];
+		size = test_payload_size(client, index);
+
+		if (frame->size != sizeof(eiMessage) + size)
+		{
+			payload_ok = eiFALSE;
+		}
+		else
+		{
+			for (j = 0; j < size; ++j)
+			{
+				if (frame->data[sizeof(eiMessage) + j] != test_payload_byte(client, index, j))
+				{
+					payload_ok = eiFALSE;
+					break;
+				}
+			}
+		}
+
+		ei_net_free_frame(frame);
+
+		ei_msg_init(&echo);
+		ei_msg_set(&echo, EI_MSG_REQ_STEP_PROGRESS);
+		echo.step_progress_params.count = index;
+		eiCHECK(ei_net_poller_send(poller, conns[client], (eiByte *)&echo, sizeof(eiMessage)));
+
+		++ num_received[client];
+		++ total;
+	}
+
+	eiCHECK(payload_ok);
+
+	for (i = 0; i < TEST_NUM_CLIENTS; ++i)
+	{
+		ei_wait_thread(threads[i]);
+		ei_delete_thread(threads[i]);
+
+		eiCHECK(clients[i].result);
+		eiCHECK(num_received[i] == TEST_NUM_FRAMES);
+
+		ei_net_poller_remove(poller, conns[i]);
+		ei_net_close_socket(&socks[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiNetPoller		*poller;
+	eiMsgFrameParams	params;
+
+	ei_net_startup();
+
+	eiRUN_TEST(test_frame_size());
+
+	params.need_byteswap = eiFALSE;
+	params.max_payload_size = TEST_MAX_PAYLOAD;
+
+	poller = ei_net_create_poller(
+		sizeof(eiMessage), 
+		ei_msg_frame_size, 
+		&params, 
+		TEST_NUM_CLIENTS, 
+		EI_NET_POLLER_DEFAULT_THREADS);
+
+	if (poller != NULL)
+	{
+		eiRUN_TEST(test_recycle_slots(poller));
+		eiRUN_TEST(test_corrupted_header(poller));
+		eiRUN_TEST(test_load_many_connections(poller));
+
+		ei_net_delete_poller(poller);
+	}
+	else
+	{
+		printf("network poller is not supported, skipped\n");
+	}
+
+	ei_net_shutdown();
+
+	return eiTEST_RESULT();
+}
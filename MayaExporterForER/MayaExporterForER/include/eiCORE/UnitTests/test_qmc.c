@@ -0,0 +1,293 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of stratification of the low-discrepancy sequences.
+ * \file test_qmc.c
+ */
+
+#include <eiCORE/ei_qmc.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_MAX_LOG2_POINTS	12
+#define TEST_NUM_SEEDS			8
+/* an arbitrary instance number where a block of samples starts */
+#define TEST_INSTANCE_OFFSET	12345
+
+/* the number of points in each cell of an elementary interval */
+static unsigned char	g_Cells[ 1 << TEST_MAX_LOG2_POINTS ];
+
+/** \brief Whether the points of a dimension group starting at an
+ * instance number form a (0,k,2)-net in base 2, every elementary
+ * interval of area 1/2^k contains exactly one point. */
+static eiBool test_sobol_is_net(const eiUint group, const eiUint start, const eiInt k, const eiUint seed)
+{
+	eiUint	n = 1u << k;
+	eiInt	a;
+	eiUint	i;
+
+	for (a = 0; a <= k; ++a)
+	{
+		memset(g_Cells, 0, n);
+
+		for (i = start; i < start + n; ++i)
+		{
+			eiGeoScalar	x = ei_sobol(group * QMC_SOBOL_DIM + 0, i, seed);
+			eiGeoScalar	y = ei_sobol(group * QMC_SOBOL_DIM + 1, i, seed);
+			eiUint		cx = (eiUint)(x * (eiGeoScalar)(1u << a));
+			eiUint		cy = (eiUint)(y * (eiGeoScalar)(1u << (k - a)));
+			eiUint		cell = (cy << a) | cx;
+
+			if (x < 0.0 || x >= 1.0 || y < 0.0 || y >= 1.0 || g_Cells[cell] != 0)
+			{
+				return eiFALSE;
+			}
+
+			g_Cells[cell] = 1;
+		}
+	}
+
+	return eiTRUE;
+}
+
+/** \brief The first 2^k points of every dimension group are nets
+ * for every scrambling seed, and so are the next 2^k points. */
+static void test_sobol_nets()
+{
+	const eiUint	groups[] = { 0, 1, 2, 7, 63, 1000 };
+	eiUint			s, g;
+	eiInt			k;
+
+	for (s = 0; s < TEST_NUM_SEEDS; ++s)
+	{
+		eiUint	seed = ei_qmc_pixel_seed((eiInt)s, (eiInt)(s * 7 + 3));
+
+		for (g = 0; g < sizeof(groups) / sizeof(groups[0]); ++g)
+		{
+			for (k = 1; k <= TEST_MAX_LOG2_POINTS; ++k)
+			{
+				eiCHECK(test_sobol_is_net(groups[g], 0, k, seed));
+				eiCHECK(test_sobol_is_net(groups[g], 1u << k, k, seed));
+			}
+		}
+	}
+}
+
+/** \brief Different seeds must scramble the sequence differently. */
+static void test_sobol_seeds()
+{
+	eiUint	i, num_equal;
+
+	num_equal = 0;
+
+	for (i = 0; i < 256; ++i)
+	{
+		if (ei_sobol(0, i, ei_qmc_pixel_seed(0, 0)) == ei_sobol(0, i, ei_qmc_pixel_seed(1, 0)))
+		{
+			++ num_equal;
+		}
+	}
+
+	eiCHECK(num_equal < 4);
+}
+
+/** \brief Any b^m consecutive points of a Halton dimension with
+ * prime base b fall into distinct intervals of length 1/b^m. */
+static void test_halton_strata()
+{
+	const eiInt		dims[] = { 0, 1, 2, 3, 10 };
+	eiInt			d;
+
+	for (d = 0; d < (eiInt)(sizeof(dims) / sizeof(dims[0])); ++d)
+	{
+		eiInt	b = lds_bases[ dims[d] ].prime;
+		eiUint	n = 1;
+
+		while (n * b <= (1u << TEST_MAX_LOG2_POINTS))
+		{
+			eiUint	i;
+
+			n *= b;
+
+			memset(g_Cells, 0, n);
+
+			for (i = TEST_INSTANCE_OFFSET; i < TEST_INSTANCE_OFFSET + n; ++i)
+			{
+				eiUint	cell = (eiUint)(ei_sigma(dims[d], (eiInt)i) * (eiGeoScalar)n);
+
+				eiCHECK(cell < n && g_Cells[cell] == 0);
+
+				if (cell < n)
+				{
+					g_Cells[cell] = 1;
+				}
+			}
+		}
+	}
+}
+
+/** \brief Positions in pixels of variance-driven sampling are drawn
+ * from Halton dimensions 0 and 2, with bases 2 and 5. any 2^a * 5^b
+ * consecutive samples put exactly one point into each cell of the
+ * 2^a by 5^b grid, wherever the block starts. */
+static void test_halton_pixel_strata()
+{
+	eiInt	a, b;
+
+	eiCHECK(lds_bases[0].prime == 2);
+	eiCHECK(lds_bases[2].prime == 5);
+
+	for (a = 1; a <= 6; ++a)
+	{
+		for (b = 1; b <= 2; ++b)
+		{
+			eiUint	nx = 1u << a;
+			eiUint	ny = (b == 1) ? 5 : 25;
+			eiUint	n = nx * ny;
+			eiUint	i;
+
+			memset(g_Cells, 0, n);
+
+			for (i = TEST_INSTANCE_OFFSET; i < TEST_INSTANCE_OFFSET + n; ++i)
+			{
+				eiUint	cx = (eiUint)(ei_sigma(0, (eiInt)i) * (eiGeoScalar)nx);
+				eiUint	cy = (eiUint)(ei_sigma(2, (eiInt)i) * (eiGeoScalar)ny);
+				eiUint	cell = cy * nx + cx;
+
+				eiCHECK(cx < nx && cy < ny && g_Cells[cell] == 0);
+
+				if (cx < nx && cy < ny)
+				{
+					g_Cells[cell] = 1;
+				}
+			}
+		}
+	}
+}
+
+/** \brief The first pass takes the Halton sequence itself, and 
+ * every later pass takes different positions in every dimension 
+ * and in the sub-pixel, which stay in [0, 1). */
+static void test_halton_passes()
+{
+	eiInt	pass;
+	eiUint	dim, i;
+
+	eiCHECK(ei_qmc_pass_seed(0) == 0);
+
+	for (dim = 0; dim < QMC_MAX_DIM + 2; ++dim)
+	{
+		for (i = 0; i < 64; ++i)
+		{
+			eiCHECK(ei_halton(dim, i, ei_qmc_pass_seed(0)) == ei_sigma(dim % QMC_MAX_DIM, i));
+		}
+	}
+
+	for (pass = 1; pass <= 3; ++pass)
+	{
+		eiUint	seed = ei_qmc_pass_seed(pass);
+		eiUint	num_equal = 0;
+		eiInt	sx, sy;
+
+		eiCHECK(seed != 0 && seed != ei_qmc_pass_seed(pass - 1));
+
+		for (dim = 0; dim < QMC_MAX_DIM; ++dim)
+		{
+			for (i = 0; i < 64; ++i)
+			{
+				eiGeoScalar	x = ei_halton(dim, i, seed);
+				eiGeoScalar	y = ei_halton(dim, i, ei_qmc_pass_seed(pass - 1));
+
+				eiCHECK(x >= 0.0 && x < 1.0);
+
+				if (x == y)
+				{
+					++ num_equal;
+				}
+			}
+		}
+
+		eiCHECK(num_equal == 0);
+
+		for (sy = 0; sy < 8; ++sy)
+		{
+			for (sx = 0; sx < 8; ++sx)
+			{
+				eiUint		i0 = 0, i1 = 0;
+				eiGeoScalar	x0 = 0.0, y0 = 0.0;
+				eiGeoScalar	x1 = 0.0, y1 = 0.0;
+
+				ei_sample_subpixel(&i0, &x0, &y0, sx, sy);
+				ei_sample_subpixel(&i1, &x1, &y1, sx, sy);
+				ei_shift_subpixel(&x1, &y1, seed);
+
+				eiCHECK(i0 == i1);
+				eiCHECK(x1 >= 0.0 && x1 < 1.0 && y1 >= 0.0 && y1 < 1.0);
+				eiCHECK(x0 != x1 && y0 != y1);
+			}
+		}
+	}
+}
+
+/** \brief Rotating the Halton sequence keeps the first b^m points 
+ * of a dimension in distinct intervals of length 1/b^m. */
+static void test_halton_pass_strata()
+{
+	const eiInt		dims[] = { 0, 1, 2, 3, 10 };
+	eiInt			pass, d;
+
+	for (pass = 1; pass <= 3; ++pass)
+	{
+		for (d = 0; d < (eiInt)(sizeof(dims) / sizeof(dims[0])); ++d)
+		{
+			eiInt	b = lds_bases[ dims[d] ].prime;
+			eiUint	n = 1;
+
+			while (n * b <= (1u << TEST_MAX_LOG2_POINTS))
+			{
+				eiUint	i;
+
+				n *= b;
+
+				memset(g_Cells, 0, n);
+
+				for (i = 0; i < n; ++i)
+				{
+					eiUint	cell = (eiUint)(ei_halton(dims[d], i, ei_qmc_pass_seed(pass)) * (eiGeoScalar)n);
+
+					eiCHECK(cell < n && g_Cells[cell] == 0);
+
+					if (cell < n)
+					{
+						g_Cells[cell] = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_sobol_nets());
+	eiRUN_TEST(test_sobol_seeds());
+	eiRUN_TEST(test_halton_strata());
+	eiRUN_TEST(test_halton_pixel_strata());
+	eiRUN_TEST(test_halton_passes());
+	eiRUN_TEST(test_halton_pass_strata());
+
+	return eiTEST_RESULT();
+}
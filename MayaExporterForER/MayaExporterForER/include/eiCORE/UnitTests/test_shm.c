@@ -0,0 +1,265 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of the shared memory transport, creating, mapping,
+ * writing, reading and destroying channels and data arenas, and
+ * failing to create or map them, where callers fall back to sockets.
+ * \file test_shm.c
+ */
+
+#include <eiCORE/ei_shm.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <string.h>
+
+#define TEST_CHANNEL_NAME		"/ei_test_shm_channel"
+#define TEST_ARENA_NAME			"/ei_test_shm_arena"
+/* a small ring, so that messages wrap around it many times */
+#define TEST_RING_SIZE			4096
+#define TEST_NUM_MSGS			1000
+#define TEST_MSG_SIZE			1000
+#define TEST_ARENA_SIZE			(64 * 1024)
+#define TEST_BLOCK_SIZE			1000
+
+/** \brief The peer process, opening the channel by name, echoing
+ * every message back with each byte incremented. */
+typedef struct TestPeer {
+	eiBool		result;
+} TestPeer;
+
+static eiTHREAD_FUNC test_peer_thread(void *param)
+{
+	TestPeer		*peer;
+	eiShmChannel	*channel;
+	eiByte			msg[ TEST_MSG_SIZE ];
+	eiUint			i, k;
+
+	peer = (TestPeer *)param;
+	peer->result = eiFALSE;
+
+	channel = ei_shm_open_channel(TEST_CHANNEL_NAME);
+
+	if (channel == NULL)
+	{
+		return (eiTHREAD_FUNC_RESULT)0;
+	}
+
+	peer->result = eiTRUE;
+
+	for (i = 0; i < TEST_NUM_MSGS && peer->result; ++i)
+	{
+		peer->result = ei_shm_recv(channel, msg, TEST_MSG_SIZE);
+
+		for (k = 0; k < TEST_MSG_SIZE; ++k)
+		{
+			++ msg[k];
+		}
+
+		peer->result = peer->result && ei_shm_send(channel, msg, TEST_MSG_SIZE);
+	}
+
+	ei_shm_close_channel(channel);
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+/** \brief Messages larger than a quarter of the ring go both ways
+ * through the channel, and arrive intact and in order. */
+static void test_channel()
+{
+	eiShmChannel	*channel;
+	TestPeer		peer;
+	eiThreadHandle	thread;
+	eiByte			msg[ TEST_MSG_SIZE ];
+	eiByte			reply[ TEST_MSG_SIZE ];
+	eiUint			i, k, num_bad;
+
+	channel = ei_shm_create_channel(TEST_CHANNEL_NAME, TEST_RING_SIZE);
+
+	eiCHECK(channel != NULL);
+
+	if (channel == NULL)
+	{
+		return;
+	}
+
+	thread = ei_create_thread(test_peer_thread, &peer, NULL);
+
+	num_bad = 0;
+
+	for (i = 0; i < TEST_NUM_MSGS; ++i)
+	{
+		for (k = 0; k < TEST_MSG_SIZE; ++k)
+		{
+			msg[k] = (eiByte)(i * 31 + k);
+		}
+
+		if (!ei_shm_send(channel, msg, TEST_MSG_SIZE) || 
+			!ei_shm_recv(channel, reply, TEST_MSG_SIZE))
+		{
+			eiCHECK(!"failed to send or receive");
+			break;
+		}
+
+		for (k = 0; k < TEST_MSG_SIZE; ++k)
+		{
+			if (reply[k] != (eiByte)(msg[k] + 1))
+			{
+				++ num_bad;
+				break;
+			}
+		}
+	}
+
+	ei_wait_thread(thread);
+	ei_delete_thread(thread);
+
+	eiCHECK(peer.result);
+	eiCHECK(num_bad == 0);
+
+	/* the peer has closed the channel */
+	eiCHECK(!ei_shm_recv(channel, reply, 1));
+
+	ei_shm_close_channel(channel);
+
+	/* the creator has unlinked the channel */
+	eiCHECK(ei_shm_open_channel(TEST_CHANNEL_NAME) == NULL);
+}
+
+/** \brief Blocks written by the creator are visible through a
+ * read-only mapping, until the arena is full. */
+static void test_arena()
+{
+	eiShmArena	*arena;
+	eiShmArena	*mapped;
+	eiSizet		offsets[ TEST_ARENA_SIZE / TEST_BLOCK_SIZE + 1 ];
+	eiUint		num_blocks, i, k, num_bad;
+
+	arena = ei_shm_create_arena(TEST_ARENA_NAME, TEST_ARENA_SIZE);
+
+	eiCHECK(arena != NULL);
+
+	if (arena == NULL)
+	{
+		return;
+	}
+
+	eiCHECK(ei_shm_arena_size(arena) == TEST_ARENA_SIZE);
+
+	mapped = ei_shm_open_arena(TEST_ARENA_NAME);
+
+	eiCHECK(mapped != NULL);
+
+	if (mapped == NULL)
+	{
+		ei_shm_close_arena(arena);
+		return;
+	}
+
+	eiCHECK(ei_shm_arena_size(mapped) == TEST_ARENA_SIZE);
+
+	num_blocks = 0;
+
+	while (num_blocks < TEST_ARENA_SIZE / TEST_BLOCK_SIZE + 1)
+	{
+		eiByte	*ptr;
+
+		offsets[num_blocks] = ei_shm_arena_alloc(arena, TEST_BLOCK_SIZE);
+
+		if (offsets[num_blocks] == eiMAX_SIZET)
+		{
+			break;
+		}
+
+		eiCHECK(offsets[num_blocks] + TEST_BLOCK_SIZE <= TEST_ARENA_SIZE);
+
+		ptr = (eiByte *)ei_shm_arena_ptr(arena, offsets[num_blocks]);
+		memset(ptr, (eiByte)num_blocks, TEST_BLOCK_SIZE);
+
+		++ num_blocks;
+	}
+
+	/* aligned blocks of 1000 bytes take 1008 bytes of the arena */
+	eiCHECK(num_blocks == (TEST_ARENA_SIZE + 1008 - TEST_BLOCK_SIZE) / 1008);
+
+	/* allocations fail when the arena is full */
+	eiCHECK(ei_shm_arena_alloc(arena, TEST_ARENA_SIZE) == eiMAX_SIZET);
+
+	num_bad = 0;
+
+	for (i = 0; i < num_blocks; ++i)
+	{
+		const eiByte	*ptr;
+
+		ptr = (const eiByte *)ei_shm_arena_ptr(mapped, offsets[i]);
+
+		for (k = 0; k < TEST_BLOCK_SIZE; ++k)
+		{
+			if (ptr[k] != (eiByte)i)
+			{
+				++ num_bad;
+				break;
+			}
+		}
+	}
+
+	eiCHECK(num_bad == 0);
+
+	ei_shm_close_arena(mapped);
+	ei_shm_close_arena(arena);
+
+	/* the creator has unlinked the arena */
+	eiCHECK(ei_shm_open_arena(TEST_ARENA_NAME) == NULL);
+}
+
+/** \brief Creating or mapping fails for invalid and missing names,
+ * returning NULL without leaking, so callers can fall back to sockets. */
+static void test_creation_failure()
+{
+	eiShmChannel	*channel;
+	eiShmArena		*arena;
+
+	/* POSIX shared memory names cannot contain more slashes */
+	eiCHECK(ei_shm_create_channel("/ei_test/invalid", TEST_RING_SIZE) == NULL);
+	eiCHECK(ei_shm_create_arena("/ei_test/invalid", TEST_ARENA_SIZE) == NULL);
+
+	eiCHECK(ei_shm_open_channel("/ei_test_shm_missing") == NULL);
+	eiCHECK(ei_shm_open_arena("/ei_test_shm_missing") == NULL);
+
+	/* a channel is not an arena, and an arena is not a channel */
+	channel = ei_shm_create_channel(TEST_CHANNEL_NAME, TEST_RING_SIZE);
+	arena = ei_shm_create_arena(TEST_ARENA_NAME, TEST_ARENA_SIZE);
+
+	eiCHECK(channel != NULL && arena != NULL);
+
+	eiCHECK(ei_shm_open_arena(TEST_CHANNEL_NAME) == NULL);
+	eiCHECK(ei_shm_open_channel(TEST_ARENA_NAME) == NULL);
+
+	ei_shm_close_arena(arena);
+	ei_shm_close_channel(channel);
+
+	/* closing nothing does nothing */
+	ei_shm_close_arena(NULL);
+	ei_shm_close_channel(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_channel());
+	eiRUN_TEST(test_arena());
+	eiRUN_TEST(test_creation_failure());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of the transcendental functions of SIMD vectors 
+ * against the standard library.
+ * \file test_simd.c
+ */
+
+#include <eiCORE/ei_simd.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <math.h>
+
+static eiScalar test_pow(const eiScalar a, const eiScalar b)
+{
+	eiScalar	r[ EI_VF_WIDTH ];
+
+	ei_vf_store(r, ei_vf_pow(ei_vf_set1(a), ei_vf_set1(b)));
+
+	return r[0];
+}
+
+static void test_pow_special()
+{
+	/* the same as powf */
+	eiCHECK(test_pow(0.0f, 0.0f) == 1.0f);
+	eiCHECK(test_pow(0.0f, 2.0f) == 0.0f);
+	eiCHECK(test_pow(0.5f, 0.0f) == 1.0f);
+	eiCHECK(test_pow(1.0f, 37.0f) == 1.0f);
+	/* non-positive bases are not supported otherwise */
+	eiCHECK(test_pow(-2.0f, 3.0f) == 0.0f);
+}
+
+static void test_pow_range()
+{
+	eiInt	i, j;
+
+	for (i = 1; i <= 100; ++i)
+	{
+		for (j = 0; j <= 100; ++j)
+		{
+			eiScalar	a, b, r, s;
+
+			a = (eiScalar)i / 100.0f;
+			b = (eiScalar)j * 0.5f;
+			r = test_pow(a, b);
+			s = powf(a, b);
+
+			eiCHECK(fabsf(r - s) <= 1.0e-5f * MAX(1.0e-30f, s) + 1.0e-30f);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_pow_special());
+	eiRUN_TEST(test_pow_range());
+
+	return eiTEST_RESULT();
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of symbol tables and the global pool of interned 
+ * strings, interned names must be freed when no symbol references 
+ * them any more.
+ * \file test_symbol.c
+ */
+
+#include <eiCORE/ei_symbol.h>
+#include <eiCORE/UnitTests/ei_unit_test.h>
+#include <stdio.h>
+
+#define TEST_NUM_SYMBOLS	10000
+
+static void test_name(char *name, const eiInt i)
+{
+	sprintf(name, "param_%d", i);
+}
+
+static void test_add_remove()
+{
+	eiSymbolTable	tab;
+	char			name[ 64 ];
+	eiUint			base_size;
+	eiInt			i;
+
+	base_size = ei_string_pool_size();
+
+	ei_symbol_table_init(&tab, (void *)eiNULL_INDEX);
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		test_name(name, i);
+		ei_symbol_table_add(&tab, name, (void *)(eiIntptr)i);
+	}
+
+	eiCHECK(ei_string_pool_size() == base_size + TEST_NUM_SYMBOLS);
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		test_name(name, i);
+		eiCHECK(ei_symbol_table_find(&tab, name) == (void *)(eiIntptr)i);
+	}
+
+	/* remove every other symbol */
+	for (i = 0; i < TEST_NUM_SYMBOLS; i += 2)
+	{
+		test_name(name, i);
+		ei_symbol_table_remove(&tab, name);
+	}
+
+	eiCHECK(ei_string_pool_size() == base_size + TEST_NUM_SYMBOLS / 2);
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		void	*expected;
+
+		test_name(name, i);
+		expected = ((i % 2) == 0) ? (void *)eiNULL_INDEX : (void *)(eiIntptr)i;
+
+		eiCHECK(ei_symbol_table_find(&tab, name) == expected);
+	}
+
+	ei_symbol_table_exit(&tab);
+
+	/* all names are released with the table */
+	eiCHECK(ei_string_pool_size() == base_size);
+}
+
+static void test_shared_names()
+{
+	eiSymbolTable	tab1, tab2;
+	eiUint			base_size;
+
+	base_size = ei_string_pool_size();
+
+	ei_symbol_table_init(&tab1, NULL);
+	ei_symbol_table_init(&tab2, NULL);
+
+	ei_symbol_table_add(&tab1, "Cs", (void *)1);
+	ei_symbol_table_add(&tab2, "Cs", (void *)2);
+	/* adding an existing symbol keeps the data and the references */
+	ei_symbol_table_add(&tab1, "Cs", (void *)3);
+
+	eiCHECK(ei_string_pool_size() == base_size + 1);
+	eiCHECK(ei_symbol_table_find(&tab1, "Cs") == (void *)1);
+
+	/* the name is still referenced by the other table */
+	ei_symbol_table_remove(&tab1, "Cs");
+
+	eiCHECK(ei_string_pool_size() == base_size + 1);
+	eiCHECK(ei_symbol_table_find(&tab1, "Cs") == NULL);
+	eiCHECK(ei_symbol_table_find(&tab2, "Cs") == (void *)2);
+
+	/* removing a missing symbol releases nothing */
+	ei_symbol_table_remove(&tab1, "Cs");
+	eiCHECK(ei_symbol_table_find(&tab2, "Cs") == (void *)2);
+
+	ei_symbol_table_remove(&tab2, "Cs");
+
+	eiCHECK(ei_string_pool_size() == base_size);
+
+	ei_symbol_table_exit(&tab2);
+	ei_symbol_table_exit(&tab1);
+}
+
+static void test_intern_release()
+{
+	const char	*strs[ TEST_NUM_SYMBOLS ];
+	char		name[ 64 ];
+	eiUint		base_size;
+	eiInt		i;
+
+	base_size = ei_string_pool_size();
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		test_name(name, i);
+		strs[i] = ei_intern_string(name);
+	}
+
+	/* releasing strings shifts the others back in the pool, they 
+	   must still be found at the same addresses */
+	for (i = 0; i < TEST_NUM_SYMBOLS; i += 3)
+	{
+		ei_release_string(strs[i]);
+	}
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		const char	*str;
+
+		if ((i % 3) == 0)
+		{
+			continue;
+		}
+
+		test_name(name, i);
+		str = ei_intern_string(name);
+
+		eiCHECK(str == strs[i]);
+		eiCHECK(ei_interned_string_hash(str) == ei_string_hash(name));
+		eiCHECK(ei_interned_string_length(str) == (eiUint)strlen(name));
+
+		ei_release_string(str);
+	}
+
+	for (i = 0; i < TEST_NUM_SYMBOLS; ++i)
+	{
+		if ((i % 3) != 0)
+		{
+			ei_release_string(strs[i]);
+		}
+	}
+
+	eiCHECK(ei_string_pool_size() == base_size);
+}
+
+int main(int argc, char *argv[])
+{
+	ei_string_pool_init();
+
+	eiRUN_TEST(test_add_remove());
+	eiRUN_TEST(test_shared_names());
+	eiRUN_TEST(test_intern_release());
+
+	ei_string_pool_exit();
+
+	return eiTEST_RESULT();
+}
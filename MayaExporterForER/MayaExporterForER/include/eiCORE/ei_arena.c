@@ -0,0 +1,176 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Memory arena implementation.
+ * \file ei_arena.c
+ */
+
+#include <eiCORE/ei_arena.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_assert.h>
+
+/** \brief Arena block, the data follows the header.
+ */
+struct ei_arena_block {
+	struct ei_arena_block	*next;
+	eiSizet					size;
+	eiSizet					used;
+	eiSizet					padding;
+};
+
+static ei_arena_block *ei_arena_create_block(ei_arena *arena, const eiSizet size)
+{
+	ei_arena_block *block;
+
+	block = (ei_arena_block *)ei_allocate(sizeof(ei_arena_block) + size);
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+
+	++ arena->numBlocks;
+
+	return block;
+}
+
+void ei_arena_init(ei_arena *arena, const eiSizet blockSize)
+{
+	eiDBG_ASSERT(arena != NULL);
+
+	arena->firstBlock = NULL;
+	arena->currentBlock = NULL;
+	arena->blockSize = ei_arena_aligned_size(blockSize);
+	arena->usedSize = 0;
+	arena->peakSize = 0;
+	arena->numAllocations = 0;
+	arena->numBlocks = 0;
+}
+
+void ei_arena_clear(ei_arena *arena)
+{
+	ei_arena_block *block;
+
+	eiDBG_ASSERT(arena != NULL);
+
+	while (arena->firstBlock != NULL)
+	{
+		block = arena->firstBlock;
+		arena->firstBlock = block->next;
+
+		eiCHECK_FREE(block);
+	}
+
+	arena->currentBlock = NULL;
+	arena->usedSize = 0;
+}
+
+void ei_arena_reserve(ei_arena *arena, const eiSizet size)
+{
+	ei_arena_block *block;
+
+	eiDBG_ASSERT(arena != NULL);
+	eiDBG_ASSERT(arena->usedSize == 0);
+
+	/* the first block cannot be replaced while memory 
+	   handed out from it is still in use */
+	if (arena->usedSize != 0 || 
+		(arena->firstBlock != NULL && arena->firstBlock->size >= size))
+	{
+		return;
+	}
+
+	/* replace the first block by a larger one, 
+	   the remaining blocks are kept for overflow */
+	block = ei_arena_create_block(arena, ei_arena_aligned_size(size));
+
+	if (arena->firstBlock != NULL)
+	{
+		ei_arena_block *oldBlock;
+
+		oldBlock = arena->firstBlock;
+		block->next = oldBlock->next;
+
+		eiCHECK_FREE(oldBlock);
+	}
+
+	arena->firstBlock = block;
+	arena->currentBlock = block;
+}
+
+void *ei_arena_allocate(ei_arena *arena, const eiSizet size)
+{
+	ei_arena_block	*block;
+	eiSizet			aligned_size;
+	eiByte			*ptr;
+
+	eiDBG_ASSERT(arena != NULL);
+
+	aligned_size = ei_arena_aligned_size(size);
+	block = arena->currentBlock;
+
+	/* move to the next block which is large enough */
+	while (block == NULL || block->used + aligned_size > block->size)
+	{
+		if (block == NULL)
+		{
+			if (arena->firstBlock == NULL)
+			{
+				arena->firstBlock = ei_arena_create_block(arena, MAX(arena->blockSize, aligned_size));
+			}
+			block = arena->firstBlock;
+		}
+		else if (block->next != NULL)
+		{
+			block = block->next;
+		}
+		else
+		{
+			block->next = ei_arena_create_block(arena, MAX(arena->blockSize, aligned_size));
+			block = block->next;
+		}
+	}
+
+	arena->currentBlock = block;
+
+	ptr = ((eiByte *)(block + 1)) + block->used;
+	block->used += aligned_size;
+
+	arena->usedSize += aligned_size;
+	arena->peakSize = MAX(arena->peakSize, arena->usedSize);
+	++ arena->numAllocations;
+
+	return ptr;
+}
+
+void ei_arena_reset(ei_arena *arena)
+{
+	ei_arena_block *block;
+
+	eiDBG_ASSERT(arena != NULL);
+
+	/* only the blocks up to the current one have been used 
+	   since last reset, which is one in the common case. */
+	for (block = arena->firstBlock; block != NULL; block = block->next)
+	{
+		block->used = 0;
+
+		if (block == arena->currentBlock)
+		{
+			break;
+		}
+	}
+
+	arena->currentBlock = arena->firstBlock;
+	arena->usedSize = 0;
+}
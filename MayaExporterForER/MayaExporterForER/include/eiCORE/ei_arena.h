@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_ARENA_H
+#define EI_ARENA_H
+
+/** \brief Memory arena for bump allocation with constant time reset.
+ * \file ei_arena.h
+ *
+ * Memory is handed out by advancing a pointer in the current block, 
+ * individual allocations are never freed. Resetting the arena makes 
+ * all blocks available again without returning them to the system, 
+ * so an arena reused by one thread stops allocating once it has 
+ * reached its working set.
+ */
+
+#include <eiCORE/ei_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief All allocations are aligned to this boundary.
+ */
+#define EI_ARENA_ALIGNMENT		16
+
+/** \brief The actual number of bytes an allocation of size takes.
+ */
+#define ei_arena_aligned_size(size)		(((size) + (EI_ARENA_ALIGNMENT - 1)) & ~((eiSizet)(EI_ARENA_ALIGNMENT - 1)))
+
+/** \brief Declaration of arena block.
+ */
+typedef struct ei_arena_block ei_arena_block;
+
+/** \brief Memory arena object.
+ */
+typedef struct ei_arena {
+	ei_arena_block	*firstBlock;		/** Linked list of allocated blocks */
+	ei_arena_block	*currentBlock;		/** The block we are allocating from */
+	eiSizet			blockSize;			/** The default size of new blocks */
+	eiSizet			usedSize;			/** Bytes handed out since last reset */
+	eiSizet			peakSize;			/** High-water mark of usedSize */
+	eiInt64			numAllocations;		/** Number of allocations from the arena */
+	eiInt64			numBlocks;			/** Number of blocks allocated from system */
+} ei_arena;
+
+/** \brief Initialize an arena.
+ */
+eiCORE_API void ei_arena_init(ei_arena *arena, const eiSizet blockSize);
+
+/** \brief Cleanup an arena, return all blocks to system.
+ */
+eiCORE_API void ei_arena_clear(ei_arena *arena);
+
+/** \brief Make sure the first block can hold size bytes, 
+ * should be called right after reset, does nothing if any 
+ * memory of the arena is in use.
+ */
+eiCORE_API void ei_arena_reserve(ei_arena *arena, const eiSizet size);
+
+/** \brief Allocate a chunk of memory from the arena.
+ */
+eiCORE_API void *ei_arena_allocate(ei_arena *arena, const eiSizet size);
+
+/** \brief Make all memory of the arena available again in O(1).
+ */
+eiCORE_API void ei_arena_reset(ei_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
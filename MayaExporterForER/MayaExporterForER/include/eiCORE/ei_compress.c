@@ -0,0 +1,267 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiCORE/ei_compress.h>
+#include <eiCORE/ei_platform.h>
+#include <string.h>
+
+#define EI_LZ_HASH_BITS			12
+#define EI_LZ_HASH_SIZE			(1 << EI_LZ_HASH_BITS)
+#define EI_LZ_MIN_MATCH			4
+/* the last bytes must be literals */
+#define EI_LZ_LAST_LITERALS		5
+/* the last match must start before this number of bytes to the end */
+#define EI_LZ_MF_LIMIT			12
+#define EI_LZ_MAX_OFFSET		65535
+#define EI_LZ_RUN_MASK			15
+
+eiFORCEINLINE eiUint ei_lz_read32(const eiByte *p)
+{
+	eiUint	v;
+
+	memcpy(&v, p, sizeof(eiUint));
+
+	return v;
+}
+
+eiFORCEINLINE eiUint ei_lz_hash(const eiUint seq)
+{
+	return (seq * 2654435761U) >> (32 - EI_LZ_HASH_BITS);
+}
+
+eiFORCEINLINE void ei_lz_write_length(eiByte *dst, eiUint *op, eiUint len)
+{
+	while (len >= 255)
+	{
+		dst[(*op) ++] = 255;
+		len -= 255;
+	}
+
+	dst[(*op) ++] = (eiByte)len;
+}
+
+/** \brief Emit a sequence of literals followed by an optional match,
+ * a match length of zero emits literals only. */
+static eiBool ei_lz_emit(
+	eiByte *dst,
+	eiUint *op,
+	const eiUint dst_capacity,
+	const eiByte *literals,
+	const eiUint num_literals,
+	const eiUint offset,
+	const eiUint match_len)
+{
+	eiUint	token_pos;
+	eiUint	lit_token, match_token;
+
+	/* token, literals, offset and extended lengths */
+	if (*op + 1 + num_literals + num_literals / 255 + 1 + 2 + match_len / 255 + 1 > dst_capacity)
+	{
+		return eiFALSE;
+	}
+
+	token_pos = (*op) ++;
+
+	lit_token = MIN(num_literals, EI_LZ_RUN_MASK);
+
+	if (num_literals >= EI_LZ_RUN_MASK)
+	{
+		ei_lz_write_length(dst, op, num_literals - EI_LZ_RUN_MASK);
+	}
+
+	memcpy(dst + *op, literals, num_literals);
+	*op += num_literals;
+
+	match_token = 0;
+
+	if (match_len != 0)
+	{
+		dst[(*op) ++] = (eiByte)(offset & 0xFF);
+		dst[(*op) ++] = (eiByte)(offset >> 8);
+
+		match_token = MIN(match_len - EI_LZ_MIN_MATCH, EI_LZ_RUN_MASK);
+
+		if (match_len - EI_LZ_MIN_MATCH >= EI_LZ_RUN_MASK)
+		{
+			ei_lz_write_length(dst, op, match_len - EI_LZ_MIN_MATCH - EI_LZ_RUN_MASK);
+		}
+	}
+
+	dst[token_pos] = (eiByte)((lit_token << 4) | match_token);
+
+	return eiTRUE;
+}
+
+eiUint ei_lz_compress_bound(const eiUint src_size)
+{
+	return src_size + src_size / 255 + 16;
+}
+
+eiUint ei_lz_compress(
+	const eiByte *src,
+	const eiUint src_size,
+	eiByte *dst,
+	const eiUint dst_capacity)
+{
+	eiUint	table[ EI_LZ_HASH_SIZE ];
+	eiUint	ip, anchor, op;
+
+	ip = 0;
+	anchor = 0;
+	op = 0;
+
+	if (src_size > EI_LZ_MF_LIMIT)
+	{
+		memset(table, 0, sizeof(table));
+
+		while (ip + EI_LZ_MF_LIMIT <= src_size)
+		{
+			eiUint	seq, h, ref;
+
+			seq = ei_lz_read32(src + ip);
+			h = ei_lz_hash(seq);
+			ref = table[h];
+			table[h] = ip;
+
+			if (ref < ip &&
+				ip - ref <= EI_LZ_MAX_OFFSET &&
+				ei_lz_read32(src + ref) == seq)
+			{
+				eiUint	len, limit;
+
+				len = EI_LZ_MIN_MATCH;
+				limit = src_size - EI_LZ_LAST_LITERALS;
+
+				while (ip + len < limit && src[ref + len] == src[ip + len])
+				{
+					++ len;
+				}
+
+				if (!ei_lz_emit(dst, &op, dst_capacity, src + anchor, ip - anchor, ip - ref, len))
+				{
+					return 0;
+				}
+
+				ip += len;
+				anchor = ip;
+			}
+			else
+			{
+				++ ip;
+			}
+		}
+	}
+
+	/* the remaining bytes are literals */
+	if (!ei_lz_emit(dst, &op, dst_capacity, src + anchor, src_size - anchor, 0, 0))
+	{
+		return 0;
+	}
+
+	return op;
+}
+
+eiBool ei_lz_decompress(
+	const eiByte *src,
+	const eiUint src_size,
+	eiByte *dst,
+	const eiUint dst_size)
+{
+	eiUint	ip, op;
+
+	ip = 0;
+	op = 0;
+
+	while (ip < src_size)
+	{
+		eiUint	token, len, offset, b;
+
+		token = src[ip ++];
+
+		/* copy literals */
+		len = token >> 4;
+
+		if (len == EI_LZ_RUN_MASK)
+		{
+			do {
+				if (ip >= src_size)
+				{
+					return eiFALSE;
+				}
+				b = src[ip ++];
+				len += b;
+			} while (b == 255);
+		}
+
+		if (len > src_size - ip || len > dst_size - op)
+		{
+			return eiFALSE;
+		}
+
+		memcpy(dst + op, src + ip, len);
+		ip += len;
+		op += len;
+
+		/* the last sequence has no match */
+		if (ip == src_size)
+		{
+			break;
+		}
+
+		/* copy match */
+		if (ip + 2 > src_size)
+		{
+			return eiFALSE;
+		}
+
+		offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > op)
+		{
+			return eiFALSE;
+		}
+
+		len = token & EI_LZ_RUN_MASK;
+
+		if (len == EI_LZ_RUN_MASK)
+		{
+			do {
+				if (ip >= src_size)
+				{
+					return eiFALSE;
+				}
+				b = src[ip ++];
+				len += b;
+			} while (b == 255);
+		}
+
+		len += EI_LZ_MIN_MATCH;
+
+		if (len > dst_size - op)
+		{
+			return eiFALSE;
+		}
+
+		/* the match may overlap the output, copy byte by byte */
+		while (len -- > 0)
+		{
+			dst[op] = dst[op - offset];
+			++ op;
+		}
+	}
+
+	return (op == dst_size);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_COMPRESS_H
+#define EI_COMPRESS_H
+
+/** \brief Fast LZ77 block compression for network transfer, the
+ * compressed stream uses the LZ4 block format.
+ * \file ei_compress.h
+ */
+
+#include <eiCORE/ei_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Returns the maximum compressed size of a block.
+ */
+eiCORE_API eiUint ei_lz_compress_bound(const eiUint src_size);
+
+/** \brief Compress a block, returns the compressed size, or 0 if
+ * the compressed block does not fit into the destination buffer.
+ */
+eiCORE_API eiUint ei_lz_compress(
+	const eiByte *src,
+	const eiUint src_size,
+	eiByte *dst,
+	const eiUint dst_capacity);
+
+/** \brief Decompress a block, the decompressed size must be known,
+ * returns false if the compressed block is corrupted.
+ */
+eiCORE_API eiBool ei_lz_decompress(
+	const eiByte *src,
+	const eiUint src_size,
+	eiByte *dst,
+	const eiUint dst_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,10 +23,13 @@
 void ei_config_init(eiConfig *config)
 {
 	config->nthreads = 0;
+	config->affinity = EI_THREAD_AFFINITY_NONE;
 	config->memlimit = EI_DEFAULT_MEMORY_LIMIT;
 	config->distributed = eiTRUE;
 	config->port = 6666;
 	config->maxclients = 5;
+	config->shmarena[0] = '\0';
+	config->shmsize = 0;
 	
 	ei_array_init(&config->servers, sizeof(eiHostDesc));
 	ei_array_init(&config->searchpaths, sizeof(eiSearchPath));
@@ -80,6 +83,26 @@ eiBool ei_config_load(eiConfig *config, const char *filename)
 				config->nthreads = atoi(sval);
 			}
 		}
+		else if (strcmp(command, "affinity") == 0)
+		{
+			if (fscanf(fp, "%s", sval) <= 0)
+			{
+				break;
+			}
+
+			if (strcmp(sval, "node") == 0)
+			{
+				config->affinity = EI_THREAD_AFFINITY_NODE;
+			}
+			else if (strcmp(sval, "core") == 0)
+			{
+				config->affinity = EI_THREAD_AFFINITY_CORE;
+			}
+			else
+			{
+				config->affinity = EI_THREAD_AFFINITY_NONE;
+			}
+		}
 		else if (strcmp(command, "memlimit") == 0)
 		{
 			if (fscanf(fp, "%d", &ival) <= 0)
@@ -123,6 +146,26 @@ eiBool ei_config_load(eiConfig *config, const char *filename)
 
 			config->maxclients = ival;
 		}
+		else if (strcmp(command, "shmarena") == 0)
+		{
+			if (fscanf(fp, "%s", sval) <= 0)
+			{
+				break;
+			}
+
+			strncpy(config->shmarena, sval, EI_SHM_MAX_NAME_LEN - 1);
+			config->shmarena[ EI_SHM_MAX_NAME_LEN - 1 ] = '\0';
+		}
+		else if (strcmp(command, "shmsize") == 0)
+		{
+			if (fscanf(fp, "%d", &ival) <= 0)
+			{
+				break;
+			}
+
+			/* offsets in the arena are 32-bit */
+			config->shmsize = MIN(MAX(0, ival), 4095);
+		}
 		else if (strcmp(command, "server") == 0)
 		{
 			eiHostDesc	host_desc;
@@ -187,8 +230,13 @@ eiBool ei_config_load(eiConfig *config, const char *filename)
 
 	/* echo the config */
 	ei_info("nthreads\t\t%d\n", config->nthreads);
+	ei_info("affinity\t\t%s\n", 
+		(config->affinity == EI_THREAD_AFFINITY_NODE) ? "node" : 
+		((config->affinity == EI_THREAD_AFFINITY_CORE) ? "core" : "none"));
 	ei_info("memlimit\t\t%d\n", config->memlimit);
 	ei_info("distributed\t%s\n", config->distributed ? "on" : "off");
+	ei_info("shmarena\t\t%s\n", config->shmarena);
+	ei_info("shmsize\t\t%d\n", config->shmsize);
 
 	for (i = 0; i < ei_array_size(&config->servers); ++i)
 	{
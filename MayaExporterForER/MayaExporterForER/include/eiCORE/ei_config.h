@@ -24,6 +24,7 @@
 #include <eiCORE/ei_core.h>
 #include <eiCORE/ei_array.h>
 #include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_shm.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,8 @@ typedef struct eiSearchPath {
 /** \brief The host configurations. */
 typedef struct eiConfig {
 	eiInt		nthreads;
+	/* the policy of binding threads to processors */
+	eiInt		affinity;
 	eiInt		memlimit;
 	eiBool		distributed;
 	/* server only: port number to listen */
@@ -50,6 +53,11 @@ typedef struct eiConfig {
 	eiInt		maxclients;
 	/* manager only: an array of eiHostDesc */
 	ei_array	servers;
+	/* the name and the size in megabytes of the shared memory 
+	   data arena, through which the manager sends data to render 
+	   servers on the same host, the arena is off if either is empty */
+	char		shmarena[ EI_SHM_MAX_NAME_LEN ];
+	eiInt		shmsize;
 	/* an array of eiSearchPath */
 	ei_array	searchpaths;
 } eiConfig;
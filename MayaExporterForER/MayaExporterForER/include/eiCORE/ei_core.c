@@ -16,6 +16,7 @@
 #include <eiCORE/ei_core.h>
 #include <eiCORE/ei_network.h>
 #include <eiCORE/ei_data_gen.h>
+#include <eiCORE/ei_symbol.h>
 #include <eiCORE/ei_assert.h>
 
 #define EI_RESERVED_SIZE		16
@@ -25,6 +26,8 @@ void ei_core_init()
 {
 	ei_verbose_init();
 
+	ei_string_pool_init();
+
 	ei_init_default_data_gen_table();
 
 	ei_info("Starting up network...\n");
@@ -34,6 +37,7 @@ void ei_core_init()
 void ei_core_exit()
 {
 	ei_net_shutdown();
+	ei_string_pool_exit();
 	ei_verbose_exit();
 }
 
@@ -16,6 +16,7 @@
 #include <eiCORE/ei_data_gen.h>
 #include <eiCORE/ei_data_array.h>
 #include <eiCORE/ei_data_table.h>
+#include <eiCORE/ei_config.h>
 #include <eiCORE/ei_assert.h>
 #include <eiCORE/ei_vector.h>
 #include <eiCORE/ei_vector2.h>
@@ -519,6 +520,20 @@ void ei_init_default_data_gen_table()
 
 void ei_run_server()
 {
+	char		cur_dir[ EI_MAX_FILE_NAME_LEN ];
+	char		config_filename[ EI_MAX_FILE_NAME_LEN ];
+	eiConfig	config;
+
+	/* apply the binding policy of this host before the server 
+	   creates its worker threads */
+	ei_get_current_directory(cur_dir);
+	ei_append_filename(config_filename, cur_dir, "server.ini");
+
+	ei_config_init(&config);
+	ei_config_load(&config, config_filename);
+	ei_set_thread_affinity(config.affinity);
+	ei_config_exit(&config);
+
 	ei_job_run_server(
 		&g_DataGenTable, 
 		g_InitGlobals, g_ExitGlobals, 
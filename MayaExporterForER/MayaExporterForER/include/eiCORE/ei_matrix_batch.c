@@ -0,0 +1,326 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiCORE/ei_matrix_batch.h>
+#include <eiCORE/ei_simd.h>
+
+/* transform a chunk of EI_VF_WIDTH points or vectors, 
+   w is 1 for points and 0 for vectors */
+static eiFORCEINLINE void transform_vf(
+	eiVf *ox, eiVf *oy, eiVf *oz, 
+	const eiVf x, const eiVf y, const eiVf z, 
+	const eiMatrix *mx, 
+	const eiScalar w)
+{
+	*ox = ei_vf_add(
+		ei_vf_add(ei_vf_mul(x, ei_vf_set1(mx->m1)), ei_vf_mul(y, ei_vf_set1(mx->m5))), 
+		ei_vf_add(ei_vf_mul(z, ei_vf_set1(mx->m9)), ei_vf_set1(w * mx->m13)));
+	*oy = ei_vf_add(
+		ei_vf_add(ei_vf_mul(x, ei_vf_set1(mx->m2)), ei_vf_mul(y, ei_vf_set1(mx->m6))), 
+		ei_vf_add(ei_vf_mul(z, ei_vf_set1(mx->m10)), ei_vf_set1(w * mx->m14)));
+	*oz = ei_vf_add(
+		ei_vf_add(ei_vf_mul(x, ei_vf_set1(mx->m3)), ei_vf_mul(y, ei_vf_set1(mx->m7))), 
+		ei_vf_add(ei_vf_mul(z, ei_vf_set1(mx->m11)), ei_vf_set1(w * mx->m15)));
+}
+
+static eiFORCEINLINE void transform_soa(
+	eiScalar *ox, eiScalar *oy, eiScalar *oz, 
+	const eiScalar *x, const eiScalar *y, const eiScalar *z, 
+	const eiInt n, 
+	const eiMatrix *mx, 
+	const eiScalar w)
+{
+	eiInt	i;
+
+	for (i = 0; i + EI_VF_WIDTH <= n; i += EI_VF_WIDTH)
+	{
+		eiVf	rx, ry, rz;
+
+		transform_vf(&rx, &ry, &rz, ei_vf_load(x + i), ei_vf_load(y + i), ei_vf_load(z + i), mx, w);
+		ei_vf_store(ox + i, rx);
+		ei_vf_store(oy + i, ry);
+		ei_vf_store(oz + i, rz);
+	}
+
+	/* the remaining elements */
+	for (; i < n; ++i)
+	{
+		eiVector	v, r;
+
+		setv(&v, x[i], y[i], z[i]);
+		if (w != 0.0f)
+		{
+			point_transform(&r, &v, mx);
+		}
+		else
+		{
+			vector_transform(&r, &v, mx);
+		}
+		ox[i] = r.x;
+		oy[i] = r.y;
+		oz[i] = r.z;
+	}
+}
+
+void ei_point_transform_soa(
+	eiScalar *ox, eiScalar *oy, eiScalar *oz, 
+	const eiScalar *x, const eiScalar *y, const eiScalar *z, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	transform_soa(ox, oy, oz, x, y, z, n, mx, 1.0f);
+}
+
+void ei_vector_transform_soa(
+	eiScalar *ox, eiScalar *oy, eiScalar *oz, 
+	const eiScalar *x, const eiScalar *y, const eiScalar *z, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	transform_soa(ox, oy, oz, x, y, z, n, mx, 0.0f);
+}
+
+#if defined(EI_SIMD_AVX2) || defined(EI_SIMD_SSE2)
+
+/* four packed vectors are loaded as three registers 
+   a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3, 
+   and shuffled into structure-of-arrays layout. */
+static eiFORCEINLINE void transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx, 
+	const eiScalar w)
+{
+	__m128	m1, m2, m3, m4;
+	eiInt	i;
+
+	m1 = _mm_loadu_ps(&mx->m1);
+	m2 = _mm_loadu_ps(&mx->m5);
+	m3 = _mm_loadu_ps(&mx->m9);
+	m4 = _mm_mul_ps(_mm_loadu_ps(&mx->m13), _mm_set1_ps(w));
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const eiScalar	*p = &src[i].x;
+		eiScalar		*q = &dst[i].x;
+		__m128			a, b, c;
+		__m128			x, y, z;
+		__m128			rx, ry, rz;
+
+		a = _mm_loadu_ps(p);
+		b = _mm_loadu_ps(p + 4);
+		c = _mm_loadu_ps(p + 8);
+
+		x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), 
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), 
+			_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		rx = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(0, 0, 0, 0))), 
+				_mm_mul_ps(y, _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(0, 0, 0, 0)))), 
+			_mm_add_ps(_mm_mul_ps(z, _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(0, 0, 0, 0))), 
+				_mm_shuffle_ps(m4, m4, _MM_SHUFFLE(0, 0, 0, 0))));
+		ry = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(1, 1, 1, 1))), 
+				_mm_mul_ps(y, _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(1, 1, 1, 1)))), 
+			_mm_add_ps(_mm_mul_ps(z, _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(1, 1, 1, 1))), 
+				_mm_shuffle_ps(m4, m4, _MM_SHUFFLE(1, 1, 1, 1))));
+		rz = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(2, 2, 2, 2))), 
+				_mm_mul_ps(y, _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(2, 2, 2, 2)))), 
+			_mm_add_ps(_mm_mul_ps(z, _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(2, 2, 2, 2))), 
+				_mm_shuffle_ps(m4, m4, _MM_SHUFFLE(2, 2, 2, 2))));
+
+		/* back to packed layout */
+		a = _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 0, 0, 0)), 
+			_mm_shuffle_ps(rz, rx, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		b = _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, _MM_SHUFFLE(1, 1, 1, 1)), 
+			_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+		c = _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 3, 2, 2)), 
+			_mm_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		_mm_storeu_ps(q, a);
+		_mm_storeu_ps(q + 4, b);
+		_mm_storeu_ps(q + 8, c);
+	}
+
+	/* the remaining vectors */
+	for (; i < n; ++i)
+	{
+		eiVector	v;
+
+		movv(&v, &src[i]);
+		if (w != 0.0f)
+		{
+			point_transform(&dst[i], &v, mx);
+		}
+		else
+		{
+			vector_transform(&dst[i], &v, mx);
+		}
+	}
+}
+
+#else
+
+static eiFORCEINLINE void transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx, 
+	const eiScalar w)
+{
+	eiInt	i;
+
+	for (i = 0; i < n; ++i)
+	{
+		eiVector	v;
+
+		movv(&v, &src[i]);
+		if (w != 0.0f)
+		{
+			point_transform(&dst[i], &v, mx);
+		}
+		else
+		{
+			vector_transform(&dst[i], &v, mx);
+		}
+	}
+}
+
+#endif
+
+void ei_point_transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	transform_array(dst, src, n, mx, 1.0f);
+}
+
+void ei_vector_transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	transform_array(dst, src, n, mx, 0.0f);
+}
+
+#if defined(EI_SIMD_AVX2) || defined(EI_SIMD_SSE2)
+
+/* a row vector times a matrix, the four terms are added pairwise, 
+   so results may differ from the scalar code in the last bit */
+static eiFORCEINLINE __m128 mulvm4_sse(
+	const __m128 x, const __m128 y, const __m128 z, const __m128 w, 
+	const __m128 m1, const __m128 m2, const __m128 m3, const __m128 m4)
+{
+	return _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m2)), 
+		_mm_add_ps(_mm_mul_ps(z, m3), _mm_mul_ps(w, m4)));
+}
+
+void ei_mulmm_simd(
+	eiMatrix *rm, 
+	const eiMatrix *mx1, 
+	const eiMatrix *mx2)
+{
+	__m128	m1, m2, m3, m4;
+	__m128	r1, r2, r3, r4;
+
+	m1 = _mm_loadu_ps(&mx2->m1);
+	m2 = _mm_loadu_ps(&mx2->m5);
+	m3 = _mm_loadu_ps(&mx2->m9);
+	m4 = _mm_loadu_ps(&mx2->m13);
+
+	/* all rows are computed before any store, so rm may be 
+	   either of the operands */
+	r1 = mulvm4_sse(_mm_set1_ps(mx1->m1), _mm_set1_ps(mx1->m2), 
+		_mm_set1_ps(mx1->m3), _mm_set1_ps(mx1->m4), m1, m2, m3, m4);
+	r2 = mulvm4_sse(_mm_set1_ps(mx1->m5), _mm_set1_ps(mx1->m6), 
+		_mm_set1_ps(mx1->m7), _mm_set1_ps(mx1->m8), m1, m2, m3, m4);
+	r3 = mulvm4_sse(_mm_set1_ps(mx1->m9), _mm_set1_ps(mx1->m10), 
+		_mm_set1_ps(mx1->m11), _mm_set1_ps(mx1->m12), m1, m2, m3, m4);
+	r4 = mulvm4_sse(_mm_set1_ps(mx1->m13), _mm_set1_ps(mx1->m14), 
+		_mm_set1_ps(mx1->m15), _mm_set1_ps(mx1->m16), m1, m2, m3, m4);
+
+	_mm_storeu_ps(&rm->m1, r1);
+	_mm_storeu_ps(&rm->m5, r2);
+	_mm_storeu_ps(&rm->m9, r3);
+	_mm_storeu_ps(&rm->m13, r4);
+}
+
+void ei_mulvm4_array(
+	eiVector4 *dst, 
+	const eiVector4 *src, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	__m128	m1, m2, m3, m4;
+	eiInt	i;
+
+	m1 = _mm_loadu_ps(&mx->m1);
+	m2 = _mm_loadu_ps(&mx->m5);
+	m3 = _mm_loadu_ps(&mx->m9);
+	m4 = _mm_loadu_ps(&mx->m13);
+
+	for (i = 0; i < n; ++i)
+	{
+		__m128	v = _mm_loadu_ps(&src[i].x);
+
+		_mm_storeu_ps(&dst[i].x, mulvm4_sse(
+			_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), 
+			_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), 
+			_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), 
+			_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), 
+			m1, m2, m3, m4));
+	}
+}
+
+#else
+
+void ei_mulmm_simd(
+	eiMatrix *rm, 
+	const eiMatrix *mx1, 
+	const eiMatrix *mx2)
+{
+	eiMatrix	r;
+
+	mulmm(&r, mx1, mx2);
+	movm(rm, &r);
+}
+
+void ei_mulvm4_array(
+	eiVector4 *dst, 
+	const eiVector4 *src, 
+	const eiInt n, 
+	const eiMatrix *mx)
+{
+	eiInt	i;
+
+	for (i = 0; i < n; ++i)
+	{
+		eiVector4	v;
+
+		movv4(&v, &src[i]);
+		mulvm4(&dst[i], &v, mx);
+	}
+}
+
+#endif
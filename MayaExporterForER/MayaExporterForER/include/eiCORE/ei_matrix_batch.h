@@ -0,0 +1,79 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_MATRIX_BATCH_H
+#define EI_MATRIX_BATCH_H
+
+/** \brief Transforming arrays of points and vectors, for 
+ * tessellation and other transform-heavy loops, and 4x4 matrix 
+ * products with SIMD rows. the results match point_transform, 
+ * vector_transform, mulmm and mulvm4 up to rounding.
+ * \file ei_matrix_batch.h
+ */
+
+#include <eiCORE/ei_matrix.h>
+#include <eiCORE/ei_vector4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Transform n points in structure-of-arrays layout, 
+ * the outputs may be the same arrays as the inputs. */
+eiCORE_API void ei_point_transform_soa(
+	eiScalar *ox, eiScalar *oy, eiScalar *oz, 
+	const eiScalar *x, const eiScalar *y, const eiScalar *z, 
+	const eiInt n, 
+	const eiMatrix *mx);
+/** \brief Transform n vectors in structure-of-arrays layout, 
+ * the outputs may be the same arrays as the inputs. */
+eiCORE_API void ei_vector_transform_soa(
+	eiScalar *ox, eiScalar *oy, eiScalar *oz, 
+	const eiScalar *x, const eiScalar *y, const eiScalar *z, 
+	const eiInt n, 
+	const eiMatrix *mx);
+
+/** \brief Transform an array of n packed points, dst may be src. */
+eiCORE_API void ei_point_transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx);
+/** \brief Transform an array of n packed vectors, dst may be src. */
+eiCORE_API void ei_vector_transform_array(
+	eiVector *dst, 
+	const eiVector *src, 
+	const eiInt n, 
+	const eiMatrix *mx);
+
+/** \brief Multiply two matrices as mulmm does, rm = mx1 * mx2, 
+ * rm may be either of the operands. */
+eiCORE_API void ei_mulmm_simd(
+	eiMatrix *rm, 
+	const eiMatrix *mx1, 
+	const eiMatrix *mx2);
+/** \brief Transform an array of n 4-component vectors as mulvm4 
+ * does, dst may be src. */
+eiCORE_API void ei_mulvm4_array(
+	eiVector4 *dst, 
+	const eiVector4 *src, 
+	const eiInt n, 
+	const eiMatrix *mx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,9 +16,13 @@
 #include <eiCORE/ei_message.h>
 #include <eiCORE/ei_platform.h>
 #include <eiCORE/ei_assert.h>
+#include <string.h>
 
 void ei_msg_init(eiMessage *msg)
 {
+	/* clear all parameters, so that optional parameters 
+	   added to the protocol default to zero. */
+	memset(msg, 0, sizeof(eiMessage));
 	msg->type = EI_MSG_UNKNOWN;
 }
 
@@ -31,6 +35,12 @@ void ei_byteswap_msg(eiMessage * const msg)
 {
 	switch (msg->type)
 	{
+	case EI_MSG_GROUP:
+		{
+			ei_byteswap_msg_group(&msg->group);
+		}
+		break;
+
 	case EI_MSG_REQ_DISCONNECT:
 		{
 			ei_byteswap_msg_req_disconnect(&msg->disconnect_params);
@@ -73,6 +83,12 @@ void ei_byteswap_msg(eiMessage * const msg)
 		}
 		break;
 
+	case EI_MSG_REQ_ALLOCATE_TAG_RANGE:
+		{
+			ei_byteswap_msg_req_allocate_tag_range(&msg->allocate_tag_range_params);
+		}
+		break;
+
 	case EI_MSG_REQ_PROCESS_JOB:
 		{
 			ei_byteswap_msg_req_process_job(&msg->process_job_params);
@@ -139,6 +155,12 @@ void ei_byteswap_msg(eiMessage * const msg)
 		}
 		break;
 
+	case EI_MSG_INF_TAG_RANGE_ALLOCATED:
+		{
+			ei_byteswap_msg_inf_tag_range_allocated(&msg->tag_range_allocated_params);
+		}
+		break;
+
 	case EI_MSG_INF_DATA_GENERATED:
 		{
 			ei_byteswap_msg_inf_data_generated(&msg->data_generated_params);
@@ -177,6 +199,11 @@ void ei_byteswap_msg(eiMessage * const msg)
 	ei_byteswap_int(&msg->type);
 }
 
+void ei_byteswap_msg_group(eiMsgGroup * const params)
+{
+	ei_byteswap_int(&params->num_msgs);
+}
+
 void ei_byteswap_msg_req_disconnect(eiMsgReqDisconnectParams * const params)
 {
 }
@@ -207,6 +234,12 @@ void ei_byteswap_msg_req_allocate_tag(eiMsgReqAllocateTagParams * const params)
 	ei_byteswap_int(&params->host);
 }
 
+void ei_byteswap_msg_req_allocate_tag_range(eiMsgReqAllocateTagRangeParams * const params)
+{
+	ei_byteswap_int(&params->host);
+	ei_byteswap_int(&params->count);
+}
+
 void ei_byteswap_msg_req_process_job(eiMsgReqProcessJobParams * const params)
 {
 	ei_byteswap_int(&params->job);
@@ -231,6 +264,8 @@ void ei_byteswap_msg_req_send_data(eiMsgReqSendDataParams * const params)
 {
 	ei_byteswap_int(&params->data);
 	ei_byteswap_int(&params->defer_init);
+	ei_byteswap_int(&params->accept_compressed);
+	ei_byteswap_int(&params->accept_shm);
 }
 
 void ei_byteswap_msg_req_flush_data(eiMsgReqFlushDataParams * const params)
@@ -272,6 +307,12 @@ void ei_byteswap_msg_inf_tag_allocated(eiMsgInfTagAllocatedParams * const params
 	ei_byteswap_int(&params->tag);
 }
 
+void ei_byteswap_msg_inf_tag_range_allocated(eiMsgInfTagRangeAllocatedParams * const params)
+{
+	ei_byteswap_int(&params->first_tag);
+	ei_byteswap_int(&params->count);
+}
+
 void ei_byteswap_msg_inf_data_generated(eiMsgInfDataGeneratedParams * const params)
 {
 	ei_byteswap_int(&params->data);
@@ -297,4 +338,7 @@ void ei_byteswap_msg_inf_data_info(eiMsgInfDataInfoParams * const params)
 {
 	ei_byteswap_int(&params->size);
 	ei_byteswap_int(&params->inited);
+	ei_byteswap_int(&params->wire_size);
+	ei_byteswap_int(&params->in_shm);
+	ei_byteswap_int(&params->shm_offset);
 }
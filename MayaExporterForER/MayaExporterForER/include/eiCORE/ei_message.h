@@ -50,6 +50,8 @@ enum {
 	EI_MSG_REQ_UPDATE_SCENE,
 	/* server wants manager to allocate a tag. */
 	EI_MSG_REQ_ALLOCATE_TAG,
+	/* server wants manager to lease a range of tags. */
+	EI_MSG_REQ_ALLOCATE_TAG_RANGE,
 	/* manager wants the server to process a job. */
 	EI_MSG_REQ_PROCESS_JOB,
 	/* manager wants the server to create a data. */
@@ -75,6 +77,8 @@ enum {
 	EI_MSG_INF_HOST_AUTHORIZED,
 	/* manager tells the server that the tag was allocated. */
 	EI_MSG_INF_TAG_ALLOCATED,
+	/* manager tells the server that the range of tags was leased. */
+	EI_MSG_INF_TAG_RANGE_ALLOCATED,
 	/* the data has been generated at a host. */
 	EI_MSG_INF_DATA_GENERATED,
 	/* server tells the manager that rendering threads have been created. */
@@ -94,6 +98,11 @@ enum {
 	EI_MSG_END,
 };
 
+/* the number of tags leased to a server in one request. */
+#define EI_TAG_LEASE_SIZE			4096
+
+/* a group message is followed by num_msgs messages 
+   in the same write, see ei_msg_batch.h */
 typedef struct eiMsgGroup {
 	/* the number of messages in this group. */
 	eiUint		num_msgs;
@@ -135,6 +144,13 @@ typedef struct eiMsgReqAllocateTagParams {
 
 } eiMsgReqAllocateTagParams;
 
+typedef struct eiMsgReqAllocateTagRangeParams {
+	eiHostID	host;
+	/* the number of tags requested. */
+	eiUint		count;
+
+} eiMsgReqAllocateTagRangeParams;
+
 typedef struct eiMsgReqProcessJobParams {
 	/* tag of the job to be processed. */
 	eiTag		job;
@@ -178,6 +194,13 @@ typedef struct eiMsgReqSendDataParams {
 	   and only the host which uses the data will 
 	   initialize it. */
 	eiBool		defer_init;
+	/* whether the requester accepts compressed 
+	   data payloads. */
+	eiBool		accept_compressed;
+	/* whether the requester has mapped the shared 
+	   memory data arena of the sender, which means 
+	   they are on the same host. */
+	eiBool		accept_shm;
 
 } eiMsgReqSendDataParams;
 
@@ -232,6 +255,16 @@ typedef struct eiMsgInfTagAllocatedParams {
 
 } eiMsgInfTagAllocatedParams;
 
+typedef struct eiMsgInfTagRangeAllocatedParams {
+	/* the first tag of the leased range, the range 
+	   is [first_tag, first_tag + count). */
+	eiTag		first_tag;
+	/* the number of tags actually leased, may be 
+	   less than requested. */
+	eiUint		count;
+
+} eiMsgInfTagRangeAllocatedParams;
+
 typedef struct eiMsgInfDataGeneratedParams {
 	/* tag of the generated data. */
 	eiTag		data;
@@ -266,6 +299,14 @@ typedef struct eiMsgInfDataInfoParams {
 	/* the initialization state of the data to be
 	   received. */
 	eiBool		inited;
+	/* the size of the compressed payload following 
+	   this message, 0 if the payload is not compressed. */
+	eiUint		wire_size;
+	/* whether the payload is in the shared memory data 
+	   arena of the sender instead of following this 
+	   message, at shm_offset. */
+	eiBool		in_shm;
+	eiUint		shm_offset;
 
 } eiMsgInfDataInfoParams;
 
@@ -302,6 +343,7 @@ typedef struct eiMessage {
 		eiMsgReqEndSceneParams			end_scene_params;
 		eiMsgReqUpdateSceneParams		update_scene_params;
 		eiMsgReqAllocateTagParams		allocate_tag_params;
+		eiMsgReqAllocateTagRangeParams	allocate_tag_range_params;
 		eiMsgReqProcessJobParams		process_job_params;
 		eiMsgReqCreateDataParams		create_data_params;
 		eiMsgReqDeleteDataParams		delete_data_params;
@@ -314,6 +356,7 @@ typedef struct eiMessage {
 		eiMsgInfHostAllocatedParams		host_allocated_params;
 		eiMsgInfHostAuthorizedParams	host_authorized_params;
 		eiMsgInfTagAllocatedParams		tag_allocated_params;
+		eiMsgInfTagRangeAllocatedParams	tag_range_allocated_params;
 		eiMsgInfDataGeneratedParams		data_generated_params;
 		eiMsgInfThreadCreatedParams		thread_created_params;
 		eiMsgInfJobFinishedParams		job_finished_params;
@@ -330,6 +373,8 @@ eiCORE_API void ei_msg_set(eiMessage *msg, const eiInt type);
 
 eiCORE_API void ei_byteswap_msg(eiMessage * const msg);
 
+void ei_byteswap_msg_group(eiMsgGroup * const params);
+
 void ei_byteswap_msg_req_disconnect(eiMsgReqDisconnectParams * const params);
 void ei_byteswap_msg_req_create_threads(eiMsgReqCreateThreadsParams * const params);
 void ei_byteswap_msg_req_link(eiMsgReqLinkParams * const params);
@@ -337,6 +382,7 @@ void ei_byteswap_msg_req_set_scene(eiMsgReqSetSceneParams * const params);
 void ei_byteswap_msg_req_end_scene(eiMsgReqEndSceneParams * const params);
 void ei_byteswap_msg_req_update_scene(eiMsgReqUpdateSceneParams * const params);
 void ei_byteswap_msg_req_allocate_tag(eiMsgReqAllocateTagParams * const params);
+void ei_byteswap_msg_req_allocate_tag_range(eiMsgReqAllocateTagRangeParams * const params);
 void ei_byteswap_msg_req_process_job(eiMsgReqProcessJobParams * const params);
 void ei_byteswap_msg_req_create_data(eiMsgReqCreateDataParams * const params);
 void ei_byteswap_msg_req_delete_data(eiMsgReqDeleteDataParams * const params);
@@ -349,6 +395,7 @@ void ei_byteswap_msg_inf_generic(eiMsgInfGenericParams * const params);
 void ei_byteswap_msg_inf_host_allocated(eiMsgInfHostAllocatedParams * const params);
 void ei_byteswap_msg_inf_host_authorized(eiMsgInfHostAuthorizedParams * const params);
 void ei_byteswap_msg_inf_tag_allocated(eiMsgInfTagAllocatedParams * const params);
+void ei_byteswap_msg_inf_tag_range_allocated(eiMsgInfTagRangeAllocatedParams * const params);
 void ei_byteswap_msg_inf_data_generated(eiMsgInfDataGeneratedParams * const params);
 void ei_byteswap_msg_inf_thread_created(eiMsgInfThreadCreatedParams * const params);
 void ei_byteswap_msg_inf_job_finished(eiMsgInfJobFinishedParams * const params);
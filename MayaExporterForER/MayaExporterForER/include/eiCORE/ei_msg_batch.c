@@ -0,0 +1,638 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiCORE/ei_msg_batch.h>
+#include <eiCORE/ei_verbose.h>
+#include <eiCORE/ei_compress.h>
+#include <eiCORE/ei_assert.h>
+
+/* the maximum number of messages in one group,
+   for rejecting corrupted group headers */
+#define EI_MSG_GROUP_MAX_SIZE		65536
+
+void ei_msg_batch_init(
+	eiMsgBatch *batch,
+	SOCKET sock,
+	const eiBool need_byteswap,
+	const eiUint max_msgs)
+{
+	ei_create_lock(&batch->lock);
+	batch->sock = sock;
+	batch->need_byteswap = need_byteswap;
+	batch->max_msgs = MAX(1, MIN(max_msgs, EI_MSG_GROUP_MAX_SIZE));
+	/* reserve the first slot for the group header */
+	batch->msgs = (eiMessage *)ei_allocate(sizeof(eiMessage) * (batch->max_msgs + 1));
+	batch->num_msgs = 0;
+	batch->num_sent_msgs = 0;
+	batch->num_writes = 0;
+}
+
+void ei_msg_batch_exit(eiMsgBatch *batch)
+{
+	ei_msg_batch_flush(batch);
+
+	ei_debug("Message batch sent %d messages in %d writes.\n",
+		(eiInt)batch->num_sent_msgs,
+		(eiInt)batch->num_writes);
+
+	eiCHECK_FREE(batch->msgs);
+	ei_delete_lock(&batch->lock);
+}
+
+eiBool ei_msg_is_batchable(const eiInt type)
+{
+	switch (type)
+	{
+	/* these messages do not expect a reply, messages which 
+	   expect a reply such as EI_MSG_REQ_SEND_DATA are sent 
+	   immediately after flushing the pending messages, 
+	   otherwise the sender would wait for a reply to a 
+	   request which is never sent. */
+	case EI_MSG_REQ_CREATE_DATA:
+	case EI_MSG_REQ_DELETE_DATA:
+	case EI_MSG_REQ_FLUSH_DATA:
+	case EI_MSG_REQ_STEP_PROGRESS:
+	case EI_MSG_INF_DATA_GENERATED:
+	case EI_MSG_BUCKET_STARTED:
+	case EI_MSG_BUCKET_FINISHED:
+		return eiTRUE;
+
+	default:
+		return eiFALSE;
+	}
+}
+
+static eiBool ei_msg_batch_flush_imp(eiMsgBatch *batch)
+{
+	eiMessage	*data;
+	eiUint		num_msgs;
+	eiBool		result;
+
+	if (batch->num_msgs == 0)
+	{
+		return eiTRUE;
+	}
+
+	num_msgs = batch->num_msgs;
+
+	if (num_msgs == 1)
+	{
+		/* a single message does not need the group header */
+		data = &batch->msgs[1];
+	}
+	else
+	{
+		data = &batch->msgs[0];
+		ei_msg_set(data, EI_MSG_GROUP);
+		data->group.num_msgs = num_msgs;
+
+		if (batch->need_byteswap)
+		{
+			ei_byteswap_msg(data);
+		}
+
+		++ num_msgs;
+	}
+
+	result = ei_net_send(batch->sock, (eiByte *)data, sizeof(eiMessage) * num_msgs);
+
+	batch->num_sent_msgs += batch->num_msgs;
+	++ batch->num_writes;
+	batch->num_msgs = 0;
+
+	return result;
+}
+
+eiBool ei_msg_batch_add(eiMsgBatch *batch, const eiMessage *msg)
+{
+	eiBool	result;
+
+	ei_lock(&batch->lock);
+
+	if (!ei_msg_is_batchable(msg->type))
+	{
+		eiMessage	send_msg;
+
+		/* preserve the order of messages */
+		result = ei_msg_batch_flush_imp(batch);
+
+		send_msg = *msg;
+
+		if (batch->need_byteswap)
+		{
+			ei_byteswap_msg(&send_msg);
+		}
+
+		result = result &&
+			ei_net_send(batch->sock, (eiByte *)&send_msg, sizeof(eiMessage));
+
+		++ batch->num_sent_msgs;
+		++ batch->num_writes;
+	}
+	else
+	{
+		eiMessage	*dst;
+
+		dst = &batch->msgs[batch->num_msgs + 1];
+		*dst = *msg;
+
+		if (batch->need_byteswap)
+		{
+			ei_byteswap_msg(dst);
+		}
+
+		++ batch->num_msgs;
+		result = eiTRUE;
+
+		if (batch->num_msgs >= batch->max_msgs)
+		{
+			result = ei_msg_batch_flush_imp(batch);
+		}
+	}
+
+	ei_unlock(&batch->lock);
+
+	return result;
+}
+
+eiBool ei_msg_batch_flush(eiMsgBatch *batch)
+{
+	eiBool	result;
+
+	ei_lock(&batch->lock);
+	result = ei_msg_batch_flush_imp(batch);
+	ei_unlock(&batch->lock);
+
+	return result;
+}
+
+eiBool ei_msg_batch_recv_group(
+	SOCKET sock,
+	const eiMessage *group_msg,
+	ei_msg_batch_proc proc,
+	void *param)
+{
+	eiMessage	*msgs;
+	eiUint		num_msgs;
+	eiUint		i;
+	eiBool		result;
+
+	eiDBG_ASSERT(group_msg->type == EI_MSG_GROUP);
+
+	/* byte order was converted by the sender */
+	num_msgs = group_msg->group.num_msgs;
+
+	if (num_msgs == 0)
+	{
+		return eiTRUE;
+	}
+
+	if (num_msgs > EI_MSG_GROUP_MAX_SIZE)
+	{
+		ei_error("Invalid message group size %d.\n", num_msgs);
+		return eiFALSE;
+	}
+
+	msgs = (eiMessage *)ei_allocate(sizeof(eiMessage) * num_msgs);
+
+	result = ei_net_recv(sock, (eiByte *)msgs, sizeof(eiMessage) * num_msgs);
+
+	for (i = 0; result && i < num_msgs; ++i)
+	{
+		result = proc(&msgs[i], param);
+	}
+
+	eiCHECK_FREE(msgs);
+
+	return result;
+}
+
+eiBool ei_msg_send_data(
+	SOCKET sock,
+	const eiByte *data,
+	const eiUint size,
+	const eiBool inited,
+	const eiBool compress,
+	const eiBool need_byteswap,
+	eiShmArena *arena,
+	eiUint *wire_size)
+{
+	eiMessage	inf;
+	eiByte		*packed;
+	eiUint		packed_size;
+	eiSizet		shm_offset;
+	eiBool		result;
+
+	packed = NULL;
+	packed_size = 0;
+	shm_offset = eiMAX_SIZET;
+
+	/* the arena only addresses 32-bit offsets in messages */
+	if (arena != NULL)
+	{
+		shm_offset = ei_shm_arena_alloc(arena, size);
+
+		if (shm_offset != eiMAX_SIZET && shm_offset + size > (eiSizet)0xFFFFFFFF)
+		{
+			shm_offset = eiMAX_SIZET;
+		}
+
+		if (shm_offset != eiMAX_SIZET)
+		{
+			memcpy(ei_shm_arena_ptr(arena, shm_offset), data, size);
+		}
+	}
+
+	if (shm_offset == eiMAX_SIZET && compress && size >= EI_MSG_COMPRESS_THRESHOLD)
+	{
+		packed = (eiByte *)ei_allocate(ei_lz_compress_bound(size));
+		packed_size = ei_lz_compress(data, size, packed, size - size / 8);
+
+		/* not worth it, send raw data */
+		if (packed_size == 0)
+		{
+			eiCHECK_FREE(packed);
+		}
+	}
+
+	/* first, let it know the current size of the data. */
+	ei_msg_init(&inf);
+	ei_msg_set(&inf, EI_MSG_INF_DATA_INFO);
+	inf.data_info_params.size = size;
+	inf.data_info_params.inited = inited;
+	inf.data_info_params.wire_size = packed_size;
+	inf.data_info_params.in_shm = (shm_offset != eiMAX_SIZET);
+	inf.data_info_params.shm_offset = (shm_offset != eiMAX_SIZET) ? (eiUint)shm_offset : 0;
+
+	if (need_byteswap)
+	{
+		ei_byteswap_msg(&inf);
+	}
+
+	result = ei_net_send(sock, (eiByte *)&inf, sizeof(eiMessage));
+
+	/* now we can send the actual data content. */
+	if (shm_offset != eiMAX_SIZET)
+	{
+		/* the payload has been written into the arena */
+	}
+	else if (packed != NULL)
+	{
+		result = result && ei_net_send(sock, packed, packed_size);
+
+		eiCHECK_FREE(packed);
+	}
+	else
+	{
+		result = result && ei_net_send(sock, (eiByte *)data, size);
+	}
+
+	if (wire_size != NULL)
+	{
+		if (shm_offset != eiMAX_SIZET)
+		{
+			*wire_size = 0;
+		}
+		else
+		{
+			*wire_size = (packed_size != 0) ? packed_size : size;
+		}
+	}
+
+	return result;
+}
+
+eiBool ei_msg_recv_data(
+	SOCKET sock,
+	const eiMsgInfDataInfoParams *info,
+	eiShmArena *arena,
+	eiByte *data)
+{
+	eiByte	*packed;
+	eiBool	result;
+
+	if (info->in_shm)
+	{
+		if (arena == NULL || 
+			(eiUint64)info->shm_offset + info->size > ei_shm_arena_size(arena))
+		{
+			ei_error("Invalid shared memory payload of size %d.\n", info->size);
+			return eiFALSE;
+		}
+
+		memcpy(data, ei_shm_arena_ptr(arena, info->shm_offset), info->size);
+
+		return eiTRUE;
+	}
+
+	if (info->wire_size == 0)
+	{
+		return ei_net_recv(sock, data, info->size);
+	}
+
+	packed = (eiByte *)ei_allocate(info->wire_size);
+
+	result = ei_net_recv(sock, packed, info->wire_size) && 
+		ei_lz_decompress(packed, info->wire_size, data, info->size);
+
+	if (!result)
+	{
+		ei_error("Failed to receive compressed data of size %d.\n", info->size);
+	}
+
+	eiCHECK_FREE(packed);
+
+	return result;
+}
+
+static eiBool ei_msg_request_data(
+	SOCKET sock,
+	const eiTag tag,
+	const eiBool defer_init,
+	const eiBool need_byteswap,
+	const eiBool accept_shm)
+{
+	eiMessage	req;
+
+	ei_msg_init(&req);
+	ei_msg_set(&req, EI_MSG_REQ_SEND_DATA);
+	req.send_data_params.data = tag;
+	req.send_data_params.defer_init = defer_init;
+	req.send_data_params.accept_compressed = eiTRUE;
+	req.send_data_params.accept_shm = accept_shm;
+
+	if (need_byteswap)
+	{
+		ei_byteswap_msg(&req);
+	}
+
+	return ei_net_send(sock, (eiByte *)&req, sizeof(eiMessage));
+}
+
+eiBool ei_msg_request_data_pipelined(
+	SOCKET sock,
+	const eiTag *tags,
+	const eiUint num_tags,
+	const eiUint depth,
+	const eiBool defer_init,
+	const eiBool need_byteswap,
+	eiShmArena *arena,
+	ei_msg_data_proc proc,
+	void *param)
+{
+	eiUint		num_requested;
+	eiUint		i;
+
+	num_requested = 0;
+
+	for (i = 0; i < num_tags; ++i)
+	{
+		eiMessage	inf;
+
+		/* keep the pipeline full */
+		while (num_requested < num_tags && num_requested < i + MAX(1, depth))
+		{
+			if (!ei_msg_request_data(sock, tags[num_requested], defer_init, need_byteswap, (arena != NULL)))
+			{
+				return eiFALSE;
+			}
+
+			++ num_requested;
+		}
+
+		ei_msg_init(&inf);
+
+		if (!ei_net_recv(sock, (eiByte *)&inf, sizeof(eiMessage)))
+		{
+			return eiFALSE;
+		}
+
+		/* the reply is in the byte order of the remote host */
+		if (need_byteswap)
+		{
+			ei_byteswap_int(&inf.type);
+
+			if (inf.type == EI_MSG_INF_DATA_INFO)
+			{
+				ei_byteswap_msg_inf_data_info(&inf.data_info_params);
+			}
+		}
+
+		if (inf.type != EI_MSG_INF_DATA_INFO)
+		{
+			ei_error("Unexpected message %d while receiving data %d.\n", inf.type, tags[i]);
+			return eiFALSE;
+		}
+
+		if (!proc(sock, tags[i], &inf.data_info_params, arena, param))
+		{
+			return eiFALSE;
+		}
+	}
+
+	return eiTRUE;
+}
+
+eiUint ei_msg_frame_size(const eiByte *header, void *param)
+{
+	const eiMsgFrameParams	*params;
+	eiMessage				msg;
+	eiBool					need_byteswap;
+	eiUint					max_payload_size;
+
+	params = (const eiMsgFrameParams *)param;
+	need_byteswap = (params != NULL) ? params->need_byteswap : eiFALSE;
+	max_payload_size = (params != NULL) ? params->max_payload_size : EI_MSG_MAX_PAYLOAD_SIZE;
+
+	/* the header may not be aligned */
+	memcpy(&msg, header, sizeof(eiMessage));
+
+	if (need_byteswap)
+	{
+		ei_byteswap_int(&msg.type);
+	}
+
+	switch (msg.type)
+	{
+	case EI_MSG_GROUP:
+		{
+			if (need_byteswap)
+			{
+				ei_byteswap_msg_group(&msg.group);
+			}
+
+			if (msg.group.num_msgs > EI_MSG_GROUP_MAX_SIZE)
+			{
+				return 0;
+			}
+
+			return sizeof(eiMessage) * (1 + msg.group.num_msgs);
+		}
+
+	case EI_MSG_INF_DATA_INFO:
+		{
+			eiUint	payload_size;
+
+			if (need_byteswap)
+			{
+				ei_byteswap_msg_inf_data_info(&msg.data_info_params);
+			}
+
+			if (msg.data_info_params.size > max_payload_size)
+			{
+				return 0;
+			}
+
+			payload_size = msg.data_info_params.size;
+
+			/* payloads in shared memory do not follow the message */
+			if (msg.data_info_params.in_shm)
+			{
+				payload_size = 0;
+			}
+			else if (msg.data_info_params.wire_size != 0)
+			{
+				/* compressed payloads never exceed the bound */
+				if (msg.data_info_params.wire_size > ei_lz_compress_bound(msg.data_info_params.size))
+				{
+					return 0;
+				}
+
+				payload_size = msg.data_info_params.wire_size;
+			}
+
+			return sizeof(eiMessage) + payload_size;
+		}
+
+	default:
+		return sizeof(eiMessage);
+	}
+}
+
+void ei_msg_transfer_stats_add(
+	eiMsgTransferStats *stats,
+	const eiUint raw_bytes,
+	const eiUint wire_bytes,
+	const eiUint time)
+{
+	++ stats->num_items;
+	stats->raw_bytes += raw_bytes;
+	stats->wire_bytes += wire_bytes;
+	stats->time += time;
+}
+
+/** \brief A leased range of tags waiting to be allocated. */
+typedef struct eiTagRange {
+	eiTag		first_tag;
+	eiTag		end_tag;
+} eiTagRange;
+
+void ei_tag_lease_init(eiTagLease *lease)
+{
+	ei_create_lock(&lease->lock);
+	lease->next_tag = eiNULL_TAG;
+	lease->end_tag = eiNULL_TAG;
+	ei_array_init(&lease->pending, sizeof(eiTagRange));
+	lease->num_available = 0;
+	lease->num_leases = 0;
+}
+
+void ei_tag_lease_exit(eiTagLease *lease)
+{
+	ei_debug("Leased %d tag ranges from rendering manager.\n", lease->num_leases);
+
+	ei_array_clear(&lease->pending);
+	ei_delete_lock(&lease->lock);
+}
+
+eiBool ei_tag_lease_alloc(eiTagLease *lease, eiTag *tag)
+{
+	eiBool	result;
+
+	ei_lock(&lease->lock);
+
+	/* move on to the next pending range */
+	if (lease->next_tag >= lease->end_tag && !ei_array_empty(&lease->pending))
+	{
+		eiTagRange	*range;
+
+		range = (eiTagRange *)ei_array_front(&lease->pending);
+		lease->next_tag = range->first_tag;
+		lease->end_tag = range->end_tag;
+
+		ei_array_erase(&lease->pending, 0);
+	}
+
+	if (lease->next_tag < lease->end_tag)
+	{
+		*tag = lease->next_tag;
+		++ lease->next_tag;
+		-- lease->num_available;
+		result = eiTRUE;
+	}
+	else
+	{
+		*tag = eiNULL_TAG;
+		result = eiFALSE;
+	}
+
+	ei_unlock(&lease->lock);
+
+	return result;
+}
+
+void ei_tag_lease_refill(
+	eiTagLease *lease,
+	const eiMsgInfTagRangeAllocatedParams *params)
+{
+	if (params->count == 0)
+	{
+		return;
+	}
+
+	ei_lock(&lease->lock);
+
+	if (lease->next_tag >= lease->end_tag && ei_array_empty(&lease->pending))
+	{
+		lease->next_tag = params->first_tag;
+		lease->end_tag = params->first_tag + params->count;
+	}
+	else
+	{
+		eiTagRange	range;
+
+		/* keep the unused tags of the current range */
+		range.first_tag = params->first_tag;
+		range.end_tag = params->first_tag + params->count;
+
+		ei_array_push_back(&lease->pending, &range);
+	}
+
+	lease->num_available += params->count;
+	++ lease->num_leases;
+
+	ei_unlock(&lease->lock);
+}
+
+eiUint ei_tag_lease_available(eiTagLease *lease)
+{
+	eiUint	num_available;
+
+	ei_lock(&lease->lock);
+	num_available = lease->num_available;
+	ei_unlock(&lease->lock);
+
+	return num_available;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_MSG_BATCH_H
+#define EI_MSG_BATCH_H
+
+/** \brief Message batching, data transfer and tag leasing for the 
+ * distributed job protocol.
+ * \file ei_msg_batch.h
+ */
+
+#include <eiCORE/ei_message.h>
+#include <eiCORE/ei_network.h>
+#include <eiCORE/ei_shm.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the default number of pending messages to flush a batch */
+#define EI_MSG_BATCH_DEFAULT_SIZE		64
+/* the minimum size of data payloads to be compressed */
+#define EI_MSG_COMPRESS_THRESHOLD		4096
+/* the default number of data requests in flight */
+#define EI_MSG_PIPELINE_DEFAULT_DEPTH	8
+/* the default maximum size of data payloads on wire */
+#define EI_MSG_MAX_PAYLOAD_SIZE			(1024 * 1024 * 1024)
+
+/** \brief A batch of messages to be sent to one socket, the
+ * messages are coalesced into one EI_MSG_GROUP message followed
+ * by the grouped messages, and written in one send call.
+ */
+typedef struct eiMsgBatch {
+	eiLock			lock;
+	SOCKET			sock;
+	/* whether to byte-swap messages for the remote host */
+	eiBool			need_byteswap;
+	/* the group header followed by pending messages */
+	eiMessage		*msgs;
+	eiUint			num_msgs;
+	/* flush when this number of messages are pending */
+	eiUint			max_msgs;
+	/* statistics */
+	eiUint64		num_sent_msgs;
+	eiUint64		num_writes;
+} eiMsgBatch;
+
+/** \brief The procedure to handle each message received in a group,
+ * the receiving will be terminated if false is returned.
+ */
+typedef eiBool (*ei_msg_batch_proc)(eiMessage *msg, void *param);
+
+/** \brief Initialize a message batch for a socket.
+ */
+eiCORE_API void ei_msg_batch_init(
+	eiMsgBatch *batch,
+	SOCKET sock,
+	const eiBool need_byteswap,
+	const eiUint max_msgs);
+/** \brief Flush pending messages and cleanup the message batch.
+ */
+eiCORE_API void ei_msg_batch_exit(eiMsgBatch *batch);
+/** \brief Returns whether a message type can be deferred in a batch,
+ * messages of other types are sent immediately.
+ */
+eiCORE_API eiBool ei_msg_is_batchable(const eiInt type);
+/** \brief Add a message to the batch, the batch is flushed when it
+ * reaches the threshold. a message which cannot be batched flushes
+ * the pending messages and is then sent immediately, so the message
+ * order is always preserved. callers must flush before waiting for
+ * a reply.
+ */
+eiCORE_API eiBool ei_msg_batch_add(eiMsgBatch *batch, const eiMessage *msg);
+/** \brief Send all pending messages in one write.
+ */
+eiCORE_API eiBool ei_msg_batch_flush(eiMsgBatch *batch);
+/** \brief Receive the messages of a group whose header has been
+ * received, and handle each of them in order.
+ */
+eiCORE_API eiBool ei_msg_batch_recv_group(
+	SOCKET sock,
+	const eiMessage *group_msg,
+	ei_msg_batch_proc proc,
+	void *param);
+
+/** \brief The statistics of data transferred over network.
+ */
+typedef struct eiMsgTransferStats {
+	eiUint64		num_items;
+	/* the size of data before compression */
+	eiUint64		raw_bytes;
+	/* the size of data actually transferred */
+	eiUint64		wire_bytes;
+	/* the accumulated transfer time in milliseconds */
+	eiUint64		time;
+} eiMsgTransferStats;
+
+/** \brief The procedure to receive the payload of a requested data,
+ * the payload must be received by ei_msg_recv_data with arena.
+ */
+typedef eiBool (*ei_msg_data_proc)(
+	SOCKET sock,
+	const eiTag tag,
+	const eiMsgInfDataInfoParams *info,
+	eiShmArena *arena,
+	void *param);
+
+/** \brief Send a data as the reply of EI_MSG_REQ_SEND_DATA, an
+ * EI_MSG_INF_DATA_INFO message followed by the payload, which is
+ * compressed if requested and it is worth it.
+ * @param need_byteswap Whether to byte-swap the message header 
+ * for the remote host, the payload is sent as is.
+ * @param arena The shared memory data arena to put the payload 
+ * into instead of the socket, for requesters which have mapped it, 
+ * or NULL. the payload falls back to the socket if the arena is full.
+ * @param wire_size Returns the size of the payload on wire.
+ */
+eiCORE_API eiBool ei_msg_send_data(
+	SOCKET sock,
+	const eiByte *data,
+	const eiUint size,
+	const eiBool inited,
+	const eiBool compress,
+	const eiBool need_byteswap,
+	eiShmArena *arena,
+	eiUint *wire_size);
+/** \brief Receive the payload following EI_MSG_INF_DATA_INFO into
+ * the data of info->size bytes, decompress if necessary, or copy 
+ * it from the shared memory data arena mapped by the requester.
+ */
+eiCORE_API eiBool ei_msg_recv_data(
+	SOCKET sock,
+	const eiMsgInfDataInfoParams *info,
+	eiShmArena *arena,
+	eiByte *data);
+/** \brief Request a number of data with at most depth requests in
+ * flight, instead of one round trip per data. the replies arrive
+ * in the order of requests, proc is called for each of them.
+ * @param need_byteswap Whether the remote host has different 
+ * byte order, the requests and the replies will be byte-swapped.
+ * @param arena The shared memory data arena of the remote host 
+ * mapped by the requester, or NULL to receive from the socket only.
+ */
+eiCORE_API eiBool ei_msg_request_data_pipelined(
+	SOCKET sock,
+	const eiTag *tags,
+	const eiUint num_tags,
+	const eiUint depth,
+	const eiBool defer_init,
+	const eiBool need_byteswap,
+	eiShmArena *arena,
+	ei_msg_data_proc proc,
+	void *param);
+/** \brief The parameters of ei_msg_frame_size.
+ */
+typedef struct eiMsgFrameParams {
+	/* whether the messages are in the byte order of a 
+	   remote host with different byte order */
+	eiBool			need_byteswap;
+	/* the maximum size of payloads, larger payloads are 
+	   treated as corrupted headers */
+	eiUint			max_payload_size;
+} eiMsgFrameParams;
+
+/** \brief Returns the total size of a message frame in bytes, including
+ * the payloads following the message, can be used as the frame size
+ * procedure of ei_net_create_poller with sizeof(eiMessage) headers. 
+ * param is an optional eiMsgFrameParams, by default the messages are 
+ * in local byte order and payloads are limited to 
+ * EI_MSG_MAX_PAYLOAD_SIZE. returns 0 for corrupted headers.
+ */
+eiCORE_API eiUint ei_msg_frame_size(const eiByte *header, void *param);
+/** \brief Accumulate the statistics of one transfer.
+ */
+eiCORE_API void ei_msg_transfer_stats_add(
+	eiMsgTransferStats *stats,
+	const eiUint raw_bytes,
+	const eiUint wire_bytes,
+	const eiUint time);
+
+/** \brief A range of tags leased from the rendering manager,
+ * so that the server can create data without a round trip
+ * for each tag.
+ */
+typedef struct eiTagLease {
+	eiLock			lock;
+	/* the next tag to allocate */
+	eiTag			next_tag;
+	/* the end of the current range */
+	eiTag			end_tag;
+	/* the ranges received before the current range 
+	   is exhausted, in the order of receiving */
+	ei_array		pending;
+	/* the number of tags not allocated yet */
+	eiUint			num_available;
+	/* statistics */
+	eiUint			num_leases;
+} eiTagLease;
+
+/** \brief Initialize an empty tag lease.
+ */
+eiCORE_API void ei_tag_lease_init(eiTagLease *lease);
+/** \brief Cleanup the tag lease, remaining tags are simply dropped.
+ */
+eiCORE_API void ei_tag_lease_exit(eiTagLease *lease);
+/** \brief Allocate a tag from the leased range, returns false
+ * if the range is exhausted and a new lease is required.
+ */
+eiCORE_API eiBool ei_tag_lease_alloc(eiTagLease *lease, eiTag *tag);
+/** \brief Refill the lease with the range received from the
+ * rendering manager in EI_MSG_INF_TAG_RANGE_ALLOCATED, the 
+ * range is queued after the unused tags of previous ranges.
+ */
+eiCORE_API void ei_tag_lease_refill(
+	eiTagLease *lease,
+	const eiMsgInfTagRangeAllocatedParams *params);
+/** \brief Returns the number of tags not allocated yet, the 
+ * server can request a new lease before the tags run out.
+ */
+eiCORE_API eiUint ei_tag_lease_available(eiTagLease *lease);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,875 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiCORE/ei_net_poller.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_atomic_ops.h>
+#include <eiCORE/ei_verbose.h>
+#include <eiCORE/ei_assert.h>
+
+#ifdef EI_OS_LINUX
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+
+/* the maximum number of events to handle in one wait */
+#define EI_NET_POLLER_MAX_EVENTS		64
+/* the size of receiving buffer of each I/O thread */
+#define EI_NET_POLLER_BUFFER_SIZE		(64 * 1024)
+
+/** \brief A chunk of data to be written, the data follows the chunk. */
+typedef struct eiNetChunk {
+	struct eiNetChunk		*next;
+	eiUint					size;
+	eiUint					offset;
+} eiNetChunk;
+
+/** \brief A connection in the poller. */
+typedef struct eiNetConn {
+	SOCKET					sock;
+	eiInt					id;
+	eiUint					thread;
+	/* one reference is held by the poller until the connection 
+	   is removed, others are held temporarily by sending threads */
+	eiAtomic				ref_count;
+	/* the next removed connection to be freed by the 
+	   I/O thread, guarded by the lock of the poller */
+	struct eiNetConn		*next_retired;
+	/* guarded by write_lock */
+	eiBool					closed;
+	/* the reading state, only accessed by the I/O thread */
+	eiByte					*header;
+	eiUint					header_pos;
+	eiNetFrame				*frame;
+	eiUint					frame_pos;
+	/* the writing queue */
+	eiLock					write_lock;
+	eiNetChunk				*write_head;
+	eiNetChunk				*write_tail;
+} eiNetConn;
+
+/** \brief An I/O thread with its own epoll instance. */
+typedef struct eiNetIOThread {
+	eiNetPoller				*poller;
+	eiThreadHandle			handle;
+	eiInt					epfd;
+	/* the event file descriptor to wake up the thread */
+	eiInt					wakefd;
+	eiByte					*buffer;
+	/* the removed connections to be freed by this thread, 
+	   guarded by the lock of the poller */
+	eiNetConn				*retired;
+} eiNetIOThread;
+
+struct eiNetPoller {
+	eiUint					header_size;
+	ei_net_frame_size_proc	frame_size;
+	void					*param;
+	eiLock					lock;
+	eiNetConn				**conns;
+	eiUint					max_connections;
+	eiNetIOThread			*threads;
+	eiUint					num_threads;
+	eiUint					next_thread;
+	volatile eiBool			quit;
+	/* complete frames received */
+	ei_ts_queue				frames;
+	eiEvent					frame_event;
+};
+
+static void ei_net_delete_frame_node(ei_ts_queue_node *node)
+{
+	ei_free(node);
+}
+
+static eiNetFrame *ei_net_alloc_frame(const eiInt conn, const eiUint size)
+{
+	eiNetFrame	*frame;
+
+	frame = (eiNetFrame *)ei_allocate(sizeof(eiNetFrame) + size);
+	ei_ts_queue_node_init(&frame->node);
+	frame->conn = conn;
+	frame->size = size;
+	frame->data = (eiByte *)(frame + 1);
+
+	return frame;
+}
+
+static void ei_net_push_frame(eiNetPoller *poller, eiNetFrame *frame)
+{
+	ei_ts_queue_push(&poller->frames, &frame->node);
+	ei_signal_event(&poller->frame_event);
+}
+
+/** \brief Write as much queued data as possible without blocking,
+ * must be called with write_lock held, returns false on error. */
+static eiBool ei_net_conn_flush(eiNetConn *conn)
+{
+	while (conn->write_head != NULL)
+	{
+		eiNetChunk	*chunk;
+		ssize_t		n;
+
+		chunk = conn->write_head;
+
+		n = send(conn->sock,
+			(char *)(chunk + 1) + chunk->offset,
+			chunk->size - chunk->offset,
+			MSG_NOSIGNAL);
+
+		if (n > 0)
+		{
+			chunk->offset += (eiUint)n;
+
+			if (chunk->offset == chunk->size)
+			{
+				conn->write_head = chunk->next;
+
+				if (conn->write_head == NULL)
+				{
+					conn->write_tail = NULL;
+				}
+
+				ei_free(chunk);
+			}
+		}
+		else if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			/* will be continued when the socket becomes writable */
+			return eiTRUE;
+		}
+		else
+		{
+			return eiFALSE;
+		}
+	}
+
+	return eiTRUE;
+}
+
+/** \brief Mark a connection as closed, returns whether it was open. */
+static eiBool ei_net_conn_mark_closed(eiNetConn *conn)
+{
+	eiBool	was_open;
+
+	ei_lock(&conn->write_lock);
+	was_open = !conn->closed;
+	conn->closed = eiTRUE;
+	ei_unlock(&conn->write_lock);
+
+	return was_open;
+}
+
+static void ei_net_conn_free(eiNetConn *conn)
+{
+	if (conn->sock != INVALID_SOCKET)
+	{
+		closesocket(conn->sock);
+	}
+
+	while (conn->write_head != NULL)
+	{
+		eiNetChunk	*chunk;
+
+		chunk = conn->write_head;
+		conn->write_head = chunk->next;
+		ei_free(chunk);
+	}
+
+	eiCHECK_FREE(conn->frame);
+	eiCHECK_FREE(conn->header);
+	ei_delete_lock(&conn->write_lock);
+	ei_free(conn);
+}
+
+/** \brief Get a connection by ID and hold a reference to it, 
+ * returns NULL if the connection does not exist. */
+static eiNetConn *ei_net_poller_get_conn(eiNetPoller *poller, const eiInt id)
+{
+	eiNetConn	*conn;
+
+	if (id < 0 || id >= (eiInt)poller->max_connections)
+	{
+		return NULL;
+	}
+
+	ei_lock(&poller->lock);
+
+	conn = poller->conns[id];
+
+	if (conn != NULL)
+	{
+		ei_atomic_inc(&conn->ref_count);
+	}
+
+	ei_unlock(&poller->lock);
+
+	return conn;
+}
+
+static void ei_net_conn_release(eiNetConn *conn)
+{
+	if (ei_atomic_dec(&conn->ref_count) == 0)
+	{
+		ei_net_conn_free(conn);
+	}
+}
+
+/** \brief Free the connections removed since the last call, must be 
+ * called by the I/O thread between handling events, so that no 
+ * event being handled still references these connections. */
+static void ei_net_io_thread_free_retired(eiNetPoller *poller, eiNetIOThread *thread)
+{
+	eiNetConn	*retired;
+	eiNetConn	*conn;
+
+	ei_lock(&poller->lock);
+	retired = thread->retired;
+	thread->retired = NULL;
+	ei_unlock(&poller->lock);
+
+	/* the connections are freed when sending threads release them */
+	while (retired != NULL)
+	{
+		conn = retired;
+		retired = conn->next_retired;
+
+		ei_net_conn_release(conn);
+	}
+}
+
+static void ei_net_conn_unregister(eiNetPoller *poller, eiNetConn *conn, const eiBool notify)
+{
+	epoll_ctl(poller->threads[conn->thread].epfd, EPOLL_CTL_DEL, conn->sock, NULL);
+	shutdown(conn->sock, SHUT_RDWR);
+
+	if (notify)
+	{
+		/* tell the consumer that the connection was closed */
+		ei_net_push_frame(poller, ei_net_alloc_frame(conn->id, 0));
+	}
+}
+
+/** \brief Split received bytes into frames, returns false if 
+ * a frame header is invalid. */
+static eiBool ei_net_conn_consume(
+	eiNetPoller *poller,
+	eiNetConn *conn,
+	const eiByte *data,
+	eiUint size)
+{
+	while (size > 0)
+	{
+		eiUint	n;
+
+		if (conn->frame == NULL)
+		{
+			eiUint	frame_size;
+
+			n = MIN(size, poller->header_size - conn->header_pos);
+			memcpy(conn->header + conn->header_pos, data, n);
+			conn->header_pos += n;
+			data += n;
+			size -= n;
+
+			if (conn->header_pos < poller->header_size)
+			{
+				break;
+			}
+
+			frame_size = poller->frame_size(conn->header, poller->param);
+
+			if (frame_size < poller->header_size)
+			{
+				ei_error("Invalid frame header received by network poller.\n");
+				return eiFALSE;
+			}
+
+			conn->frame = ei_net_alloc_frame(conn->id, frame_size);
+			memcpy(conn->frame->data, conn->header, poller->header_size);
+			conn->frame_pos = poller->header_size;
+			conn->header_pos = 0;
+		}
+		else
+		{
+			n = MIN(size, conn->frame->size - conn->frame_pos);
+			memcpy(conn->frame->data + conn->frame_pos, data, n);
+			conn->frame_pos += n;
+			data += n;
+			size -= n;
+		}
+
+		if (conn->frame_pos == conn->frame->size)
+		{
+			ei_net_push_frame(poller, conn->frame);
+			conn->frame = NULL;
+			conn->frame_pos = 0;
+		}
+	}
+
+	return eiTRUE;
+}
+
+static void ei_net_conn_read(eiNetPoller *poller, eiNetIOThread *thread, eiNetConn *conn)
+{
+	while (eiTRUE)
+	{
+		ssize_t		n;
+
+		n = recv(conn->sock, (char *)thread->buffer, EI_NET_POLLER_BUFFER_SIZE, 0);
+
+		if (n > 0)
+		{
+			if (!ei_net_conn_consume(poller, conn, thread->buffer, (eiUint)n))
+			{
+				/* the stream cannot be recovered */
+				if (ei_net_conn_mark_closed(conn))
+				{
+					ei_net_conn_unregister(poller, conn, eiTRUE);
+				}
+				return;
+			}
+		}
+		else if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			/* edge-triggered, wait for the next event */
+			return;
+		}
+		else
+		{
+			/* connection closed by peer or broken */
+			if (ei_net_conn_mark_closed(conn))
+			{
+				ei_net_conn_unregister(poller, conn, eiTRUE);
+			}
+			return;
+		}
+	}
+}
+
+static eiTHREAD_FUNC ei_net_io_thread(void *param)
+{
+	eiNetIOThread		*thread;
+	eiNetPoller			*poller;
+	struct epoll_event	events[ EI_NET_POLLER_MAX_EVENTS ];
+
+	thread = (eiNetIOThread *)param;
+	poller = thread->poller;
+
+	while (!poller->quit)
+	{
+		eiInt	num_events;
+		eiInt	i;
+
+		ei_net_io_thread_free_retired(poller, thread);
+
+		num_events = epoll_wait(thread->epfd, events, EI_NET_POLLER_MAX_EVENTS, -1);
+
+		if (num_events < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			ei_error("Network poller failed to wait for events.\n");
+			break;
+		}
+
+		for (i = 0; i < num_events; ++i)
+		{
+			eiNetConn	*conn;
+			eiBool		failed;
+
+			conn = (eiNetConn *)events[i].data.ptr;
+
+			if (conn == NULL)
+			{
+				eiUint64	value;
+
+				/* wake up for quitting */
+				if (read(thread->wakefd, &value, sizeof(eiUint64)) < 0)
+				{
+					/* nothing to do */
+				}
+				continue;
+			}
+
+			if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+			{
+				ei_net_conn_read(poller, thread, conn);
+			}
+
+			if (events[i].events & EPOLLOUT)
+			{
+				failed = eiFALSE;
+
+				ei_lock(&conn->write_lock);
+				if (!conn->closed && !ei_net_conn_flush(conn))
+				{
+					conn->closed = eiTRUE;
+					failed = eiTRUE;
+				}
+				ei_unlock(&conn->write_lock);
+
+				if (failed)
+				{
+					ei_net_conn_unregister(poller, conn, eiTRUE);
+				}
+			}
+		}
+	}
+
+	return (eiTHREAD_FUNC_RESULT)0;
+}
+
+eiNetPoller *ei_net_create_poller(
+	const eiUint header_size,
+	ei_net_frame_size_proc frame_size,
+	void *param,
+	const eiUint max_connections,
+	const eiUint num_threads)
+{
+	eiNetPoller		*poller;
+	eiUint			i;
+
+	eiDBG_ASSERT(header_size != 0 && frame_size != NULL);
+
+	poller = (eiNetPoller *)ei_allocate(sizeof(eiNetPoller));
+
+	poller->header_size = header_size;
+	poller->frame_size = frame_size;
+	poller->param = param;
+	ei_create_lock(&poller->lock);
+	poller->max_connections = max_connections;
+	poller->conns = (eiNetConn **)ei_allocate(sizeof(eiNetConn *) * max_connections);
+	memset(poller->conns, 0, sizeof(eiNetConn *) * max_connections);
+	poller->num_threads = MAX(1, num_threads);
+	poller->threads = (eiNetIOThread *)ei_allocate(sizeof(eiNetIOThread) * poller->num_threads);
+	poller->next_thread = 0;
+	poller->quit = eiFALSE;
+	ei_ts_queue_init(&poller->frames, ei_net_delete_frame_node);
+	ei_create_event(&poller->frame_event);
+
+	for (i = 0; i < poller->num_threads; ++i)
+	{
+		eiNetIOThread		*thread;
+		struct epoll_event	ev;
+		eiUint				error;
+
+		thread = &poller->threads[i];
+
+		thread->poller = poller;
+		thread->epfd = epoll_create1(0);
+		thread->wakefd = eventfd(0, EFD_NONBLOCK);
+		thread->buffer = NULL;
+		thread->retired = NULL;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+
+		if (thread->epfd < 0 || 
+			thread->wakefd < 0 || 
+			epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->wakefd, &ev) < 0)
+		{
+			ei_error("Failed to create network I/O thread.\n");
+			break;
+		}
+
+		thread->buffer = (eiByte *)ei_allocate(EI_NET_POLLER_BUFFER_SIZE);
+
+		/* the result of pthread_create is returned as thread ID */
+		error = 0;
+		thread->handle = ei_create_thread(ei_net_io_thread, thread, &error);
+
+		if (error != 0)
+		{
+			ei_error("Failed to create network I/O thread.\n");
+			break;
+		}
+	}
+
+	if (i < poller->num_threads)
+	{
+		/* release the partially created thread, and delete 
+		   the poller with the threads created so far */
+		if (poller->threads[i].wakefd >= 0)
+		{
+			close(poller->threads[i].wakefd);
+		}
+
+		if (poller->threads[i].epfd >= 0)
+		{
+			close(poller->threads[i].epfd);
+		}
+
+		eiCHECK_FREE(poller->threads[i].buffer);
+
+		poller->num_threads = i;
+		ei_net_delete_poller(poller);
+
+		return NULL;
+	}
+
+	return poller;
+}
+
+void ei_net_delete_poller(eiNetPoller *poller)
+{
+	eiUint		i;
+
+	if (poller == NULL)
+	{
+		return;
+	}
+
+	poller->quit = eiTRUE;
+
+	for (i = 0; i < poller->num_threads; ++i)
+	{
+		eiUint64	value;
+
+		value = 1;
+		if (write(poller->threads[i].wakefd, &value, sizeof(eiUint64)) < 0)
+		{
+			ei_error("Failed to wake up network I/O thread.\n");
+		}
+	}
+
+	for (i = 0; i < poller->num_threads; ++i)
+	{
+		eiNetIOThread	*thread;
+
+		thread = &poller->threads[i];
+
+		ei_wait_thread(thread->handle);
+		ei_delete_thread(thread->handle);
+
+		close(thread->wakefd);
+		close(thread->epfd);
+		eiCHECK_FREE(thread->buffer);
+	}
+
+	/* no I/O thread is running now */
+	for (i = 0; i < poller->max_connections; ++i)
+	{
+		if (poller->conns[i] != NULL)
+		{
+			ei_net_conn_free(poller->conns[i]);
+		}
+	}
+
+	/* removed connections not freed by I/O threads yet */
+	for (i = 0; i < poller->num_threads; ++i)
+	{
+		while (poller->threads[i].retired != NULL)
+		{
+			eiNetConn	*conn;
+
+			conn = poller->threads[i].retired;
+			poller->threads[i].retired = conn->next_retired;
+
+			ei_net_conn_free(conn);
+		}
+	}
+
+	ei_delete_event(&poller->frame_event);
+	ei_ts_queue_clear(&poller->frames);
+	eiCHECK_FREE(poller->threads);
+	eiCHECK_FREE(poller->conns);
+	ei_delete_lock(&poller->lock);
+
+	ei_free(poller);
+}
+
+eiInt ei_net_poller_add(eiNetPoller *poller, SOCKET sock)
+{
+	eiNetConn			*conn;
+	struct epoll_event	ev;
+	eiInt				id;
+	eiUint				i;
+
+	if (sock == INVALID_SOCKET)
+	{
+		return -1;
+	}
+
+	ei_lock(&poller->lock);
+
+	id = -1;
+
+	for (i = 0; i < poller->max_connections; ++i)
+	{
+		if (poller->conns[i] == NULL)
+		{
+			id = (eiInt)i;
+			break;
+		}
+	}
+
+	if (id < 0)
+	{
+		ei_unlock(&poller->lock);
+		ei_error("Too many connections in network poller.\n");
+		return -1;
+	}
+
+	conn = (eiNetConn *)ei_allocate(sizeof(eiNetConn));
+
+	conn->sock = sock;
+	conn->id = id;
+	conn->thread = poller->next_thread;
+	ei_atomic_set(&conn->ref_count, 1);
+	conn->next_retired = NULL;
+	conn->closed = eiFALSE;
+	conn->header = (eiByte *)ei_allocate(poller->header_size);
+	conn->header_pos = 0;
+	conn->frame = NULL;
+	conn->frame_pos = 0;
+	ei_create_lock(&conn->write_lock);
+	conn->write_head = NULL;
+	conn->write_tail = NULL;
+
+	poller->conns[id] = conn;
+	poller->next_thread = (poller->next_thread + 1) % poller->num_threads;
+
+	ei_unlock(&poller->lock);
+
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+	/* edge-triggered, handles both reading and writing */
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = conn;
+
+	if (epoll_ctl(poller->threads[conn->thread].epfd, EPOLL_CTL_ADD, sock, &ev) < 0)
+	{
+		ei_error("Failed to add socket to network poller.\n");
+
+		/* no I/O thread knows the connection, free it 
+		   immediately, the socket is left to the caller */
+		ei_lock(&poller->lock);
+		poller->conns[id] = NULL;
+		ei_unlock(&poller->lock);
+
+		fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) & ~O_NONBLOCK);
+
+		conn->sock = INVALID_SOCKET;
+		ei_net_conn_release(conn);
+
+		return -1;
+	}
+
+	return id;
+}
+
+void ei_net_poller_remove(eiNetPoller *poller, const eiInt conn)
+{
+	eiNetConn		*c;
+	eiNetIOThread	*thread;
+	eiUint64		value;
+
+	if (conn < 0 || conn >= (eiInt)poller->max_connections)
+	{
+		return;
+	}
+
+	/* recycle the slot for new connections immediately */
+	ei_lock(&poller->lock);
+
+	c = poller->conns[conn];
+	poller->conns[conn] = NULL;
+
+	ei_unlock(&poller->lock);
+
+	if (c == NULL)
+	{
+		return;
+	}
+
+	/* it may have been closed by the peer already */
+	if (ei_net_conn_mark_closed(c))
+	{
+		ei_net_conn_unregister(poller, c, eiFALSE);
+	}
+
+	/* the I/O thread may still be handling events of the 
+	   connection, let it free the connection between 
+	   handling events */
+	thread = &poller->threads[c->thread];
+
+	ei_lock(&poller->lock);
+	c->next_retired = thread->retired;
+	thread->retired = c;
+	ei_unlock(&poller->lock);
+
+	value = 1;
+	if (write(thread->wakefd, &value, sizeof(eiUint64)) < 0)
+	{
+		ei_error("Failed to wake up network I/O thread.\n");
+	}
+}
+
+eiBool ei_net_poller_send(
+	eiNetPoller *poller,
+	const eiInt conn,
+	const eiByte *data,
+	const eiUint size)
+{
+	eiNetConn	*c;
+	eiNetChunk	*chunk;
+	eiBool		failed;
+
+	c = ei_net_poller_get_conn(poller, conn);
+
+	if (c == NULL)
+	{
+		return eiFALSE;
+	}
+
+	chunk = (eiNetChunk *)ei_allocate(sizeof(eiNetChunk) + size);
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->offset = 0;
+	memcpy(chunk + 1, data, size);
+
+	ei_lock(&c->write_lock);
+
+	if (c->closed)
+	{
+		ei_unlock(&c->write_lock);
+		ei_free(chunk);
+		ei_net_conn_release(c);
+		return eiFALSE;
+	}
+
+	if (c->write_tail != NULL)
+	{
+		c->write_tail->next = chunk;
+	}
+	else
+	{
+		c->write_head = chunk;
+	}
+	c->write_tail = chunk;
+
+	/* try writing immediately from the calling thread, the I/O
+	   thread continues when the socket becomes writable again */
+	failed = eiFALSE;
+
+	if (!ei_net_conn_flush(c))
+	{
+		c->closed = eiTRUE;
+		failed = eiTRUE;
+	}
+
+	ei_unlock(&c->write_lock);
+
+	if (failed)
+	{
+		ei_net_conn_unregister(poller, c, eiTRUE);
+	}
+
+	ei_net_conn_release(c);
+
+	return !failed;
+}
+
+eiNetFrame *ei_net_poller_pop(eiNetPoller *poller)
+{
+	return (eiNetFrame *)ei_ts_queue_pop(&poller->frames);
+}
+
+eiNetFrame *ei_net_poller_wait(eiNetPoller *poller, const eiUint milliseconds)
+{
+	eiNetFrame	*frame;
+
+	frame = ei_net_poller_pop(poller);
+
+	if (frame == NULL)
+	{
+		ei_time_wait_event(&poller->frame_event, milliseconds);
+
+		frame = ei_net_poller_pop(poller);
+	}
+
+	return frame;
+}
+
+void ei_net_free_frame(eiNetFrame *frame)
+{
+	eiCHECK_FREE(frame);
+}
+
+#else
+
+eiNetPoller *ei_net_create_poller(
+	const eiUint header_size,
+	ei_net_frame_size_proc frame_size,
+	void *param,
+	const eiUint max_connections,
+	const eiUint num_threads)
+{
+	/* not supported yet, use blocking sockets */
+	return NULL;
+}
+
+void ei_net_delete_poller(eiNetPoller *poller)
+{
+}
+
+eiInt ei_net_poller_add(eiNetPoller *poller, SOCKET sock)
+{
+	return -1;
+}
+
+void ei_net_poller_remove(eiNetPoller *poller, const eiInt conn)
+{
+}
+
+eiBool ei_net_poller_send(
+	eiNetPoller *poller,
+	const eiInt conn,
+	const eiByte *data,
+	const eiUint size)
+{
+	return eiFALSE;
+}
+
+eiNetFrame *ei_net_poller_pop(eiNetPoller *poller)
+{
+	return NULL;
+}
+
+eiNetFrame *ei_net_poller_wait(eiNetPoller *poller, const eiUint milliseconds)
+{
+	return NULL;
+}
+
+void ei_net_free_frame(eiNetFrame *frame)
+{
+}
+
+#endif
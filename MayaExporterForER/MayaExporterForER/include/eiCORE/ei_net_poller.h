@@ -0,0 +1,110 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_NET_POLLER_H
+#define EI_NET_POLLER_H
+
+/** \brief Event-driven network I/O, multiplexes many connections on
+ * a few I/O threads with non-blocking sockets, complete frames are
+ * handed to the consumer through a thread-safe queue. currently only
+ * implemented with epoll on Linux, ei_net_create_poller returns NULL
+ * on other platforms, callers should fall back to blocking ei_net_send
+ * and ei_net_recv.
+ * \file ei_net_poller.h
+ */
+
+#include <eiCORE/ei_network.h>
+#include <eiCORE/ei_ts_queue.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the default number of I/O threads */
+#define EI_NET_POLLER_DEFAULT_THREADS		2
+
+typedef struct eiNetPoller		eiNetPoller;
+
+/** \brief A complete frame received from a connection. a frame of
+ * zero size indicates that the connection has been closed, the 
+ * connection should still be removed to recycle its slot.
+ */
+typedef struct eiNetFrame {
+	ei_ts_queue_node	node;
+	/* the connection which received the frame */
+	eiInt				conn;
+	eiUint				size;
+	eiByte				*data;
+} eiNetFrame;
+
+/** \brief The procedure to determine the total size of a frame from
+ * its fixed-size header, the header is included in the total size. 
+ * returns a size smaller than the header size such as 0 if the 
+ * header is invalid, then the connection will be closed.
+ */
+typedef eiUint (*ei_net_frame_size_proc)(const eiByte *header, void *param);
+
+/** \brief Create a poller with I/O threads, returns NULL if the 
+ * I/O threads cannot be created.
+ * @param header_size The size of fixed-size frame headers.
+ * @param frame_size The procedure to get the total size of a frame.
+ * @param max_connections The maximum number of connections.
+ */
+eiCORE_API eiNetPoller *ei_net_create_poller(
+	const eiUint header_size,
+	ei_net_frame_size_proc frame_size,
+	void *param,
+	const eiUint max_connections,
+	const eiUint num_threads);
+/** \brief Stop I/O threads and delete the poller, all connections
+ * are closed, pending frames are dropped.
+ */
+eiCORE_API void ei_net_delete_poller(eiNetPoller *poller);
+/** \brief Add a connected socket to the poller, the socket will be
+ * switched to non-blocking mode, and owned by the poller. returns
+ * the connection ID, or -1 on failure, in which case the socket 
+ * is still owned by the caller.
+ */
+eiCORE_API eiInt ei_net_poller_add(eiNetPoller *poller, SOCKET sock);
+/** \brief Close a connection, the slot is recycled immediately, 
+ * the socket is closed and the connection is freed by the I/O 
+ * thread once it has finished handling the pending events of 
+ * the connection.
+ */
+eiCORE_API void ei_net_poller_remove(eiNetPoller *poller, const eiInt conn);
+/** \brief Queue data to be written to a connection, the data is
+ * copied, returns false if the connection has been closed.
+ */
+eiCORE_API eiBool ei_net_poller_send(
+	eiNetPoller *poller,
+	const eiInt conn,
+	const eiByte *data,
+	const eiUint size);
+/** \brief Pop a received frame, returns NULL if there is none.
+ */
+eiCORE_API eiNetFrame *ei_net_poller_pop(eiNetPoller *poller);
+/** \brief Wait for a received frame with time-out in milliseconds,
+ * returns NULL if timed out.
+ */
+eiCORE_API eiNetFrame *ei_net_poller_wait(eiNetPoller *poller, const eiUint milliseconds);
+/** \brief Free a frame returned by the poller.
+ */
+eiCORE_API void ei_net_free_frame(eiNetFrame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
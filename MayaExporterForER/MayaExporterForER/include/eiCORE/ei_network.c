@@ -371,6 +371,34 @@ void ei_net_set_nodelay(SOCKET *sock)
 	setsockopt(*sock, SOL_SOCKET, SO_RCVBUF, (const char *)&sock_buf_size, sizeof(eiInt));
 }
 
+eiBool ei_net_is_local_peer(SOCKET sock)
+{
+	SOCKADDR_IN		local_addr;
+	SOCKADDR_IN		peer_addr;
+	socklen_t		len;
+
+	if (sock == INVALID_SOCKET)
+	{
+		return eiFALSE;
+	}
+
+	len = sizeof(SOCKADDR_IN);
+	if (getsockname(sock, (SOCKADDR *)&local_addr, &len) < 0)
+	{
+		return eiFALSE;
+	}
+
+	len = sizeof(SOCKADDR_IN);
+	if (getpeername(sock, (SOCKADDR *)&peer_addr, &len) < 0)
+	{
+		return eiFALSE;
+	}
+
+	/* loopback, or both ends bound to the same address */
+	return ((ntohl(peer_addr.sin_addr.s_addr) >> 24) == 127 || 
+		local_addr.sin_addr.s_addr == peer_addr.sin_addr.s_addr);
+}
+
 eiShort ei_net_hton_short(const eiShort v)
 {
 	return htons(v);
@@ -76,6 +76,9 @@ eiCORE_API SOCKET ei_net_time_accept(SOCKET srvSock, SOCKADDR_IN *clientAddr);
 eiCORE_API eiBool ei_net_init_client(SOCKET *clientSock, eiUshort port, const char *srvName);
 eiCORE_API eiBool ei_net_close_socket(SOCKET *sock);
 eiCORE_API void ei_net_set_nodelay(SOCKET *sock);
+/** \brief Returns whether the peer of a connected socket is on the 
+ * same host, in which case shared memory transport can be used. */
+eiCORE_API eiBool ei_net_is_local_peer(SOCKET sock);
 eiCORE_API eiShort ei_net_hton_short(const eiShort v);
 eiCORE_API eiUshort ei_net_hton_ushort(const eiUshort v);
 eiCORE_API eiInt ei_net_hton_int(const eiInt v);
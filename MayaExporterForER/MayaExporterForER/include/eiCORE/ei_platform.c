@@ -13,7 +13,13 @@
  * limitations under the License.
  */
 
+/* required for binding threads to processors */
+#if !defined _WIN32 && !defined _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_atomic_ops.h>
 #include <eiCORE/ei_assert.h>
 
 #include <malloc.h>
@@ -22,6 +28,9 @@
 #include <time.h>
 #include <errno.h>
 
+/* the maximum number of NUMA nodes to detect */
+#define EI_MAX_NUMA_NODES		64
+
 #ifdef EI_OS_WINDOWS
 
 #include <io.h>
@@ -66,6 +75,128 @@ eiUint ei_get_number_threads()
 	return sys_info.dwNumberOfProcessors;
 }
 
+/** \brief The processors of a NUMA node within its processor group, 
+ * laid out as GROUP_AFFINITY. */
+typedef struct eiGroupAffinity {
+	ULONG_PTR	mask;
+	WORD		group;
+	WORD		reserved[3];
+} eiGroupAffinity;
+
+typedef BOOL (WINAPI *eiGetNumaHighestNodeNumberProc)(PULONG highest_node);
+typedef BOOL (WINAPI *eiGetNumaNodeProcessorMaskExProc)(USHORT node, eiGroupAffinity *affinity);
+typedef BOOL (WINAPI *eiSetThreadGroupAffinityProc)(HANDLE thread, const eiGroupAffinity *affinity, eiGroupAffinity *prev_affinity);
+
+/** \brief Get the processors of all NUMA nodes which own processors, 
+ * returns the number of nodes. the NUMA functions are not declared 
+ * for our minimum Windows version, so look them up at runtime. */
+static eiUint ei_get_numa_node_affinities(eiGroupAffinity *nodes, const eiUint max_nodes)
+{
+	HMODULE								kernel;
+	eiGetNumaHighestNodeNumberProc		get_highest_node;
+	eiGetNumaNodeProcessorMaskExProc	get_node_mask;
+	ULONG								highest_node;
+	ULONG								node;
+	eiUint								num_nodes;
+
+	kernel = GetModuleHandle("kernel32.dll");
+
+	if (kernel == NULL)
+	{
+		return 0;
+	}
+
+	get_highest_node = (eiGetNumaHighestNodeNumberProc)GetProcAddress(kernel, "GetNumaHighestNodeNumber");
+	get_node_mask = (eiGetNumaNodeProcessorMaskExProc)GetProcAddress(kernel, "GetNumaNodeProcessorMaskEx");
+
+	if (get_highest_node == NULL || get_node_mask == NULL || !get_highest_node(&highest_node))
+	{
+		return 0;
+	}
+
+	/* node numbers may not be contiguous, skip nodes without processors */
+	num_nodes = 0;
+
+	for (node = 0; node <= highest_node && num_nodes < max_nodes; ++node)
+	{
+		eiGroupAffinity	affinity;
+
+		memset(&affinity, 0, sizeof(affinity));
+
+		if (get_node_mask((USHORT)node, &affinity) && affinity.mask != 0)
+		{
+			nodes[ num_nodes ++ ] = affinity;
+		}
+	}
+
+	return num_nodes;
+}
+
+eiUint ei_get_number_numa_nodes()
+{
+	eiGroupAffinity	nodes[ EI_MAX_NUMA_NODES ];
+
+	return MAX(1, ei_get_numa_node_affinities(nodes, EI_MAX_NUMA_NODES));
+}
+
+eiBool ei_bind_current_thread(const eiInt policy, const eiUint index)
+{
+	eiGroupAffinity					nodes[ EI_MAX_NUMA_NODES ];
+	eiGroupAffinity					affinity;
+	eiSetThreadGroupAffinityProc	set_group_affinity;
+	eiUint							num_nodes;
+
+	if (policy == EI_THREAD_AFFINITY_NONE)
+	{
+		return eiTRUE;
+	}
+
+	set_group_affinity = (eiSetThreadGroupAffinityProc)GetProcAddress(
+		GetModuleHandle("kernel32.dll"), "SetThreadGroupAffinity");
+	num_nodes = ei_get_numa_node_affinities(nodes, EI_MAX_NUMA_NODES);
+
+	if (set_group_affinity == NULL || num_nodes == 0)
+	{
+		return eiFALSE;
+	}
+
+	/* the mask is relative to the processor group of the node, 
+	   so processors beyond the first 64 are reachable */
+	affinity = nodes[ index % num_nodes ];
+
+	if (policy == EI_THREAD_AFFINITY_CORE)
+	{
+		eiUint	num_cpus, k, i;
+
+		/* pick the k-th processor of the node */
+		num_cpus = 0;
+		for (i = 0; i < sizeof(ULONG_PTR) * 8; ++i)
+		{
+			if (affinity.mask & ((ULONG_PTR)1 << i))
+			{
+				++ num_cpus;
+			}
+		}
+
+		k = (index / num_nodes) % num_cpus;
+
+		for (i = 0; i < sizeof(ULONG_PTR) * 8; ++i)
+		{
+			if (affinity.mask & ((ULONG_PTR)1 << i))
+			{
+				if (k == 0)
+				{
+					affinity.mask = ((ULONG_PTR)1 << i);
+					break;
+				}
+				-- k;
+			}
+		}
+	}
+
+	return (set_group_affinity(GetCurrentThread(), &affinity, NULL) != 0);
+}
+
 eiThreadHandle ei_get_current_thread()
 {
 	return GetCurrentThread();
@@ -354,6 +485,154 @@ eiUint ei_get_number_threads()
 	return number;
 }
 
+/** \brief Get the processors of a NUMA node from sysfs, 
+ * returns the number of processors. */
+static eiUint ei_get_numa_node_cpus(const eiUint node, eiUint *cpus, const eiUint max_cpus)
+{
+	char	filename[ 128 ];
+	char	buf[ 1024 ];
+	char	*token;
+	char	*saveptr;
+	FILE	*fp;
+	eiUint	num_cpus;
+
+	sprintf(filename, "/sys/devices/system/node/node%d/cpulist", node);
+
+	fp = fopen(filename, "r");
+
+	if (fp == NULL)
+	{
+		return 0;
+	}
+
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+	{
+		buf[0] = '\0';
+	}
+
+	fclose(fp);
+
+	/* the list is in the form of "0-7,16-23" */
+	num_cpus = 0;
+
+	for (token = strtok_r(buf, ",\n", &saveptr); 
+		token != NULL; 
+		token = strtok_r(NULL, ",\n", &saveptr))
+	{
+		eiInt	first, last, i;
+
+		if (sscanf(token, "%d-%d", &first, &last) != 2)
+		{
+			if (sscanf(token, "%d", &first) != 1)
+			{
+				continue;
+			}
+			last = first;
+		}
+
+		for (i = first; i <= last && num_cpus < max_cpus; ++i)
+		{
+			cpus[ num_cpus ++ ] = (eiUint)i;
+		}
+	}
+
+	return num_cpus;
+}
+
+/** \brief Get the IDs of all NUMA nodes from sysfs, node IDs may 
+ * not be contiguous, returns the number of nodes. */
+static eiUint ei_get_numa_node_ids(eiUint *nodes, const eiUint max_nodes)
+{
+	glob_t		globbuf;
+	eiUint		num_nodes;
+	eiUint		i;
+
+	num_nodes = 0;
+	globbuf.gl_offs = 0;
+
+	if (glob("/sys/devices/system/node/node[0-9]*", 0, NULL, &globbuf) != 0)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < globbuf.gl_pathc && num_nodes < max_nodes; ++i)
+	{
+		eiUint	node;
+
+		if (sscanf(globbuf.gl_pathv[i], "/sys/devices/system/node/node%u", &node) == 1)
+		{
+			nodes[ num_nodes ++ ] = node;
+		}
+	}
+
+	globfree(&globbuf);
+
+	return num_nodes;
+}
+
+eiUint ei_get_number_numa_nodes()
+{
+	eiUint		nodes[ EI_MAX_NUMA_NODES ];
+
+	return MAX(1, ei_get_numa_node_ids(nodes, EI_MAX_NUMA_NODES));
+}
+
+eiBool ei_bind_current_thread(const eiInt policy, const eiUint index)
+{
+	eiUint		nodes[ EI_MAX_NUMA_NODES ];
+	eiUint		cpus[ CPU_SETSIZE ];
+	eiUint		num_cpus;
+	eiUint		num_nodes;
+	cpu_set_t	set;
+	eiUint		i;
+
+	if (policy == EI_THREAD_AFFINITY_NONE)
+	{
+		return eiTRUE;
+	}
+
+	num_cpus = 0;
+	num_nodes = ei_get_numa_node_ids(nodes, EI_MAX_NUMA_NODES);
+
+	if (num_nodes != 0)
+	{
+		num_cpus = ei_get_numa_node_cpus(nodes[ index % num_nodes ], cpus, CPU_SETSIZE);
+	}
+
+	/* no NUMA information, treat all processors as one node */
+	if (num_cpus == 0)
+	{
+		num_nodes = 1;
+		num_cpus = MIN(ei_get_number_threads(), CPU_SETSIZE);
+
+		for (i = 0; i < num_cpus; ++i)
+		{
+			cpus[i] = i;
+		}
+	}
+
+	if (num_cpus == 0)
+	{
+		return eiFALSE;
+	}
+
+	CPU_ZERO(&set);
+
+	if (policy == EI_THREAD_AFFINITY_CORE)
+	{
+		CPU_SET(cpus[ (index / num_nodes) % num_cpus ], &set);
+	}
+	else
+	{
+		for (i = 0; i < num_cpus; ++i)
+		{
+			CPU_SET(cpus[i], &set);
+		}
+	}
+
+	return (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0);
+}
+
 eiThreadHandle ei_get_current_thread()
 {
 	return pthread_self();
@@ -600,6 +879,35 @@ void ei_unmap_file(eiFileMap* file_map)
 
 #endif
 
+static eiInt g_ThreadAffinity = EI_THREAD_AFFINITY_NONE;
+
+void ei_set_thread_affinity(const eiInt policy)
+{
+	g_ThreadAffinity = policy;
+}
+
+eiInt ei_get_thread_affinity()
+{
+	return g_ThreadAffinity;
+}
+
+/* the number of worker threads bound on this host */
+static eiAtomic g_NumBoundThreads;
+
+eiBool ei_bind_worker_thread()
+{
+	eiUint	index;
+
+	if (g_ThreadAffinity == EI_THREAD_AFFINITY_NONE)
+	{
+		return eiTRUE;
+	}
+
+	index = (eiUint)(ei_atomic_inc(&g_NumBoundThreads) - 1);
+
+	return ei_bind_current_thread(g_ThreadAffinity, index);
+}
+
 eiInt ei_get_endian()
 {
 #ifdef EI_OS_LITTLE_ENDIAN
@@ -613,7 +921,7 @@ void ei_byteswap_short(void *v)
 {
 	eiShort result;
 	eiByte *dst = (eiByte *)&result;
-	eiByte *src = (eiByte *)&v;
+	eiByte *src = (eiByte *)v;
 	dst[0] = src[1];
 	dst[1] = src[0];
 	*((eiShort *)v) = result;
@@ -623,7 +931,7 @@ void ei_byteswap_int(void *v)
 {
 	eiInt result;
 	eiByte *dst = (eiByte *)&result;
-	eiByte *src = (eiByte *)&v;
+	eiByte *src = (eiByte *)v;
 	dst[0] = src[3];
 	dst[1] = src[2];
 	dst[2] = src[1];
@@ -635,15 +943,15 @@ void ei_byteswap_long(void *v)
 {
 	eiLong result;
 	eiByte *dst = (eiByte *)&result;
-	eiByte *src = (eiByte *)&v;
-	dst[0] = src[3];
-	dst[1] = src[2];
-	dst[2] = src[1];
-	dst[3] = src[0];
-	dst[4] = src[7];
-	dst[5] = src[6];
-	dst[6] = src[5];
-	dst[7] = src[4];
+	eiByte *src = (eiByte *)v;
+	dst[0] = src[7];
+	dst[1] = src[6];
+	dst[2] = src[5];
+	dst[3] = src[4];
+	dst[4] = src[3];
+	dst[5] = src[2];
+	dst[6] = src[1];
+	dst[7] = src[0];
 	*((eiLong *)v) = result;
 }
 
@@ -651,7 +959,7 @@ void ei_byteswap_scalar(void *v)
 {
 	eiScalar result;
 	eiByte *dst = (eiByte *)&result;
-	eiByte *src = (eiByte *)&v;
+	eiByte *src = (eiByte *)v;
 	dst[0] = src[3];
 	dst[1] = src[2];
 	dst[2] = src[1];
@@ -663,15 +971,15 @@ void ei_byteswap_geoscalar(void *v)
 {
 	eiGeoScalar result;
 	eiByte *dst = (eiByte *)&result;
-	eiByte *src = (eiByte *)&v;
-	dst[0] = src[3];
-	dst[1] = src[2];
-	dst[2] = src[1];
-	dst[3] = src[0];
-	dst[4] = src[7];
-	dst[5] = src[6];
-	dst[6] = src[5];
-	dst[7] = src[4];
+	eiByte *src = (eiByte *)v;
+	dst[0] = src[7];
+	dst[1] = src[6];
+	dst[2] = src[5];
+	dst[3] = src[4];
+	dst[4] = src[3];
+	dst[5] = src[2];
+	dst[6] = src[1];
+	dst[7] = src[0];
 	*((eiGeoScalar *)v) = result;
 }
 
@@ -66,6 +66,18 @@ typedef enum eiFileMode {
 	EI_FILE_APPEND_UPDATE,
 } eiFileMode;
 
+/** \brief The policies of binding worker threads to processors. */
+enum {
+	/* let the operating system schedule threads freely */
+	EI_THREAD_AFFINITY_NONE = 0,
+	/* bind each thread to all processors of a NUMA node, 
+	   threads are distributed over nodes in round-robin */
+	EI_THREAD_AFFINITY_NODE,
+	/* bind each thread to a single processor, threads 
+	   are distributed over nodes in round-robin */
+	EI_THREAD_AFFINITY_CORE,
+};
+
 #if defined EI_OS_WINDOWS
 
 /* include socket header before windows.h to prevent from macro redefinitions */
@@ -169,6 +181,29 @@ eiCORE_API void ei_free_module(eiModuleHandle module);
  */
 eiCORE_API eiUint ei_get_number_threads();
 
+/** \brief Get the number of NUMA nodes, returns 1 on non-NUMA systems.
+ */
+eiCORE_API eiUint ei_get_number_numa_nodes();
+
+/** \brief Set the process-wide policy of binding worker threads.
+ */
+eiCORE_API void ei_set_thread_affinity(const eiInt policy);
+
+/** \brief Get the process-wide policy of binding worker threads.
+ */
+eiCORE_API eiInt ei_get_thread_affinity();
+
+/** \brief Bind the calling thread to processors by the policy.
+ * @param index The index of the worker thread on this host.
+ */
+eiCORE_API eiBool ei_bind_current_thread(const eiInt policy, const eiUint index);
+
+/** \brief Bind the calling worker thread by the process-wide policy, 
+ * should be called once when the thread starts, threads are indexed 
+ * in the order they call this.
+ */
+eiCORE_API eiBool ei_bind_worker_thread();
+
 /** \brief Get the handle of the current thread in which this function is invoked.
  */
 eiCORE_API eiThreadHandle ei_get_current_thread();
@@ -95,6 +95,149 @@ eiFORCEINLINE eiGeoScalar ei_sigma(eiInt bi, eiInt i)
 	return x;
 }
 
+/* the number of Sobol dimensions generated directly, higher 
+   dimensions reuse them with independent scrambling */
+#define QMC_SOBOL_DIM				2
+
+eiFORCEINLINE eiUint ei_reverse_bits(eiUint x)
+{
+	x = (x << 16) | (x >> 16);
+	x = ((x & 0x00ff00ff) << 8) | ((x & 0xff00ff00) >> 8);
+	x = ((x & 0x0f0f0f0f) << 4) | ((x & 0xf0f0f0f0) >> 4);
+	x = ((x & 0x33333333) << 2) | ((x & 0xcccccccc) >> 2);
+	x = ((x & 0x55555555) << 1) | ((x & 0xaaaaaaaa) >> 1);
+	return x;
+}
+
+/** \brief Hash an integer into well distributed bits. */
+eiFORCEINLINE eiUint ei_qmc_hash(eiUint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+eiFORCEINLINE eiUint ei_qmc_hash_combine(eiUint seed, eiUint v)
+{
+	return ei_qmc_hash(seed ^ ((v + 1) * 0x9e3779b9));
+}
+
+/** \brief The scrambling seed of a pixel, used to decorrelate 
+ * the sample patterns of neighboring pixels. */
+eiFORCEINLINE eiUint ei_qmc_pixel_seed(eiInt x, eiInt y)
+{
+	return ei_qmc_hash_combine(ei_qmc_hash((eiUint)x), (eiUint)y);
+}
+
+/** \brief The scrambling seed of a progressive pass, 0 for the 
+ * first pass. */
+eiFORCEINLINE eiUint ei_qmc_pass_seed(eiInt pass)
+{
+	return ei_qmc_hash((eiUint)pass);
+}
+
+/** \brief A Cranley-Patterson shift in [0, 1) of dimension dim 
+ * derived from seed. */
+eiFORCEINLINE eiGeoScalar ei_qmc_shift(eiUint seed, eiUint dim)
+{
+	return (eiGeoScalar)ei_qmc_hash_combine(seed, dim) * (1.0 / 4294967296.0);
+}
+
+/** \brief The Halton sequence rotated by the Cranley-Patterson 
+ * shifts of seed, blocks of b^m points starting at multiples of 
+ * b^m stay stratified. a seed of 0 gives the sequence itself. */
+eiFORCEINLINE eiGeoScalar ei_halton(eiUint dim, eiUint i, eiUint seed)
+{
+	eiGeoScalar	x;
+
+	/* the Halton sequence only has QMC_MAX_DIM bases */
+	x = ei_sigma(dim % QMC_MAX_DIM, i);
+
+	if (seed != 0)
+	{
+		x += ei_qmc_shift(seed, dim);
+
+		if (x >= 1.0)
+		{
+			x -= 1.0;
+		}
+	}
+
+	return x;
+}
+
+/** \brief Rotate the jitter of a sub-pixel from ei_sample_subpixel 
+ * by the shifts of seed, so that passes with different seeds sample 
+ * different positions in the sub-pixel. */
+eiFORCEINLINE void ei_shift_subpixel(eiGeoScalar *x, eiGeoScalar *y, eiUint seed)
+{
+	if (seed != 0)
+	{
+		/* use shifts of their own, beyond the dimensions of the sequence */
+		*x = fmod(*x + ei_qmc_shift(seed, QMC_MAX_DIM), 1.0);
+		*y = fmod(*y + ei_qmc_shift(seed, QMC_MAX_DIM + 1), 1.0);
+	}
+}
+
+/** \brief A random permutation of bit-reversed 32-bit fixed point 
+ * values, where each bit is flipped depending only on the lower 
+ * bits, which is Owen scrambling of the unreversed values. */
+eiFORCEINLINE eiUint ei_laine_karras_permutation(eiUint x, eiUint seed)
+{
+	x ^= x * 0x3d20adea;
+	x += seed;
+	x *= (seed >> 16) | 1;
+	x ^= x * 0x05526c56;
+	x ^= x * 0x53a22864;
+	return x;
+}
+
+eiFORCEINLINE eiUint ei_nested_uniform_scramble(eiUint x, eiUint seed)
+{
+	return ei_reverse_bits(ei_laine_karras_permutation(ei_reverse_bits(x), seed));
+}
+
+/** \brief The Sobol point of instance number i in bit-reversed 
+ * 32-bit fixed point, dim must be less than QMC_SOBOL_DIM. the 
+ * generator matrix of dimension 0 is the identity, the one of 
+ * dimension 1 is the Pascal matrix mod 2, which is applied to 
+ * the bits of i in five steps. */
+eiFORCEINLINE eiUint ei_sobol_reversed(eiUint dim, eiUint i)
+{
+	if (dim != 0) {
+		i ^= (i >> 1) & 0x55555555;
+		i ^= (i >> 2) & 0x33333333;
+		i ^= (i >> 4) & 0x0f0f0f0f;
+		i ^= (i >> 8) & 0x00ff00ff;
+		i ^= (i >> 16) & 0x0000ffff;
+	}
+	return i;
+}
+
+/** \brief The Owen-scrambled Sobol sequence. dim is the dimension, 
+ * i is the instance number, seed selects the scrambling. dimensions 
+ * are grouped by QMC_SOBOL_DIM, each group shuffles the instance 
+ * numbers by its own seed, so the number of dimensions is not limited. 
+ * every group forms a (0,k,2)-net over the first 2^k instances. */
+eiFORCEINLINE eiGeoScalar ei_sobol(eiUint dim, eiUint i, eiUint seed)
+{
+	eiUint	group_seed = ei_qmc_hash_combine(seed, dim / QMC_SOBOL_DIM);
+	eiUint	d = dim % QMC_SOBOL_DIM;
+	eiUint	x;
+
+	/* the scrambling works on reversed bits, so the reversal of 
+	   the Sobol point cancels out */
+	i = ei_nested_uniform_scramble(i, group_seed);
+	x = ei_laine_karras_permutation(ei_sobol_reversed(d, i), ei_qmc_hash(group_seed + d + 1));
+	x = ei_reverse_bits(x);
+
+	/* keep 24 bits so the value stays below 1 in single precision */
+	return (eiGeoScalar)(x >> 8) * (1.0 / 16777216.0);
+}
+
 #ifdef __cplusplus
 }
 #endif
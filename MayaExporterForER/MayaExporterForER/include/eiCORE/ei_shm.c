@@ -0,0 +1,565 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiCORE/ei_shm.h>
+#include <eiCORE/ei_platform.h>
+#include <eiCORE/ei_atomic_ops.h>
+#include <eiCORE/ei_verbose.h>
+#include <eiCORE/ei_assert.h>
+
+#ifdef EI_OS_LINUX
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+#define EI_SHM_CACHE_LINE			64
+#define EI_SHM_CHANNEL_MAGIC		0x6569434E
+#define EI_SHM_ARENA_MAGIC			0x65694152
+#define EI_SHM_ARENA_ALIGN			16
+/* the number of spins before yielding the processor */
+#define EI_SHM_SPIN_COUNT			1024
+/* the number of yields before sleeping */
+#define EI_SHM_YIELD_COUNT			64
+
+/** \brief A single-producer single-consumer ring buffer in shared
+ * memory, the data follows the header. head and tail are on separate
+ * cache lines to avoid false sharing between processes. */
+typedef struct eiShmRing {
+	/* the total bytes written, only modified by the producer */
+	volatile eiUint64	head;
+	eiByte				pad1[ EI_SHM_CACHE_LINE - sizeof(eiUint64) ];
+	/* the total bytes read, only modified by the consumer */
+	volatile eiUint64	tail;
+	eiByte				pad2[ EI_SHM_CACHE_LINE - sizeof(eiUint64) ];
+} eiShmRing;
+
+/** \brief The header of the shared memory of a channel. */
+typedef struct eiShmChannelHeader {
+	volatile eiUint		magic;
+	eiUint				ring_size;
+	/* set by either side on closing */
+	volatile eiInt		closed;
+	eiByte				pad[ EI_SHM_CACHE_LINE - sizeof(eiUint) * 3 ];
+} eiShmChannelHeader;
+
+struct eiShmChannel {
+	char				name[ EI_SHM_MAX_NAME_LEN ];
+	eiBool				owner;
+	eiByte				*base;
+	eiSizet				size;
+	eiShmChannelHeader	*header;
+	eiShmRing			*send_ring;
+	eiShmRing			*recv_ring;
+};
+
+/** \brief The header of the shared memory of a data arena. */
+typedef struct eiShmArenaHeader {
+	volatile eiUint		magic;
+	eiUint				pad0;
+	eiUint64			size;
+	eiByte				pad[ EI_SHM_CACHE_LINE - sizeof(eiUint) * 2 - sizeof(eiUint64) ];
+} eiShmArenaHeader;
+
+struct eiShmArena {
+	char				name[ EI_SHM_MAX_NAME_LEN ];
+	eiBool				owner;
+	eiByte				*base;
+	eiSizet				size;
+	/* the allocation state, only for the owner */
+	eiLock				lock;
+	eiSizet				used;
+};
+
+/** \brief Back off while waiting for the peer process. */
+static void ei_shm_backoff(eiUint *count)
+{
+	if (*count < EI_SHM_SPIN_COUNT)
+	{
+		ei_pause();
+	}
+	else if (*count < EI_SHM_SPIN_COUNT + EI_SHM_YIELD_COUNT)
+	{
+		sched_yield();
+	}
+	else
+	{
+		ei_sleep(1);
+	}
+
+	++ (*count);
+}
+
+static eiByte *ei_shm_map(
+	const char *name,
+	const eiBool create,
+	const eiBool writable,
+	eiSizet *size)
+{
+	eiInt		fd;
+	void		*base;
+	struct stat	st;
+
+	if (create)
+	{
+		/* remove the stale segment left by a crashed process */
+		shm_unlink(name);
+
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+		if (fd < 0 || ftruncate(fd, (off_t)*size) < 0)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+				shm_unlink(name);
+			}
+			ei_error("Failed to create shared memory %s.\n", name);
+			return NULL;
+		}
+	}
+	else
+	{
+		fd = shm_open(name, writable ? O_RDWR : O_RDONLY, 0600);
+
+		if (fd < 0 || fstat(fd, &st) < 0)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+			ei_error("Failed to open shared memory %s.\n", name);
+			return NULL;
+		}
+
+		*size = (eiSizet)st.st_size;
+	}
+
+	base = mmap(NULL, *size,
+		writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		MAP_SHARED, fd, 0);
+
+	/* the mapping stays valid after closing the descriptor */
+	close(fd);
+
+	if (base == MAP_FAILED)
+	{
+		if (create)
+		{
+			shm_unlink(name);
+		}
+		ei_error("Failed to map shared memory %s.\n", name);
+		return NULL;
+	}
+
+	return (eiByte *)base;
+}
+
+static void ei_shm_setup_channel(eiShmChannel *channel)
+{
+	eiShmRing	*ring0;
+	eiShmRing	*ring1;
+
+	channel->header = (eiShmChannelHeader *)channel->base;
+
+	ring0 = (eiShmRing *)(channel->base + sizeof(eiShmChannelHeader));
+	ring1 = (eiShmRing *)((eiByte *)(ring0 + 1) + channel->header->ring_size);
+
+	/* the creator sends on the first ring */
+	if (channel->owner)
+	{
+		channel->send_ring = ring0;
+		channel->recv_ring = ring1;
+	}
+	else
+	{
+		channel->send_ring = ring1;
+		channel->recv_ring = ring0;
+	}
+}
+
+eiShmChannel *ei_shm_create_channel(const char *name, const eiUint ring_size)
+{
+	eiShmChannel	*channel;
+	eiSizet			size;
+	eiShmRing		*ring;
+
+	size = sizeof(eiShmChannelHeader) + (sizeof(eiShmRing) + ring_size) * 2;
+
+	channel = (eiShmChannel *)ei_allocate(sizeof(eiShmChannel));
+	strncpy(channel->name, name, EI_SHM_MAX_NAME_LEN - 1);
+	channel->name[ EI_SHM_MAX_NAME_LEN - 1 ] = '\0';
+	channel->owner = eiTRUE;
+	channel->size = size;
+	channel->base = ei_shm_map(channel->name, eiTRUE, eiTRUE, &channel->size);
+
+	if (channel->base == NULL)
+	{
+		ei_free(channel);
+		return NULL;
+	}
+
+	channel->header = (eiShmChannelHeader *)channel->base;
+	channel->header->ring_size = ring_size;
+	channel->header->closed = eiFALSE;
+
+	ring = (eiShmRing *)(channel->base + sizeof(eiShmChannelHeader));
+	ring->head = 0;
+	ring->tail = 0;
+	ring = (eiShmRing *)((eiByte *)(ring + 1) + ring_size);
+	ring->head = 0;
+	ring->tail = 0;
+
+	ei_shm_setup_channel(channel);
+
+	/* publish the channel after it has been initialized */
+	ei_write_barrier();
+	channel->header->magic = EI_SHM_CHANNEL_MAGIC;
+
+	return channel;
+}
+
+eiShmChannel *ei_shm_open_channel(const char *name)
+{
+	eiShmChannel	*channel;
+
+	channel = (eiShmChannel *)ei_allocate(sizeof(eiShmChannel));
+	strncpy(channel->name, name, EI_SHM_MAX_NAME_LEN - 1);
+	channel->name[ EI_SHM_MAX_NAME_LEN - 1 ] = '\0';
+	channel->owner = eiFALSE;
+	channel->size = 0;
+	channel->base = ei_shm_map(channel->name, eiFALSE, eiTRUE, &channel->size);
+
+	if (channel->base == NULL)
+	{
+		ei_free(channel);
+		return NULL;
+	}
+
+	if (channel->size < sizeof(eiShmChannelHeader) ||
+		((eiShmChannelHeader *)channel->base)->magic != EI_SHM_CHANNEL_MAGIC ||
+		channel->size < sizeof(eiShmChannelHeader) +
+			(sizeof(eiShmRing) + ((eiShmChannelHeader *)channel->base)->ring_size) * 2)
+	{
+		ei_error("Invalid shared memory channel %s.\n", name);
+		munmap(channel->base, channel->size);
+		ei_free(channel);
+		return NULL;
+	}
+
+	ei_read_barrier();
+
+	ei_shm_setup_channel(channel);
+
+	return channel;
+}
+
+void ei_shm_close_channel(eiShmChannel *channel)
+{
+	if (channel == NULL)
+	{
+		return;
+	}
+
+	channel->header->closed = eiTRUE;
+	ei_write_barrier();
+
+	munmap(channel->base, channel->size);
+
+	if (channel->owner)
+	{
+		shm_unlink(channel->name);
+	}
+
+	ei_free(channel);
+}
+
+eiBool ei_shm_send(eiShmChannel *channel, const eiByte *data, const eiUint size)
+{
+	eiShmRing	*ring;
+	eiByte		*ring_data;
+	eiUint64	capacity;
+	eiUint		remaining;
+	eiUint		count;
+
+	ring = channel->send_ring;
+	ring_data = (eiByte *)(ring + 1);
+	capacity = channel->header->ring_size;
+	remaining = size;
+	count = 0;
+
+	while (remaining > 0)
+	{
+		eiUint64	head, tail, pos;
+		eiUint		n, first;
+
+		if (channel->header->closed)
+		{
+			return eiFALSE;
+		}
+
+		head = ring->head;
+		tail = ring->tail;
+		ei_read_barrier();
+
+		n = (eiUint)MIN((eiUint64)remaining, capacity - (head - tail));
+
+		if (n == 0)
+		{
+			ei_shm_backoff(&count);
+			continue;
+		}
+
+		/* copy with wrapping around */
+		pos = head % capacity;
+		first = (eiUint)MIN((eiUint64)n, capacity - pos);
+		memcpy(ring_data + pos, data, first);
+		memcpy(ring_data, data + first, n - first);
+
+		/* publish the data before advancing the head */
+		ei_write_barrier();
+		ring->head = head + n;
+
+		data += n;
+		remaining -= n;
+		count = 0;
+	}
+
+	return eiTRUE;
+}
+
+eiBool ei_shm_recv(eiShmChannel *channel, eiByte *data, const eiUint size)
+{
+	eiShmRing	*ring;
+	eiByte		*ring_data;
+	eiUint64	capacity;
+	eiUint		remaining;
+	eiUint		count;
+
+	ring = channel->recv_ring;
+	ring_data = (eiByte *)(ring + 1);
+	capacity = channel->header->ring_size;
+	remaining = size;
+	count = 0;
+
+	while (remaining > 0)
+	{
+		eiUint64	head, tail, pos;
+		eiUint		n, first;
+
+		head = ring->head;
+		tail = ring->tail;
+		ei_read_barrier();
+
+		n = (eiUint)MIN((eiUint64)remaining, head - tail);
+
+		if (n == 0)
+		{
+			if (channel->header->closed)
+			{
+				return eiFALSE;
+			}
+
+			ei_shm_backoff(&count);
+			continue;
+		}
+
+		pos = tail % capacity;
+		first = (eiUint)MIN((eiUint64)n, capacity - pos);
+		memcpy(data, ring_data + pos, first);
+		memcpy(data + first, ring_data, n - first);
+
+		/* finish reading before releasing the space */
+		ei_read_write_barrier();
+		ring->tail = tail + n;
+
+		data += n;
+		remaining -= n;
+		count = 0;
+	}
+
+	return eiTRUE;
+}
+
+eiShmArena *ei_shm_create_arena(const char *name, const eiUint64 size)
+{
+	eiShmArena		*arena;
+	eiShmArenaHeader	*header;
+
+	arena = (eiShmArena *)ei_allocate(sizeof(eiShmArena));
+	strncpy(arena->name, name, EI_SHM_MAX_NAME_LEN - 1);
+	arena->name[ EI_SHM_MAX_NAME_LEN - 1 ] = '\0';
+	arena->owner = eiTRUE;
+	arena->size = (eiSizet)(sizeof(eiShmArenaHeader) + size);
+	arena->base = ei_shm_map(arena->name, eiTRUE, eiTRUE, &arena->size);
+
+	if (arena->base == NULL)
+	{
+		ei_free(arena);
+		return NULL;
+	}
+
+	ei_create_lock(&arena->lock);
+	arena->used = 0;
+
+	header = (eiShmArenaHeader *)arena->base;
+	header->size = size;
+	ei_write_barrier();
+	header->magic = EI_SHM_ARENA_MAGIC;
+
+	return arena;
+}
+
+eiShmArena *ei_shm_open_arena(const char *name)
+{
+	eiShmArena		*arena;
+
+	arena = (eiShmArena *)ei_allocate(sizeof(eiShmArena));
+	strncpy(arena->name, name, EI_SHM_MAX_NAME_LEN - 1);
+	arena->name[ EI_SHM_MAX_NAME_LEN - 1 ] = '\0';
+	arena->owner = eiFALSE;
+	arena->size = 0;
+	arena->used = 0;
+	/* read-only mapping, the data can only be modified by the owner */
+	arena->base = ei_shm_map(arena->name, eiFALSE, eiFALSE, &arena->size);
+
+	if (arena->base == NULL)
+	{
+		ei_free(arena);
+		return NULL;
+	}
+
+	if (arena->size < sizeof(eiShmArenaHeader) ||
+		((eiShmArenaHeader *)arena->base)->magic != EI_SHM_ARENA_MAGIC)
+	{
+		ei_error("Invalid shared memory arena %s.\n", name);
+		munmap(arena->base, arena->size);
+		ei_free(arena);
+		return NULL;
+	}
+
+	return arena;
+}
+
+void ei_shm_close_arena(eiShmArena *arena)
+{
+	if (arena == NULL)
+	{
+		return;
+	}
+
+	munmap(arena->base, arena->size);
+
+	if (arena->owner)
+	{
+		ei_delete_lock(&arena->lock);
+		shm_unlink(arena->name);
+	}
+
+	ei_free(arena);
+}
+
+eiSizet ei_shm_arena_alloc(eiShmArena *arena, const eiSizet size)
+{
+	eiSizet		offset;
+
+	eiDBG_ASSERT(arena->owner);
+
+	ei_lock(&arena->lock);
+
+	offset = (arena->used + (EI_SHM_ARENA_ALIGN - 1)) & ~((eiSizet)EI_SHM_ARENA_ALIGN - 1);
+
+	if (offset + size > arena->size - sizeof(eiShmArenaHeader))
+	{
+		ei_unlock(&arena->lock);
+		return eiMAX_SIZET;
+	}
+
+	arena->used = offset + size;
+
+	ei_unlock(&arena->lock);
+
+	return offset;
+}
+
+void *ei_shm_arena_ptr(eiShmArena *arena, const eiSizet offset)
+{
+	return arena->base + sizeof(eiShmArenaHeader) + offset;
+}
+
+eiSizet ei_shm_arena_size(eiShmArena *arena)
+{
+	return arena->size - sizeof(eiShmArenaHeader);
+}
+
+#else
+
+eiShmChannel *ei_shm_create_channel(const char *name, const eiUint ring_size)
+{
+	/* not supported yet, use sockets */
+	return NULL;
+}
+
+eiShmChannel *ei_shm_open_channel(const char *name)
+{
+	return NULL;
+}
+
+void ei_shm_close_channel(eiShmChannel *channel)
+{
+}
+
+eiBool ei_shm_send(eiShmChannel *channel, const eiByte *data, const eiUint size)
+{
+	return eiFALSE;
+}
+
+eiBool ei_shm_recv(eiShmChannel *channel, eiByte *data, const eiUint size)
+{
+	return eiFALSE;
+}
+
+eiShmArena *ei_shm_create_arena(const char *name, const eiUint64 size)
+{
+	return NULL;
+}
+
+eiShmArena *ei_shm_open_arena(const char *name)
+{
+	return NULL;
+}
+
+void ei_shm_close_arena(eiShmArena *arena)
+{
+}
+
+eiSizet ei_shm_arena_alloc(eiShmArena *arena, const eiSizet size)
+{
+	return eiMAX_SIZET;
+}
+
+void *ei_shm_arena_ptr(eiShmArena *arena, const eiSizet offset)
+{
+	return NULL;
+}
+
+eiSizet ei_shm_arena_size(eiShmArena *arena)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_SHM_H
+#define EI_SHM_H
+
+/** \brief Shared memory transport between processes on the same host,
+ * a message channel made of two ring buffers, and a data arena for
+ * large read-only data which can be mapped by multiple processes
+ * instead of being copied. currently implemented with POSIX shared
+ * memory, creating or opening returns NULL on other platforms, and
+ * callers should fall back to sockets.
+ * \file ei_shm.h
+ */
+
+#include <eiCORE/ei_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the maximum length of shared memory names */
+#define EI_SHM_MAX_NAME_LEN			64
+/* the default capacity of each ring buffer of a channel */
+#define EI_SHM_DEFAULT_RING_SIZE	(4 * 1024 * 1024)
+
+typedef struct eiShmChannel		eiShmChannel;
+typedef struct eiShmArena		eiShmArena;
+
+/** \brief Create a message channel, called by the rendering manager.
+ */
+eiCORE_API eiShmChannel *ei_shm_create_channel(const char *name, const eiUint ring_size);
+/** \brief Open a message channel created by another process, called
+ * by the rendering server.
+ */
+eiCORE_API eiShmChannel *ei_shm_open_channel(const char *name);
+/** \brief Close the channel, the peer will fail on waiting for data,
+ * the shared memory is unlinked by the creator.
+ */
+eiCORE_API void ei_shm_close_channel(eiShmChannel *channel);
+/** \brief Send data through the channel, blocks while the ring buffer
+ * is full, returns false if the peer has closed the channel.
+ */
+eiCORE_API eiBool ei_shm_send(eiShmChannel *channel, const eiByte *data, const eiUint size);
+/** \brief Receive data from the channel, blocks until all data has
+ * been received, returns false if the peer has closed the channel.
+ */
+eiCORE_API eiBool ei_shm_recv(eiShmChannel *channel, eiByte *data, const eiUint size);
+
+/** \brief Create a data arena of a fixed size, called by the
+ * rendering manager, which is the only process allocating from it.
+ */
+eiCORE_API eiShmArena *ei_shm_create_arena(const char *name, const eiUint64 size);
+/** \brief Map a data arena created by another process as read-only.
+ */
+eiCORE_API eiShmArena *ei_shm_open_arena(const char *name);
+/** \brief Unmap the data arena, the shared memory is unlinked by
+ * the creator.
+ */
+eiCORE_API void ei_shm_close_arena(eiShmArena *arena);
+/** \brief Allocate a block from the arena, returns its offset which
+ * can be sent to other processes, or eiMAX_SIZET if the arena is full.
+ */
+eiCORE_API eiSizet ei_shm_arena_alloc(eiShmArena *arena, const eiSizet size);
+/** \brief Get the local address of a block by its offset.
+ */
+eiCORE_API void *ei_shm_arena_ptr(eiShmArena *arena, const eiSizet offset);
+/** \brief Get the size of the arena available for blocks, which 
+ * bounds the offsets received from other processes.
+ */
+eiCORE_API eiSizet ei_shm_arena_size(eiShmArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EI_SIMD_H
+#define EI_SIMD_H
+
+/** \brief Portable SIMD vectors of floats for structure-of-arrays
+ * kernels. the width is 8 with AVX2, 4 with SSE2, and 1 otherwise,
+ * so kernels written with these operations loop over their data
+ * with a step of EI_VF_WIDTH. a few operations on vectors of 
+ * integers of the same width are provided for hashing and bit 
+ * tests, their comparisons return float masks.
+ * \file ei_simd.h
+ */
+
+#include <eiCORE/ei_types.h>
+#include <eiCORE/ei_util.h>
+
+#if defined(__AVX2__)
+	#define EI_SIMD_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define EI_SIMD_SSE2
+	#include <emmintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(EI_SIMD_AVX2)
+
+#define EI_VF_WIDTH		8
+
+typedef __m256		eiVf;
+
+eiFORCEINLINE eiVf ei_vf_set1(const eiScalar a) { return _mm256_set1_ps(a); }
+eiFORCEINLINE eiVf ei_vf_load(const eiScalar *p) { return _mm256_loadu_ps(p); }
+eiFORCEINLINE void ei_vf_store(eiScalar *p, const eiVf a) { _mm256_storeu_ps(p, a); }
+eiFORCEINLINE eiVf ei_vf_add(const eiVf a, const eiVf b) { return _mm256_add_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_sub(const eiVf a, const eiVf b) { return _mm256_sub_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_mul(const eiVf a, const eiVf b) { return _mm256_mul_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_div(const eiVf a, const eiVf b) { return _mm256_div_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_min(const eiVf a, const eiVf b) { return _mm256_min_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_max(const eiVf a, const eiVf b) { return _mm256_max_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_sqrt(const eiVf a) { return _mm256_sqrt_ps(a); }
+eiFORCEINLINE eiVf ei_vf_floor(const eiVf a) { return _mm256_floor_ps(a); }
+eiFORCEINLINE eiVf ei_vf_abs(const eiVf a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+/* comparisons return masks of all bits set for true lanes */
+eiFORCEINLINE eiVf ei_vf_lt(const eiVf a, const eiVf b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+eiFORCEINLINE eiVf ei_vf_gt(const eiVf a, const eiVf b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+eiFORCEINLINE eiVf ei_vf_ge(const eiVf a, const eiVf b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+eiFORCEINLINE eiVf ei_vf_and(const eiVf a, const eiVf b) { return _mm256_and_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_or(const eiVf a, const eiVf b) { return _mm256_or_ps(a, b); }
+/* returns a for true lanes of mask, b otherwise */
+eiFORCEINLINE eiVf ei_vf_select(const eiVf mask, const eiVf a, const eiVf b) { return _mm256_blendv_ps(b, a, mask); }
+eiFORCEINLINE eiInt ei_vf_movemask(const eiVf mask) { return _mm256_movemask_ps(mask); }
+
+typedef __m256i		eiVi;
+
+eiFORCEINLINE eiVi ei_vi_set1(const eiInt a) { return _mm256_set1_epi32(a); }
+eiFORCEINLINE eiVi ei_vi_load(const eiInt *p) { return _mm256_loadu_si256((const __m256i *)p); }
+eiFORCEINLINE eiVi ei_vi_and(const eiVi a, const eiVi b) { return _mm256_and_si256(a, b); }
+eiFORCEINLINE eiVf ei_vi_eq(const eiVi a, const eiVi b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+eiFORCEINLINE eiVf ei_vi_lt(const eiVi a, const eiVi b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)); }
+eiFORCEINLINE eiVf ei_vi_to_vf(const eiVi a) { return _mm256_cvtepi32_ps(a); }
+/* truncate towards zero and store as integers */
+eiFORCEINLINE void ei_vf_store_int(eiInt *p, const eiVf a) { _mm256_storeu_si256((__m256i *)p, _mm256_cvttps_epi32(a)); }
+
+/* split a positive float into exponent and mantissa in [1, 2) */
+eiFORCEINLINE eiVf ei_vf_frexp(const eiVf a, eiVf *e)
+{
+	__m256i		bits;
+
+	bits = _mm256_castps_si256(a);
+	*e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+
+	return _mm256_castsi256_ps(_mm256_or_si256(
+		_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+		_mm256_set1_epi32(0x3F800000)));
+}
+
+/* returns 2 to the power of an integral float */
+eiFORCEINLINE eiVf ei_vf_ldexp1(const eiVf n)
+{
+	return _mm256_castsi256_ps(_mm256_slli_epi32(
+		_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+}
+
+#elif defined(EI_SIMD_SSE2)
+
+#define EI_VF_WIDTH		4
+
+typedef __m128		eiVf;
+
+eiFORCEINLINE eiVf ei_vf_set1(const eiScalar a) { return _mm_set1_ps(a); }
+eiFORCEINLINE eiVf ei_vf_load(const eiScalar *p) { return _mm_loadu_ps(p); }
+eiFORCEINLINE void ei_vf_store(eiScalar *p, const eiVf a) { _mm_storeu_ps(p, a); }
+eiFORCEINLINE eiVf ei_vf_add(const eiVf a, const eiVf b) { return _mm_add_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_sub(const eiVf a, const eiVf b) { return _mm_sub_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_mul(const eiVf a, const eiVf b) { return _mm_mul_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_div(const eiVf a, const eiVf b) { return _mm_div_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_min(const eiVf a, const eiVf b) { return _mm_min_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_max(const eiVf a, const eiVf b) { return _mm_max_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_sqrt(const eiVf a) { return _mm_sqrt_ps(a); }
+eiFORCEINLINE eiVf ei_vf_abs(const eiVf a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+eiFORCEINLINE eiVf ei_vf_lt(const eiVf a, const eiVf b) { return _mm_cmplt_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_gt(const eiVf a, const eiVf b) { return _mm_cmpgt_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_ge(const eiVf a, const eiVf b) { return _mm_cmpge_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_and(const eiVf a, const eiVf b) { return _mm_and_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_or(const eiVf a, const eiVf b) { return _mm_or_ps(a, b); }
+eiFORCEINLINE eiVf ei_vf_select(const eiVf mask, const eiVf a, const eiVf b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+eiFORCEINLINE eiInt ei_vf_movemask(const eiVf mask) { return _mm_movemask_ps(mask); }
+
+typedef __m128i		eiVi;
+
+eiFORCEINLINE eiVi ei_vi_set1(const eiInt a) { return _mm_set1_epi32(a); }
+eiFORCEINLINE eiVi ei_vi_load(const eiInt *p) { return _mm_loadu_si128((const __m128i *)p); }
+eiFORCEINLINE eiVi ei_vi_and(const eiVi a, const eiVi b) { return _mm_and_si128(a, b); }
+eiFORCEINLINE eiVf ei_vi_eq(const eiVi a, const eiVi b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+eiFORCEINLINE eiVf ei_vi_lt(const eiVi a, const eiVi b) { return _mm_castsi128_ps(_mm_cmplt_epi32(a, b)); }
+eiFORCEINLINE eiVf ei_vi_to_vf(const eiVi a) { return _mm_cvtepi32_ps(a); }
+eiFORCEINLINE void ei_vf_store_int(eiInt *p, const eiVf a) { _mm_storeu_si128((__m128i *)p, _mm_cvttps_epi32(a)); }
+
+eiFORCEINLINE eiVf ei_vf_floor(const eiVf a)
+{
+	eiVf	t;
+
+	/* truncate, then subtract one where truncation rounded up,
+	   only valid for magnitudes below 2^31 */
+	t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+
+eiFORCEINLINE eiVf ei_vf_frexp(const eiVf a, eiVf *e)
+{
+	__m128i		bits;
+
+	bits = _mm_castps_si128(a);
+	*e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+
+	return _mm_castsi128_ps(_mm_or_si128(
+		_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+		_mm_set1_epi32(0x3F800000)));
+}
+
+eiFORCEINLINE eiVf ei_vf_ldexp1(const eiVf n)
+{
+	return _mm_castsi128_ps(_mm_slli_epi32(
+		_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+}
+
+#else
+
+#define EI_VF_WIDTH		1
+
+typedef eiScalar	eiVf;
+
+eiFORCEINLINE eiVf ei_vf_set1(const eiScalar a) { return a; }
+eiFORCEINLINE eiVf ei_vf_load(const eiScalar *p) { return *p; }
+eiFORCEINLINE void ei_vf_store(eiScalar *p, const eiVf a) { *p = a; }
+eiFORCEINLINE eiVf ei_vf_add(const eiVf a, const eiVf b) { return a + b; }
+eiFORCEINLINE eiVf ei_vf_sub(const eiVf a, const eiVf b) { return a - b; }
+eiFORCEINLINE eiVf ei_vf_mul(const eiVf a, const eiVf b) { return a * b; }
+eiFORCEINLINE eiVf ei_vf_div(const eiVf a, const eiVf b) { return a / b; }
+eiFORCEINLINE eiVf ei_vf_min(const eiVf a, const eiVf b) { return (a < b) ? a : b; }
+eiFORCEINLINE eiVf ei_vf_max(const eiVf a, const eiVf b) { return (a > b) ? a : b; }
+eiFORCEINLINE eiVf ei_vf_sqrt(const eiVf a) { return sqrtf(a); }
+eiFORCEINLINE eiVf ei_vf_floor(const eiVf a) { return floorf(a); }
+eiFORCEINLINE eiVf ei_vf_abs(const eiVf a) { return fabsf(a); }
+/* masks are 1 for true and 0 for false in scalar mode */
+eiFORCEINLINE eiVf ei_vf_lt(const eiVf a, const eiVf b) { return (a < b) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vf_gt(const eiVf a, const eiVf b) { return (a > b) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vf_ge(const eiVf a, const eiVf b) { return (a >= b) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vf_and(const eiVf a, const eiVf b) { return (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vf_or(const eiVf a, const eiVf b) { return (a != 0.0f || b != 0.0f) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vf_select(const eiVf mask, const eiVf a, const eiVf b) { return (mask != 0.0f) ? a : b; }
+eiFORCEINLINE eiInt ei_vf_movemask(const eiVf mask) { return (mask != 0.0f) ? 1 : 0; }
+
+typedef eiInt		eiVi;
+
+eiFORCEINLINE eiVi ei_vi_set1(const eiInt a) { return a; }
+eiFORCEINLINE eiVi ei_vi_load(const eiInt *p) { return *p; }
+eiFORCEINLINE eiVi ei_vi_and(const eiVi a, const eiVi b) { return a & b; }
+eiFORCEINLINE eiVf ei_vi_eq(const eiVi a, const eiVi b) { return (a == b) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vi_lt(const eiVi a, const eiVi b) { return (a < b) ? 1.0f : 0.0f; }
+eiFORCEINLINE eiVf ei_vi_to_vf(const eiVi a) { return (eiScalar)a; }
+eiFORCEINLINE void ei_vf_store_int(eiInt *p, const eiVf a) { *p = (eiInt)a; }
+
+eiFORCEINLINE eiVf ei_vf_frexp(const eiVf a, eiVf *e)
+{
+	eiInt	n;
+	eiVf	m;
+
+	m = frexpf(a, &n);
+	*e = (eiScalar)(n - 1);
+
+	return m * 2.0f;
+}
+
+eiFORCEINLINE eiVf ei_vf_ldexp1(const eiVf n)
+{
+	return ldexpf(1.0f, (eiInt)n);
+}
+
+#endif
+
+/** \brief Base-2 logarithm of positive values, the relative error
+ * is below 1e-6. */
+eiFORCEINLINE eiVf ei_vf_log2(const eiVf a)
+{
+	eiVf	e, m, big, t, t2, p;
+
+	m = ei_vf_frexp(a, &e);
+
+	/* center the mantissa around 1 to [sqrt(0.5), sqrt(2)) */
+	big = ei_vf_gt(m, ei_vf_set1(1.41421356f));
+	m = ei_vf_select(big, ei_vf_mul(m, ei_vf_set1(0.5f)), m);
+	e = ei_vf_select(big, ei_vf_add(e, ei_vf_set1(1.0f)), e);
+
+	/* log2(m) = 2 / ln(2) * atanh((m - 1) / (m + 1)) */
+	t = ei_vf_div(ei_vf_sub(m, ei_vf_set1(1.0f)), ei_vf_add(m, ei_vf_set1(1.0f)));
+	t2 = ei_vf_mul(t, t);
+	p = ei_vf_add(ei_vf_set1(1.0f / 7.0f), ei_vf_mul(t2, ei_vf_set1(1.0f / 9.0f)));
+	p = ei_vf_add(ei_vf_set1(1.0f / 5.0f), ei_vf_mul(t2, p));
+	p = ei_vf_add(ei_vf_set1(1.0f / 3.0f), ei_vf_mul(t2, p));
+	p = ei_vf_add(ei_vf_set1(1.0f), ei_vf_mul(t2, p));
+
+	return ei_vf_add(e, ei_vf_mul(ei_vf_mul(t, p), ei_vf_set1(2.88539008f)));
+}
+
+/** \brief Base-2 exponential, the relative error is below 2e-6,
+ * the input is clamped to the range of normalized floats. */
+eiFORCEINLINE eiVf ei_vf_exp2(eiVf a)
+{
+	eiVf	n, f, p;
+
+	a = ei_vf_min(ei_vf_max(a, ei_vf_set1(-126.0f)), ei_vf_set1(127.0f));
+	n = ei_vf_floor(a);
+	f = ei_vf_sub(a, n);
+
+	/* the Taylor series of 2^f on [0, 1) */
+	p = ei_vf_set1(1.5252734e-5f);
+	p = ei_vf_add(ei_vf_set1(1.5403530e-4f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(1.3333558e-3f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(9.6181291e-3f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(5.5504109e-2f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(0.24022651f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(0.69314718f), ei_vf_mul(f, p));
+	p = ei_vf_add(ei_vf_set1(1.0f), ei_vf_mul(f, p));
+
+	return ei_vf_mul(p, ei_vf_ldexp1(n));
+}
+
+/** \brief Power function for positive bases, returns 1 for zero
+ * exponents as powf, and 0 for non-positive bases otherwise. */
+eiFORCEINLINE eiVf ei_vf_pow(const eiVf a, const eiVf b)
+{
+	eiVf	r, zero_b;
+
+	r = ei_vf_exp2(ei_vf_mul(b, ei_vf_log2(ei_vf_max(a, ei_vf_set1(1.0e-30f)))));
+	zero_b = ei_vf_select(ei_vf_gt(ei_vf_abs(b), ei_vf_set1(0.0f)), ei_vf_set1(0.0f), ei_vf_set1(1.0f));
+
+	return ei_vf_select(ei_vf_gt(a, ei_vf_set1(0.0f)), r, zero_b);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,266 @@
 
 #include <eiCORE/ei_symbol.h>
 #include <eiCORE/ei_assert.h>
+#include <string.h>
+
+/* the initial number of entries of the global string pool */
+#define EI_STRING_POOL_INIT_SIZE	4096
+/* the minimum number of entries of symbol tables */
+#define EI_SYMBOL_TABLE_MIN_SIZE	8
+
+/** \brief The global pool of interned strings, each string is 
+ * stored after its reference count, its hash value and its length. */
+typedef struct eiStringPool {
+	eiLock			lock;
+	const char		**entries;
+	/* the number of entries, always a power of 2 */
+	eiUint			capacity;
+	eiUint			size;
+	eiInt			ref_count;
+} eiStringPool;
+
+static eiStringPool		g_StringPool;
+
+/* the marker for deleted entries of symbol tables, never 
+   returned by the string pool */
+static const char		g_DeletedSymbol[] = "";
+
+eiUint ei_string_hash(const char *str)
+{
+	eiUint	hash;
+
+	/* FNV-1a */
+	hash = 2166136261U;
+
+	while (*str != '\0')
+	{
+		hash ^= (eiUint)(unsigned char)(*str);
+		hash *= 16777619U;
+		++ str;
+	}
+
+	return hash;
+}
+
+void ei_string_pool_init()
+{
+	if ((g_StringPool.ref_count ++) > 0)
+	{
+		return;
+	}
+
+	ei_create_lock(&g_StringPool.lock);
+	g_StringPool.capacity = EI_STRING_POOL_INIT_SIZE;
+	g_StringPool.size = 0;
+	g_StringPool.entries = (const char **)ei_allocate(sizeof(const char *) * g_StringPool.capacity);
+	memset(g_StringPool.entries, 0, sizeof(const char *) * g_StringPool.capacity);
+}
+
+eiUint ei_string_pool_size()
+{
+	eiUint	size;
+
+	ei_lock(&g_StringPool.lock);
+	size = g_StringPool.size;
+	ei_unlock(&g_StringPool.lock);
+
+	return size;
+}
+
+/** \brief Get the header in front of an interned string. */
+static eiFORCEINLINE eiUint *ei_interned_string_header(const char *str)
+{
+	return ((eiUint *)str) - 3;
+}
+
+void ei_string_pool_exit()
+{
+	eiUint	i;
+
+	eiDBG_ASSERT(g_StringPool.ref_count > 0);
+
+	if ((-- g_StringPool.ref_count) > 0)
+	{
+		return;
+	}
+
+	/* free the strings which are still referenced */
+	for (i = 0; i < g_StringPool.capacity; ++i)
+	{
+		if (g_StringPool.entries[i] != NULL)
+		{
+			ei_free(ei_interned_string_header(g_StringPool.entries[i]));
+		}
+	}
+
+	eiCHECK_FREE(g_StringPool.entries);
+	g_StringPool.capacity = 0;
+	g_StringPool.size = 0;
+	ei_delete_lock(&g_StringPool.lock);
+}
+
+/** \brief Double the number of entries of the global string pool. */
+static void ei_string_pool_grow()
+{
+	const char	**entries;
+	eiUint		capacity;
+	eiUint		mask;
+	eiUint		i;
+
+	capacity = g_StringPool.capacity * 2;
+	mask = capacity - 1;
+	entries = (const char **)ei_allocate(sizeof(const char *) * capacity);
+	memset(entries, 0, sizeof(const char *) * capacity);
+
+	for (i = 0; i < g_StringPool.capacity; ++i)
+	{
+		const char	*str;
+		eiUint		j;
+
+		str = g_StringPool.entries[i];
+
+		if (str == NULL)
+		{
+			continue;
+		}
+
+		j = ei_interned_string_hash(str) & mask;
+
+		while (entries[j] != NULL)
+		{
+			j = (j + 1) & mask;
+		}
+
+		entries[j] = str;
+	}
+
+	eiCHECK_FREE(g_StringPool.entries);
+	g_StringPool.entries = entries;
+	g_StringPool.capacity = capacity;
+}
+
+const char *ei_intern_string(const char *str)
+{
+	const char	*ustr;
+	eiUint		hash;
+	eiUint		length;
+	eiUint		mask;
+	eiUint		i;
+
+	eiDBG_ASSERT(g_StringPool.ref_count > 0);
+
+	hash = ei_string_hash(str);
+
+	ei_lock(&g_StringPool.lock);
+
+	mask = g_StringPool.capacity - 1;
+	i = hash & mask;
+
+	while ((ustr = g_StringPool.entries[i]) != NULL)
+	{
+		if (ei_interned_string_hash(ustr) == hash && strcmp(ustr, str) == 0)
+		{
+			++ ei_interned_string_header(ustr)[0];
+			ei_unlock(&g_StringPool.lock);
+			return ustr;
+		}
+
+		i = (i + 1) & mask;
+	}
+
+	/* not found, store a new string at the empty entry */
+	{
+		eiUint	*header;
+
+		length = (eiUint)strlen(str);
+		header = (eiUint *)ei_allocate(sizeof(eiUint) * 3 + length + 1);
+		header[0] = 1;
+		header[1] = hash;
+		header[2] = length;
+		ustr = (const char *)(header + 3);
+		memcpy((char *)ustr, str, length + 1);
+	}
+
+	g_StringPool.entries[i] = ustr;
+	++ g_StringPool.size;
+
+	/* keep the load factor below 1/2 */
+	if (g_StringPool.size * 2 > g_StringPool.capacity)
+	{
+		ei_string_pool_grow();
+	}
+
+	ei_unlock(&g_StringPool.lock);
+
+	return ustr;
+}
+
+void ei_release_string(const char *str)
+{
+	eiUint	*header;
+	eiUint	mask;
+	eiUint	i, j;
+
+	eiDBG_ASSERT(g_StringPool.ref_count > 0);
+
+	header = ei_interned_string_header(str);
+
+	ei_lock(&g_StringPool.lock);
+
+	eiDBG_ASSERT(header[0] > 0);
+
+	if ((-- header[0]) > 0)
+	{
+		ei_unlock(&g_StringPool.lock);
+		return;
+	}
+
+	mask = g_StringPool.capacity - 1;
+	i = ei_interned_string_hash(str) & mask;
+
+	while (g_StringPool.entries[i] != str)
+	{
+		eiDBG_ASSERT(g_StringPool.entries[i] != NULL);
+		i = (i + 1) & mask;
+	}
+
+	/* shift the following strings back into the hole, so that 
+	   the probing sequences stay unbroken without tombstones */
+	j = i;
+
+	for (;;)
+	{
+		const char	*next;
+		eiUint		k;
+
+		j = (j + 1) & mask;
+		next = g_StringPool.entries[j];
+
+		if (next == NULL)
+		{
+			break;
+		}
+
+		/* the ideal entry of the next string, it stays if the 
+		   entry lies cyclically in (i, j] */
+		k = ei_interned_string_hash(next) & mask;
+
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+		{
+			continue;
+		}
+
+		g_StringPool.entries[i] = next;
+		i = j;
+	}
+
+	g_StringPool.entries[i] = NULL;
+	-- g_StringPool.size;
+
+	ei_unlock(&g_StringPool.lock);
+
+	ei_free(header);
+}
 
 typedef struct eiStringNode {
 	ei_btree_node	node;
@@ -225,60 +485,241 @@ void ei_symbol_map_erase(eiSymbolMap *map, const char *name)
 	}
 }
 
+/** \brief Get the number of entries to hold a number of symbols 
+ * with a load factor below 3/4. */
+static eiUint ei_symbol_table_capacity(const eiUint count)
+{
+	eiUint	capacity;
+
+	capacity = EI_SYMBOL_TABLE_MIN_SIZE;
+
+	while (capacity * 3 < count * 4)
+	{
+		capacity *= 2;
+	}
+
+	return capacity;
+}
+
+/** \brief Re-insert all symbols into a number of entries, 
+ * entries marked as deleted are dropped. */
+static void ei_symbol_table_rehash(eiSymbolTable *tab, const eiUint capacity)
+{
+	eiSymbolEntry	*entries;
+	eiUint			mask;
+	eiUint			i;
+
+	mask = capacity - 1;
+	entries = (eiSymbolEntry *)ei_allocate(sizeof(eiSymbolEntry) * capacity);
+	memset(entries, 0, sizeof(eiSymbolEntry) * capacity);
+
+	for (i = 0; i < tab->capacity; ++i)
+	{
+		const char	*name;
+		eiUint		j;
+
+		name = tab->entries[i].name;
+
+		if (name == NULL || name == g_DeletedSymbol)
+		{
+			continue;
+		}
+
+		j = ei_interned_string_hash(name) & mask;
+
+		while (entries[j].name != NULL)
+		{
+			j = (j + 1) & mask;
+		}
+
+		entries[j] = tab->entries[i];
+	}
+
+	eiCHECK_FREE(tab->entries);
+	tab->entries = entries;
+	tab->capacity = capacity;
+	tab->num_deleted = 0;
+}
+
+/** \brief Find the entry of a symbol, returns NULL if not found. */
+static eiSymbolEntry *ei_symbol_table_lookup(
+	eiSymbolTable *tab, 
+	const char *name, 
+	const eiUint hash, 
+	const eiBool interned)
+{
+	eiUint	mask;
+	eiUint	i;
+
+	if (tab->capacity == 0)
+	{
+		return NULL;
+	}
+
+	mask = tab->capacity - 1;
+	i = hash & mask;
+
+	for (;;)
+	{
+		eiSymbolEntry	*entry;
+
+		entry = &tab->entries[i];
+
+		if (entry->name == NULL)
+		{
+			return NULL;
+		}
+
+		if (entry->name == name)
+		{
+			return entry;
+		}
+
+		if (!interned && 
+			entry->name != g_DeletedSymbol && 
+			ei_interned_string_hash(entry->name) == hash && 
+			strcmp(entry->name, name) == 0)
+		{
+			return entry;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
 void ei_symbol_table_init(eiSymbolTable *tab, void * const null)
 {
-	ei_string_table_init(&tab->string_table);
-	ei_symbol_map_init(&tab->symbol_map, null);
+	tab->entries = NULL;
+	tab->capacity = 0;
+	tab->size = 0;
+	tab->num_deleted = 0;
+	tab->null = null;
 }
 
 void ei_symbol_table_exit(eiSymbolTable *tab)
 {
-	ei_symbol_map_exit(&tab->symbol_map);
-	ei_string_table_exit(&tab->string_table);
+	eiUint	i;
+
+	/* release the references to interned names */
+	for (i = 0; i < tab->capacity; ++i)
+	{
+		const char	*name;
+
+		name = tab->entries[i].name;
+
+		if (name != NULL && name != g_DeletedSymbol)
+		{
+			ei_release_string(name);
+		}
+	}
+
+	eiCHECK_FREE(tab->entries);
+	tab->capacity = 0;
+	tab->size = 0;
+	tab->num_deleted = 0;
+}
+
+void ei_symbol_table_reserve(eiSymbolTable *tab, const eiUint count)
+{
+	eiUint	capacity;
+
+	capacity = ei_symbol_table_capacity(count);
+
+	if (capacity > tab->capacity)
+	{
+		ei_symbol_table_rehash(tab, capacity);
+	}
 }
 
 void ei_symbol_table_add(eiSymbolTable *tab, const char *name, void * const data)
 {
-	const char	*unique_name;
+	const char		*unique_name;
+	eiSymbolEntry	*entry;
+	eiUint			hash;
+	eiUint			mask;
+	eiUint			i;
 
 	/* convert to unique string */
-	unique_name = ei_string_table_convert(&tab->string_table, name);
+	unique_name = ei_intern_string(name);
+	hash = ei_interned_string_hash(unique_name);
+
+	/* keep the existing data if the symbol has been added */
+	if (ei_symbol_table_lookup(tab, unique_name, hash, eiTRUE) != NULL)
+	{
+		ei_release_string(unique_name);
+		return;
+	}
 
-	/* add to symbol map */
-	ei_symbol_map_insert(&tab->symbol_map, unique_name, data);
+	if ((tab->size + tab->num_deleted + 1) * 4 > tab->capacity * 3)
+	{
+		ei_symbol_table_rehash(tab, ei_symbol_table_capacity((tab->size + 1) * 2));
+	}
+
+	mask = tab->capacity - 1;
+	i = hash & mask;
+
+	/* reuse the first deleted or empty entry */
+	while (tab->entries[i].name != NULL && tab->entries[i].name != g_DeletedSymbol)
+	{
+		i = (i + 1) & mask;
+	}
+
+	entry = &tab->entries[i];
+
+	if (entry->name == g_DeletedSymbol)
+	{
+		-- tab->num_deleted;
+	}
+
+	entry->name = unique_name;
+	entry->data = data;
+	++ tab->size;
 }
 
 void *ei_symbol_table_find(eiSymbolTable *tab, const char *name)
 {
-	const char	*unique_name;
+	eiSymbolEntry	*entry;
+
+	entry = ei_symbol_table_lookup(tab, name, ei_string_hash(name), eiFALSE);
+
+	if (entry == NULL)
+	{
+		return tab->null;
+	}
+
+	return entry->data;
+}
+
+void *ei_symbol_table_find_interned(eiSymbolTable *tab, const char *name)
+{
+	eiSymbolEntry	*entry;
 
-	/* lookup and convert to unique string */
-	unique_name = ei_string_table_lookup(&tab->string_table, name);
+	entry = ei_symbol_table_lookup(tab, name, ei_interned_string_hash(name), eiTRUE);
 
-	if (unique_name == NULL)
+	if (entry == NULL)
 	{
-		return tab->symbol_map.null;
+		return tab->null;
 	}
 
-	/* lookup the data by unique string in symbol map */
-	return ei_symbol_map_find(&tab->symbol_map, unique_name);
+	return entry->data;
 }
 
 void ei_symbol_table_remove(eiSymbolTable *tab, const char *name)
 {
-	const char	*unique_name;
+	eiSymbolEntry	*entry;
 
-	/* lookup and convert to unique string */
-	unique_name = ei_string_table_lookup(&tab->string_table, name);
+	entry = ei_symbol_table_lookup(tab, name, ei_string_hash(name), eiFALSE);
 
-	if (unique_name == NULL)
+	if (entry == NULL)
 	{
 		return;
 	}
 
-	/* remove from symbol map */
-	ei_symbol_map_erase(&tab->symbol_map, unique_name);
-
-	/* remove from string table */
-	ei_string_table_unconvert(&tab->string_table, name);
+	/* mark as deleted to keep the probing sequences of other 
+	   symbols, the string is freed when no table references it */
+	ei_release_string(entry->name);
+	entry->name = g_DeletedSymbol;
+	entry->data = NULL;
+	-- tab->size;
+	++ tab->num_deleted;
 }
@@ -29,6 +29,41 @@
 extern "C" {
 #endif
 
+/** \brief Initialize the global pool of interned strings, called 
+ * by ei_core_init, calls can be nested. */
+eiCORE_API void ei_string_pool_init();
+/** \brief Cleanup the global pool of interned strings, all interned 
+ * strings become invalid when the outermost call returns. */
+eiCORE_API void ei_string_pool_exit();
+
+/** \brief Intern a string into the global pool, equal strings are 
+ * always converted to the same address, so interned strings can be 
+ * compared by pointers. interned strings are reference counted, each 
+ * call must be paired with ei_release_string. this function is 
+ * thread-safe. */
+eiCORE_API const char *ei_intern_string(const char *str);
+/** \brief Release a reference to an interned string, the string is 
+ * removed from the pool and freed when the last reference is released. 
+ * this function is thread-safe. */
+eiCORE_API void ei_release_string(const char *str);
+/** \brief Get the number of strings in the global pool. */
+eiCORE_API eiUint ei_string_pool_size();
+/** \brief Compute the hash value of a native string. */
+eiCORE_API eiUint ei_string_hash(const char *str);
+
+/** \brief Get the hash value cached in front of an interned string, 
+ * the same as ei_string_hash. */
+eiFORCEINLINE eiUint ei_interned_string_hash(const char *str)
+{
+	return ((const eiUint *)str)[-2];
+}
+
+/** \brief Get the length cached in front of an interned string. */
+eiFORCEINLINE eiUint ei_interned_string_length(const char *str)
+{
+	return ((const eiUint *)str)[-1];
+}
+
 /** \brief A string table for converting all strings 
  * into unique addresses. this class is not thread-safe, 
  * users must ensure this from outside */
@@ -73,12 +108,27 @@ eiCORE_API void *ei_symbol_map_find(eiSymbolMap *map, const char *name);
 /** \brief Delete a symbol by its name. */
 eiCORE_API void ei_symbol_map_erase(eiSymbolMap *map, const char *name);
 
-/** \brief A symbol table for mapping unique string to a data. 
- * this class is not thread-safe, users must ensure this from outside. */
+/** \brief An entry of symbol table. */
+typedef struct eiSymbolEntry {
+	/* the interned name, NULL for empty entries */
+	const char		*name;
+	/* this can be a tag or a user pointer */
+	void			*data;
+} eiSymbolEntry;
+
+/** \brief A symbol table for mapping unique string to a data, 
+ * implemented as an open-addressing hash map keyed by interned 
+ * strings. concurrent lookups are safe, modifications are not 
+ * thread-safe, users must ensure this from outside. */
 typedef struct eiSymbolTable {
-	/* the string table for converting all strings to unique strings */
-	eiStringTable	string_table;
-	eiSymbolMap		symbol_map;
+	eiSymbolEntry	*entries;
+	/* the number of entries, always a power of 2 or 0 */
+	eiUint			capacity;
+	/* the number of symbols in the table */
+	eiUint			size;
+	/* the number of entries marked as deleted */
+	eiUint			num_deleted;
+	void			*null;
 } eiSymbolTable;
 
 /** \brief Initialize the symbol table.
@@ -87,6 +137,9 @@ typedef struct eiSymbolTable {
 eiCORE_API void ei_symbol_table_init(eiSymbolTable *tab, void * const null);
 /** \brief Cleanup the symbol table. */
 eiCORE_API void ei_symbol_table_exit(eiSymbolTable *tab);
+/** \brief Reserve space for a number of symbols to avoid growing 
+ * the table while adding them. */
+eiCORE_API void ei_symbol_table_reserve(eiSymbolTable *tab, const eiUint count);
 
 /** \brief Insert a symbol into the table.
  * @param name The name of the symbol
@@ -95,6 +148,9 @@ eiCORE_API void ei_symbol_table_exit(eiSymbolTable *tab);
 eiCORE_API void ei_symbol_table_add(eiSymbolTable *tab, const char *name, void * const data);
 /** \brief Lookup a symbol by its name and returns its data. */
 eiCORE_API void *ei_symbol_table_find(eiSymbolTable *tab, const char *name);
+/** \brief Lookup a symbol by a name returned by ei_intern_string, 
+ * which only compares pointers. */
+eiCORE_API void *ei_symbol_table_find_interned(eiSymbolTable *tab, const char *name);
 /** \brief Delete a symbol by its name. */
 eiCORE_API void ei_symbol_table_remove(eiSymbolTable *tab, const char *name);
 
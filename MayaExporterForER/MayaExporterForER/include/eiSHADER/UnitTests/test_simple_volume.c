@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \brief Tests of simple_volume marching with the occupancy grid,
+ * the images must match the ones rendered by marching with fixed
+ * steps within the error of adaptive stepping and sampling.
+ * \file test_simple_volume.c
+ */
+
+#include <eiAPI/UnitTests/ei_render_test.h>
+
+#define TEST_WIDTH				80
+#define TEST_HEIGHT				60
+#define TEST_GRID_RES			16
+/* homogeneous cells are marched with 4 times larger steps */
+#define TEST_MARCH_TOLERANCE	0.05f
+/* the relative error of the image average by ratio tracking */
+#define TEST_RATIO_TOLERANCE	0.05f
+
+static void render_volume(eiTestImage *image, const eiInt grid_res, const eiBool ratio_tracking)
+{
+	ei_test_image_init(image, "color", TEST_WIDTH, TEST_HEIGHT);
+
+	ei_test_load_scene("simple_volume.ess");
+
+	ei_shader("volume_shader");
+		ei_shader_param_int("grid_res", grid_res);
+		ei_shader_param_bool("ratio_tracking", ratio_tracking);
+	ei_end_shader();
+
+	ei_test_render(image);
+
+	ei_test_unload_scene();
+}
+
+/** \brief Skipping empty cells and larger steps in homogeneous
+ * cells must not change the image beyond the stepping error. */
+static void test_adaptive_marching()
+{
+	eiTestImage		fixed;
+	eiTestImage		adaptive;
+
+	render_volume(&fixed, 0, eiFALSE);
+	render_volume(&adaptive, TEST_GRID_RES, eiFALSE);
+
+	eiCHECK(fixed.pixels != NULL);
+	eiCHECK(ei_test_image_average(&fixed) > 0.0f);
+	eiCHECK(ei_test_image_max_difference(&fixed, &adaptive) <= TEST_MARCH_TOLERANCE);
+
+	ei_test_image_exit(&adaptive);
+	ei_test_image_exit(&fixed);
+}
+
+/** \brief Ratio tracking is unbiased, the shadows it estimates
+ * must brighten or darken the image only by sampling noise, which
+ * averages out over the image. */
+static void test_ratio_tracking()
+{
+	eiTestImage		marched;
+	eiTestImage		tracked;
+	eiScalar		marched_average;
+	eiScalar		tracked_average;
+
+	render_volume(&marched, TEST_GRID_RES, eiFALSE);
+	render_volume(&tracked, TEST_GRID_RES, eiTRUE);
+
+	marched_average = ei_test_image_average(&marched);
+	tracked_average = ei_test_image_average(&tracked);
+
+	eiCHECK(marched_average > 0.0f);
+	eiCHECK(tracked_average == tracked_average);
+	eiCHECK(fabs(tracked_average - marched_average) <= TEST_RATIO_TOLERANCE * marched_average);
+
+	ei_test_image_exit(&tracked);
+	ei_test_image_exit(&marched);
+}
+
+int main(int argc, char *argv[])
+{
+	eiRUN_TEST(test_adaptive_marching());
+	eiRUN_TEST(test_ratio_tracking());
+
+	return eiTEST_RESULT();
+}
@@ -301,4 +301,20 @@ DISPLACEMENT(simple_displace)
 		P() = P() + dist * noise(P());
 	}
 
+	eiBool main_batch(eiDisplaceBatch * const batch)
+	{
+		scalar dist = disp_dist();
+
+		for (eiUint i = 0; i < batch->count; ++i)
+		{
+			scalar offset = dist * noise(point(batch->Px[i], batch->Py[i], batch->Pz[i]));
+
+			batch->Px[i] += offset;
+			batch->Py[i] += offset;
+			batch->Pz[i] += offset;
+		}
+
+		return eiTRUE;
+	}
+
 END(simple_displace)
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2010 elvish render Team
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <eiAPI/ei_shaderx.h>
+
+/* shows a quantity of the hit as color, for checking intersections:
+   0 for the position, 1 for the distance along the ray, 2 for the
+   shading normal */
+SURFACE(state_color)
+
+	PARAM(int, channel);
+
+	void parameters(int pid)
+	{
+		DECLARE_INT(channel, 0);
+	}
+
+	void init()
+	{
+	}
+
+	void exit()
+	{
+	}
+
+	void main()
+	{
+		switch (channel())
+		{
+		case 1:
+			Ci() = color(get_state()->hit_t);
+			break;
+
+		case 2:
+			Ci() = color(N().x, N().y, N().z);
+			break;
+
+		default:
+			Ci() = color(P().x, P().y, P().z);
+			break;
+		}
+
+		Oi() = color(1.0f);
+	}
+
+END(state_color)
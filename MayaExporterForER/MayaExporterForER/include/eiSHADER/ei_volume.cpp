@@ -14,6 +14,7 @@
  */
 
 #include <eiAPI/ei_shaderx.h>
+#include <eiCORE/ei_atomic_ops.h>
 
 SURFACE(volume_shell)
 
@@ -56,6 +57,32 @@ SHADOW(shadowvol_shell)
 
 END(shadowvol_shell)
 
+/* the upper bound of turbulence, 5 octaves of noise in [0, 1] */
+#define VOLUME_TURBULENCE_MAX		1.9375f
+/* the number of density samples along each axis of a grid cell */
+#define VOLUME_GRID_SAMPLES			3
+/* grid cells whose density varies less than this are homogeneous */
+#define VOLUME_HOMOGENEOUS_RANGE	0.05f
+/* the step size is scaled by this in homogeneous grid cells */
+#define VOLUME_HOMOGENEOUS_STEP		4.0f
+
+/** \brief A coarse grid of density bounds in the local space of 
+ * the density function, cells with non-positive majorant are empty. */
+struct VolumeGrid {
+	/* the parameters the grid was built for */
+	scalar		radius;
+	eiVector	offset;
+	int			res;
+	/* the grid covers [-extent, extent] on each axis */
+	scalar		extent;
+	scalar		cell_size;
+	/* the analytic upper bound of density in each cell */
+	scalar		*majorant;
+	/* the scale of step size in each cell */
+	scalar		*step_scale;
+	VolumeGrid	*next;
+};
+
 VOLUME(simple_volume)
 
 	PARAM(color, vol_color);
@@ -65,6 +92,8 @@ VOLUME(simple_volume)
 	PARAM(vector, vol_offset);
 	PARAM(scalar, absorption);
 	PARAM(scalar, anisotropic);
+	PARAM(int, grid_res);
+	PARAM(eiBool, ratio_tracking);
 
 	void parameters(int pid)
 	{
@@ -75,6 +104,13 @@ VOLUME(simple_volume)
 		DECLARE_VECTOR(vol_offset, 0.0f, 0.0f, 0.0f);
 		DECLARE_SCALAR(absorption, 0.3f);
 		DECLARE_SCALAR(anisotropic, 0.4f);
+		/* the resolution of the occupancy grid for skipping empty 
+		   space and adaptive stepping, 0 for marching with fixed 
+		   steps */
+		DECLARE_INT(grid_res, 0);
+		/* estimate transmittance of shadow rays by ratio tracking 
+		   against the grid majorants instead of marching */
+		DECLARE_BOOL(ratio_tracking, eiFALSE);
 	}
 
 	scalar turbulence(const point & p)
@@ -96,6 +132,14 @@ VOLUME(simple_volume)
 		return turbulence(p) + (1.0f - length(p / radius));
 	}
 
+	/** \brief The density clamped to zero for marching with the grid, 
+	 * which skips the cells where the density cannot be positive, 
+	 * marching with fixed steps keeps the unclamped density. */
+	scalar gridDensity(const point & p, const scalar radius)
+	{
+		return MAX(0.0f, noiseDensity(p, radius));
+	}
+
 	scalar phaseSchlick(const vector & w, const vector & wp, const scalar k)
 	{
 		scalar kcostheta = k * (w % wp);
@@ -139,12 +183,321 @@ VOLUME(simple_volume)
 		return light_color;
 	}
 
+	/** \brief Build the grid, the majorant of each cell is the 
+	 * analytic upper bound of the density in the cell, so that it 
+	 * bounds the density everywhere for ratio tracking, cells where 
+	 * the bound is not positive are empty. the density is sampled 
+	 * only to detect homogeneous cells for adaptive stepping. */
+	VolumeGrid *buildGrid(const scalar radius, const vector & offset, const int res)
+	{
+		VolumeGrid	*grid;
+
+		grid = (VolumeGrid *)ei_allocate(sizeof(VolumeGrid));
+		grid->radius = radius;
+		grid->offset = offset;
+		grid->res = res;
+		grid->extent = (1.0f + VOLUME_TURBULENCE_MAX) * radius;
+		grid->cell_size = 2.0f * grid->extent / (scalar)res;
+		grid->majorant = (scalar *)ei_allocate(sizeof(scalar) * res * res * res);
+		grid->step_scale = (scalar *)ei_allocate(sizeof(scalar) * res * res * res);
+		grid->next = NULL;
+
+		for (int k = 0; k < res; ++k)
+		{
+			for (int j = 0; j < res; ++j)
+			{
+				for (int i = 0; i < res; ++i)
+				{
+					point	lo = point(
+						-grid->extent + (scalar)i * grid->cell_size, 
+						-grid->extent + (scalar)j * grid->cell_size, 
+						-grid->extent + (scalar)k * grid->cell_size);
+					point	hi = lo + vector(grid->cell_size);
+					/* the nearest point of the cell to the center */
+					point	nearest = point(
+						clamp(0.0f, lo.x, hi.x), 
+						clamp(0.0f, lo.y, hi.y), 
+						clamp(0.0f, lo.z, hi.z));
+					scalar	upper = VOLUME_TURBULENCE_MAX + 1.0f - length(nearest) / radius;
+					int		index = (k * res + j) * res + i;
+
+					grid->majorant[index] = 0.0f;
+					grid->step_scale[index] = 1.0f;
+
+					if (upper <= 0.0f)
+					{
+						continue;
+					}
+
+					scalar	rho_max = -eiMAX_SCALAR;
+					scalar	rho_min = eiMAX_SCALAR;
+
+					grid->majorant[index] = upper;
+
+					for (int c = 0; c < VOLUME_GRID_SAMPLES; ++c)
+					{
+						for (int b = 0; b < VOLUME_GRID_SAMPLES; ++b)
+						{
+							for (int a = 0; a < VOLUME_GRID_SAMPLES; ++a)
+							{
+								vector	f = vector((scalar)a, (scalar)b, (scalar)c) * 
+									(grid->cell_size / (scalar)(VOLUME_GRID_SAMPLES - 1));
+								scalar	rho = turbulence(lo + f) + (1.0f - length((lo + f) / radius));
+
+								rho_max = MAX(rho_max, rho);
+								rho_min = MIN(rho_min, rho);
+							}
+						}
+					}
+
+					if (rho_max - rho_min < VOLUME_HOMOGENEOUS_RANGE)
+					{
+						grid->step_scale[index] = VOLUME_HOMOGENEOUS_STEP;
+					}
+				}
+			}
+		}
+
+		return grid;
+	}
+
+	/** \brief Get the grid for the density parameters, built on 
+	 * first use and shared by all shader instances using the same 
+	 * parameters. */
+	VolumeGrid *getGrid(const scalar radius, const vector & offset, const int res)
+	{
+		VolumeGrid	*grid;
+
+		grid = m_grids;
+		/* pairs with the write barrier before publishing, so that a 
+		   published grid is read completely built */
+		ei_read_barrier();
+
+		for (; grid != NULL; grid = grid->next)
+		{
+			if (grid->radius == radius && grid->res == res && 
+				grid->offset.x == offset.x && grid->offset.y == offset.y && grid->offset.z == offset.z)
+			{
+				return grid;
+			}
+		}
+
+		ei_lock(&m_grids_lock);
+
+		/* check again in case another thread has built it */
+		for (grid = m_grids; grid != NULL; grid = grid->next)
+		{
+			if (grid->radius == radius && grid->res == res && 
+				grid->offset.x == offset.x && grid->offset.y == offset.y && grid->offset.z == offset.z)
+			{
+				break;
+			}
+		}
+
+		if (grid == NULL)
+		{
+			grid = buildGrid(radius, offset, res);
+			grid->next = m_grids;
+			/* publish the grid after it has been completely built */
+			ei_write_barrier();
+			m_grids = grid;
+		}
+
+		ei_unlock(&m_grids_lock);
+
+		return grid;
+	}
+
+	/** \brief Find the grid cell containing a point, returns -1 if 
+	 * the point is outside the grid. also returns the distance along 
+	 * the direction to exit the cell, or to enter the grid. */
+	int findCell(VolumeGrid *grid, const point & q, const vector & dq, scalar & t_exit)
+	{
+		scalar	inv_cell = 1.0f / grid->cell_size;
+		int		i = int(floorf((q.x + grid->extent) * inv_cell));
+		int		j = int(floorf((q.y + grid->extent) * inv_cell));
+		int		k = int(floorf((q.z + grid->extent) * inv_cell));
+		point	lo, hi;
+		int		cell;
+
+		if (i < 0 || j < 0 || k < 0 || i >= grid->res || j >= grid->res || k >= grid->res)
+		{
+			lo = point(-grid->extent);
+			hi = point(grid->extent);
+			cell = -1;
+		}
+		else
+		{
+			lo = point(
+				-grid->extent + (scalar)i * grid->cell_size, 
+				-grid->extent + (scalar)j * grid->cell_size, 
+				-grid->extent + (scalar)k * grid->cell_size);
+			hi = lo + vector(grid->cell_size);
+			cell = (k * grid->res + j) * grid->res + i;
+		}
+
+		scalar	t_near = 0.0f;
+		scalar	t_far = eiMAX_SCALAR;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (absf(dq.comp[axis]) < eiSCALAR_EPS)
+			{
+				if (q.comp[axis] < lo.comp[axis] || q.comp[axis] > hi.comp[axis])
+				{
+					t_far = -1.0f;
+				}
+				continue;
+			}
+
+			scalar	t0 = (lo.comp[axis] - q.comp[axis]) / dq.comp[axis];
+			scalar	t1 = (hi.comp[axis] - q.comp[axis]) / dq.comp[axis];
+
+			t_near = MAX(t_near, MIN(t0, t1));
+			t_far = MIN(t_far, MAX(t0, t1));
+		}
+
+		if (cell >= 0)
+		{
+			/* the point may be slightly outside the cell due to 
+			   rounding errors */
+			t_exit = MAX(0.0f, t_far);
+		}
+		else
+		{
+			/* skip to the grid, or to the end if the ray misses it */
+			t_exit = (t_near <= t_far) ? t_near : eiMAX_SCALAR;
+		}
+
+		return cell;
+	}
+
+	/** \brief March through non-empty cells of the grid, with larger 
+	 * steps in homogeneous cells. */
+	void marchAdaptive(VolumeGrid *grid, const matrix & cameraToLocal, const vector & offset, const scalar radius)
+	{
+		scalar	len = length(I());
+		vector	dir = normalize(I());
+		point	origin = P() - I();
+		point	q0 = origin * cameraToLocal + offset;
+		vector	dq = dir * cameraToLocal;
+		scalar	sigma = absorption();
+		/* ensure progress when exiting cells */
+		scalar	nudge = 1.0e-4f * step_size();
+		scalar	T = 1.0f;
+		scalar	t = 0.0f;
+
+		if (get_state()->type == eiRAY_SHADOW)
+		{
+			while (t < len && T >= eiSCALAR_EPS)
+			{
+				scalar	t_exit;
+				int		cell = findCell(grid, q0 + dq * t, dq, t_exit);
+
+				t_exit = MIN(len, t + t_exit);
+
+				if (cell < 0 || grid->majorant[cell] <= 0.0f || sigma <= 0.0f)
+				{
+					t = t_exit + nudge;
+					continue;
+				}
+
+				if (ratio_tracking())
+				{
+					scalar	mu = sigma * grid->majorant[cell];
+
+					for (;;)
+					{
+						t -= logf(1.0f - (scalar)random()) / mu;
+
+						if (t >= t_exit)
+						{
+							break;
+						}
+
+						/* the majorant bounds the density, so the ratio is 
+						   never negative */
+						T *= 1.0f - sigma * gridDensity(q0 + dq * t, radius) / mu;
+					}
+
+					t = t_exit + nudge;
+				}
+				else
+				{
+					scalar	ds = MIN(step_size() * grid->step_scale[cell], len - t);
+
+					T *= expf(-sigma * ds * gridDensity(q0 + dq * (t + 0.5f * ds), radius));
+					t += ds;
+				}
+			}
+
+			Cl() *= T;
+		}
+		else
+		{
+			color adjustedColor = vol_color() * vol_density();
+			scalar k = anisotropic();
+
+			color C = color(0.0f);
+			scalar O = 0.0f;
+
+			while (t < len)
+			{
+				scalar	t_exit;
+				int		cell = findCell(grid, q0 + dq * t, dq, t_exit);
+
+				t_exit = MIN(len, t + t_exit);
+
+				if (cell < 0 || grid->majorant[cell] <= 0.0f)
+				{
+					t = t_exit + nudge;
+					continue;
+				}
+
+				scalar	ds = MIN(step_size() * grid->step_scale[cell], len - t);
+
+				P() = origin + dir * (t + 0.5f * ds);
+
+				scalar rho = gridDensity(q0 + dq * (t + 0.5f * ds), radius);
+				scalar Ti = expf(-sigma * ds * rho);
+				T *= Ti;
+				if (T < eiSCALAR_EPS)
+				{
+					break;
+				}
+
+				if (rho > 0.0f)
+				{
+					color ci = T * computeLighting(-dir, k) * adjustedColor * rho * ds;
+					C += ci;
+					O += (1 - Ti) * (1 - O);
+				}
+				t += ds;
+			}
+
+			Ci() = C;
+			Oi() = O;
+		}
+	}
+
 	void init()
 	{
+		m_grids = NULL;
+		ei_create_lock(&m_grids_lock);
 	}
 
 	void exit()
 	{
+		while (m_grids != NULL)
+		{
+			VolumeGrid	*grid = m_grids;
+
+			m_grids = grid->next;
+			eiCHECK_FREE(grid->majorant);
+			eiCHECK_FREE(grid->step_scale);
+			eiCHECK_FREE(grid);
+		}
+		ei_delete_lock(&m_grids_lock);
 	}
 
 	void main()
@@ -153,6 +506,12 @@ VOLUME(simple_volume)
 		vector offset = vol_offset();
 		matrix cameraToLocal = to_object();
 
+		if (grid_res() > 0)
+		{
+			marchAdaptive(getGrid(radius, offset, grid_res()), cameraToLocal, offset, radius);
+			return;
+		}
+
 		int numsteps = MAX(1, int(ceilf(length(I()) / step_size())));
 		scalar ds = length(I()) / (scalar)numsteps;
 		vector stepdir = normalize(I()) * ds;
@@ -208,4 +567,9 @@ VOLUME(simple_volume)
 		}
 	}
 
+	/* the grids built for different parameters, never removed 
+	   before the shader exits */
+	VolumeGrid * volatile	m_grids;
+	eiLock					m_grids_lock;
+
 END(simple_volume)